@@ -0,0 +1,59 @@
+#include "background_model.hpp"
+
+BackgroundModel::BackgroundModel(uint8_t shift, uint8_t sigma, int16_t min_deviation) : shift(shift),
+                                                                                        sigmaSquared(sigma * sigma),
+                                                                                        minDeviation(min_deviation),
+                                                                                        mean(),
+                                                                                        variance(),
+                                                                                        frames(0)
+{
+}
+
+uint64_t BackgroundModel::update(const int16_t *frame)
+{
+    // While training, the rate is about 1 / frames so the model is a plain average of what it has seen so far
+    const bool trained = frames >= (1u << shift);
+    const uint8_t rate = trained ? shift : 31 - __builtin_clz(frames + 1);
+
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BACKGROUND_MODEL_PIXELS; i++)
+    {
+        const int32_t deviation = ((int32_t) frame[i] << 8) - mean[i];
+        const auto deviation_squared = (int64_t) (((int64_t) deviation * deviation) >> 8);
+
+        const bool flagged = trained &&
+                             (deviation > minDeviation << 8 || deviation < -(minDeviation << 8)) &&
+                             deviation_squared > (int64_t) sigmaSquared * variance[i];
+        if (frames == 0)
+        {
+            // The first frame seeds the average. Measured against the empty model, the variance would start at the
+            // pixel value squared and take far longer than the training to come down
+            mean[i] = (int32_t) frame[i] << 8;
+            variance[i] = 0;
+        }
+        else if (flagged)
+        {
+            // The variance stays that of the background, otherwise a heat source would hide itself in a few frames
+            mean[i] += deviation >> (rate + BACKGROUND_MODEL_FOREGROUND_SHIFT);
+        }
+        else
+        {
+            mean[i] += deviation >> rate;
+            const int64_t new_variance = variance[i] + ((deviation_squared - variance[i]) >> rate);
+            variance[i] = new_variance < 0 ? 0 : (uint32_t) new_variance;
+        }
+
+        mask |= (uint64_t) flagged << i;
+    }
+
+    if (!trained)
+    {
+        frames++;
+    }
+    return mask;
+}
+
+void BackgroundModel::reset()
+{
+    frames = 0;
+}
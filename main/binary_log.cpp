@@ -0,0 +1,23 @@
+#include "binary_log.hpp"
+
+#include <cstring>
+
+size_t encodeBinaryLogRecord(const LogRecord &record, uint8_t *buffer, size_t size)
+{
+    const size_t payload_length = record.messageLength > UINT8_MAX ? UINT8_MAX : record.messageLength;
+    if (size < BINARY_LOG_RECORD_HEADER_SIZE + payload_length)
+    {
+        return 0;
+    }
+
+    const uint32_t site = record.site != 0 ? record.site : logSiteId(record.file, record.line);
+    buffer[0] = site & 0xFF;
+    buffer[1] = (site >> 8) & 0xFF;
+    buffer[2] = (site >> 16) & 0xFF;
+    buffer[3] = (site >> 24) & 0xFF;
+    buffer[4] = record.level;
+    buffer[5] = payload_length;
+    memcpy(&buffer[BINARY_LOG_RECORD_HEADER_SIZE], record.message, payload_length);
+
+    return BINARY_LOG_RECORD_HEADER_SIZE + payload_length;
+}
@@ -0,0 +1,157 @@
+#include "boot.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "log_buffer.hpp"
+#include "system.hpp"
+
+struct BootRecord
+{
+    const char *name;
+    int64_t start;
+    /**
+     * 0 until the phase is over
+     */
+    std::atomic<int64_t> end;
+    BaseType_t core;
+};
+
+static BootRecord bootRecords[BOOT_PROFILE_RECORDS];
+static std::atomic<size_t> bootRecordCount = 0;
+static size_t loggedBootRecords = 0;
+
+/**
+ * @return The index of the new record, or BOOT_PROFILE_RECORDS if there is no room left
+ */
+static size_t addBootRecord(const char *name, int64_t start)
+{
+    const size_t index = bootRecordCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= BOOT_PROFILE_RECORDS)
+    {
+        bootRecordCount.store(BOOT_PROFILE_RECORDS, std::memory_order_relaxed);
+        return BOOT_PROFILE_RECORDS;
+    }
+    bootRecords[index].name = name;
+    bootRecords[index].start = start;
+    bootRecords[index].core = xPortGetCoreID();
+    return index;
+}
+
+BootPhase::BootPhase(const char *name) : index(addBootRecord(name, esp_timer_get_time()))
+{
+}
+
+BootPhase::~BootPhase()
+{
+    if (index < BOOT_PROFILE_RECORDS)
+    {
+        bootRecords[index].end.store(esp_timer_get_time(), std::memory_order_release);
+    }
+}
+
+void markBootEvent(const char *name)
+{
+    const int64_t now = esp_timer_get_time();
+    const size_t index = addBootRecord(name, now);
+    if (index < BOOT_PROFILE_RECORDS)
+    {
+        bootRecords[index].end.store(now, std::memory_order_release);
+    }
+}
+
+void logBootProfile()
+{
+    const size_t count = bootRecordCount.load(std::memory_order_relaxed);
+    // Stop at a phase that is still running, so records are logged in order and only once
+    while (loggedBootRecords < count)
+    {
+        const BootRecord &record = bootRecords[loggedBootRecords];
+        const int64_t end = record.end.load(std::memory_order_acquire);
+        if (end == 0)
+        {
+            break;
+        }
+
+        char message[LOG_RECORD_MESSAGE_SIZE];
+        if (end == record.start)
+        {
+            snprintf(message, sizeof(message), "Boot: %s at %.1f ms", record.name, (double) record.start / 1000);
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "Boot: %s took %.1f ms, from %.1f ms on core %d", record.name,
+                     (double) (end - record.start) / 1000, (double) record.start / 1000, (int) record.core);
+        }
+        LOG(LOGLEVEL_INFO, message);
+        loggedBootRecords++;
+    }
+}
+
+InitScheduler::InitScheduler() : steps(),
+                                 stepCount(0),
+                                 done(nullptr)
+{
+}
+
+InitStep InitScheduler::add(const char *name, InitFunction function, void *context, InitStep dependencies)
+{
+    if (stepCount >= BOOT_MAX_STEPS)
+    {
+        ESP_LOGE("boot", "Too many boot steps, %s runs right away", name);
+        BootPhase phase(name);
+        function(context);
+        return 0;
+    }
+
+    const InitStep step = (InitStep) 1 << stepCount;
+    if ((dependencies & ~(step - 1)) != 0)
+    {
+        ESP_LOGE("boot", "%s depends on a step added after it", name);
+        dependencies &= step - 1;
+    }
+    steps[stepCount] = {name, function, context, dependencies, step, this};
+    stepCount++;
+    return step;
+}
+
+void InitScheduler::start()
+{
+    done = xEventGroupCreate();
+    for (size_t i = 0; i < stepCount; i++)
+    {
+        xTaskCreate(stepThread,
+                    steps[i].name,
+                    BOOT_STEP_STACK_SIZE,
+                    &steps[i],
+                    BOOT_STEP_PRIORITY,
+                    nullptr);
+    }
+}
+
+void InitScheduler::wait()
+{
+    if (stepCount > 0)
+    {
+        const InitStep all = ((InitStep) 1 << stepCount) - 1;
+        xEventGroupWaitBits(done, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+}
+
+void InitScheduler::stepThread(void *arg)
+{
+    const Step *step = (Step *) arg;
+    if (step->dependencies != 0)
+    {
+        xEventGroupWaitBits(step->scheduler->done, step->dependencies, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    {
+        BootPhase phase(step->name);
+        step->function(step->context);
+    }
+    xEventGroupSetBits(step->scheduler->done, step->step);
+    vTaskDelete(nullptr);
+}
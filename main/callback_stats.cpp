@@ -0,0 +1,200 @@
+#include "callback_stats.hpp"
+
+#include <cstdio>
+#include <esp_timer.h>
+
+#define CALLBACK_STATS_OVERHEAD_ROUNDS 1000
+
+static std::atomic<CallbackStats *> callbackStatsHead = nullptr;
+/**
+ * When the executor running on this task last woke up with work. Only the low 32 bits of the us timer are kept,
+ * differences are still right across the wrap
+ */
+static thread_local uint32_t executorWakeTime = 0;
+
+static inline uint32_t now()
+{
+    return (uint32_t) esp_timer_get_time();
+}
+
+CallbackHistogram::CallbackHistogram() : buckets(),
+                                         count(0),
+                                         max(0)
+{
+}
+
+void CallbackHistogram::add(int64_t time)
+{
+    // Only the callback's own executor task writes, so there is no need for read-modify-write atomics
+    const size_t bucket = callbackStatsBucket(time);
+    buckets[bucket].store(buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (time > max.load(std::memory_order_relaxed))
+    {
+        max.store((uint32_t) time, std::memory_order_relaxed);
+    }
+}
+
+uint32_t CallbackHistogram::getCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+uint32_t CallbackHistogram::getBucket(size_t bucket) const
+{
+    return buckets[bucket].load(std::memory_order_relaxed);
+}
+
+uint32_t CallbackHistogram::getMax() const
+{
+    return max.load(std::memory_order_relaxed);
+}
+
+uint32_t CallbackHistogram::getPercentile(uint32_t percent) const
+{
+    const uint32_t total = getCount();
+    if (total == 0)
+    {
+        return 0;
+    }
+    // The rank of the percentile, rounded up so 100 percent is the last time
+    const uint64_t rank = ((uint64_t) total * percent + 99) / 100;
+    const uint32_t longest = getMax();
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < CALLBACK_STATS_BUCKETS - 1; bucket++)
+    {
+        seen += getBucket(bucket);
+        if (seen >= rank)
+        {
+            const uint32_t upper_bound = 1UL << bucket;
+            return upper_bound < longest ? upper_bound : longest;
+        }
+    }
+    return longest;
+}
+
+size_t CallbackHistogram::format(char *buffer, size_t size) const
+{
+    size_t length = 0;
+    for (size_t bucket = 0; bucket < CALLBACK_STATS_BUCKETS && length < size; bucket++)
+    {
+        const uint32_t bucket_count = getBucket(bucket);
+        if (bucket_count == 0)
+        {
+            continue;
+        }
+        const int written = bucket == CALLBACK_STATS_BUCKETS - 1 ?
+                            snprintf(buffer + length, size - length, " inf:%lu", (unsigned long) bucket_count) :
+                            snprintf(buffer + length, size - length, " %lu:%lu",
+                                     (unsigned long) (1UL << bucket), (unsigned long) bucket_count);
+        if (written < 0)
+        {
+            break;
+        }
+        length += (size_t) written;
+    }
+    return length < size ? length : size - 1;
+}
+
+CallbackStats::CallbackStats(const char *name, bool registered) : name(name),
+                                                                  execution(),
+                                                                  queueing(),
+                                                                  next(callbackStatsHead.load(std::memory_order_relaxed))
+{
+    if (!registered)
+    {
+        next = nullptr;
+        return;
+    }
+    while (!callbackStatsHead.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+CallbackTimer::CallbackTimer(CallbackStats *stats) : stats(stats),
+                                                     start(now()),
+                                                     activity(stats->name)
+{
+    stats->queueing.add(start - executorWakeTime);
+}
+
+CallbackTimer::CallbackTimer(CallbackStats *stats, const rcl_timer_t *timer) : stats(stats),
+                                                                               start(now()),
+                                                                               activity(stats->name)
+{
+    // The timer's next call has already been moved forward by one period when the callback runs
+    int64_t period;
+    int64_t time_until_next_call;
+    if (rcl_timer_get_period(timer, &period) == RCL_RET_OK &&
+        rcl_timer_get_time_until_next_call(timer, &time_until_next_call) == RCL_RET_OK)
+    {
+        const int64_t late = (period - time_until_next_call) / 1000;
+        stats->queueing.add(late > 0 ? late : 0);
+    }
+}
+
+CallbackTimer::~CallbackTimer()
+{
+    stats->execution.add(now() - start);
+}
+
+bool callbackStatsTrigger(rclc_executor_handle_t *handles, unsigned int size, void *obj)
+{
+    executorWakeTime = now();
+    return rclc_executor_trigger_any(handles, size, obj);
+}
+
+CallbackStats *getCallbackStats()
+{
+    return callbackStatsHead.load(std::memory_order_acquire);
+}
+
+uint32_t measureCallbackStatsOverhead()
+{
+    static CallbackStats overhead_stats("overhead", false);
+    const int64_t start = esp_timer_get_time();
+    for (size_t i = 0; i < CALLBACK_STATS_OVERHEAD_ROUNDS; i++)
+    {
+        CallbackTimer callback_timer(&overhead_stats);
+    }
+    return (uint32_t) ((esp_timer_get_time() - start) * 1000 / CALLBACK_STATS_OVERHEAD_ROUNDS);
+}
+
+size_t formatCallbackStats(char *buffer, size_t size)
+{
+    size_t length = 0;
+    for (CallbackStats *stats = getCallbackStats(); stats != nullptr && length + 1 < size; stats = stats->next)
+    {
+        int written = snprintf(buffer + length, size - length, "%s n=%lu p50=%luus p99=%luus max=%luus exec",
+                               stats->name,
+                               (unsigned long) stats->execution.getCount(),
+                               (unsigned long) stats->execution.getPercentile(50),
+                               (unsigned long) stats->execution.getPercentile(99),
+                               (unsigned long) stats->execution.getMax());
+        if (written < 0 || (size_t) written >= size - length)
+        {
+            return size - 1;
+        }
+        length += (size_t) written;
+        length += stats->execution.format(buffer + length, size - length);
+        if (length + 1 >= size)
+        {
+            return size - 1;
+        }
+
+        written = snprintf(buffer + length, size - length, " queue");
+        if (written < 0 || (size_t) written >= size - length)
+        {
+            return size - 1;
+        }
+        length += (size_t) written;
+        length += stats->queueing.format(buffer + length, size - length);
+        if (length + 1 >= size)
+        {
+            return size - 1;
+        }
+        buffer[length++] = '\n';
+        buffer[length] = '\0';
+    }
+    return length;
+}
@@ -0,0 +1,301 @@
+#include "diagnostics.hpp"
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <diagnostic_msgs/msg/diagnostic_array.h>
+
+#include "boot.hpp"
+#include "esp32_serial_transport.hpp"
+#include "i2c_bus.hpp"
+#include "link_budget.hpp"
+#include "pool_allocator.hpp"
+#include "recorder.hpp"
+#include "stall_monitor.hpp"
+#include "system.hpp"
+#include "task_stats.hpp"
+#include "time_sync.hpp"
+
+#define DIAGNOSTICS_STATUSES 6
+#define DIAGNOSTICS_MAX_VALUES (35 + TASK_STATS_MAX_TASKS)
+#define DIAGNOSTICS_KEY_SIZE 24
+#define DIAGNOSTICS_VALUE_SIZE 24
+/**
+ * Warn when the free heap has ever dropped below this many bytes
+ */
+#define DIAGNOSTICS_HEAP_WARNING 16384
+
+struct DiagnosticsValue
+{
+    char key[DIAGNOSTICS_KEY_SIZE];
+    char value[DIAGNOSTICS_VALUE_SIZE];
+};
+
+static rcl_timer_t diagnosticsTimer;
+static rcl_publisher_t diagnosticsPublisher;
+static diagnostic_msgs__msg__DiagnosticArray diagnosticsMessage;
+static diagnostic_msgs__msg__DiagnosticStatus statuses[DIAGNOSTICS_STATUSES];
+static diagnostic_msgs__msg__KeyValue keyValues[DIAGNOSTICS_MAX_VALUES];
+static DiagnosticsValue valueText[DIAGNOSTICS_MAX_VALUES];
+static size_t statusCount;
+static size_t valueCount;
+/**
+ * Handed out once every status is used, so an extra status can't write past the array. It is never published
+ */
+static diagnostic_msgs__msg__DiagnosticStatus overflowStatus;
+
+static TaskStatsAggregator taskStats;
+static TaskStatus_t taskStatus[TASK_STATS_MAX_TASKS];
+static TaskSample taskSamples[TASK_STATS_MAX_TASKS];
+static TaskUsage taskUsages[TASK_STATS_MAX_TASKS];
+
+static void setString(rosidl_runtime_c__String *string, const char *text)
+{
+    string->data = const_cast<char *>(text);
+    string->size = strlen(text);
+    string->capacity = string->size + 1;
+}
+
+static diagnostic_msgs__msg__DiagnosticStatus *addStatus(const char *name)
+{
+    if (statusCount >= DIAGNOSTICS_STATUSES)
+    {
+        return &overflowStatus;
+    }
+    diagnostic_msgs__msg__DiagnosticStatus *status = &statuses[statusCount++];
+    status->level = diagnostic_msgs__msg__DiagnosticStatus__OK;
+    setString(&status->name, name);
+    setString(&status->message, "");
+    setString(&status->hardware_id, "pcc");
+    status->values.data = &keyValues[valueCount];
+    status->values.size = 0;
+    status->values.capacity = DIAGNOSTICS_MAX_VALUES - valueCount;
+    return status;
+}
+
+__attribute__((format(printf, 3, 4)))
+static void addValue(diagnostic_msgs__msg__DiagnosticStatus *status, const char *key, const char *format, ...)
+{
+    if (valueCount >= DIAGNOSTICS_MAX_VALUES || status == &overflowStatus)
+    {
+        return;
+    }
+    DiagnosticsValue *text = &valueText[valueCount];
+    diagnostic_msgs__msg__KeyValue *key_value = &keyValues[valueCount++];
+
+    strncpy(text->key, key, sizeof(text->key) - 1);
+    text->key[sizeof(text->key) - 1] = '\0';
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text->value, sizeof(text->value), format, args);
+    va_end(args);
+
+    setString(&key_value->key, text->key);
+    setString(&key_value->value, text->value);
+    status->values.size++;
+}
+
+static void addHeapStatus()
+{
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: heap");
+    const size_t minimum_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    addValue(status, "free", "%zu", heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    addValue(status, "min_free", "%zu", minimum_free);
+    addValue(status, "largest_free_block", "%zu", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    if (minimum_free < DIAGNOSTICS_HEAP_WARNING)
+    {
+        status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+        setString(&status->message, "Low heap");
+    }
+}
+
+#if CONFIG_PCC_POOL_ALLOCATOR
+static void addAllocatorStatus()
+{
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: allocator");
+    for (size_t pool = 0; pool < POOL_ALLOCATOR_POOLS; pool++)
+    {
+        const PoolAllocatorStats stats = getPoolAllocatorStats(pool);
+        char key[DIAGNOSTICS_KEY_SIZE];
+        snprintf(key, sizeof(key), "pool_%" PRIu32, stats.blockSize);
+        addValue(status, key, "%" PRIu32 "/%" PRIu32 " max %" PRIu32 " full %" PRIu32,
+                 stats.used, stats.blocks, stats.peak, stats.exhausted);
+    }
+    addValue(status, "heap_allocations", "%" PRIu32, getPoolAllocatorHeapAllocations());
+    addValue(status, "heap_blocks", "%" PRIu32, getPoolAllocatorHeapBlocks());
+    if (getPoolAllocatorHeapBlocks() > 0)
+    {
+        status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+        setString(&status->message, "Pools too small");
+    }
+}
+#endif
+
+static void addLinkStatus()
+{
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: link");
+    Esp32SerialStats serial_stats;
+    esp32SerialGetStats(&serial_stats);
+    addValue(status, "baud_rate", "%" PRIu32, esp32SerialGetBaudRate());
+    addValue(status, "bytes_in", "%" PRIu32, serial_stats.bytesIn);
+    addValue(status, "bytes_out", "%" PRIu32, serial_stats.bytesOut);
+    addValue(status, "overruns", "%" PRIu32, serial_stats.overruns);
+    addValue(status, "blocked_write_ms", "%" PRId64, serial_stats.blockedWriteTime / 1000);
+    addValue(status, "reconnects", "%" PRIu32, getConnectionStats().reconnects);
+    addValue(status, "dropped_logs", "%" PRIu32, getDroppedLogs() + getRateLimitedEspLogs());
+    addValue(status, "time_synced", "%s", isTimeSynced() ? "true" : "false");
+    addValue(status, "clock_drift_ppb", "%" PRId64, getClockDrift());
+    addValue(status, "sync_error_us", "%" PRId64, getClockSyncError() / 1000);
+    addValue(status, "sync_outliers", "%" PRIu32, getClockSyncOutliers());
+#if CONFIG_PCC_RECORDING
+    addValue(status, "dropped_records", "%" PRIu32, getRecorderDropped());
+#endif
+#if CONFIG_PCC_LINK_BUDGET
+    static const char *const class_names[LINK_CLASSES] = {"budget_telemetry", "budget_log", "budget_bulk"};
+    addValue(status, "utilization_percent", "%.1f", getLinkUtilization());
+    for (size_t link_class = 0; link_class < LINK_CLASSES; link_class++)
+    {
+        const LinkClassStats stats = getLinkClassStats((LinkClass) link_class);
+        addValue(status, class_names[link_class], "%" PRIu32 "KiB %" PRIu32 " held %" PRIu32,
+                 stats.bytes / 1024, stats.messages, stats.held);
+    }
+#endif
+    if (serial_stats.overruns > 0)
+    {
+        status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+        setString(&status->message, "Serial overruns");
+    }
+}
+
+static void addI2cStatus()
+{
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: i2c");
+    addValue(status, "bus_recoveries", "%" PRIu32, getI2cRecoveries());
+    for (I2cDevice *device = getI2cDevices(); device != nullptr; device = device->getNext())
+    {
+        const I2cDeviceStats stats = device->getStats();
+        addValue(status, device->getName(), "%" PRIu32 " err %" PRIu32 "/%" PRIu32 "us",
+                 stats.errors, stats.averageLatency, stats.maxLatency);
+        if (stats.errors > 0)
+        {
+            status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+            setString(&status->message, "I2C errors");
+        }
+    }
+}
+
+#if CONFIG_PCC_STALL_MONITOR
+static void addStallStatus()
+{
+    static char message[2 * STALL_NAME_SIZE + 16];
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: stalls");
+    const StallReport report = getStallReport();
+    addValue(status, "stalls", "%" PRIu32, report.count);
+    addValue(status, "longest_ms", "%" PRIu32, report.duration);
+    addValue(status, "longest_at_ms", "%" PRIu32, report.uptime);
+    addValue(status, "previous_boot", "%s", hasPreviousStall() ? "stalled" : "ok");
+    if (report.count > 0)
+    {
+        status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+        snprintf(message, sizeof(message), "%s stalled in %s", report.task, report.activity);
+        setString(&status->message, message);
+    }
+}
+#endif
+
+static void addTaskStatus()
+{
+    diagnostic_msgs__msg__DiagnosticStatus *status = addStatus("pcc: tasks");
+
+    uint32_t total_run_time;
+    const UBaseType_t task_count = uxTaskGetSystemState(taskStatus, TASK_STATS_MAX_TASKS, &total_run_time);
+    if (task_count == 0)
+    {
+        status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+        setString(&status->message, "Too many tasks to report");
+        return;
+    }
+
+    for (UBaseType_t i = 0; i < task_count; i++)
+    {
+        taskSamples[i] = {taskStatus[i].xTaskNumber,
+                          taskStatus[i].pcTaskName,
+                          taskStatus[i].ulRunTimeCounter,
+                          taskStatus[i].usStackHighWaterMark};
+    }
+
+    const size_t usage_count = taskStats.update(taskSamples, task_count, total_run_time, portNUM_PROCESSORS, taskUsages);
+    for (size_t i = 0; i < usage_count; i++)
+    {
+        addValue(status, taskUsages[i].name, "%.1f%% %" PRIu32 "B", taskUsages[i].cpuPercent,
+                 taskUsages[i].stackHighWaterMark);
+        if (taskUsages[i].lowStack)
+        {
+            status->level = diagnostic_msgs__msg__DiagnosticStatus__WARN;
+            setString(&status->message, "Low stack");
+        }
+    }
+}
+
+static void diagnosticsTimerCallback(rcl_timer_t *timer, __attribute__((unused)) int64_t last_call_time)
+{
+    MEASURE_TIMER_CALLBACK("diagnosticsTimerCallback", timer);
+    statusCount = 0;
+    valueCount = 0;
+
+    addHeapStatus();
+#if CONFIG_PCC_POOL_ALLOCATOR
+    addAllocatorStatus();
+#endif
+    addLinkStatus();
+    addI2cStatus();
+#if CONFIG_PCC_STALL_MONITOR
+    addStallStatus();
+#endif
+    addTaskStatus();
+
+    // One status per message, all of them together are too big for the reliable stream's buffers
+    stampNow(&diagnosticsMessage.header.stamp);
+    for (size_t i = 0; i < statusCount; i++)
+    {
+        diagnosticsMessage.status.data = &statuses[i];
+        diagnosticsMessage.status.size = 1;
+        diagnosticsMessage.status.capacity = 1;
+
+        // Diagnostics are bulk traffic, so they are the first to be skipped while the link is busy
+        if (linkBudgetTakeMessage(LINK_CLASS_BULK, ROSIDL_GET_MSG_TYPE_SUPPORT(diagnostic_msgs, msg, DiagnosticArray),
+                                  &diagnosticsMessage))
+        {
+            HANDLE_ROS_ERROR(rcl_publish(&diagnosticsPublisher, &diagnosticsMessage, nullptr), false);
+        }
+    }
+
+    // Boot phases are logged on the first run after connecting, events after that as they happen
+    logBootProfile();
+    logPreviousStall();
+}
+
+void setupDiagnostics(rclc_support_t *support, rclc_executor_t *executor, rcl_node_t *node)
+{
+    // Reliable, since a status is bigger than the transport's MTU and best effort streams can't fragment
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&diagnosticsPublisher,
+                                                 node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(diagnostic_msgs, msg, DiagnosticArray),
+                                                 "/diagnostics"), true);
+    HANDLE_ROS_ERROR(rclc_timer_init_default(&diagnosticsTimer,
+                                             support,
+                                             RCL_MS_TO_NS(CONFIG_PCC_DIAGNOSTICS_PERIOD),
+                                             diagnosticsTimerCallback), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_timer(executor, &diagnosticsTimer), true);
+    LOG(LOGLEVEL_DEBUG, "Set up diagnostics");
+}
+
+void cleanupDiagnostics(rcl_node_t *node)
+{
+    HANDLE_ROS_ERROR(rcl_timer_fini(&diagnosticsTimer), false);
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&diagnosticsPublisher, node), false);
+}
@@ -1,26 +1,109 @@
 #include "esp32_serial_transport.hpp"
 
+#include <atomic>
 #include <driver/uart.h>
 #include <driver/gpio.h>
+#include <esp_attr.h>
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 
 #define UART_TXD  (CONFIG_MICROROS_UART_TXD)
 #define UART_RXD  (CONFIG_MICROROS_UART_RXD)
 #define UART_RTS  (CONFIG_MICROROS_UART_RTS)
 #define UART_CTS  (CONFIG_MICROROS_UART_CTS)
 
-#define UART_BUFFER_SIZE (512)
+#define UART_RX_BUFFER_SIZE (CONFIG_PCC_UART_RX_BUFFER_SIZE)
+
+#if CONFIG_PCC_UART_EVENT_DRIVEN
+#define UART_TX_BUFFER_SIZE (CONFIG_PCC_UART_TX_BUFFER_SIZE)
+#define UART_EVENT_QUEUE_SIZE (CONFIG_PCC_UART_EVENT_QUEUE_SIZE)
+#else
+#define UART_TX_BUFFER_SIZE (0)
+#define UART_EVENT_QUEUE_SIZE (0)
+#endif
+
+/**
+ * Every XRCE serial frame starts with this flag byte
+ */
+#define XRCE_FRAMING_FLAG (0x7E)
+
+/**
+ * The configured rate comes first, so a stock agent is found on the first ping after boot
+ */
+static const uint32_t baudRates[] = {
+        CONFIG_PCC_UART_BAUD_RATE,
+#if CONFIG_PCC_UART_AUTO_BAUD
+        921600,
+        2000000
+#endif
+};
+static const size_t baudRateCount = sizeof(baudRates) / sizeof(baudRates[0]);
+
+static QueueHandle_t uartQueue = nullptr;
+static uart_port_t openPort = UART_NUM_MAX;
+/**
+ * Kept across software resets, so the link comes back at the rate the agent was last found at
+ */
+RTC_NOINIT_ATTR static size_t baudRateIndex;
+static bool baudRateIndexChecked = false;
+static uint32_t failedPings = 0;
+
+static std::atomic<uint32_t> bytesIn;
+static std::atomic<uint32_t> bytesOut;
+static std::atomic<uint32_t> frames;
+static std::atomic<uint32_t> overruns;
+static std::atomic<int64_t> blockedWriteTime;
+
+/**
+ * Handle all of the pending uart events without blocking
+ * @param uart_port The port the events are for
+ * @param wait_ticks How long to wait for the first event
+ */
+static void handleUartEvents(uart_port_t uart_port, TickType_t wait_ticks)
+{
+    uart_event_t event;
+    while (xQueueReceive(uartQueue, &event, wait_ticks) == pdTRUE)
+    {
+        wait_ticks = 0;
+        switch (event.type)
+        {
+            case UART_PATTERN_DET:
+                uart_pattern_pop_pos(uart_port);
+                frames++;
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                overruns++;
+                uart_flush_input(uart_port);
+                xQueueReset(uartQueue);
+                return;
+            default:
+                break;
+        }
+    }
+}
 
 bool esp32SerialOpen(uxrCustomTransport *transport)
 {
     auto *uart_port = (uart_port_t *) transport->args;
 
+    if (!baudRateIndexChecked)
+    {
+        if (esp_reset_reason() != ESP_RST_SW || baudRateIndex >= baudRateCount)
+        {
+            baudRateIndex = 0;
+        }
+        baudRateIndexChecked = true;
+    }
+
     uart_config_t uart_config = {
-            .baud_rate = 115200,
+            .baud_rate = (int) baudRates[baudRateIndex],
             .data_bits = UART_DATA_8_BITS,
             .parity    = UART_PARITY_DISABLE,
             .stop_bits = UART_STOP_BITS_1,
             .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+            .rx_flow_ctrl_thresh = 0,
     };
 
     if (uart_param_config(*uart_port, &uart_config) == ESP_FAIL)
@@ -31,11 +114,28 @@ bool esp32SerialOpen(uxrCustomTransport *transport)
     {
         return false;
     }
-    if (uart_driver_install(*uart_port, UART_BUFFER_SIZE * 2, 0, 0, nullptr, 0) == ESP_FAIL)
+    if (uart_driver_install(*uart_port,
+                            UART_RX_BUFFER_SIZE,
+                            UART_TX_BUFFER_SIZE,
+                            UART_EVENT_QUEUE_SIZE,
+                            UART_EVENT_QUEUE_SIZE > 0 ? &uartQueue : nullptr,
+                            0) == ESP_FAIL)
     {
         return false;
     }
 
+#if CONFIG_PCC_UART_EVENT_DRIVEN
+    if (uart_enable_pattern_det_baud_intr(*uart_port, XRCE_FRAMING_FLAG, 1, 9, 0, 0) != ESP_OK)
+    {
+        return false;
+    }
+    if (uart_pattern_queue_reset(*uart_port, UART_EVENT_QUEUE_SIZE) != ESP_OK)
+    {
+        return false;
+    }
+#endif
+
+    openPort = *uart_port;
     return true;
 }
 
@@ -43,6 +143,8 @@ bool esp32SerialClose(uxrCustomTransport *transport)
 {
     auto *uart_port = (uart_port_t *) transport->args;
 
+    openPort = UART_NUM_MAX;
+    uartQueue = nullptr;
     return uart_driver_delete(*uart_port) == ESP_OK;
 }
 
@@ -50,14 +152,87 @@ size_t esp32SerialWrite(uxrCustomTransport *transport,
                         const uint8_t *buf, size_t len, __attribute((unused)) uint8_t *err)
 {
     auto *uart_port = (uart_port_t *) transport->args;
+
+    const int64_t start_time = esp_timer_get_time();
     const int tx_bytes = uart_write_bytes(*uart_port, (const char *) buf, len);
-    return tx_bytes;
+    blockedWriteTime += esp_timer_get_time() - start_time;
+
+    if (tx_bytes > 0)
+    {
+        bytesOut += tx_bytes;
+    }
+    return tx_bytes < 0 ? 0 : tx_bytes;
 }
 
 size_t esp32SerialRead(uxrCustomTransport *transport,
                        uint8_t *buf, size_t len, int timeout, __attribute((unused)) uint8_t *err)
 {
     auto *uart_port = (uart_port_t *) transport->args;
-    const int rx_bytes = uart_read_bytes(*uart_port, buf, len, timeout / portTICK_PERIOD_MS);
-    return rx_bytes;
+    TickType_t timeout_ticks = timeout / portTICK_PERIOD_MS;
+
+#if CONFIG_PCC_UART_EVENT_DRIVEN
+    // Sleep on the event queue instead of inside uart_read_bytes so that a frame flag wakes us up immediately
+    size_t buffered = 0;
+    handleUartEvents(*uart_port, 0);
+    uart_get_buffered_data_len(*uart_port, &buffered);
+    if (buffered == 0)
+    {
+        handleUartEvents(*uart_port, timeout_ticks);
+    }
+    timeout_ticks = 0;
+#endif
+
+    const int rx_bytes = uart_read_bytes(*uart_port, buf, len, timeout_ticks);
+    if (rx_bytes > 0)
+    {
+        bytesIn += rx_bytes;
+    }
+    return rx_bytes < 0 ? 0 : rx_bytes;
+}
+
+void esp32SerialGetStats(Esp32SerialStats *stats)
+{
+    stats->bytesIn = bytesIn;
+    stats->bytesOut = bytesOut;
+    stats->frames = frames;
+    stats->overruns = overruns;
+    stats->blockedWriteTime = blockedWriteTime;
+}
+
+uint32_t esp32SerialGetBaudRate()
+{
+    return baudRates[baudRateIndex];
+}
+
+void esp32SerialPingFailed()
+{
+#if CONFIG_PCC_UART_AUTO_BAUD
+    if (++failedPings >= CONFIG_PCC_UART_AUTO_BAUD_PINGS)
+    {
+        failedPings = 0;
+        esp32SerialStepBaudRate();
+    }
+#endif
+}
+
+void esp32SerialResetPings()
+{
+    failedPings = 0;
+}
+
+uint32_t esp32SerialStepBaudRate()
+{
+    // Wrap around to the configured rate so that an agent restarted at a lower rate is found again
+    baudRateIndex = (baudRateIndex + 1) % baudRateCount;
+    if (openPort != UART_NUM_MAX)
+    {
+        uart_wait_tx_done(openPort, pdMS_TO_TICKS(100));
+        uart_set_baudrate(openPort, baudRates[baudRateIndex]);
+        uart_flush_input(openPort);
+        if (uartQueue != nullptr)
+        {
+            xQueueReset(uartQueue);
+        }
+    }
+    return baudRates[baudRateIndex];
 }
@@ -0,0 +1,331 @@
+#include "i2c_bus.hpp"
+
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "recorder.hpp"
+#include "stall_monitor.hpp"
+#include "system.hpp"
+
+/**
+ * Moving averages move 1 / I2C_BUS_LATENCY_FILTER of the way to each new latency
+ */
+#define I2C_BUS_LATENCY_FILTER 8
+/**
+ * Clock pulses sent to free a stuck device, enough for it to finish any byte it is sending
+ */
+#define I2C_BUS_RECOVERY_CLOCKS 9
+
+static std::atomic<I2cDevice *> i2cDevicesHead = nullptr;
+static std::atomic<uint32_t> i2cRecoveries = 0;
+
+static void delayUs(uint32_t time)
+{
+    const int64_t end = esp_timer_get_time() + time;
+    while (esp_timer_get_time() < end)
+    {
+    }
+}
+
+I2cBus::I2cBus(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t frequency) : port(port),
+                                                                                      sda(sda),
+                                                                                      scl(scl),
+                                                                                      frequency(frequency),
+                                                                                      queueBuffer(),
+                                                                                      queueStorage(),
+                                                                                      queue(),
+                                                                                      busTask(),
+                                                                                      linkBuffer()
+{
+    queue = xQueueCreateStatic(I2C_BUS_QUEUE_SIZE, sizeof(I2cTransaction *), queueStorage, &queueBuffer);
+    HANDLE_ESP_ERROR(installDriver(), true);
+    busTask.start(CONTEXT_TASK_CALLBACK(I2cBus, busThread), "i2c_bus", this, 6);
+}
+
+esp_err_t I2cBus::run(I2cTransaction *transaction, I2cPriority priority)
+{
+    transaction->queuedTime = esp_timer_get_time();
+    const BaseType_t queued = priority == I2C_PRIORITY_HIGH ?
+                              xQueueSendToFront(queue, &transaction, portMAX_DELAY) :
+                              xQueueSendToBack(queue, &transaction, portMAX_DELAY);
+    if (queued != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    // The bus task always finishes a transaction, so the caller's transaction stays valid until then
+    xSemaphoreTake(transaction->device->done, portMAX_DELAY);
+    return transaction->result;
+}
+
+i2c_port_t I2cBus::getPort() const
+{
+    return port;
+}
+
+/**
+ * A failed command link doesn't tell which of its transactions went through, so only transactions that can safely be
+ * run twice are batched: reads, with at most a register address written first
+ */
+static bool isBatchable(const I2cTransaction *transaction)
+{
+    return transaction->readLength > 0 && transaction->writeLength <= 1;
+}
+
+void I2cBus::busThread()
+{
+    I2cTransaction *batch[I2C_BUS_BATCH_SIZE];
+    // Taken off the queue while filling a batch but not batchable, it goes first next time
+    I2cTransaction *pending = nullptr;
+    const char *activity = port == I2C_NUM_0 ? "transfer on port 0" : "transfer on port 1";
+    watchTask("i2c_bus");
+    while (true)
+    {
+        feedWatchdog();
+        if (pending != nullptr)
+        {
+            batch[0] = pending;
+            pending = nullptr;
+        }
+        else if (xQueueReceive(queue, &batch[0], STALL_FEED_PERIOD / portTICK_PERIOD_MS) != pdTRUE)
+        {
+            continue;
+        }
+        StallActivity transfer(activity);
+        size_t count = 1;
+        while (isBatchable(batch[0]) && count < I2C_BUS_BATCH_SIZE &&
+               xQueueReceive(queue, &batch[count], 0) == pdTRUE)
+        {
+            if (!isBatchable(batch[count]))
+            {
+                pending = batch[count];
+                break;
+            }
+            count++;
+        }
+
+        if (count > 1 && runLink(batch, count) == ESP_OK)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                finish(batch[i], ESP_OK);
+            }
+            continue;
+        }
+
+        // Run them one at a time, so a failure is only counted against the device that caused it
+        for (size_t i = 0; i < count; i++)
+        {
+            esp_err_t result = runLink(&batch[i], 1);
+            if (result == ESP_ERR_TIMEOUT)
+            {
+                recover();
+                result = runLink(&batch[i], 1);
+            }
+            finish(batch[i], result);
+        }
+    }
+}
+
+esp_err_t I2cBus::runLink(I2cTransaction *const *transactions, size_t count)
+{
+    i2c_cmd_handle_t link = i2c_cmd_link_create_static(linkBuffer, sizeof(linkBuffer));
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < count && result == ESP_OK; i++)
+    {
+        // Transactions after the first start with a repeated start instead of a stop and start
+        const I2cTransaction *transaction = transactions[i];
+        const uint8_t address = transaction->device->address << 1;
+        result = i2c_master_start(link);
+        if (result == ESP_OK && (transaction->writeLength > 0 || transaction->readLength == 0))
+        {
+            result = i2c_master_write_byte(link, address | I2C_MASTER_WRITE, true);
+            if (result == ESP_OK && transaction->writeLength > 0)
+            {
+                result = i2c_master_write(link, transaction->writeData, transaction->writeLength, true);
+            }
+            if (result == ESP_OK && transaction->readLength > 0)
+            {
+                result = i2c_master_start(link);
+            }
+        }
+        if (result == ESP_OK && transaction->readLength > 0)
+        {
+            result = i2c_master_write_byte(link, address | I2C_MASTER_READ, true);
+            if (result == ESP_OK)
+            {
+                result = i2c_master_read(link, transaction->readData, transaction->readLength, I2C_MASTER_LAST_NACK);
+            }
+        }
+    }
+    if (result == ESP_OK)
+    {
+        result = i2c_master_stop(link);
+    }
+    if (result == ESP_OK)
+    {
+        result = i2c_master_cmd_begin(port, link, I2C_BUS_TIMEOUT / portTICK_PERIOD_MS);
+    }
+    i2c_cmd_link_delete_static(link);
+    return result;
+}
+
+void I2cBus::finish(I2cTransaction *transaction, esp_err_t result)
+{
+    I2cDevice *device = transaction->device;
+    const auto latency = (uint32_t) (esp_timer_get_time() - transaction->queuedTime);
+
+    device->transactions.store(device->transactions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (result != ESP_OK)
+    {
+        device->errors.store(device->errors.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    const auto average = (int32_t) device->averageLatency.load(std::memory_order_relaxed);
+    device->averageLatency.store(average + ((int32_t) latency - average) / I2C_BUS_LATENCY_FILTER,
+                                 std::memory_order_relaxed);
+    if (latency > device->maxLatency.load(std::memory_order_relaxed))
+    {
+        device->maxLatency.store(latency, std::memory_order_relaxed);
+    }
+
+    transaction->result = result;
+    xSemaphoreGive(device->done);
+}
+
+esp_err_t I2cBus::installDriver()
+{
+    i2c_config_t config = {};
+    config.mode = I2C_MODE_MASTER;
+    config.sda_io_num = sda;
+    config.scl_io_num = scl;
+    config.sda_pullup_en = true;
+    config.scl_pullup_en = true;
+    config.master.clk_speed = frequency;
+
+    esp_err_t result = i2c_param_config(port, &config);
+    if (result == ESP_OK)
+    {
+        result = i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0);
+    }
+    return result;
+}
+
+void I2cBus::recover()
+{
+    i2cRecoveries++;
+    LOG(LOGLEVEL_WARN, "Recovering a stuck i2c bus");
+
+    HANDLE_ESP_ERROR(i2c_driver_delete(port), false);
+
+    const uint32_t half_period = 500000 / frequency + 1;
+    gpio_set_direction(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(sda, 1);
+    gpio_set_level(scl, 1);
+    delayUs(half_period);
+    for (size_t i = 0; i < I2C_BUS_RECOVERY_CLOCKS && gpio_get_level(sda) == 0; i++)
+    {
+        gpio_set_level(scl, 0);
+        delayUs(half_period);
+        gpio_set_level(scl, 1);
+        delayUs(half_period);
+    }
+
+    // A stop condition resets every device's state machine
+    gpio_set_level(scl, 0);
+    delayUs(half_period);
+    gpio_set_level(sda, 0);
+    delayUs(half_period);
+    gpio_set_level(scl, 1);
+    delayUs(half_period);
+    gpio_set_level(sda, 1);
+    delayUs(half_period);
+
+    HANDLE_ESP_ERROR(installDriver(), false);
+}
+
+I2cDevice::I2cDevice(I2cBus *bus, uint8_t address, const char *name, I2cPriority priority) :
+        bus(bus),
+        address(address),
+        name(name),
+        priority(priority),
+        lock(xSemaphoreCreateMutex()),
+        done(xSemaphoreCreateBinary()),
+        transactions(0),
+        errors(0),
+        averageLatency(0),
+        maxLatency(0),
+        next(i2cDevicesHead.load(std::memory_order_relaxed))
+{
+    while (!i2cDevicesHead.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+esp_err_t I2cDevice::write(const uint8_t *data, size_t length)
+{
+    return writeRead(data, length, nullptr, 0);
+}
+
+esp_err_t I2cDevice::read(uint8_t *data, size_t length)
+{
+    return writeRead(nullptr, 0, data, length);
+}
+
+esp_err_t I2cDevice::writeRead(const uint8_t *write_data, size_t write_length, uint8_t *read_data, size_t read_length)
+{
+    I2cTransaction transaction = {this, write_data, write_length, read_data, read_length, 0, ESP_FAIL};
+
+    // One transaction per device at a time, since they share the done semaphore
+    xSemaphoreTake(lock, portMAX_DELAY);
+    const esp_err_t result = bus->run(&transaction, priority);
+    xSemaphoreGive(lock);
+    if (result == ESP_OK && read_length > 0)
+    {
+        recordI2cRead(bus->getPort(), address, write_data, write_length, read_data, read_length);
+    }
+    return result;
+}
+
+esp_err_t I2cDevice::writeRegister(uint8_t reg, uint8_t value)
+{
+    const uint8_t data[] = {reg, value};
+    return write(data, sizeof(data));
+}
+
+esp_err_t I2cDevice::readRegisters(uint8_t reg, uint8_t *data, size_t length)
+{
+    return writeRead(&reg, 1, data, length);
+}
+
+uint8_t I2cDevice::getAddress() const
+{
+    return address;
+}
+
+const char *I2cDevice::getName() const
+{
+    return name;
+}
+
+I2cDeviceStats I2cDevice::getStats() const
+{
+    return {transactions.load(std::memory_order_relaxed),
+            errors.load(std::memory_order_relaxed),
+            averageLatency.load(std::memory_order_relaxed),
+            maxLatency.load(std::memory_order_relaxed)};
+}
+
+I2cDevice *I2cDevice::getNext() const
+{
+    return next;
+}
+
+I2cDevice *getI2cDevices()
+{
+    return i2cDevicesHead.load(std::memory_order_acquire);
+}
+
+uint32_t getI2cRecoveries()
+{
+    return i2cRecoveries.load(std::memory_order_relaxed);
+}
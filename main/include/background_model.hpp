@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_BACKGROUND_MODEL_HPP
+#define AVR_PCC_2023_BACKGROUND_MODEL_HPP
+
+#define BACKGROUND_MODEL_PIXELS 64
+/**
+ * Pixels that are flagged adapt this many times slower, so a heat source that stays put fades into the background
+ * instead of being absorbed right away
+ */
+#define BACKGROUND_MODEL_FOREGROUND_SHIFT 3
+
+/**
+ * A per pixel exponential average and variance of the frames, in fixed point, that flags pixels that are far enough
+ * from the background to be something new
+ */
+class BackgroundModel
+{
+public:
+    /**
+     * @param shift Each frame moves the background 1 / 2^shift of the way to it, and the first 2^shift frames only
+     * train the model
+     * @param sigma A pixel is flagged when it is more than this many standard deviations from its average
+     * @param min_deviation and at least this far, in raw sensor units
+     */
+    BackgroundModel(uint8_t shift, uint8_t sigma, int16_t min_deviation);
+
+    /**
+     * Add a frame to the model
+     * @param frame The raw pixel values, row major
+     * @return A bit for each pixel that is flagged, pixel 0 in the least significant bit
+     */
+    uint64_t update(const int16_t *frame);
+
+    /**
+     * Forget the background and train again
+     */
+    void reset();
+
+private:
+    const uint8_t shift;
+    const uint32_t sigmaSquared;
+    const int32_t minDeviation;
+
+    /**
+     * Averages, with 8 fractional bits
+     */
+    int32_t mean[BACKGROUND_MODEL_PIXELS];
+    /**
+     * Variances in raw units squared, with 8 fractional bits
+     */
+    uint32_t variance[BACKGROUND_MODEL_PIXELS];
+    uint32_t frames;
+};
+
+#endif //AVR_PCC_2023_BACKGROUND_MODEL_HPP
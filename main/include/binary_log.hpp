@@ -0,0 +1,91 @@
+#include <cstddef>
+#include <cstdint>
+
+#include "log_buffer.hpp"
+
+#ifndef AVR_PCC_2023_BINARY_LOG_HPP
+#define AVR_PCC_2023_BINARY_LOG_HPP
+
+/**
+ * A binary log record is the site id (u32, little endian), the level (u8), the payload length (u8) and the payload.
+ * The payload is empty for literal messages, which the host decoder looks up by site id instead
+ */
+#define BINARY_LOG_RECORD_HEADER_SIZE 6
+#define BINARY_LOG_RECORD_MAX_SIZE (BINARY_LOG_RECORD_HEADER_SIZE + LOG_RECORD_MESSAGE_SIZE)
+
+/**
+ * Compute the id of a log site as the 32 bit FNV-1a hash of "<file name>:<line>".
+ * tools/log_decoder.py computes the same hash when it scans the sources, so the two have to be kept in sync
+ * @param file The path of the source file, only the part after the last slash is used
+ * @param line The line of the log call
+ */
+constexpr uint32_t logSiteId(const char *file, uint32_t line)
+{
+    const char *name = file;
+    for (const char *c = file; *c != '\0'; c++)
+    {
+        if (*c == '/' || *c == '\\')
+        {
+            name = c + 1;
+        }
+    }
+
+    uint32_t hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++)
+    {
+        hash = (hash ^ (uint8_t) *c) * 16777619u;
+    }
+    hash = (hash ^ (uint8_t) ':') * 16777619u;
+
+    char digits[10] = {};
+    int digit_count = 0;
+    do
+    {
+        digits[digit_count++] = (char) ('0' + line % 10);
+        line /= 10;
+    } while (line > 0);
+    while (digit_count > 0)
+    {
+        hash = (hash ^ (uint8_t) digits[--digit_count]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Check whether the spelling of a LOG message argument is a single string literal, the only kind of message
+ * tools/log_decoder.py finds the text of in the sources. Anything else, like a variable or a ternary between two
+ * literals, has its text sent
+ * @param spelling The message argument as spelled in the source, from the # operator
+ */
+constexpr bool isLogLiteral(const char *spelling)
+{
+    if (spelling[0] != '"')
+    {
+        return false;
+    }
+    for (const char *c = spelling + 1; *c != '\0'; c++)
+    {
+        if (*c == '\\' && c[1] != '\0')
+        {
+            c++;
+        }
+        else if (*c == '"')
+        {
+            // A quote ends the literal, and must end the spelling too, so "a" "b" is not one literal
+            return c[1] == '\0';
+        }
+    }
+    return false;
+}
+
+/**
+ * Encode a log record in the binary log format
+ * @param record The record to encode
+ * @param buffer Where to write it
+ * @param size The space left in buffer
+ * @return The number of bytes written, or 0 if the record did not fit
+ */
+size_t encodeBinaryLogRecord(const LogRecord &record, uint8_t *buffer, size_t size);
+
+#endif //AVR_PCC_2023_BINARY_LOG_HPP
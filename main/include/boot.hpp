@@ -0,0 +1,105 @@
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#ifndef AVR_PCC_2023_BOOT_HPP
+#define AVR_PCC_2023_BOOT_HPP
+
+/**
+ * At most this many phases and events are kept, later ones are not recorded
+ */
+#define BOOT_PROFILE_RECORDS 24
+/**
+ * Event groups have 24 usable bits, one per step
+ */
+#define BOOT_MAX_STEPS 24
+#define BOOT_STEP_STACK_SIZE 6144
+#define BOOT_STEP_PRIORITY 3
+
+/**
+ * Records how long one phase of booting took, from construction to destruction. Phases can overlap and can be on
+ * any task
+ */
+class BootPhase
+{
+public:
+    /**
+     * @param name The name of the phase, it must be a string literal
+     */
+    explicit BootPhase(const char *name);
+
+    ~BootPhase();
+
+    BootPhase(const BootPhase &) = delete;
+
+    BootPhase &operator=(const BootPhase &) = delete;
+
+private:
+    size_t index;
+};
+
+/**
+ * Record a point in time during boot, like the first frame being published
+ * @param name The name of the event, it must be a string literal
+ */
+void markBootEvent(const char *name);
+
+/**
+ * Log the phases and events that finished since the last call, so the boot profile reaches /rosout once the agent is
+ * connected and later events follow when they happen
+ */
+void logBootProfile();
+
+/**
+ * A set of the steps added to an InitScheduler
+ */
+typedef EventBits_t InitStep;
+
+/**
+ * Runs boot steps concurrently, each on its own task as soon as the steps it depends on are done
+ */
+class InitScheduler
+{
+public:
+    typedef void (*InitFunction)(void *context);
+
+    InitScheduler();
+
+    /**
+     * Add a step. Steps can only depend on steps added before them, so there can't be a cycle
+     * @param name The name of the step and its task, it must be a string literal
+     * @param dependencies The steps that have to finish first, or'd together
+     * @return The step, to depend on in later steps
+     */
+    InitStep add(const char *name, InitFunction function, void *context = nullptr, InitStep dependencies = 0);
+
+    /**
+     * Start a task for every step. Each task times its step as a BootPhase and deletes itself when it is done
+     */
+    void start();
+
+    /**
+     * Block until every step is done, after start
+     */
+    void wait();
+
+private:
+    struct Step
+    {
+        const char *name;
+        InitFunction function;
+        void *context;
+        InitStep dependencies;
+        InitStep step;
+        InitScheduler *scheduler;
+    };
+
+    Step steps[BOOT_MAX_STEPS];
+    size_t stepCount;
+    EventGroupHandle_t done;
+
+    static void stepThread(void *arg);
+};
+
+#endif //AVR_PCC_2023_BOOT_HPP
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <rcl/rcl.h>
+#include <rclc/executor.h>
+
+#include "stall_monitor.hpp"
+
+#ifndef AVR_PCC_2023_CALLBACK_STATS_HPP
+#define AVR_PCC_2023_CALLBACK_STATS_HPP
+
+/**
+ * Bucket 0 counts times under 1us, bucket i counts times in [2^(i-1), 2^i) us and the last bucket counts everything
+ * longer, so 16 buckets go up to about 16ms
+ */
+#define CALLBACK_STATS_BUCKETS 16
+
+/**
+ * Record execution time and queueing delay for the enclosing executor callback.
+ * Every expansion has its own histogram, registered the first time it runs
+ */
+#define MEASURE_CALLBACK(name)                       \
+    static CallbackStats callback_stats(name);       \
+    CallbackTimer callback_timer(&callback_stats)
+/**
+ * Like MEASURE_CALLBACK, but the queueing delay is how late the timer is called instead of how long the callback
+ * waited behind others after the executor woke up
+ */
+#define MEASURE_TIMER_CALLBACK(name, timer)          \
+    static CallbackStats callback_stats(name);       \
+    CallbackTimer callback_timer(&callback_stats, timer)
+
+/**
+ * @param time A time in us
+ * @return The histogram bucket that the time falls in
+ */
+constexpr size_t callbackStatsBucket(int64_t time)
+{
+    size_t bucket = 0;
+    while (time > 0 && bucket < CALLBACK_STATS_BUCKETS - 1)
+    {
+        time >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * A fixed bucket log2 histogram of times in us. It only has one writer, readers may see a slightly stale copy
+ */
+class CallbackHistogram
+{
+public:
+    CallbackHistogram();
+
+    void add(int64_t time);
+
+    [[nodiscard]] uint32_t getCount() const;
+
+    [[nodiscard]] uint32_t getBucket(size_t bucket) const;
+
+    /**
+     * @return The longest time added, in us
+     */
+    [[nodiscard]] uint32_t getMax() const;
+
+    /**
+     * @param percent The share of times to cover, 1 to 100
+     * @return An upper bound in us of that share of the times added: the end of the bucket the percentile falls in,
+     * or the longest time if that is less. 0 when nothing was added
+     */
+    [[nodiscard]] uint32_t getPercentile(uint32_t percent) const;
+
+    /**
+     * Write the non empty buckets as "upper_bound_us:count" pairs
+     * @return The number of characters written, not counting the terminator
+     */
+    size_t format(char *buffer, size_t size) const;
+
+private:
+    std::atomic<uint32_t> buckets[CALLBACK_STATS_BUCKETS];
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> max;
+};
+
+/**
+ * Execution time and queueing delay of one callback
+ */
+struct CallbackStats
+{
+    /**
+     * @param registered Whether to add it to the list reported by formatCallbackStats
+     */
+    explicit CallbackStats(const char *name, bool registered = true);
+
+    const char *name;
+    CallbackHistogram execution;
+    CallbackHistogram queueing;
+    CallbackStats *next;
+};
+
+/**
+ * Measures the callback it is created in until it goes out of scope, and marks it as its task's activity for the stall
+ * monitor
+ */
+class CallbackTimer
+{
+public:
+    /**
+     * The queueing delay is the time since the executor last woke up with work
+     */
+    explicit CallbackTimer(CallbackStats *stats);
+
+    /**
+     * The queueing delay is how late the timer is
+     */
+    CallbackTimer(CallbackStats *stats, const rcl_timer_t *timer);
+
+    ~CallbackTimer();
+
+    CallbackTimer(const CallbackTimer &) = delete;
+    CallbackTimer &operator=(const CallbackTimer &) = delete;
+
+private:
+    CallbackStats *stats;
+    uint32_t start;
+    StallActivity activity;
+};
+
+/**
+ * An executor trigger that records when the executor wakes up, for the queueing delay, then behaves like
+ * rclc_executor_trigger_any
+ */
+bool callbackStatsTrigger(rclc_executor_handle_t *handles, unsigned int size, void *obj);
+
+/**
+ * @return The first registered callback's stats, follow next for the rest
+ */
+CallbackStats *getCallbackStats();
+
+/**
+ * Measure how long an empty MEASURE_CALLBACK takes, so it can be subtracted when reading the histograms
+ * @return The average overhead in ns
+ */
+uint32_t measureCallbackStatsOverhead();
+
+/**
+ * Write a text report of every registered callback
+ * @return The number of characters written, not counting the terminator
+ */
+size_t formatCallbackStats(char *buffer, size_t size);
+
+#endif //AVR_PCC_2023_CALLBACK_STATS_HPP
@@ -1,10 +1,13 @@
 #include <rcl/rcl.h>
 
+#include "callback_stats.hpp"
+
 #ifndef AVR_PCC_2023_CONTEXT_TIMER_HPP
 #define AVR_PCC_2023_CONTEXT_TIMER_HPP
 
 #define CONTEXT_TIMER_CALLBACK(cls, func) [](rcl_timer_t *timer, int64_t n) \
 {                                                                           \
+    MEASURE_TIMER_CALLBACK(#cls "::" #func, timer);                         \
     auto context_timer = (TimerWithContext *) timer;                        \
     auto context = (cls *) context_timer->context;                          \
     context->func(timer, n);                                                \
@@ -0,0 +1,23 @@
+#include <rcl/rcl.h>
+#include <rclc/executor.h>
+#include <rclc/rclc.h>
+
+#include "node.hpp"
+
+#ifndef AVR_PCC_2023_DIAGNOSTICS_HPP
+#define AVR_PCC_2023_DIAGNOSTICS_HPP
+
+/**
+ * Set up the diagnostics publisher and timer on the system node
+ * @param support A micro ros support structure
+ * @param executor The telemetry executor to bind the timer to
+ * @param node The node to publish from
+ */
+void setupDiagnostics(rclc_support_t *support, rclc_executor_t *executor, rcl_node_t *node);
+
+/**
+ * Clean up the diagnostics publisher and timer
+ */
+void cleanupDiagnostics(rcl_node_t *node);
+
+#endif //AVR_PCC_2023_DIAGNOSTICS_HPP
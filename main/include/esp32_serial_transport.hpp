@@ -8,6 +8,27 @@ extern "C"
 {
 #endif
 
+/**
+ * Counters for the serial transport since boot
+ */
+struct Esp32SerialStats
+{
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+    /**
+     * Number of XRCE frame flags seen by the uart pattern detection
+     */
+    uint32_t frames;
+    /**
+     * Number of times the rx fifo or ring buffer overflowed and input was dropped
+     */
+    uint32_t overruns;
+    /**
+     * Total time in us spent inside uart writes
+     */
+    int64_t blockedWriteTime;
+};
+
 bool esp32SerialOpen(uxrCustomTransport *transport);
 
 bool esp32SerialClose(uxrCustomTransport *transport);
@@ -16,6 +37,30 @@ size_t esp32SerialWrite(uxrCustomTransport *transport, const uint8_t *buf, size_
 
 size_t esp32SerialRead(uxrCustomTransport *transport, uint8_t *buf, size_t len, int timeout, uint8_t *err);
 
+void esp32SerialGetStats(struct Esp32SerialStats *stats);
+
+/**
+ * @return The baud rate the link is currently using
+ */
+uint32_t esp32SerialGetBaudRate();
+
+/**
+ * Move to the next higher candidate baud rate, wrapping around to the configured one
+ * @return The new baud rate
+ */
+uint32_t esp32SerialStepBaudRate();
+
+/**
+ * Count a ping the agent didn't answer. With auto baud, every CONFIG_PCC_UART_AUTO_BAUD_PINGS unanswered pings in a
+ * row step to the next baud rate
+ */
+void esp32SerialPingFailed();
+
+/**
+ * Start counting unanswered pings from zero, so the current rate gets its full share of pings first
+ */
+void esp32SerialResetPings();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <driver/gpio.h>
+#include <driver/i2c.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#include "static_task.hpp"
+
+#ifndef AVR_PCC_2023_I2C_BUS_HPP
+#define AVR_PCC_2023_I2C_BUS_HPP
+
+#define I2C_BUS_QUEUE_SIZE 8
+/**
+ * At most this many queued reads are run back to back in one command link
+ */
+#define I2C_BUS_BATCH_SIZE 4
+/**
+ * A command link that takes longer than this (ms) is treated as a stuck bus
+ */
+#define I2C_BUS_TIMEOUT 50
+
+enum I2cPriority
+{
+    I2C_PRIORITY_LOW,
+    /**
+     * Queued ahead of low priority transactions, for commands that something is waiting on
+     */
+    I2C_PRIORITY_HIGH
+};
+
+/**
+ * Counters for one device since boot
+ */
+struct I2cDeviceStats
+{
+    uint32_t transactions;
+    uint32_t errors;
+    /**
+     * Moving average time in us from queueing a transaction to it finishing
+     */
+    uint32_t averageLatency;
+    uint32_t maxLatency;
+};
+
+class I2cDevice;
+
+/**
+ * A queued transfer, owned by the task that waits for it
+ */
+struct I2cTransaction
+{
+    I2cDevice *device;
+    const uint8_t *writeData;
+    size_t writeLength;
+    uint8_t *readData;
+    size_t readLength;
+    int64_t queuedTime;
+    esp_err_t result;
+};
+
+/**
+ * Owns an i2c port. Transactions from every device on it are queued and run by one task, which batches queued reads
+ * into a single command link and recovers the bus when it gets stuck. Writes run on their own, so retrying a failed
+ * batch one transaction at a time never repeats one
+ */
+class I2cBus
+{
+public:
+    /**
+     * Install the driver and start the bus task
+     * @param frequency The scl frequency in Hz
+     */
+    I2cBus(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t frequency);
+
+    /**
+     * Queue a transaction and wait for it to finish
+     * @return The result of the transaction
+     */
+    esp_err_t run(I2cTransaction *transaction, I2cPriority priority);
+
+    [[nodiscard]] i2c_port_t getPort() const;
+
+private:
+    const i2c_port_t port;
+    const gpio_num_t sda;
+    const gpio_num_t scl;
+    const uint32_t frequency;
+
+    StaticQueue_t queueBuffer;
+    uint8_t queueStorage[I2C_BUS_QUEUE_SIZE * sizeof(I2cTransaction *)];
+    QueueHandle_t queue;
+    StaticStackTask<3072> busTask;
+    alignas(void *) uint8_t linkBuffer[I2C_LINK_RECOMMENDED_SIZE(2 * I2C_BUS_BATCH_SIZE)];
+
+    void busThread();
+
+    esp_err_t runLink(I2cTransaction *const *transactions, size_t count);
+
+    static void finish(I2cTransaction *transaction, esp_err_t result);
+
+    esp_err_t installDriver();
+
+    /**
+     * Clock out a device that is holding sda low, then reinstall the driver
+     */
+    void recover();
+};
+
+/**
+ * A device on an I2cBus. Calls block until the transfer is done and may come from any task
+ */
+class I2cDevice
+{
+public:
+    /**
+     * @param address The 7 bit address
+     * @param name A name for diagnostics, it must be a string literal
+     */
+    I2cDevice(I2cBus *bus, uint8_t address, const char *name, I2cPriority priority = I2C_PRIORITY_LOW);
+
+    esp_err_t write(const uint8_t *data, size_t length);
+
+    esp_err_t read(uint8_t *data, size_t length);
+
+    /**
+     * Write then read with a repeated start in between
+     */
+    esp_err_t writeRead(const uint8_t *write_data, size_t write_length, uint8_t *read_data, size_t read_length);
+
+    esp_err_t writeRegister(uint8_t reg, uint8_t value);
+
+    esp_err_t readRegisters(uint8_t reg, uint8_t *data, size_t length);
+
+    [[nodiscard]] uint8_t getAddress() const;
+
+    [[nodiscard]] const char *getName() const;
+
+    [[nodiscard]] I2cDeviceStats getStats() const;
+
+    /**
+     * @return The next device in the list from getI2cDevices
+     */
+    [[nodiscard]] I2cDevice *getNext() const;
+
+private:
+    friend class I2cBus;
+
+    I2cBus *const bus;
+    const uint8_t address;
+    const char *const name;
+    const I2cPriority priority;
+
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t done;
+
+    // Only written by the bus task
+    std::atomic<uint32_t> transactions;
+    std::atomic<uint32_t> errors;
+    std::atomic<uint32_t> averageLatency;
+    std::atomic<uint32_t> maxLatency;
+
+    I2cDevice *next;
+};
+
+/**
+ * @return The first device created, follow getNext for the rest
+ */
+I2cDevice *getI2cDevices();
+
+/**
+ * @return The number of times any bus had to be recovered
+ */
+uint32_t getI2cRecoveries();
+
+#endif //AVR_PCC_2023_I2C_BUS_HPP
@@ -0,0 +1,48 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_LASER_PATTERN_HPP
+#define AVR_PCC_2023_LASER_PATTERN_HPP
+
+#define LASER_PATTERN_MAX_PULSES 32
+/**
+ * Safety limits for uploaded pulse patterns. The duty cycle limit matches the single fire (250 on / 750 off)
+ */
+#define LASER_PATTERN_MAX_ON_TIME 250
+#define LASER_PATTERN_MIN_OFF_TIME 50
+#define LASER_PATTERN_MAX_DUTY_PERCENT 25
+#define LASER_PATTERN_MAX_REPEATS 100
+
+struct LaserPulse
+{
+    uint16_t onTime;
+    uint16_t offTime;
+};
+
+/**
+ * Check a pattern against the laser's safety limits
+ * @param data The uploaded pattern: a repeat count followed by on/off time pairs in ms
+ * @param size The number of elements in data
+ * @return nullptr if the pattern is safe, otherwise the reason it was rejected
+ */
+const char *validateLaserPattern(const uint16_t *data, size_t size);
+
+/**
+ * Unpack a pattern that passed validateLaserPattern
+ * @param pulses Where to write the pulses, room for LASER_PATTERN_MAX_PULSES
+ * @param repeats Set to the repeat count
+ * @return The number of pulses
+ */
+size_t loadLaserPattern(const uint16_t *data, size_t size, LaserPulse *pulses, uint16_t *repeats);
+
+/**
+ * Move a running pattern on to its next edge. Edges are kept relative to the first, like vTaskDelayUntil, so waking
+ * late doesn't push the rest of the pattern back
+ * @param wake_time The tick of the last edge, moved on to this one
+ * @param ticks The time from the last edge
+ * @param now The current tick
+ * @return The ticks left until the edge, 0 if it has already passed
+ */
+uint32_t advanceLaserPulse(uint32_t *wake_time, uint32_t ticks, uint32_t now);
+
+#endif //AVR_PCC_2023_LASER_PATTERN_HPP
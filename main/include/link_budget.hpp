@@ -0,0 +1,126 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <rosidl_runtime_c/message_type_support_struct.h>
+#include <sdkconfig.h>
+
+#ifndef AVR_PCC_2023_LINK_BUDGET_HPP
+#define AVR_PCC_2023_LINK_BUDGET_HPP
+
+/**
+ * Added to each message's payload size for the XRCE and serial framing around it
+ */
+#define LINK_MESSAGE_OVERHEAD 32
+
+/**
+ * Budgeted traffic classes on the serial link, highest priority first. Service responses and everything else that
+ * isn't budgeted are never held back, they just use up the link's capacity
+ */
+enum LinkClass
+{
+    /**
+     * Sensor data. Dropped when it is over its budget or the link is full, the next sample replaces it anyway
+     */
+    LINK_CLASS_TELEMETRY = 0,
+    /**
+     * /rosout. Deferred, the records wait in the log buffer
+     */
+    LINK_CLASS_LOG,
+    /**
+     * Diagnostics and recordings, the first to be held back
+     */
+    LINK_CLASS_BULK,
+    LINK_CLASSES
+};
+
+struct LinkClassStats
+{
+    uint32_t messages;
+    uint32_t bytes;
+    /**
+     * Times the class was held back, a deferred message can be held back several times
+     */
+    uint32_t held;
+};
+
+#if CONFIG_PCC_LINK_BUDGET
+
+/**
+ * Set up the budgets. Has to be called before the first message
+ */
+void initLinkBudget();
+
+/**
+ * Check whether a class may send now, without using any of its budget. For senders that only know the size after
+ * sending, which then call linkBudgetCharge. A refusal counts as held
+ */
+bool linkBudgetReady(LinkClass link_class);
+
+/**
+ * Count a message that was sent against its class's budget. A class can go into debt, which holds it back until its
+ * budget refills
+ * @param bytes The serialized message size, LINK_MESSAGE_OVERHEAD is added
+ */
+void linkBudgetCharge(LinkClass link_class, size_t bytes);
+
+/**
+ * linkBudgetReady and linkBudgetCharge together, for senders that know the size up front
+ * @return Whether the message may be sent
+ */
+bool linkBudgetTake(LinkClass link_class, size_t bytes);
+
+/**
+ * linkBudgetTake for a message, charged at its serialized size
+ */
+bool linkBudgetTakeMessage(LinkClass link_class, const rosidl_message_type_support_t *type_support,
+                           const void *message);
+
+/**
+ * linkBudgetCharge for a message that was sent, at its serialized size
+ */
+void linkBudgetChargeMessage(LinkClass link_class, const rosidl_message_type_support_t *type_support,
+                             const void *message);
+
+LinkClassStats getLinkClassStats(LinkClass link_class);
+
+/**
+ * @return The share of the link's capacity that was written since the last call, in percent
+ */
+float getLinkUtilization();
+
+#else
+
+inline void initLinkBudget()
+{
+}
+
+inline bool linkBudgetReady(__attribute__((unused)) LinkClass link_class)
+{
+    return true;
+}
+
+inline void linkBudgetCharge(__attribute__((unused)) LinkClass link_class, __attribute__((unused)) size_t bytes)
+{
+}
+
+inline bool linkBudgetTake(__attribute__((unused)) LinkClass link_class, __attribute__((unused)) size_t bytes)
+{
+    return true;
+}
+
+inline bool linkBudgetTakeMessage(__attribute__((unused)) LinkClass link_class,
+                                  __attribute__((unused)) const rosidl_message_type_support_t *type_support,
+                                  __attribute__((unused)) const void *message)
+{
+    return true;
+}
+
+inline void linkBudgetChargeMessage(__attribute__((unused)) LinkClass link_class,
+                                    __attribute__((unused)) const rosidl_message_type_support_t *type_support,
+                                    __attribute__((unused)) const void *message)
+{
+}
+
+#endif
+
+#endif //AVR_PCC_2023_LINK_BUDGET_HPP
@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifndef AVR_PCC_2023_LOCAL_TOPIC_HPP
+#define AVR_PCC_2023_LOCAL_TOPIC_HPP
+
+/**
+ * How many times a read starts over when a publish overlaps it before giving up until the next call. A reader that
+ * spins without a limit would never let a lower priority writer on the same core finish
+ */
+#define LOCAL_TOPIC_READ_ATTEMPTS 4
+
+/**
+ * The latest sample of something one task produces, for other tasks on the pcc to read without going through the
+ * host. It is a sequence lock: the sequence is odd while a publish is in progress and goes up by 2 with every sample,
+ * so neither side ever blocks or allocates.
+ *
+ * There can only be one publishing task. It writes the sample in place, any number of readers copy it out.
+ * @tparam T The sample, it has to be trivially copyable
+ */
+template<typename T>
+class LocalTopic
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Local topic samples are copied with memcpy");
+
+public:
+    LocalTopic() : sequence(0),
+                   sample()
+    {
+    }
+
+    LocalTopic(const LocalTopic &) = delete;
+
+    LocalTopic &operator=(const LocalTopic &) = delete;
+
+    /**
+     * Start a publish. Readers skip the sample until endWrite
+     * @return The sample to fill in, only valid until endWrite
+     */
+    T *beginWrite()
+    {
+        const uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return &sample;
+    }
+
+    /**
+     * Finish a publish started with beginWrite
+     */
+    void endWrite()
+    {
+        const uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_release);
+    }
+
+    /**
+     * Publish a copy of a sample that was built somewhere else
+     */
+    void publish(const T &value)
+    {
+        memcpy(beginWrite(), &value, sizeof(T));
+        endWrite();
+    }
+
+    /**
+     * Copy the sample out if it is newer than the last one this reader got
+     * @param output Where to copy the sample to, its contents are only valid when this returns true
+     * @param last_sequence The sequence of the last sample the reader got, 0 at first. Updated when this returns true
+     * @return Whether there was a new sample that could be read without a publish overlapping it
+     */
+    bool read(T &output, uint32_t &last_sequence) const
+    {
+        for (size_t attempt = 0; attempt < LOCAL_TOPIC_READ_ATTEMPTS; attempt++)
+        {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before == last_sequence)
+            {
+                return false;
+            }
+            if (before & 1)
+            {
+                continue;
+            }
+
+            // The copy can race with a publish, the sequence check throws a torn copy away
+            memcpy(&output, &sample, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                last_sequence = before;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @return The sequence of the latest sample, 0 if nothing was published yet. Odd while a publish is in progress
+     */
+    [[nodiscard]] uint32_t getSequence() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<uint32_t> sequence;
+    T sample;
+};
+
+#endif //AVR_PCC_2023_LOCAL_TOPIC_HPP
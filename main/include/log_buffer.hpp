@@ -0,0 +1,142 @@
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_LOG_BUFFER_HPP
+#define AVR_PCC_2023_LOG_BUFFER_HPP
+
+#define LOG_BUFFER_RECORDS 32
+#define LOG_RECORD_MESSAGE_SIZE 128
+
+static_assert((LOG_BUFFER_RECORDS & (LOG_BUFFER_RECORDS - 1)) == 0, "LOG_BUFFER_RECORDS must be a power of 2");
+
+/**
+ * A log message waiting to be published. file and function are not copied, so they must be string literals
+ */
+struct LogRecord
+{
+    int64_t stamp;
+    const char *file;
+    const char *function;
+    uint32_t line;
+    /**
+     * Id of the log site for binary logging, or 0 if it has to be computed from file and line
+     */
+    uint32_t site;
+    uint8_t level;
+    size_t messageLength;
+    char message[LOG_RECORD_MESSAGE_SIZE];
+};
+
+/**
+ * A fixed size lock-free queue of log records with any number of producers and one consumer.
+ * Producers never block: when the queue is full the record is dropped and counted
+ */
+class LogBuffer
+{
+public:
+    LogBuffer();
+
+    /**
+     * Add a record to the queue
+     * @param write Called with the record's message buffer and its size, returns the message length
+     * @return Whether there was room for the record
+     */
+    template<typename Writer>
+    bool push(int64_t stamp, uint8_t level,
+              const char *file, const char *function, uint32_t line, uint32_t site,
+              Writer write)
+    {
+        Slot *slot;
+        uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot = &slots[position & (LOG_BUFFER_RECORDS - 1)];
+            const uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto difference = (int32_t) (sequence - position);
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        LogRecord &record = slot->record;
+        record.stamp = stamp;
+        record.level = level;
+        record.file = file;
+        record.function = function;
+        record.line = line;
+        record.site = site;
+        record.messageLength = write(record.message, sizeof(record.message));
+        if (record.messageLength >= sizeof(record.message))
+        {
+            record.messageLength = sizeof(record.message) - 1;
+        }
+
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Add a record with a printf style message, formatted straight into the record without allocating. Trailing
+     * newlines are left out
+     * @param args The format's arguments, they are used up like by vsnprintf
+     * @return Whether there was room for the record
+     */
+    bool pushFormatted(int64_t stamp, uint8_t level,
+                       const char *file, const char *function, uint32_t line, uint32_t site,
+                       const char *format, va_list args);
+
+    /**
+     * Hand the oldest record to a function, then free its slot. Only one task may consume
+     * @param consume Called with the record, which is only valid during the call
+     * @return Whether there was a record
+     */
+    template<typename Consumer>
+    bool pop(Consumer consume)
+    {
+        Slot &slot = slots[dequeuePosition & (LOG_BUFFER_RECORDS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+        {
+            return false;
+        }
+
+        consume(slot.record);
+
+        slot.sequence.store(dequeuePosition + LOG_BUFFER_RECORDS, std::memory_order_release);
+        dequeuePosition++;
+        return true;
+    }
+
+    /**
+     * @return The number of records dropped because the queue was full
+     */
+    [[nodiscard]] uint32_t getDropped() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
+    Slot slots[LOG_BUFFER_RECORDS];
+    std::atomic<uint32_t> enqueuePosition;
+    uint32_t dequeuePosition;
+    std::atomic<uint32_t> dropped;
+};
+
+#endif //AVR_PCC_2023_LOG_BUFFER_HPP
@@ -1,11 +1,16 @@
+#include <cstddef>
+
 #include <rclc/rclc.h>
 #include <rclc/executor.h>
 
+#include "node_resources.hpp"
+
 #ifndef AVR_PCC_2023_NODE_HPP
 #define AVR_PCC_2023_NODE_HPP
 
 /**
- * Represents a micro ros node
+ * Represents a micro ros node. Subclasses declare what they create in a static constexpr NodeResources RESOURCES
+ * and which executor they use in a static constexpr ExecutorGroup EXECUTOR
  */
 class Node
 {
@@ -0,0 +1,91 @@
+#include <cstddef>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <rclc/executor.h>
+#include <rclc/rclc.h>
+
+#include "node.hpp"
+
+#ifndef AVR_PCC_2023_NODE_REGISTRY_HPP
+#define AVR_PCC_2023_NODE_REGISTRY_HPP
+
+/**
+ * Static storage for a fixed set of nodes, which are set up in order and cleaned up in reverse order.
+ * Each node type has to declare its entities in a static constexpr NodeResources RESOURCES
+ */
+template<typename... Nodes>
+class NodeRegistry
+{
+public:
+    /**
+     * Everything the nodes create together
+     */
+    static constexpr NodeResources RESOURCES = (NodeResources{} + ... + Nodes::RESOURCES);
+
+    /**
+     * @return The number of handles the nodes add to one executor
+     */
+    static constexpr size_t executorHandles(ExecutorGroup group)
+    {
+        return (0 + ... + (Nodes::EXECUTOR == group ? Nodes::RESOURCES.executorHandles() : 0));
+    }
+
+    /**
+     * Construct a node in its slot. Nodes are constructed when the hardware they need is ready, not at startup
+     * @return The node
+     */
+    template<typename T, typename... Args>
+    T &emplace(Args &&... args)
+    {
+        return std::get<std::optional<T>>(nodes).emplace(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T &get()
+    {
+        return *std::get<std::optional<T>>(nodes);
+    }
+
+    /**
+     * Set up every node on the executor for its group
+     * @param executors The executors, indexed by ExecutorGroup
+     * @return Whether every node added as many handles to its executor as its RESOURCES declare
+     */
+    bool setup(rclc_support_t *support, rclc_executor_t *executors)
+    {
+        bool matched = true;
+        std::apply([support, executors, &matched](auto &... node)
+                   {
+                       ((matched &= setupNode(*node, support, &executors[std::decay_t<decltype(*node)>::EXECUTOR])),
+                        ...);
+                   }, nodes);
+        return matched;
+    }
+
+    void cleanup()
+    {
+        cleanupReversed(std::index_sequence_for<Nodes...>());
+    }
+
+private:
+    std::tuple<std::optional<Nodes>...> nodes;
+
+    template<typename T>
+    static bool setupNode(T &node, rclc_support_t *support, rclc_executor_t *executor)
+    {
+        const size_t handles = executor->index;
+        node.setup(support, executor);
+        return executor->index - handles == T::RESOURCES.executorHandles();
+    }
+
+    template<size_t... Indices>
+    void cleanupReversed(std::index_sequence<Indices...>)
+    {
+        (std::get<sizeof...(Nodes) - 1 - Indices>(nodes)->cleanup(), ...);
+    }
+};
+
+#endif //AVR_PCC_2023_NODE_REGISTRY_HPP
@@ -0,0 +1,94 @@
+#include <cstddef>
+
+#include <sdkconfig.h>
+
+#ifndef AVR_PCC_2023_NODE_RESOURCES_HPP
+#define AVR_PCC_2023_NODE_RESOURCES_HPP
+
+/**
+ * Which executor a node's handles go to. Control handles run in a higher priority task than telemetry,
+ * so slow publishing can't hold up commands
+ */
+enum ExecutorGroup
+{
+    EXECUTOR_CONTROL,
+    EXECUTOR_TELEMETRY,
+    EXECUTOR_GROUPS
+};
+
+/**
+ * The micro ros entities something creates, to size the executor and check the limits in app-colcon.meta
+ */
+struct NodeResources
+{
+    size_t nodes;
+    size_t publishers;
+    size_t subscriptions;
+    size_t services;
+    size_t timers;
+
+    /**
+     * @return The number of executor handles needed, one per subscription, service and timer
+     */
+    [[nodiscard]] constexpr size_t executorHandles() const
+    {
+        return subscriptions + services + timers;
+    }
+
+    constexpr NodeResources operator+(const NodeResources &other) const
+    {
+        return {nodes + other.nodes,
+                publishers + other.publishers,
+                subscriptions + other.subscriptions,
+                services + other.services,
+                timers + other.timers};
+    }
+
+    constexpr bool operator==(const NodeResources &other) const
+    {
+        return nodes == other.nodes && publishers == other.publishers && subscriptions == other.subscriptions &&
+               services == other.services && timers == other.timers;
+    }
+};
+
+// What everything creates is kept here, away from micro-ROS, so the host tests can check it against app-colcon.meta
+
+/**
+ * The system node with the logger publisher and the reset and callback_stats services, which use the control
+ * executor. Diagnostics are counted separately in DIAGNOSTICS_RESOURCES
+ */
+constexpr NodeResources SYSTEM_RESOURCES = {1, 1, 0, 2, 0};
+
+/**
+ * The diagnostics publisher and timer, on the system node and the telemetry executor
+ */
+constexpr NodeResources DIAGNOSTICS_RESOURCES = {0, 1, 0, 0, 1};
+
+#if CONFIG_PCC_RECORDING
+/**
+ * The recording publisher and the timer that drains the buffer into it, on the system node and the telemetry executor
+ */
+constexpr NodeResources RECORDER_RESOURCES = {0, 1, 0, 0, 1};
+#else
+constexpr NodeResources RECORDER_RESOURCES = {0, 0, 0, 0, 0};
+#endif
+
+/**
+ * The fire, set_loop, fire_pattern and cancel_pattern services, the pattern subscription and the pattern done publisher
+ */
+constexpr NodeResources LASER_RESOURCES = {1, 1, 1, 4, 0};
+constexpr NodeResources LED_STRIP_RESOURCES = {1, 0, 0, 1, 0};
+constexpr NodeResources SERVO_RESOURCES = {1, 0, 0, 2, 0};
+/**
+ * The frame, roi, stats and motion publishers, the roi_config subscription and the frame timer
+ */
+constexpr NodeResources THERMAL_CAMERA_RESOURCES = {1, 5, 1, 0, 1};
+
+/**
+ * Everything the firmware creates. main.cpp checks that its node registry adds up to the same
+ */
+constexpr NodeResources PCC_RESOURCES = SYSTEM_RESOURCES + DIAGNOSTICS_RESOURCES + RECORDER_RESOURCES +
+                                        LASER_RESOURCES + LED_STRIP_RESOURCES + SERVO_RESOURCES +
+                                        THERMAL_CAMERA_RESOURCES;
+
+#endif //AVR_PCC_2023_NODE_RESOURCES_HPP
@@ -2,22 +2,29 @@
 
 #include <atomic>
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include <rcl/rcl.h>
 #include <rclc/rclc.h>
 #include <rclc/executor.h>
 #include <std_srvs/srv/trigger.h>
 #include <std_srvs/srv/set_bool.h>
+#include <std_msgs/msg/bool.h>
+#include <std_msgs/msg/u_int16_multi_array.h>
 
+#include "laser_pattern.hpp"
 #include "node.hpp"
+#include "static_task.hpp"
 
 #ifndef AVR_PCC_2023_LASER_HPP
 #define AVR_PCC_2023_LASER_HPP
 
-#define LASER_NODE_EXECUTOR_HANDLES 2
-
 class LaserNode : Node
 {
 public:
+    static constexpr NodeResources RESOURCES = LASER_RESOURCES;
+    static constexpr ExecutorGroup EXECUTOR = EXECUTOR_CONTROL;
+
     explicit LaserNode(gpio_num_t laser_pin);
 
     void setup(rclc_support_t *support, rclc_executor_t *executor) override;
@@ -29,14 +36,50 @@ private:
 
     rcl_service_t fireService;
     rcl_service_t setLoopService;
+    rcl_service_t firePatternService;
+    rcl_service_t cancelPatternService;
+    rcl_subscription_t patternSubscription;
+    rcl_publisher_t patternDonePublisher;
     std_srvs__srv__Trigger_Request fireRequest;
     std_srvs__srv__SetBool_Request setLoopRequest;
+    std_srvs__srv__Trigger_Request firePatternRequest;
+    std_srvs__srv__Trigger_Request cancelPatternRequest;
     std_srvs__srv__Trigger_Response fireResponse;
     std_srvs__srv__SetBool_Response setLoopResponse;
+    std_srvs__srv__Trigger_Response firePatternResponse;
+    std_srvs__srv__Trigger_Response cancelPatternResponse;
+    std_msgs__msg__UInt16MultiArray patternMessage;
+    uint16_t patternMessageBuffer[1 + (LASER_PATTERN_MAX_PULSES << 1)];
+    std_msgs__msg__Bool patternDoneMessage;
+
+    /**
+     * Each waits for a notification, then fires, loops or runs the pattern once
+     */
+    StaticStackTask<configMINIMAL_STACK_SIZE> fireTask;
+    StaticStackTask<configMINIMAL_STACK_SIZE> loopTask;
+    StaticStackTask<4096> patternTask;
+    /**
+     * LASER_PATTERN_IDLE is set while no pattern runs, cleanup waits for it
+     */
+    EventGroupHandle_t patternEvents;
 
     std::atomic<bool> loopState = false;
     std::atomic<bool> laserState = false;
     std::atomic<bool> cooldownState = false;
+    std::atomic<bool> patternState = false;
+    /**
+     * Stops the running pattern right away, set by cancel_pattern and on cleanup
+     */
+    std::atomic<bool> patternAbort = false;
+    /**
+     * Whether pattern_done can be published, only between setup and cleanup
+     */
+    std::atomic<bool> patternDoneReady = false;
+
+    LaserPulse pattern[LASER_PATTERN_MAX_PULSES];
+    size_t patternLength = 0;
+    uint16_t patternRepeats = 0;
+    const char *patternError = "No pattern uploaded";
 
     void setLaser(bool state);
 
@@ -46,10 +89,25 @@ private:
 
     void loopThread();
 
+    void patternThread();
+
+    /**
+     * Wait for a pattern pulse edge like vTaskDelayUntil, but return as soon as the pattern is aborted
+     * @param wake_time The time of the last edge, moved on to this one
+     * @param time The time from the last edge, in ms
+     */
+    void waitPulse(TickType_t *wake_time, uint16_t time);
+
     void fireCallback(const void *request, void *response);
 
     void setLoopCallback(const void *request, void *response);
 
+    void firePatternCallback(const void *request, void *response);
+
+    void cancelPatternCallback(const void *request, void *response);
+
+    void patternCallback(const void *message);
+
 //    static void setLoopCallback(const std_srvs__srv__SetBool_Request *request_msg,
 //                                std_srvs__srv__SetBool_Response *response_msg,
 //                                LaserNode *laser_node);
@@ -6,16 +6,29 @@
 
 #include "node.hpp"
 #include "neopixel_strip.hpp"
-
-#define LED_STRIP_NODE_EXECUTOR_HANDLES 1
+#include "static_task.hpp"
+#include "thermal_strip.hpp"
+#include "nodes/thermal_camera.hpp"
 
 #ifndef AVR_PCC_2023_LED_STRIP_HPP
 #define AVR_PCC_2023_LED_STRIP_HPP
 
+/**
+ * Shows the thermal camera's frames on the strip, without the host. The argument is a LedStripThermalView.
+ * SetLedStrip lives in the external interfaces package, this is the next value after MODE_CYCLE
+ */
+#define LED_STRIP_MODE_THERMAL 3
+/**
+ * How often the thermal mode checks for a new frame, well under the camera's 100ms frame period
+ */
+#define LED_STRIP_THERMAL_POLL_MS 10
 
 class LedStripNode : Node
 {
 public:
+    static constexpr NodeResources RESOURCES = LED_STRIP_RESOURCES;
+    static constexpr ExecutorGroup EXECUTOR = EXECUTOR_CONTROL;
+
     explicit LedStripNode(NeopixelStrip *strip);
 
     void setup(rclc_support_t *support, rclc_executor_t *executor) override;
@@ -29,16 +42,31 @@ private:
     avr_pcc_2023_interfaces__srv__SetLedStrip_Request setModeServiceRequest;
     avr_pcc_2023_interfaces__srv__SetLedStrip_Response setModeServiceResponse;
 
-    std::atomic<bool> isUpdating;
+    StaticStackTask<3072> updateTask;
     std::atomic<bool> shouldUpdate;
     std::atomic<uint8_t> state;
     AtomicRgbColor primaryColor;
     AtomicRgbColor secondaryColor;
     std::atomic<uint8_t> mode;
     std::atomic<uint8_t> modeArgument;
+    /**
+     * Only used by the update thread, kept out of its small stack
+     */
+    ThermalSample thermalSample;
+    uint32_t thermalSequence;
 
     void updateThread();
 
+    /**
+     * Show the current mode until it is done or replaced
+     */
+    void updateStrip();
+
+    /**
+     * Draw thermalSample, see thermalStripColor
+     */
+    void drawThermalFrame(LedStripThermalView view);
+
     void setModeCallback(const void *request, void *response);
 };
 
@@ -1,15 +1,12 @@
-#include <i2cdev.h>
-#include <pca9685.h>
-
 #include <rcl/rcl.h>
 #include <rclc/rclc.h>
 #include <rclc/executor.h>
 #include <std_srvs/srv/set_bool.h>
 #include <avr_pcc_2023_interfaces/srv/set_servo.h>
 
+#include "i2c_bus.hpp"
 #include "node.hpp"
-
-#define SERVO_NODE_EXECUTOR_HANDLES 2
+#include "pca9685.hpp"
 
 #ifndef AVR_PCC_2023_SERVO_NODE_HPP
 #define AVR_PCC_2023_SERVO_NODE_HPP
@@ -18,7 +15,10 @@
 class ServoNode : Node
 {
 public:
-    ServoNode(gpio_num_t sda, gpio_num_t scl, i2c_port_t port = I2C_NUM_0);
+    static constexpr NodeResources RESOURCES = SERVO_RESOURCES;
+    static constexpr ExecutorGroup EXECUTOR = EXECUTOR_CONTROL;
+
+    explicit ServoNode(I2cBus *bus);
 
     void setup(rclc_support_t *support, rclc_executor_t *executor) override;
 
@@ -28,7 +28,7 @@ private:
     // services, topics, subscribers, clients, and variables defined here
     // 1. from constructor (try to make it constant)
     // 2. things you instantiate (services)
-    i2c_dev_t device;
+    Pca9685 driver;
     rcl_service_t enableService;
     rcl_service_t setPosService;
 //    rcl_service_t setDefaultService; // save default val to flash mem and read on startup
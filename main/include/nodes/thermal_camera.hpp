@@ -1,33 +1,55 @@
-#include <gpio_cxx.hpp>
-#include <i2c_cxx.hpp>
-
 #include <rcl/rcl.h>
 #include <rclc/rclc.h>
 #include <rclc/executor.h>
+#include <builtin_interfaces/msg/time.h>
 #include <sensor_msgs/msg/temperature.h>
+#include <std_msgs/msg/float32_multi_array.h>
+#include <std_msgs/msg/u_int8_multi_array.h>
+#include <std_msgs/msg/u_int64.h>
 #include <avr_pcc_2023_interfaces/msg/thermal_frame.h>
 
-#include "node.hpp"
+#include "background_model.hpp"
 #include "context_timer.hpp"
+#include "i2c_bus.hpp"
+#include "local_topic.hpp"
+#include "node.hpp"
+#include "thermal_frame.hpp"
 
-#define THERMAL_CAMERA_NODE_EXECUTOR_HANDLES 1
-#define AMG88XX_PIXEL_ARRAY_SIZE 64
+#define THERMAL_REGION_LABEL_SIZE 16
 
 #ifndef AVR_PCC_2023_THERMAL_CAMERA_HPP
 #define AVR_PCC_2023_THERMAL_CAMERA_HPP
 
+/**
+ * A converted frame, shared with the other nodes on the pcc through thermalFrames
+ */
+struct ThermalSample
+{
+    float pixels[AMG88XX_PIXEL_ARRAY_SIZE];
+    ThermalFrameStats stats;
+    uint64_t motionMask;
+    builtin_interfaces__msg__Time stamp;
+};
+
+/**
+ * The latest thermal frame. Only ThermalCameraNode publishes it, the sequence stays at 0 without a camera
+ */
+extern LocalTopic<ThermalSample> thermalFrames;
 
 class ThermalCameraNode : Node
 {
 public:
-    ThermalCameraNode(idf::GPIONumBase<idf::SDA_type> sda, idf::GPIONumBase<idf::SCL_type> scl, idf::I2CNumber port = idf::I2CNumber::I2C0());
+    static constexpr NodeResources RESOURCES = THERMAL_CAMERA_RESOURCES;
+    static constexpr ExecutorGroup EXECUTOR = EXECUTOR_TELEMETRY;
+
+    explicit ThermalCameraNode(I2cBus *bus);
 
     void setup(rclc_support_t *support, rclc_executor_t *executor) override;
 
     void cleanup() override;
 
 private:
-    std::shared_ptr<idf::I2CMaster> master;
+    I2cDevice camera;
 
     TimerWithContext updateTimer;
     rcl_publisher_t refPublisher;
@@ -37,15 +59,41 @@ private:
     rcl_publisher_t interpolatedPublisher;
     avr_pcc_2023_interfaces__msg__ThermalFrame interpolatedMessage;
 
+    rcl_subscription_t regionsSubscription;
+    std_msgs__msg__UInt8MultiArray regionsMessage;
+    uint8_t regionsMessageBuffer[THERMAL_MAX_REGIONS * sizeof(ThermalRegion)];
+    ThermalRegion regions[THERMAL_MAX_REGIONS];
+    size_t regionCount;
+    rcl_publisher_t roiPublisher;
+    std_msgs__msg__Float32MultiArray roiMessage;
+    std_msgs__msg__MultiArrayDimension roiDimensions[THERMAL_MAX_REGIONS];
+    char roiLabels[THERMAL_MAX_REGIONS][THERMAL_REGION_LABEL_SIZE];
+    float roiPixels[THERMAL_MAX_REGIONS * AMG88XX_PIXEL_ARRAY_SIZE];
+    uint32_t frameCount;
+    rcl_publisher_t statsPublisher;
+    std_msgs__msg__Float32MultiArray statsMessage;
+    std_msgs__msg__MultiArrayDimension statsDimension;
+    float statsData[THERMAL_STATS_SIZE];
+    BackgroundModel background;
+    int16_t rawPixels[AMG88XX_PIXEL_ARRAY_SIZE];
+    uint64_t motionMask;
+    /**
+     * Cleared on setup, so a new connection gets the current mask even if it didn't change
+     */
+    bool motionPublished;
+    rcl_publisher_t motionPublisher;
+    std_msgs__msg__UInt64 motionMessage;
+
     bool updateThermistor;
-    std::vector<uint8_t> thermistorBuffer;
-    std::vector<uint8_t> pixelBuffer;
-    float pixels[AMG88XX_PIXEL_ARRAY_SIZE];
-    int32_t time;
-    uint32_t timeNs;
+    uint8_t thermistorBuffer[2];
+    uint8_t pixelBuffer[AMG88XX_PIXEL_ARRAY_SIZE << 1];
+    builtin_interfaces__msg__Time stamp;
+    bool framePublished;
 
     void updateTimerCallback(rcl_timer_t *timer, int64_t n);
 
+    void regionsCallback(const void *message);
+
 //    void interpolateFrame(float *data);
 
     inline static uint16_t uInt8ToUInt16(uint8_t v0, uint8_t v1)
@@ -55,7 +103,7 @@ private:
 
     static float signedMag12ToFloat(uint16_t val);
 
-    static float int12ToFloat(uint16_t val);
+    static int16_t int12ToInt16(uint16_t val);
 };
 
 
@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <esp_err.h>
+
+#include "i2c_bus.hpp"
+
+#ifndef AVR_PCC_2023_PCA9685_HPP
+#define AVR_PCC_2023_PCA9685_HPP
+
+#define PCA9685_CHANNEL_ALL 16
+#define PCA9685_MAX_PWM_VALUE 4096
+
+/**
+ * A PCA9685 16 channel pwm driver on an I2cBus
+ */
+class Pca9685
+{
+public:
+    Pca9685(I2cBus *bus, uint8_t address, const char *name);
+
+    /**
+     * Turn on register auto increment and wake the chip up
+     */
+    esp_err_t init();
+
+    /**
+     * @param frequency The pwm frequency in Hz, 24 - 1526
+     */
+    esp_err_t setPwmFrequency(uint16_t frequency);
+
+    /**
+     * @param channel The channel, or PCA9685_CHANNEL_ALL
+     * @param value The on time out of 4096, PCA9685_MAX_PWM_VALUE is always on
+     */
+    esp_err_t setPwmValue(uint8_t channel, uint16_t value);
+
+    esp_err_t sleep(bool sleep);
+
+private:
+    I2cDevice device;
+
+    esp_err_t updateMode(uint8_t clear, uint8_t set);
+};
+
+#endif //AVR_PCC_2023_PCA9685_HPP
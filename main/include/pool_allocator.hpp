@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <rcl/allocator.h>
+
+#ifndef AVR_PCC_2023_POOL_ALLOCATOR_HPP
+#define AVR_PCC_2023_POOL_ALLOCATOR_HPP
+
+/**
+ * The number of size classes, from 16 bytes up to 4 KiB
+ */
+#define POOL_ALLOCATOR_POOLS 8
+
+/**
+ * Usage of one size class
+ */
+struct PoolAllocatorStats
+{
+    uint32_t blockSize;
+    uint32_t blocks;
+    uint32_t used;
+    /**
+     * The most blocks that were ever used at once
+     */
+    uint32_t peak;
+    /**
+     * Allocations that found the class full and went to a larger class or the heap
+     */
+    uint32_t exhausted;
+};
+
+/**
+ * Set up the pools. Has to be called before the first allocation
+ */
+void initPoolAllocator();
+
+/**
+ * @return An allocator that hands out blocks from fixed size class pools in a static arena, and only goes to the heap
+ * when a request is larger than the largest class or every class that fits it is full. Without
+ * CONFIG_PCC_POOL_ALLOCATOR, this is the default allocator
+ */
+rcl_allocator_t getPoolAllocator();
+
+/**
+ * @return The usage of a size class, smallest first
+ */
+PoolAllocatorStats getPoolAllocatorStats(size_t pool);
+
+/**
+ * @return How many allocations went to the heap in total
+ */
+uint32_t getPoolAllocatorHeapAllocations();
+
+/**
+ * @return How many heap allocations are currently live
+ */
+uint32_t getPoolAllocatorHeapBlocks();
+
+#endif //AVR_PCC_2023_POOL_ALLOCATOR_HPP
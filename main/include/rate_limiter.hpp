@@ -0,0 +1,38 @@
+#include <atomic>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_RATE_LIMITER_HPP
+#define AVR_PCC_2023_RATE_LIMITER_HPP
+
+/**
+ * A lock-free generic cell rate algorithm: each event pushes the theoretical arrival time forward by one interval, and
+ * events are refused while it is more than a burst ahead of now. Any task may take from it at once
+ */
+class RateLimiter
+{
+public:
+    /**
+     * @param interval The time between events on average, in the unit of the times passed to take
+     * @param burst How many events may come at once after a quiet period
+     */
+    RateLimiter(int64_t interval, uint32_t burst);
+
+    /**
+     * @param now The current time
+     * @return Whether the event is allowed. Refused events are counted
+     */
+    bool take(int64_t now);
+
+    /**
+     * @return The number of events refused
+     */
+    [[nodiscard]] uint32_t getLimited() const;
+
+private:
+    const int64_t interval;
+    const int64_t limit;
+    std::atomic<int64_t> arrivalTime;
+    std::atomic<uint32_t> limited;
+};
+
+#endif //AVR_PCC_2023_RATE_LIMITER_HPP
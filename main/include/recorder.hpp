@@ -0,0 +1,135 @@
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#include <driver/i2c.h>
+#include <rcl/rcl.h>
+#include <rclc/executor.h>
+#include <rclc/rclc.h>
+#include <sdkconfig.h>
+
+#include "node.hpp"
+
+#ifndef AVR_PCC_2023_RECORDER_HPP
+#define AVR_PCC_2023_RECORDER_HPP
+
+/**
+ * Recording is a stream of records, each a RecordHeader followed by its payload. The firmware buffers them and
+ * publishes whole records on the "recording" topic, where tools/pcc_record.py saves them for replay
+ */
+enum RecordType : uint8_t
+{
+    /**
+     * A successful i2c read.
+     * Payload: u8 port, u8 address, u8 write length, the written bytes, then the bytes that were read
+     */
+    RECORD_I2C_READ = 1,
+    /**
+     * A service request, or a command message on a subscription, as it arrived.
+     * Payload: u8 name length, the service or topic name, then the request fields as the callback recorded them
+     */
+    RECORD_SERVICE_REQUEST = 2,
+    /**
+     * Records were dropped because the buffer was full. Payload: u32 number of records dropped
+     */
+    RECORD_GAP = 3
+};
+
+struct __attribute__((packed)) RecordHeader
+{
+    RecordType type;
+    uint8_t reserved;
+    /**
+     * Payload length in bytes, not counting the header
+     */
+    uint16_t length;
+    /**
+     * Milliseconds since boot
+     */
+    uint32_t time;
+};
+
+#if CONFIG_PCC_RECORDING
+
+/**
+ * Create the record buffer, records can be added from any task after this
+ */
+void initRecorder();
+
+/**
+ * Set up the recording publisher and timer on the system node
+ * @param support A micro ros support structure
+ * @param executor The telemetry executor to bind the timer to
+ * @param node The node to publish from
+ */
+void setupRecorder(rclc_support_t *support, rclc_executor_t *executor, rcl_node_t *node);
+
+/**
+ * Clean up the recording publisher and timer. Records keep being buffered until the next setup
+ */
+void cleanupRecorder(rcl_node_t *node);
+
+/**
+ * Record the result of a successful i2c read
+ */
+void recordI2cRead(i2c_port_t port, uint8_t address,
+                   const uint8_t *write_data, size_t write_length,
+                   const uint8_t *read_data, size_t read_length);
+
+/**
+ * Record an incoming service request or command message
+ * @param service The full service or topic name, it is how the replay tool finds what to call
+ * @param fields The request fields in the order of the definition, packed little endian. The tool has to know
+ * the layout for each name, so keep it in sync with tools/pcc_record.py
+ * @param length The number of field bytes
+ */
+void recordServiceRequest(const char *service, const uint8_t *fields, size_t length);
+
+/**
+ * @return The number of records dropped because the buffer was full
+ */
+uint32_t getRecorderDropped();
+
+#else
+
+inline void initRecorder()
+{
+}
+
+inline void setupRecorder(__attribute__((unused)) rclc_support_t *support,
+                          __attribute__((unused)) rclc_executor_t *executor,
+                          __attribute__((unused)) rcl_node_t *node)
+{
+}
+
+inline void cleanupRecorder(__attribute__((unused)) rcl_node_t *node)
+{
+}
+
+inline void recordI2cRead(__attribute__((unused)) i2c_port_t port, __attribute__((unused)) uint8_t address,
+                          __attribute__((unused)) const uint8_t *write_data,
+                          __attribute__((unused)) size_t write_length,
+                          __attribute__((unused)) const uint8_t *read_data,
+                          __attribute__((unused)) size_t read_length)
+{
+}
+
+inline void recordServiceRequest(__attribute__((unused)) const char *service,
+                                 __attribute__((unused)) const uint8_t *fields,
+                                 __attribute__((unused)) size_t length)
+{
+}
+
+inline uint32_t getRecorderDropped()
+{
+    return 0;
+}
+
+#endif
+
+inline void recordServiceRequest(const char *service, std::initializer_list<uint8_t> fields = {})
+{
+    recordServiceRequest(service, fields.begin(), fields.size());
+}
+
+#endif //AVR_PCC_2023_RECORDER_HPP
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <sdkconfig.h>
+
+#ifndef AVR_PCC_2023_STALL_MONITOR_HPP
+#define AVR_PCC_2023_STALL_MONITOR_HPP
+
+/**
+ * The most tasks that can be watched
+ */
+#define STALL_MAX_HEARTBEATS 8
+/**
+ * Task and activity names are cut to this many characters, with the terminator, in stall reports
+ */
+#define STALL_NAME_SIZE 48
+/**
+ * Watched tasks feed the task watchdog at least this often (ms), also while they wait for work
+ */
+#define STALL_FEED_PERIOD 1000
+
+/**
+ * The longest stall of a boot, kept in RTC memory so the next boot can report it after a watchdog reset
+ */
+struct StallReport
+{
+    uint32_t magic;
+    char task[STALL_NAME_SIZE];
+    char activity[STALL_NAME_SIZE];
+    /**
+     * How long the activity had been running when the report was last updated, in ms
+     */
+    uint32_t duration;
+    /**
+     * When the activity started, in ms since boot
+     */
+    uint32_t uptime;
+    /**
+     * The number of stalls in the boot
+     */
+    uint32_t count;
+};
+
+#if CONFIG_PCC_STALL_MONITOR
+
+/**
+ * What a watched task is doing. Only its own task writes it
+ */
+struct Heartbeat
+{
+    const char *task;
+    /**
+     * The running activity, nullptr while the task waits for work
+     */
+    std::atomic<const char *> activity;
+    /**
+     * When the activity started, in us. Only the low 32 bits are kept, like in the callback stats
+     */
+    std::atomic<uint32_t> since;
+};
+
+/**
+ * Pick up the previous boot's stall report and start the monitor task
+ */
+void initStallMonitor();
+
+/**
+ * Watch the calling task: its activities are checked for stalls and it is subscribed to the task watchdog, so it has
+ * to call feedWatchdog at least every STALL_FEED_PERIOD ms from then on
+ * @param name The task name, it must outlive the task
+ */
+void watchTask(const char *name);
+
+/**
+ * Reset the task watchdog for the calling task, if it is watched
+ */
+void feedWatchdog();
+
+/**
+ * Check every heartbeat for an activity that has been running longer than CONFIG_PCC_STALL_TIMEOUT, and report each
+ * stall once. Called by the monitor task
+ * @param time The time in us, truncated to 32 bits
+ * @return The number of tasks that are stalled
+ */
+size_t checkHeartbeats(uint32_t time);
+
+/**
+ * @return The number of stalls since boot
+ */
+uint32_t getStallCount();
+
+/**
+ * @return The longest stall since boot, with a count of 0 if there was none
+ */
+StallReport getStallReport();
+
+/**
+ * Log the previous boot's stall report and how it was reset, once. Called from the diagnostics timer, since logs are
+ * only published after connecting
+ */
+void logPreviousStall();
+
+/**
+ * Whether the previous boot stalled or was reset by a watchdog
+ */
+bool hasPreviousStall();
+
+/**
+ * Marks the calling task as busy with an activity until it goes out of scope, then goes back to the activity it
+ * interrupted. Does nothing on tasks that aren't watched
+ */
+class StallActivity
+{
+public:
+    /**
+     * @param name The activity, it must outlive the scope
+     */
+    explicit StallActivity(const char *name);
+
+    ~StallActivity();
+
+    StallActivity(const StallActivity &) = delete;
+    StallActivity &operator=(const StallActivity &) = delete;
+
+private:
+    Heartbeat *heartbeat;
+    const char *previous;
+};
+
+#else
+
+inline void initStallMonitor()
+{
+}
+
+inline void watchTask(__attribute__((unused)) const char *name)
+{
+}
+
+inline void feedWatchdog()
+{
+}
+
+inline void logPreviousStall()
+{
+}
+
+class StallActivity
+{
+public:
+    explicit StallActivity(__attribute__((unused)) const char *name)
+    {
+    }
+};
+
+#endif
+
+#endif //AVR_PCC_2023_STALL_MONITOR_HPP
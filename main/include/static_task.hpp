@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifndef AVR_PCC_2023_STATIC_TASK_HPP
+#define AVR_PCC_2023_STATIC_TASK_HPP
+
+/**
+ * A task whose control block and stack are in static memory, so starting it never touches the heap. Each one can only
+ * be started once and its function must never return or delete the task, so tasks that run on demand wait for a
+ * notification instead of being created each time
+ */
+class StaticTask
+{
+public:
+    StaticTask(const StaticTask &) = delete;
+
+    StaticTask &operator=(const StaticTask &) = delete;
+
+    /**
+     * @param name The name of the task, it must outlive the task
+     */
+    void start(TaskFunction_t function, const char *name, void *arg, UBaseType_t priority);
+
+    void startPinned(TaskFunction_t function, const char *name, void *arg, UBaseType_t priority, BaseType_t core);
+
+    /**
+     * Wake the task from waitForNotify. A notification sent while the task is busy wakes it again once it waits
+     */
+    void notify();
+
+    /**
+     * Block the calling task until it is notified
+     * @param timeout The longest time to wait, in ticks
+     * @return Whether the task was notified before the timeout
+     */
+    static bool waitForNotify(TickType_t timeout = portMAX_DELAY);
+
+    [[nodiscard]] TaskHandle_t getHandle() const;
+
+protected:
+    /**
+     * @param stack_size The size of the stack in bytes
+     */
+    StaticTask(StackType_t *stack, uint32_t stack_size);
+
+private:
+    StackType_t *stack;
+    const uint32_t stackSize;
+    StaticTask_t buffer;
+    TaskHandle_t handle;
+};
+
+/**
+ * A StaticTask with its stack
+ * @tparam STACK_SIZE The stack size in bytes
+ */
+template<uint32_t STACK_SIZE>
+class StaticStackTask : public StaticTask
+{
+public:
+    StaticStackTask() : StaticTask(stackBuffer, STACK_SIZE),
+                        stackBuffer()
+    {
+    }
+
+private:
+    StackType_t stackBuffer[STACK_SIZE / sizeof(StackType_t)];
+};
+
+#endif //AVR_PCC_2023_STATIC_TASK_HPP
@@ -5,15 +5,26 @@
 #include <rclc/executor.h>
 #include <rclc/rclc.h>
 
+#include <type_traits>
+
+#include "binary_log.hpp"
+#include "callback_stats.hpp"
+#include "diagnostics.hpp"
 #include "neopixel_strip.hpp"
+#include "node.hpp"
 
 #ifndef AVR_PCC_2023_SYSTEM_HPP
 #define AVR_PCC_2023_SYSTEM_HPP
 
 #define LED_PIN GPIO_NUM_13
-#define SYSTEM_EXECUTOR_HANDLES 2
 
+#if CONFIG_PCC_BINARY_LOG
+#define LOG(logLevel, msg) log(logLevel, msg, __FILE__, __PRETTY_FUNCTION__, __LINE__,                    \
+                               std::integral_constant<uint32_t, logSiteId(__FILE__, __LINE__)>::value, \
+                               std::integral_constant<bool, isLogLiteral(#msg)>::value)
+#else
 #define LOG(logLevel, msg) log(logLevel, msg, __FILE__, __PRETTY_FUNCTION__, __LINE__)
+#endif
 
 enum [[maybe_unused]] LogLevel
 {
@@ -23,6 +34,23 @@ enum [[maybe_unused]] LogLevel
     LOGLEVEL_ERROR = rcl_interfaces__msg__Log__ERROR,
     LOGLEVEL_FATAL = rcl_interfaces__msg__Log__FATAL
 };
+enum ConnectionState
+{
+    CONNECTION_WAITING,
+    CONNECTION_CONNECTED,
+    CONNECTION_LOST
+};
+
+struct ConnectionStats
+{
+    uint32_t disconnects;
+    uint32_t reconnects;
+    /**
+     * Time in us from losing the agent to being set up again, for the last reconnect
+     */
+    int64_t lastReconnectTime;
+};
+
 #define HANDLE_ROS_ERROR(rc, do_reset) handleError(rc, true, do_reset, __FILE__, __PRETTY_FUNCTION__, __LINE__)
 #define HANDLE_ESP_ERROR(rc, do_reset) handleError(rc, false, do_reset, __FILE__, __PRETTY_FUNCTION__, __LINE__)
 #define CONTEXT_TASK_CALLBACK(cls, func) [](void *void_context)                                \
@@ -32,9 +60,16 @@ enum [[maybe_unused]] LogLevel
 }
 #define CONTEXT_SERVICE_CALLBACK(cls, func) [](const void *req, void *res, void *void_context) \
 {                                                                                              \
+    MEASURE_CALLBACK(#cls "::" #func);                                                         \
     auto context = (cls *) void_context;                                                       \
     context->func(req, res);                                                                   \
 }
+#define CONTEXT_SUBSCRIPTION_CALLBACK(cls, func) [](const void *msg, void *void_context)         \
+{                                                                                              \
+    MEASURE_CALLBACK(#cls "::" #func);                                                         \
+    auto context = (cls *) void_context;                                                       \
+    context->func(msg);                                                                        \
+}
 
 /**
  * Set the NeopixelStrip object to use for the status light
@@ -42,16 +77,34 @@ enum [[maybe_unused]] LogLevel
 void setStatusStrip(NeopixelStrip *strip);
 
 /**
- * Send a log message on a ros topic
+ * Queue a log message to be sent on a ros topic by the log drain task
  * @param level The log level
- * @param msg The log message to be sent
- * @param file The name of the file where the log was called
- * @param function The function where the log was called
+ * @param msg The log message to be sent, it is copied
+ * @param file The name of the file where the log was called, it must be a string literal
+ * @param function The function where the log was called, it must be a string literal
  * @param line The line number that the log was called
- * @return Whether it was successful
+ * @param site The binary log site id, or 0 to compute it from file and line
+ * @param literal Whether msg is a single string literal, in which case binary logging doesn't send it
+ * @return Whether it was queued
  */
 bool log(LogLevel level,
-         const char msg[], const char file[] = "", const char function[] = "", uint32_t line = 0);
+         const char msg[], const char file[] = "", const char function[] = "", uint32_t line = 0,
+         uint32_t site = 0, bool literal = false);
+
+/**
+ * Publish all queued log messages from the calling task
+ */
+void flushLog();
+
+/**
+ * @return The number of log messages dropped because the log buffer was full
+ */
+uint32_t getDroppedLogs();
+
+/**
+ * @return The number of ESP-IDF log lines that were not sent to /rosout because of the rate limit
+ */
+uint32_t getRateLimitedEspLogs();
 
 /**
  * Checks the error code passed in and logs if it is an issue
@@ -68,11 +121,11 @@ bool handleError(int32_t rc,
                  const char file[] = "", const char function[] = "", uint32_t line = 0);
 
 /**
- * Set up logging and reset service
+ * Set up logging, diagnostics and the system services
  * @param support A micro ros support structure
- * @param executor An initialized executor to bind handles to
+ * @param executors The initialized executors to bind handles to, indexed by ExecutorGroup
  */
-void setupSystem(rclc_support_t *support, rclc_executor_t *executor);
+void setupSystem(rclc_support_t *support, rclc_executor_t *executors);
 
 /**
  * Clean up logging and reset service
@@ -80,9 +133,19 @@ void setupSystem(rclc_support_t *support, rclc_executor_t *executor);
 void cleanupSystem();
 
 /**
- * Initializes the logging and starts the ping timer
+ * @return The state of the connection to the micro-ros agent
+ */
+ConnectionState getConnectionState();
+
+/**
+ * @return Counters for agent disconnects and reconnects since boot
+ */
+ConnectionStats getConnectionStats();
+
+/**
+ * Initializes the logging and starts the connection thread
  * @param setup_func Function to call when connecting to agent
- * @param cleanup_func Function to call when disconnecting from agent
+ * @param cleanup_func Function to call when disconnecting from agent. It may be followed by another setup_func call
  */
 void initSystem(void (*setup_func)(), void (*cleanup_func)());
 
@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_TASK_STATS_HPP
+#define AVR_PCC_2023_TASK_STATS_HPP
+
+#define TASK_STATS_MAX_TASKS 24
+/**
+ * A task is low on stack when it has had less than this many bytes left
+ */
+#define TASK_STATS_STACK_WARNING 256
+
+/**
+ * A snapshot of one task from the task stats source
+ */
+struct TaskSample
+{
+    /**
+     * A number that identifies the task for as long as it exists
+     */
+    uint32_t id;
+    const char *name;
+    uint32_t runTime;
+    /**
+     * The least stack the task has had left, in bytes
+     */
+    uint32_t stackHighWaterMark;
+};
+
+/**
+ * A task's usage over the last interval
+ */
+struct TaskUsage
+{
+    const char *name;
+    float cpuPercent;
+    uint32_t stackHighWaterMark;
+    bool lowStack;
+};
+
+/**
+ * Turns run time counter snapshots into per task cpu usage over the time between snapshots
+ */
+class TaskStatsAggregator
+{
+public:
+    TaskStatsAggregator();
+
+    /**
+     * Add a new snapshot
+     * @param samples The tasks that exist right now
+     * @param count The number of samples
+     * @param total_run_time The run time counter at the time of the snapshot
+     * @param cores The number of cores the tasks share, usage is a percentage of all of them
+     * @param usages Where to write the usage for each sample, in the same order
+     * @return The number of usages written. Tasks that are new since the last snapshot are measured from their start
+     */
+    size_t update(const TaskSample *samples, size_t count, uint32_t total_run_time, uint32_t cores, TaskUsage *usages);
+
+private:
+    struct History
+    {
+        uint32_t id;
+        uint32_t runTime;
+    };
+
+    History history[TASK_STATS_MAX_TASKS];
+    size_t historyCount;
+    uint32_t lastTotalRunTime;
+};
+
+#endif //AVR_PCC_2023_TASK_STATS_HPP
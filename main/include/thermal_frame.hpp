@@ -0,0 +1,101 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_THERMAL_FRAME_HPP
+#define AVR_PCC_2023_THERMAL_FRAME_HPP
+
+#define AMG88XX_PIXEL_ARRAY_SIZE 64
+#define AMG88XX_GRID_SIZE 8
+#define THERMAL_MAX_REGIONS 4
+/**
+ * The histogram covers the AMG88xx's 0 - 80 C range in 10 C bins, values outside go in the first or last bin
+ */
+#define THERMAL_HISTOGRAM_BINS 8
+#define THERMAL_HISTOGRAM_MIN 0.0f
+#define THERMAL_HISTOGRAM_BIN_WIDTH 10.0f
+/**
+ * min, max, mean, hottest pixel index, then the histogram counts
+ */
+#define THERMAL_STATS_SIZE (4 + THERMAL_HISTOGRAM_BINS)
+
+/**
+ * A rectangle of pixels on the raw 8x8 grid
+ */
+struct ThermalRegion
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+};
+
+/**
+ * Frame statistics, accumulated one pixel at a time while the frame is converted
+ */
+struct ThermalFrameStats
+{
+    float min;
+    float max;
+    float sum;
+    uint8_t hottest;
+    uint8_t count;
+    uint8_t histogram[THERMAL_HISTOGRAM_BINS];
+
+    inline void reset()
+    {
+        *this = {INFINITY, -INFINITY, 0, 0, 0, {}};
+    }
+
+    inline void add(uint8_t index, float value)
+    {
+        if (value > max)
+        {
+            max = value;
+            hottest = index;
+        }
+        min = value < min ? value : min;
+        sum += value;
+        count++;
+
+        int bin = (int) ((value - THERMAL_HISTOGRAM_MIN) * (1 / THERMAL_HISTOGRAM_BIN_WIDTH));
+        bin = bin < 0 ? 0 : (bin >= THERMAL_HISTOGRAM_BINS ? THERMAL_HISTOGRAM_BINS - 1 : bin);
+        histogram[bin]++;
+    }
+
+    /**
+     * Write the stats in the stats topic layout
+     * @param output Room for THERMAL_STATS_SIZE values
+     */
+    inline void write(float *output) const
+    {
+        output[0] = min;
+        output[1] = max;
+        output[2] = count > 0 ? sum / (float) count : 0;
+        output[3] = hottest;
+        for (size_t i = 0; i < THERMAL_HISTOGRAM_BINS; i++)
+        {
+            output[4 + i] = histogram[i];
+        }
+    }
+};
+
+/**
+ * Check a region of interest list from the roi_config topic
+ * @param data x, y, width, height for each region
+ * @param size The number of bytes
+ * @return nullptr if the list is valid, or else a message explaining why not
+ */
+const char *validateThermalRegions(const uint8_t *data, size_t size);
+
+/**
+ * Copy the pixels in each region out of a frame, row by row, one region after the other
+ * @param frame The 8x8 frame, row major
+ * @param regions Valid regions
+ * @param count The number of regions
+ * @param output Room for the pixels of every region
+ * @return The number of pixels written
+ */
+size_t extractThermalRegions(const float *frame, const ThermalRegion *regions, size_t count, float *output);
+
+#endif //AVR_PCC_2023_THERMAL_FRAME_HPP
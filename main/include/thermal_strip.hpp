@@ -0,0 +1,43 @@
+#include <cstddef>
+#include <color.h>
+#include <sdkconfig.h>
+
+#include "thermal_frame.hpp"
+
+#ifndef AVR_PCC_2023_THERMAL_STRIP_HPP
+#define AVR_PCC_2023_THERMAL_STRIP_HPP
+
+enum LedStripThermalView
+{
+    /**
+     * The strip is stretched over the frame's columns, each LED shows the hottest pixel of its columns
+     */
+    LED_STRIP_THERMAL_COLUMNS = 0,
+    /**
+     * Only the LEDs at the hottest pixel's column are lit, in its color
+     */
+    LED_STRIP_THERMAL_BEARING = 1
+};
+
+/**
+ * @param low The temperature that maps to the first color, CONFIG_PCC_LED_THERMAL_SPAN above it maps to the last
+ * @return The temperature's color, black through purple, red and orange to white
+ */
+rgb_t thermalColor(float temperature, float low);
+
+/**
+ * @param pixels A frame, row by row
+ * @param column_max Set to the hottest pixel of each column
+ */
+void thermalColumnMax(const float *pixels, float *column_max);
+
+/**
+ * The color of one LED for a frame, with the colors spread from the frame's mean to CONFIG_PCC_LED_THERMAL_SPAN
+ * above it. Each LED covers the columns it overlaps, so a short strip still shows every column
+ * @param column_max The frame's column maxima from thermalColumnMax
+ * @param led The LED, of length
+ */
+rgb_t thermalStripColor(const float *column_max, const ThermalFrameStats &stats, LedStripThermalView view,
+                        size_t led, size_t length);
+
+#endif //AVR_PCC_2023_THERMAL_STRIP_HPP
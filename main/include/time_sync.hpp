@@ -0,0 +1,144 @@
+#include <cstdint>
+
+#include <builtin_interfaces/msg/time.h>
+
+#ifndef AVR_PCC_2023_TIME_SYNC_HPP
+#define AVR_PCC_2023_TIME_SYNC_HPP
+
+/**
+ * A sample further than this (ns) from the model, plus TIME_SYNC_OUTLIER_DRIFT ppm of the time since the last sample
+ * for the drift it hasn't caught yet, is taken as an answer held up on the link and ignored
+ */
+#define TIME_SYNC_OUTLIER_THRESHOLD 2000000LL
+#define TIME_SYNC_OUTLIER_DRIFT 100
+/**
+ * After this many ignored samples in a row the clock really moved, and the next sample is used whatever its error
+ */
+#define TIME_SYNC_MAX_OUTLIERS 2
+/**
+ * Errors bigger than this (ns) that outlast the outliers are stepped instead of slewed, so time can jump backwards when
+ * it is this far off
+ */
+#define TIME_SYNC_STEP_THRESHOLD 100000000LL
+/**
+ * Smaller errors are slewed out over this long (us), so time never goes backwards
+ */
+#define TIME_SYNC_SLEW_TIME 2000000LL
+/**
+ * Each new drift measurement moves the estimate 1 / TIME_SYNC_DRIFT_FILTER of the way
+ */
+#define TIME_SYNC_DRIFT_FILTER 8
+
+/**
+ * Models a reference clock in ns as a function of a local clock in us from occasional pairs of readings.
+ * The drift between the clocks is estimated from consecutive samples and smaller offset errors are slewed in,
+ * so that for a given model converting increasing local times gives increasing reference times
+ */
+class ClockModel
+{
+public:
+    ClockModel();
+
+    /**
+     * Add a pair of clock readings taken at the same moment
+     * @param local The local clock in us
+     * @param reference The reference clock in ns
+     */
+    void addSample(int64_t local, int64_t reference);
+
+    /**
+     * @param local A local time in us
+     * @return The reference time in ns, or the local time in ns if there are no samples yet
+     */
+    [[nodiscard]] int64_t toReference(int64_t local) const;
+
+    [[nodiscard]] bool isSynced() const;
+
+    /**
+     * @return How much faster the reference clock runs than the local clock, in parts per billion
+     */
+    [[nodiscard]] int64_t getDrift() const;
+
+    /**
+     * @return The difference between the last sample and the model's prediction for it, in ns, even if it was ignored
+     */
+    [[nodiscard]] int64_t getLastError() const;
+
+    /**
+     * @return The number of samples ignored as outliers
+     */
+    [[nodiscard]] uint32_t getOutliers() const;
+
+private:
+    int64_t anchorLocal;
+    int64_t anchorReference;
+    /**
+     * The error being slewed in after the anchor
+     */
+    int64_t correction;
+    int64_t drift;
+    int64_t lastSampleLocal;
+    int64_t lastSampleReference;
+    int64_t lastError;
+    uint32_t samples;
+    uint32_t outliers;
+    /**
+     * Outliers since the last sample that was used
+     */
+    uint32_t recentOutliers;
+};
+
+/**
+ * Create the lock for the clock model, must be called before any other time sync function
+ */
+void initTimeSync();
+
+/**
+ * Synchronize with the agent and add the result to the clock model. The session must be set up
+ * @return Whether the agent answered
+ */
+bool syncTime();
+
+/**
+ * @return Whether at least one sync with the agent has worked
+ */
+bool isTimeSynced();
+
+/**
+ * @return The estimated drift between the agent's clock and esp_timer, in parts per billion
+ */
+int64_t getClockDrift();
+
+/**
+ * @return The error of the model at the last sync in ns
+ */
+int64_t getClockSyncError();
+
+/**
+ * @return The number of syncs ignored as outliers
+ */
+uint32_t getClockSyncOutliers();
+
+/**
+ * @param local A time from esp_timer_get_time
+ * @return The agent's epoch time in ns, or the time since boot in ns before the first sync
+ */
+int64_t toEpochNanos(int64_t local);
+
+/**
+ * @return The current agent epoch time in ns
+ */
+int64_t getEpochNanos();
+
+/**
+ * Fill in a message stamp
+ * @param local A time from esp_timer_get_time
+ */
+void toStamp(int64_t local, builtin_interfaces__msg__Time *stamp);
+
+/**
+ * Fill in a message stamp with the current time
+ */
+void stampNow(builtin_interfaces__msg__Time *stamp);
+
+#endif //AVR_PCC_2023_TIME_SYNC_HPP
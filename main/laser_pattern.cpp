@@ -0,0 +1,61 @@
+#include "laser_pattern.hpp"
+
+const char *validateLaserPattern(const uint16_t *data, size_t size)
+{
+    if (size < 3 || (size & 1) == 0)
+    {
+        return "Pattern must be a repeat count followed by on/off pairs";
+    }
+    if ((size >> 1) > LASER_PATTERN_MAX_PULSES)
+    {
+        return "Too many pulses";
+    }
+    if (data[0] == 0 || data[0] > LASER_PATTERN_MAX_REPEATS)
+    {
+        return "Invalid repeat count";
+    }
+
+    uint32_t total_on_time = 0;
+    uint32_t total_time = 0;
+    for (size_t i = 1; i < size; i += 2)
+    {
+        const uint16_t on_time = data[i];
+        const uint16_t off_time = data[i + 1];
+        if (on_time == 0 || on_time > LASER_PATTERN_MAX_ON_TIME)
+        {
+            return "Pulse on time out of range";
+        }
+        if (off_time < LASER_PATTERN_MIN_OFF_TIME)
+        {
+            return "Pulse off time too short";
+        }
+        total_on_time += on_time;
+        total_time += on_time + off_time;
+    }
+    if (total_on_time * 100 > total_time * LASER_PATTERN_MAX_DUTY_PERCENT)
+    {
+        return "Duty cycle too high";
+    }
+
+    return nullptr;
+}
+
+size_t loadLaserPattern(const uint16_t *data, size_t size, LaserPulse *pulses, uint16_t *repeats)
+{
+    *repeats = data[0];
+    const size_t length = size >> 1;
+    for (size_t pulse = 0; pulse < length; pulse++)
+    {
+        pulses[pulse].onTime = data[(pulse << 1) + 1];
+        pulses[pulse].offTime = data[(pulse << 1) + 2];
+    }
+    return length;
+}
+
+uint32_t advanceLaserPulse(uint32_t *wake_time, uint32_t ticks, uint32_t now)
+{
+    *wake_time += ticks;
+    // Unsigned, so this also works across the tick count wrapping. Past the edge, it is more than ticks
+    const uint32_t remaining = *wake_time - now;
+    return remaining <= ticks ? remaining : 0;
+}
@@ -0,0 +1,214 @@
+#include "link_budget.hpp"
+
+#if CONFIG_PCC_LINK_BUDGET
+
+#include <algorithm>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <rosidl_typesupport_microxrcedds_c/identifier.h>
+#include <rosidl_typesupport_microxrcedds_c/message_type_support.h>
+
+#include "esp32_serial_transport.hpp"
+
+/**
+ * Budgets save up at most this long's worth of bytes (ms), so an idle class can send a short burst
+ */
+#define LINK_BUDGET_BURST 200
+/**
+ * Bits on the wire per byte, with the start and stop bits
+ */
+#define LINK_BITS_PER_BYTE 10
+
+struct LinkClassBudget
+{
+    /**
+     * The class's share of the link capacity, in percent
+     */
+    uint8_t share;
+    /**
+     * The class only sends while the link has more than this share of its burst left, in percent. Higher for lower
+     * priorities, so they back off first and leave room for the classes above them and unbudgeted traffic
+     */
+    uint8_t linkReserve;
+    /**
+     * Bytes the class can still send
+     */
+    float tokens;
+    LinkClassStats stats;
+};
+
+static LinkClassBudget budgets[LINK_CLASSES] = {
+        {CONFIG_PCC_LINK_TELEMETRY_SHARE, 0, 0, {}},
+        {CONFIG_PCC_LINK_LOG_SHARE, 25, 0, {}},
+        {CONFIG_PCC_LINK_BULK_SHARE, 50, 0, {}}
+};
+/**
+ * Bytes the link can take right now. Everything written to the uart uses it up, budgeted or not
+ */
+static float linkTokens;
+static int64_t lastRefillTime;
+static uint32_t lastBytesOut;
+static int64_t lastUtilizationTime;
+static uint32_t lastUtilizationBytes;
+static StaticSemaphore_t linkBudgetLockBuffer;
+static SemaphoreHandle_t linkBudgetLock;
+
+/**
+ * @return The link capacity in bytes per second
+ */
+static float linkCapacity()
+{
+    return (float) esp32SerialGetBaudRate() / LINK_BITS_PER_BYTE;
+}
+
+/**
+ * @return The size of a message in CDR, as the XRCE client writes it
+ */
+static size_t serializedSize(const rosidl_message_type_support_t *type_support, const void *message)
+{
+    const rosidl_message_type_support_t *handle =
+            get_message_typesupport_handle(type_support, ROSIDL_TYPESUPPORT_MICROXRCEDDS_C__IDENTIFIER_VALUE);
+    if (handle == nullptr)
+    {
+        return 0;
+    }
+    auto callbacks = (const message_type_support_callbacks_t *) handle->data;
+    return callbacks->get_serialized_size(message);
+}
+
+static uint32_t bytesOut()
+{
+    Esp32SerialStats serial_stats;
+    esp32SerialGetStats(&serial_stats);
+    return serial_stats.bytesOut;
+}
+
+/**
+ * Add the tokens earned since the last refill. Must be called with linkBudgetLock held
+ */
+static void refill()
+{
+    const int64_t now = esp_timer_get_time();
+    const float elapsed = (float) (now - lastRefillTime) / 1000000;
+    lastRefillTime = now;
+    const uint32_t bytes_out = bytesOut();
+    const uint32_t written = bytes_out - lastBytesOut;
+    lastBytesOut = bytes_out;
+
+    // The link can owe at most a second of traffic, in case the counters jump after a baud rate change
+    const float capacity = linkCapacity();
+    linkTokens = std::clamp(linkTokens + capacity * elapsed - (float) written,
+                            -capacity,
+                            capacity * LINK_BUDGET_BURST / 1000);
+    for (LinkClassBudget &budget : budgets)
+    {
+        const float rate = capacity * (float) budget.share / 100;
+        budget.tokens = std::min(budget.tokens + rate * elapsed, rate * LINK_BUDGET_BURST / 1000);
+    }
+}
+
+/**
+ * Must be called with linkBudgetLock held, after refill
+ */
+static bool ready(LinkClass link_class)
+{
+    LinkClassBudget &budget = budgets[link_class];
+    const float link_burst = linkCapacity() * LINK_BUDGET_BURST / 1000;
+    if (budget.tokens > 0 && linkTokens > link_burst * (float) budget.linkReserve / 100)
+    {
+        return true;
+    }
+    budget.stats.held++;
+    return false;
+}
+
+/**
+ * Must be called with linkBudgetLock held
+ */
+static void charge(LinkClass link_class, size_t bytes)
+{
+    LinkClassBudget &budget = budgets[link_class];
+    budget.tokens -= (float) (bytes + LINK_MESSAGE_OVERHEAD);
+    budget.stats.messages++;
+    budget.stats.bytes += bytes + LINK_MESSAGE_OVERHEAD;
+}
+
+void initLinkBudget()
+{
+    linkBudgetLock = xSemaphoreCreateMutexStatic(&linkBudgetLockBuffer);
+
+    lastRefillTime = esp_timer_get_time();
+    lastUtilizationTime = lastRefillTime;
+    lastBytesOut = bytesOut();
+    lastUtilizationBytes = lastBytesOut;
+    // Start with full budgets
+    linkTokens = linkCapacity() * LINK_BUDGET_BURST / 1000;
+    for (LinkClassBudget &budget : budgets)
+    {
+        budget.tokens = linkCapacity() * (float) budget.share / 100 * LINK_BUDGET_BURST / 1000;
+    }
+}
+
+bool linkBudgetReady(LinkClass link_class)
+{
+    xSemaphoreTake(linkBudgetLock, portMAX_DELAY);
+    refill();
+    const bool result = ready(link_class);
+    xSemaphoreGive(linkBudgetLock);
+    return result;
+}
+
+void linkBudgetCharge(LinkClass link_class, size_t bytes)
+{
+    xSemaphoreTake(linkBudgetLock, portMAX_DELAY);
+    charge(link_class, bytes);
+    xSemaphoreGive(linkBudgetLock);
+}
+
+bool linkBudgetTake(LinkClass link_class, size_t bytes)
+{
+    xSemaphoreTake(linkBudgetLock, portMAX_DELAY);
+    refill();
+    const bool result = ready(link_class);
+    if (result)
+    {
+        charge(link_class, bytes);
+    }
+    xSemaphoreGive(linkBudgetLock);
+    return result;
+}
+
+bool linkBudgetTakeMessage(LinkClass link_class, const rosidl_message_type_support_t *type_support,
+                           const void *message)
+{
+    return linkBudgetTake(link_class, serializedSize(type_support, message));
+}
+
+void linkBudgetChargeMessage(LinkClass link_class, const rosidl_message_type_support_t *type_support,
+                             const void *message)
+{
+    linkBudgetCharge(link_class, serializedSize(type_support, message));
+}
+
+LinkClassStats getLinkClassStats(LinkClass link_class)
+{
+    xSemaphoreTake(linkBudgetLock, portMAX_DELAY);
+    const LinkClassStats stats = budgets[link_class].stats;
+    xSemaphoreGive(linkBudgetLock);
+    return stats;
+}
+
+float getLinkUtilization()
+{
+    const int64_t now = esp_timer_get_time();
+    const uint32_t bytes_out = bytesOut();
+    const float capacity = linkCapacity() * (float) (now - lastUtilizationTime) / 1000000;
+    const float utilization = capacity > 0 ? 100 * (float) (bytes_out - lastUtilizationBytes) / capacity : 0;
+    lastUtilizationTime = now;
+    lastUtilizationBytes = bytes_out;
+    return utilization;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#include "log_buffer.hpp"
+
+#include <cstdio>
+
+LogBuffer::LogBuffer() : slots(),
+                         enqueuePosition(0),
+                         dequeuePosition(0),
+                         dropped(0)
+{
+    for (uint32_t i = 0; i < LOG_BUFFER_RECORDS; i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+uint32_t LogBuffer::getDropped() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+bool LogBuffer::pushFormatted(int64_t stamp, uint8_t level,
+                              const char *file, const char *function, uint32_t line, uint32_t site,
+                              const char *format, va_list args)
+{
+    return push(stamp, level, file, function, line, site,
+                [format, &args](char *buffer, size_t size)
+                {
+                    const int written = vsnprintf(buffer, size, format, args);
+                    size_t message_length = written < 0 ? 0 : (size_t) written;
+                    if (message_length >= size)
+                    {
+                        message_length = size - 1;
+                    }
+                    while (message_length > 0 && buffer[message_length - 1] == '\n')
+                    {
+                        message_length--;
+                    }
+                    return message_length;
+                });
+}
@@ -1,19 +1,27 @@
-#include <i2cdev.h>
-#include <gpio_cxx.hpp>
 #include <driver/gpio.h>
 #include <driver/uart.h>
 #include <esp_log.h>
 #include <freertos/task.h>
+#include <atomic>
 
 #include <rcl/error_handling.h>
 #include <rcl/rcl.h>
+#include <rcutils/allocator.h>
 #include <rclc/executor.h>
 #include <rclc/rclc.h>
 
 #include <rmw_microros/rmw_microros.h>
+#include <rmw_microxrcedds_c/config.h>
 
+#include "boot.hpp"
 #include "esp32_serial_transport.hpp"
+#include "i2c_bus.hpp"
 #include "neopixel_strip.hpp"
+#include "node_registry.hpp"
+#include "pool_allocator.hpp"
+#include "recorder.hpp"
+#include "stall_monitor.hpp"
+#include "static_task.hpp"
 #include "system.hpp"
 
 #include "nodes/laser.hpp"
@@ -25,49 +33,129 @@
 #error micro-ROS transports misconfigured
 #endif
 
-#define EXECUTOR_HANDLES (SYSTEM_EXECUTOR_HANDLES + \
-                          LASER_NODE_EXECUTOR_HANDLES + \
-                          LED_STRIP_NODE_EXECUTOR_HANDLES + \
-                          SERVO_NODE_EXECUTOR_HANDLES + \
-                          THERMAL_CAMERA_NODE_EXECUTOR_HANDLES)
+/**
+ * Every node, in setup order. Adding a node here sizes the executor and checks the micro-ROS limits for it
+ */
+using PccNodes = NodeRegistry<LaserNode, LedStripNode, ServoNode, ThermalCameraNode>;
+
+static constexpr NodeResources resources = SYSTEM_RESOURCES + DIAGNOSTICS_RESOURCES + RECORDER_RESOURCES +
+                                           PccNodes::RESOURCES;
+static_assert(resources == PCC_RESOURCES, "Add the node's resources to PCC_RESOURCES in node_resources.hpp");
+static_assert(resources.nodes <= RMW_UXRCE_MAX_NODES,
+              "Too many nodes, raise RMW_UXRCE_MAX_NODES in app-colcon.meta");
+static_assert(resources.publishers <= RMW_UXRCE_MAX_PUBLISHERS,
+              "Too many publishers, raise RMW_UXRCE_MAX_PUBLISHERS in app-colcon.meta");
+static_assert(resources.subscriptions <= RMW_UXRCE_MAX_SUBSCRIPTIONS,
+              "Too many subscriptions, raise RMW_UXRCE_MAX_SUBSCRIPTIONS in app-colcon.meta");
+static_assert(resources.services <= RMW_UXRCE_MAX_SERVICES,
+              "Too many services, raise RMW_UXRCE_MAX_SERVICES in app-colcon.meta");
+
+static StaticStackTask<12288> controlExecutorTask;
+static StaticStackTask<16000> telemetryExecutorTask;
+
+/**
+ * How each executor is spun. Control waits on the session so commands run as soon as they arrive. Telemetry is mostly
+ * timers, so it polls without waiting and sleeps in between, instead of holding the session while it waits. Its
+ * subscriptions, like roi_config, are picked up by the same poll, up to CONFIG_PCC_TELEMETRY_SPIN_PERIOD late
+ */
+struct ExecutorTask
+{
+    const char *name;
+    StaticTask *task;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t spinTimeout;
+    uint32_t idleDelay;
+};
+
+static const ExecutorTask executorTasks[EXECUTOR_GROUPS] = {
+        {"uros_control", &controlExecutorTask, 4, 1, CONFIG_PCC_CONTROL_SPIN_TIMEOUT, 0},
+        {"uros_telemetry", &telemetryExecutorTask, 2, 0, 0, CONFIG_PCC_TELEMETRY_SPIN_PERIOD}
+};
+
+static constexpr size_t executorHandles[EXECUTOR_GROUPS] = {
+        SYSTEM_RESOURCES.executorHandles() + PccNodes::executorHandles(EXECUTOR_CONTROL),
+        DIAGNOSTICS_RESOURCES.executorHandles() + RECORDER_RESOURCES.executorHandles() +
+        PccNodes::executorHandles(EXECUTOR_TELEMETRY)
+};
 
 static const size_t uartPort = UART_NUM_0;
 
 NeopixelStrip *strip;
+I2cBus *servoBus;
+I2cBus *thermalBus;
 
 rcl_allocator_t allocator;
 rclc_support_t support;
-rclc_executor_t executor;
+rclc_executor_t executors[EXECUTOR_GROUPS];
+
+PccNodes nodes;
+InitScheduler boot;
 
-LaserNode *laserNode;
-LedStripNode *ledStripNode;
-ServoNode *servoNode;
-ThermalCameraNode *thermalCameraNode;
+std::atomic<bool> executorRunning = false;
+std::atomic<uint32_t> runningExecutors = 0;
+
+void executorThread(void *arg)
+{
+    const auto group = (ExecutorGroup) (uintptr_t) arg;
+    const ExecutorTask &task = executorTasks[group];
+    watchTask(task.name);
+    // The task outlives the session, it waits here until the next one is set up
+    while (true)
+    {
+        while (!StaticTask::waitForNotify(STALL_FEED_PERIOD / portTICK_PERIOD_MS))
+        {
+            feedWatchdog();
+        }
+        while (executorRunning)
+        {
+            feedWatchdog();
+            {
+                // Callbacks mark themselves, this covers the executor and the transport in between
+                StallActivity activity("spin");
+                rclc_executor_spin_some(&executors[group], RCL_MS_TO_NS(task.spinTimeout));
+            }
+            if (task.idleDelay > 0)
+            {
+                vTaskDelay(task.idleDelay / portTICK_PERIOD_MS);
+            }
+        }
+        runningExecutors--;
+    }
+}
 
 void setup()
 {
+    // The agent can answer before the peripherals are ready
+    boot.wait();
+
     // Init support
     HANDLE_ROS_ERROR(rclc_support_init(&support, 0, nullptr, &allocator), true);
 
-    // Init executor
-    HANDLE_ROS_ERROR(rclc_executor_init(&executor, &support.context, EXECUTOR_HANDLES, &allocator), true);
+    // Init executors
+    for (size_t group = 0; group < EXECUTOR_GROUPS; group++)
+    {
+        HANDLE_ROS_ERROR(rclc_executor_init(&executors[group], &support.context, executorHandles[group], &allocator),
+                         true);
+        HANDLE_ROS_ERROR(rclc_executor_set_trigger(&executors[group], callbackStatsTrigger, nullptr), true);
+    }
 
-    setupSystem(&support, &executor);
+    setupSystem(&support, executors);
 
     ESP_LOGI("agent", "Connected to micro-ros agent");
 
-    laserNode->setup(&support, &executor);
-    ledStripNode->setup(&support, &executor);
-    servoNode->setup(&support, &executor);
-    thermalCameraNode->setup(&support, &executor);
+    if (!nodes.setup(&support, executors))
+    {
+        LOG(LOGLEVEL_ERROR, "A node added a different number of executor handles than its RESOURCES declare");
+    }
 
-    // Spin the executor
-    xTaskCreate([](void *arg) { rclc_executor_spin(&executor); },
-                "uros_executor",
-                16000,
-                nullptr,
-                3,
-                nullptr);
+    // Spin the executors
+    executorRunning = true;
+    runningExecutors = EXECUTOR_GROUPS;
+    for (const ExecutorTask &task : executorTasks)
+    {
+        task.task->notify();
+    }
 
     HANDLE_ESP_ERROR(gpio_set_level(LED_PIN, 1), true);
 
@@ -78,16 +166,56 @@ void cleanup()
 {
     ESP_LOGI("agent", "Disconnected from micro-ros agent");
 
-    thermalCameraNode->cleanup();
-    servoNode->cleanup();
-    ledStripNode->cleanup();
-    laserNode->cleanup();
+    executorRunning = false;
+    while (runningExecutors > 0)
+    {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    // The agent may be gone, so don't wait for it to confirm that entities are destroyed
+    rmw_context_t *rmw_context = rcl_context_get_rmw_context(&support.context);
+    HANDLE_ROS_ERROR(rmw_uros_set_context_entity_destroy_session_timeout(rmw_context, 0), false);
+
+    nodes.cleanup();
 
     cleanupSystem();
+
+    for (rclc_executor_t &executor : executors)
+    {
+        HANDLE_ROS_ERROR(rclc_executor_fini(&executor), false);
+    }
+    HANDLE_ROS_ERROR(rclc_support_fini(&support), false);
+}
+
+void initServoBus(__attribute__((unused)) void *context)
+{
+    servoBus = new I2cBus(I2C_NUM_0, GPIO_NUM_23, GPIO_NUM_22, 400000);
+}
+
+void initThermalBus(__attribute__((unused)) void *context)
+{
+    thermalBus = new I2cBus(I2C_NUM_1, GPIO_NUM_18, GPIO_NUM_19, 100000);
+}
+
+void initServoNode(__attribute__((unused)) void *context)
+{
+    nodes.emplace<ServoNode>(servoBus);
+}
+
+void initThermalCameraNode(__attribute__((unused)) void *context)
+{
+    nodes.emplace<ThermalCameraNode>(thermalBus);
+}
+
+void initLaserNode(__attribute__((unused)) void *context)
+{
+    nodes.emplace<LaserNode>(GPIO_NUM_4);
 }
 
 extern "C" [[maybe_unused]] void app_main()
 {
+    BootPhase phase("app_main");
+
     // Setup status led
     const gpio_config_t led_pin_config = {
             1ULL << LED_PIN,
@@ -99,9 +227,7 @@ extern "C" [[maybe_unused]] void app_main()
     HANDLE_ESP_ERROR(gpio_config(&led_pin_config), true);
     HANDLE_ESP_ERROR(gpio_set_level(LED_PIN, 0), true);
 
-    i2cdev_init();
-
-    // Setup neopixel strip
+    // Setup neopixel strip, before anything that can fail, since errors are shown on it
     strip = new NeopixelStrip(GPIO_NUM_12, NEOPIXEL_TYPE_WS2812, 30);
     strip->fill(75, 0, 255);
     strip->show();
@@ -117,15 +243,37 @@ extern "C" [[maybe_unused]] void app_main()
             esp32SerialRead
     ), true);
 
-    // Get allocator
-    allocator = rcl_get_default_allocator();
+    // Every micro-ROS allocation, including the ones that use rcutils' default allocator, comes from the pools
+    initPoolAllocator();
+    allocator = getPoolAllocator();
+    if (!rcutils_set_default_allocator(&allocator))
+    {
+        ESP_LOGE("allocator", "Can't set the default allocator");
+    }
 
-    initSystem(&setup, &cleanup);
+    // Before the watched tasks start, so their first stalls are caught
+    initStallMonitor();
 
-    laserNode = new LaserNode(GPIO_NUM_4);
-    ledStripNode = new LedStripNode(strip);
-    servoNode = new ServoNode(GPIO_NUM_23 , GPIO_NUM_22, I2C_NUM_0);
-    thermalCameraNode = new ThermalCameraNode(idf::GPIONumBase<idf::SDA_type>(GPIO_NUM_18),
-                                              idf::GPIONumBase<idf::SCL_type>(GPIO_NUM_19),
-                                              idf::I2CNumber::I2C1());
+    // The executor tasks are started once and wait for each session
+    for (size_t group = 0; group < EXECUTOR_GROUPS; group++)
+    {
+        const ExecutorTask &task = executorTasks[group];
+#if CONFIG_PCC_PIN_EXECUTORS
+        task.task->startPinned(executorThread, task.name, (void *) group, task.priority, task.core);
+#else
+        task.task->start(executorThread, task.name, (void *) group, task.priority);
+#endif
+    }
+
+    // The two i2c buses are independent, so each device is brought up as soon as its own bus is
+    const InitStep servo_bus = boot.add("boot_servo_bus", initServoBus);
+    const InitStep thermal_bus = boot.add("boot_thermal_bus", initThermalBus);
+    boot.add("boot_servo", initServoNode, nullptr, servo_bus);
+    boot.add("boot_thermal", initThermalCameraNode, nullptr, thermal_bus);
+    boot.add("boot_laser", initLaserNode);
+    nodes.emplace<LedStripNode>(strip);
+    boot.start();
+
+    // Start looking for the agent while the steps run, setup waits for them
+    initSystem(&setup, &cleanup);
 }
@@ -1,18 +1,42 @@
 #include "nodes/laser.hpp"
 
+#include <cstring>
+
+#include "recorder.hpp"
 #include "system.hpp"
 
 #define LASER_FIRE_DURATION 250
 #define LASER_FIRE_COOLDOWN 750
 #define LASER_LOOP_DURATION 100
 #define LASER_LOOP_COOLDOWN 500
+#define LASER_PATTERN_IDLE (1 << 0)
+/**
+ * A pattern stops at its next check of patternAbort, so this (ms) is only reached if the pattern task is stuck
+ */
+#define LASER_PATTERN_STOP_TIMEOUT 100
+
+static_assert(LASER_PATTERN_MAX_ON_TIME == LASER_FIRE_DURATION, "Patterns may not stay on longer than a single fire");
 
 LaserNode::LaserNode(gpio_num_t laser_pin) : Node("pcc_laser", "laser"),
                                              laserPin(laser_pin),
-                                             fireService(), setLoopService(),
-                                             fireRequest(), setLoopRequest(),
-                                             fireResponse(), setLoopResponse()
+                                             fireService(), setLoopService(), firePatternService(),
+                                             cancelPatternService(),
+                                             patternSubscription(), patternDonePublisher(),
+                                             fireRequest(), setLoopRequest(), firePatternRequest(),
+                                             cancelPatternRequest(),
+                                             fireResponse(), setLoopResponse(), firePatternResponse(),
+                                             cancelPatternResponse(),
+                                             patternMessage(), patternMessageBuffer(), patternDoneMessage(),
+                                             fireTask(), loopTask(), patternTask(),
+                                             patternEvents(xEventGroupCreate()),
+                                             pattern()
 {
+    xEventGroupSetBits(patternEvents, LASER_PATTERN_IDLE);
+
+    patternMessage.data.data = patternMessageBuffer;
+    patternMessage.data.size = 0;
+    patternMessage.data.capacity = sizeof(patternMessageBuffer) / sizeof(patternMessageBuffer[0]);
+
     const gpio_config_t pin_config = {
             .pin_bit_mask = 1ULL << laserPin,
             .mode = GPIO_MODE_OUTPUT,
@@ -22,6 +46,10 @@ LaserNode::LaserNode(gpio_num_t laser_pin) : Node("pcc_laser", "laser"),
     };
     HANDLE_ESP_ERROR(gpio_config(&pin_config), true);
     HANDLE_ESP_ERROR(gpio_set_level(laserPin, 0), true);
+
+    fireTask.start(CONTEXT_TASK_CALLBACK(LaserNode, fireThread), "laser_fire", this, 10);
+    loopTask.start(CONTEXT_TASK_CALLBACK(LaserNode, loopThread), "laser_loop", this, 10);
+    patternTask.start(CONTEXT_TASK_CALLBACK(LaserNode, patternThread), "laser_pattern", this, 10);
 }
 
 void LaserNode::setup(rclc_support_t *support, rclc_executor_t *executor)
@@ -51,13 +79,72 @@ void LaserNode::setup(rclc_support_t *support, rclc_executor_t *executor)
                                                             &setLoopRequest, &setLoopResponse,
                                                             CONTEXT_SERVICE_CALLBACK(LaserNode, setLoopCallback),
                                                             this), true);
+
+    LOG(LOGLEVEL_DEBUG, "Setting up LaserNode: pattern subscription");
+    HANDLE_ROS_ERROR(rclc_subscription_init_default(&patternSubscription,
+                                                    &node,
+                                                    ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt16MultiArray),
+                                                    "pattern"), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_subscription_with_context(executor,
+                                                                 &patternSubscription,
+                                                                 &patternMessage,
+                                                                 CONTEXT_SUBSCRIPTION_CALLBACK(LaserNode,
+                                                                                               patternCallback),
+                                                                 this,
+                                                                 ON_NEW_DATA), true);
+
+    LOG(LOGLEVEL_DEBUG, "Setting up LaserNode: fire pattern service");
+    HANDLE_ROS_ERROR(rclc_service_init_default(&firePatternService,
+                                               &node,
+                                               ROSIDL_GET_SRV_TYPE_SUPPORT(std_srvs, srv, Trigger),
+                                               "fire_pattern"), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_service_with_context(executor,
+                                                            &firePatternService,
+                                                            &firePatternRequest, &firePatternResponse,
+                                                            CONTEXT_SERVICE_CALLBACK(LaserNode, firePatternCallback),
+                                                            this), true);
+
+    LOG(LOGLEVEL_DEBUG, "Setting up LaserNode: cancel pattern service");
+    HANDLE_ROS_ERROR(rclc_service_init_default(&cancelPatternService,
+                                               &node,
+                                               ROSIDL_GET_SRV_TYPE_SUPPORT(std_srvs, srv, Trigger),
+                                               "cancel_pattern"), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_service_with_context(executor,
+                                                            &cancelPatternService,
+                                                            &cancelPatternRequest, &cancelPatternResponse,
+                                                            CONTEXT_SERVICE_CALLBACK(LaserNode, cancelPatternCallback),
+                                                            this), true);
+
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&patternDonePublisher,
+                                                 &node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Bool),
+                                                 "pattern_done"), true);
+    patternDoneReady = true;
 }
 
 void LaserNode::cleanup()
 {
+    // Don't leave the loop or a pattern running while nobody can turn it off
+    loopState = false;
+    patternDoneReady = false;
+    patternAbort = true;
+    patternTask.notify();
     HANDLE_ESP_ERROR(gpio_set_level(laserPin, 0), false);
     LOG(LOGLEVEL_DEBUG, "Cleaning up LaserNode");
 
+    // The pattern task stops as soon as it runs, wait for it so it never publishes on a finalized publisher
+    const EventBits_t pattern_events = xEventGroupWaitBits(patternEvents, LASER_PATTERN_IDLE, pdFALSE, pdTRUE,
+                                                           LASER_PATTERN_STOP_TIMEOUT / portTICK_PERIOD_MS);
+    if (!(pattern_events & LASER_PATTERN_IDLE))
+    {
+        // A stuck pattern task could still publish, so reset instead of finalizing under it
+        HANDLE_ESP_ERROR(ESP_ERR_TIMEOUT, true);
+    }
+
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&patternDonePublisher, &node), false);
+    HANDLE_ROS_ERROR(rcl_service_fini(&cancelPatternService, &node), false);
+    HANDLE_ROS_ERROR(rcl_service_fini(&firePatternService, &node), false);
+    HANDLE_ROS_ERROR(rcl_subscription_fini(&patternSubscription, &node), false);
     HANDLE_ROS_ERROR(rcl_service_fini(&setLoopService, &node), false);
     HANDLE_ROS_ERROR(rcl_service_fini(&fireService, &node), false);
 
@@ -72,72 +159,126 @@ void LaserNode::setLaser(bool state)
 
 void LaserNode::tryStartLoop()
 {
-    if (loopState && !laserState && !cooldownState)
+    if (loopState && !laserState && !cooldownState && !patternState)
     {
         LOG(LOGLEVEL_DEBUG, "Laser loop: starting loop");
 
-        xTaskCreate(CONTEXT_TASK_CALLBACK(LaserNode, loopThread),
-                    "laser_loop",
-                    configMINIMAL_STACK_SIZE,
-                    this,
-                    10,
-                    nullptr);
+        loopTask.notify();
     }
 }
 
 void LaserNode::fireThread()
 {
-    setLaser(true);
-    vTaskDelay(LASER_FIRE_DURATION / portTICK_PERIOD_MS);
+    while (true)
+    {
+        StaticTask::waitForNotify();
 
-    cooldownState = true;
-    RCL_UNUSED(cooldownState); // Stop unused warnings
-    setLaser(false);
-    vTaskDelay(LASER_FIRE_COOLDOWN / portTICK_PERIOD_MS);
+        setLaser(true);
+        vTaskDelay(LASER_FIRE_DURATION / portTICK_PERIOD_MS);
 
-    cooldownState = false;
+        cooldownState = true;
+        RCL_UNUSED(cooldownState); // Stop unused warnings
+        setLaser(false);
+        vTaskDelay(LASER_FIRE_COOLDOWN / portTICK_PERIOD_MS);
 
-    tryStartLoop();
+        cooldownState = false;
 
-    vTaskDelete(nullptr);
+        tryStartLoop();
+    }
 }
 
 void LaserNode::loopThread()
 {
-    while (loopState)
+    while (true)
     {
-        setLaser(true);
-        vTaskDelay(LASER_LOOP_DURATION / portTICK_PERIOD_MS);
+        StaticTask::waitForNotify();
 
-        cooldownState = true;
-        RCL_UNUSED(cooldownState); // Stop unused warnings
-        setLaser(false);
-        vTaskDelay(LASER_LOOP_COOLDOWN / portTICK_PERIOD_MS);
+        while (loopState)
+        {
+            setLaser(true);
+            vTaskDelay(LASER_LOOP_DURATION / portTICK_PERIOD_MS);
 
-        cooldownState = false;
+            cooldownState = true;
+            RCL_UNUSED(cooldownState); // Stop unused warnings
+            setLaser(false);
+            vTaskDelay(LASER_LOOP_COOLDOWN / portTICK_PERIOD_MS);
+
+            cooldownState = false;
+        }
+
+        LOG(LOGLEVEL_DEBUG, "Laser loop: ended");
     }
+}
 
-    LOG(LOGLEVEL_DEBUG, "Laser loop: ended");
+void LaserNode::patternThread()
+{
+    while (true)
+    {
+        StaticTask::waitForNotify();
+        // A cancel that arrives after the pattern ended only wakes the task
+        if (!patternState)
+        {
+            continue;
+        }
+
+        TickType_t wake_time = xTaskGetTickCount();
+        for (uint16_t repeat = 0; repeat < patternRepeats && !patternAbort; repeat++)
+        {
+            for (size_t pulse = 0; pulse < patternLength && !patternAbort; pulse++)
+            {
+                cooldownState = false;
+                setLaser(true);
+                waitPulse(&wake_time, pattern[pulse].onTime);
+
+                cooldownState = true;
+                setLaser(false);
+                waitPulse(&wake_time, pattern[pulse].offTime);
+            }
+        }
+        setLaser(false);
+        cooldownState = false;
+
+        const bool aborted = patternAbort;
+        LOG(LOGLEVEL_DEBUG, aborted ? "Laser pattern: cancelled" : "Laser pattern: ended");
+        if (patternDoneReady)
+        {
+            patternDoneMessage.data = !aborted;
+            HANDLE_ROS_ERROR(rcl_publish(&patternDonePublisher, &patternDoneMessage, nullptr), false);
+        }
+        // Marked idle last, cleanup waits for it before finalizing the publisher
+        patternState = false;
+        xEventGroupSetBits(patternEvents, LASER_PATTERN_IDLE);
+
+        tryStartLoop();
+    }
+}
 
-    vTaskDelete(nullptr);
+void LaserNode::waitPulse(TickType_t *wake_time, uint16_t time)
+{
+    if (patternAbort)
+    {
+        return;
+    }
+    // Only an abort notifies the task while a pattern runs
+    const TickType_t remaining = advanceLaserPulse(wake_time, pdMS_TO_TICKS(time), xTaskGetTickCount());
+    if (remaining > 0)
+    {
+        StaticTask::waitForNotify(remaining);
+    }
 }
 
 void LaserNode::fireCallback(__attribute__((unused)) const void *request, void *response)
 {
+    recordServiceRequest("/laser/fire");
     auto response_msg = (std_srvs__srv__Trigger_Response *) response;
     response_msg->success = false;
 
-    if (!laserState && !loopState && !cooldownState)
+    if (!laserState && !loopState && !cooldownState && !patternState)
     {
         LOG(LOGLEVEL_DEBUG, "Laser fire: starting fire");
 
         laserState = true;
-        xTaskCreate(CONTEXT_TASK_CALLBACK(LaserNode, fireThread),
-                    "laser_fire",
-                    configMINIMAL_STACK_SIZE,
-                    this,
-                    10,
-                    nullptr);
+        fireTask.notify();
 
         response_msg->success = true;
     }
@@ -147,6 +288,12 @@ void LaserNode::fireCallback(__attribute__((unused)) const void *request, void *
         response_msg->message.data = const_cast<char *>("Success");
         response_msg->message.size = 7;
     }
+    else if (patternState)
+    {
+        response_msg->message.data = const_cast<char *>("Pattern is running");
+        response_msg->message.size = 18;
+        LOG(LOGLEVEL_WARN, "Tried to fire laser while a pattern is running");
+    }
     else if (loopState)
     {
         response_msg->message.data = const_cast<char *>("Loop is on");
@@ -171,6 +318,7 @@ void LaserNode::setLoopCallback(const void *request, void *response)
 {
     auto request_msg = (std_srvs__srv__SetBool_Request *) request;
     auto response_msg = (std_srvs__srv__SetBool_Response *) response;
+    recordServiceRequest("/laser/set_loop", {request_msg->data});
 
     if (request_msg->data == loopState)
     {
@@ -189,3 +337,97 @@ void LaserNode::setLoopCallback(const void *request, void *response)
         response_msg->message.size = 8;
     }
 }
+
+void LaserNode::firePatternCallback(__attribute__((unused)) const void *request, void *response)
+{
+    recordServiceRequest("/laser/fire_pattern");
+    auto response_msg = (std_srvs__srv__Trigger_Response *) response;
+    response_msg->success = false;
+
+    const char *message;
+    if (patternError != nullptr)
+    {
+        message = patternError;
+    }
+    else if (patternState)
+    {
+        message = "Pattern is running";
+    }
+    else if (loopState)
+    {
+        message = "Loop is on";
+    }
+    else if (laserState || cooldownState)
+    {
+        message = "Laser is busy";
+    }
+    else
+    {
+        LOG(LOGLEVEL_DEBUG, "Laser pattern: starting pattern");
+
+        patternAbort = false;
+        xEventGroupClearBits(patternEvents, LASER_PATTERN_IDLE);
+        patternState = true;
+        patternTask.notify();
+
+        response_msg->success = true;
+        message = "Success";
+    }
+
+    if (!response_msg->success)
+    {
+        LOG(LOGLEVEL_WARN, message);
+    }
+    response_msg->message.data = const_cast<char *>(message);
+    response_msg->message.size = strlen(message);
+}
+
+void LaserNode::cancelPatternCallback(__attribute__((unused)) const void *request, void *response)
+{
+    recordServiceRequest("/laser/cancel_pattern");
+    auto response_msg = (std_srvs__srv__Trigger_Response *) response;
+
+    const char *message;
+    if (patternState)
+    {
+        LOG(LOGLEVEL_DEBUG, "Laser pattern: cancelling pattern");
+
+        patternAbort = true;
+        patternTask.notify();
+
+        response_msg->success = true;
+        message = "Success";
+    }
+    else
+    {
+        response_msg->success = false;
+        message = "No pattern is running";
+    }
+    response_msg->message.data = const_cast<char *>(message);
+    response_msg->message.size = strlen(message);
+}
+
+void LaserNode::patternCallback(const void *message)
+{
+    auto message_msg = (const std_msgs__msg__UInt16MultiArray *) message;
+    // The esp32 is little endian, so the array is already in the recorded layout
+    recordServiceRequest("/laser/pattern", (const uint8_t *) message_msg->data.data,
+                         message_msg->data.size * sizeof(uint16_t));
+
+    if (patternState)
+    {
+        LOG(LOGLEVEL_WARN, "Tried to upload a laser pattern while one is running");
+        return;
+    }
+
+    patternError = validateLaserPattern(message_msg->data.data, message_msg->data.size);
+    if (patternError != nullptr)
+    {
+        LOG(LOGLEVEL_WARN, patternError);
+        return;
+    }
+
+    patternLength = loadLaserPattern(message_msg->data.data, message_msg->data.size, pattern, &patternRepeats);
+
+    LOG(LOGLEVEL_INFO, "Laser pattern uploaded");
+}
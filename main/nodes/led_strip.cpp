@@ -1,15 +1,19 @@
 #include "nodes/led_strip.hpp"
 
+#include "recorder.hpp"
+#include "stall_monitor.hpp"
 #include "system.hpp"
 
 LedStripNode::LedStripNode(NeopixelStrip *strip) : Node("pcc_led_strip", "led_strip"),
                                                    strip(strip),
                                                    setModeService(),
                                                    setModeServiceRequest(), setModeServiceResponse(),
-                                                   isUpdating(), shouldUpdate(),
+                                                   updateTask(), shouldUpdate(),
                                                    primaryColor(), secondaryColor(),
-                                                   mode(), modeArgument()
+                                                   mode(), modeArgument(),
+                                                   thermalSample(), thermalSequence(0)
 {
+    updateTask.start(CONTEXT_TASK_CALLBACK(LedStripNode, updateThread), "led_strip_update", this, 4);
 }
 
 void LedStripNode::setup(rclc_support_t *support, rclc_executor_t *executor)
@@ -42,11 +46,27 @@ void LedStripNode::cleanup()
 
 void LedStripNode::updateThread()
 {
-    isUpdating = true;
-    RCLC_UNUSED(isUpdating); // Get rid of unused warning
-    LOG(LOGLEVEL_DEBUG, "LED Strip update thread started");
+    watchTask("led_strip_update");
+    while (true)
+    {
+        while (!StaticTask::waitForNotify(STALL_FEED_PERIOD / portTICK_PERIOD_MS))
+        {
+            feedWatchdog();
+        }
+        LOG(LOGLEVEL_DEBUG, "LED Strip update thread started");
+        updateStrip();
+        LOG(LOGLEVEL_DEBUG, "LED Strip update thread ended");
+    }
+}
+
+void LedStripNode::updateStrip()
+{
     while (shouldUpdate)
     {
+        feedWatchdog();
+        // Covers the delay as well, which is far below the stall timeout, so only a show that never finishes stalls
+        StallActivity activity("update");
+        TickType_t delay = 100 / portTICK_PERIOD_MS;
         switch (mode)
         {
             case avr_pcc_2023_interfaces__srv__SetLedStrip_Request__MODE_SOLID:
@@ -89,18 +109,40 @@ void LedStripNode::updateThread()
                     strip->setPixel((state + 2) % strip->getLength(), &primaryColor);
                 }
                 break;
+            case LED_STRIP_MODE_THERMAL:
+                // Poll often so a frame is shown well within a frame period of the camera reading it
+                if (!thermalFrames.read(thermalSample, thermalSequence))
+                {
+                    vTaskDelay(LED_STRIP_THERMAL_POLL_MS / portTICK_PERIOD_MS);
+                    continue;
+                }
+                drawThermalFrame((LedStripThermalView) modeArgument.load());
+                delay = LED_STRIP_THERMAL_POLL_MS / portTICK_PERIOD_MS;
+                break;
         }
         strip->show();
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        vTaskDelay(delay);
+    }
+}
+
+void LedStripNode::drawThermalFrame(LedStripThermalView view)
+{
+    const size_t length = strip->getLength();
+    float column_max[AMG88XX_GRID_SIZE];
+    thermalColumnMax(thermalSample.pixels, column_max);
+    for (size_t led = 0; led < length; led++)
+    {
+        strip->setPixel(led, thermalStripColor(column_max, thermalSample.stats, view, led, length));
     }
-    isUpdating = false;
-    LOG(LOGLEVEL_DEBUG, "LED Strip update thread ended");
-    vTaskDelete(nullptr);
 }
 
 void LedStripNode::setModeCallback(const void *request, __attribute__((unused)) void *response)
 {
     auto request_msg = (avr_pcc_2023_interfaces__srv__SetLedStrip_Request *) request;
+    recordServiceRequest("/led_strip/set", {request_msg->mode, request_msg->argument,
+                                            request_msg->color.r, request_msg->color.g, request_msg->color.b,
+                                            request_msg->secondary_color.r, request_msg->secondary_color.g,
+                                            request_msg->secondary_color.b});
 
     primaryColor.r = request_msg->color.r;
     primaryColor.g = request_msg->color.g;
@@ -115,13 +157,6 @@ void LedStripNode::setModeCallback(const void *request, __attribute__((unused))
 
     shouldUpdate = true;
 
-    if (!isUpdating)
-    {
-        xTaskCreate(CONTEXT_TASK_CALLBACK(LedStripNode, updateThread),
-                    "led_strip_update",
-                    configMINIMAL_STACK_SIZE,
-                    this,
-                    4,
-                    nullptr);
-    }
+    // If the strip is already updating, the notification makes it check again once it is done
+    updateTask.notify();
 }
@@ -1,21 +1,21 @@
 #include "nodes/servo_node.hpp"
 
+#include "recorder.hpp"
 #include "system.hpp"
 
 #define SERVO_DRIVER_ADDRESS 0x40
 #define PWM_FREQ 50
 
-ServoNode::ServoNode(gpio_num_t sda, gpio_num_t scl, i2c_port_t port) : Node("pcc_servo", "servo"),
-                                                                        device(),
-                                                                        enableService(), setPosService(),
-                                                                        enableRequest(), setPosRequest(),
-                                                                        enableResponse(), setPosResponse()
+ServoNode::ServoNode(I2cBus *bus) : Node("pcc_servo", "servo"),
+                                    driver(bus, SERVO_DRIVER_ADDRESS, "servo_driver"),
+                                    enableService(), setPosService(),
+                                    enableRequest(), setPosRequest(),
+                                    enableResponse(), setPosResponse()
 {
-    HANDLE_ESP_ERROR(pca9685_init_desc(&device, SERVO_DRIVER_ADDRESS, port, sda, scl), true);
-    HANDLE_ESP_ERROR(pca9685_init(&device), true);
-    HANDLE_ESP_ERROR(pca9685_set_pwm_frequency(&device, PWM_FREQ), true);
-    HANDLE_ESP_ERROR(pca9685_set_pwm_value(&device, PCA9685_CHANNEL_ALL, 0), true);
-    HANDLE_ESP_ERROR(pca9685_sleep(&device, true), true);
+    HANDLE_ESP_ERROR(driver.init(), true);
+    HANDLE_ESP_ERROR(driver.setPwmFrequency(PWM_FREQ), true);
+    HANDLE_ESP_ERROR(driver.setPwmValue(PCA9685_CHANNEL_ALL, 0), true);
+    HANDLE_ESP_ERROR(driver.sleep(true), true);
 }
 
 void ServoNode::setup(rclc_support_t *support, rclc_executor_t *executor)
@@ -51,7 +51,7 @@ void ServoNode::setup(rclc_support_t *support, rclc_executor_t *executor)
 
 void ServoNode::cleanup()
 {
-    HANDLE_ESP_ERROR(pca9685_sleep(&device, true), false);
+    HANDLE_ESP_ERROR(driver.sleep(true), false);
     LOG(LOGLEVEL_DEBUG, "Cleaning up ServoNode");
 
     HANDLE_ROS_ERROR(rcl_service_fini(&setPosService, &node), false);
@@ -64,8 +64,9 @@ void ServoNode::enableCallback(const void *request, void *response)
 {
     auto request_msg = (std_srvs__srv__SetBool_Request *) request;
     auto response_msg = (std_srvs__srv__SetBool_Response *) response;
+    recordServiceRequest("/servo/enable", {request_msg->data});
 
-    response_msg->success = HANDLE_ESP_ERROR(pca9685_sleep(&device, !request_msg->data), false);
+    response_msg->success = HANDLE_ESP_ERROR(driver.sleep(!request_msg->data), false);
     response_msg->message.data = const_cast<char *>(response_msg->success ? "Success" : "Failed");
     response_msg->message.size = response_msg->success ? 7 : 6;
 }
@@ -74,8 +75,9 @@ void ServoNode::setPosCallback(const void *request, void *response)
 {
     auto request_msg = (avr_pcc_2023_interfaces__srv__SetServo_Request *) request;
     auto response_msg = (avr_pcc_2023_interfaces__srv__SetServo_Response *) response;
+    recordServiceRequest("/servo/set_position", {request_msg->servo_num, request_msg->value});
 
     auto pwm_value = (uint16_t)((float) request_msg->value * ((float) 380 / 255) + 90); // ToDo: Recalibrate range
-    bool success = HANDLE_ESP_ERROR(pca9685_set_pwm_value(&device, request_msg->servo_num, pwm_value), false);
+    bool success = HANDLE_ESP_ERROR(driver.setPwmValue(request_msg->servo_num, pwm_value), false);
     response_msg->success = success;
 }
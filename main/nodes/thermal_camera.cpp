@@ -1,14 +1,21 @@
 #include "nodes/thermal_camera.hpp"
 
 #include <cmath>
+#include <cstdio>
 #include <esp_log.h>
 
+#include "boot.hpp"
+#include "link_budget.hpp"
+#include "recorder.hpp"
 #include "system.hpp"
+#include "time_sync.hpp"
 
-#define AMG88XX_ADDR idf::I2CAddress(0x69)
+#define AMG88XX_ADDR 0x69
 #define AMG88XX_THERMISTOR_CONVERSION .0625
 #define AMG88XX_PIXEL_TEMP_CONVERSION .25
 
+LocalTopic<ThermalSample> thermalFrames;
+
 enum [[maybe_unused]] Amg88XxRegisters
 {
     AMG88XX_REG_POWER_MODE = 0x00,
@@ -44,29 +51,39 @@ enum [[maybe_unused]] Amg88XxFrameRates
     AMG88XX_FPS_1 = 0x01
 };
 
-ThermalCameraNode::ThermalCameraNode(idf::GPIONumBase<idf::SDA_type> sda,
-                                     idf::GPIONumBase<idf::SCL_type> scl,
-                                     idf::I2CNumber port) : Node("pcc_thermal_camera", "thermal"),
-                                                            master(new idf::I2CMaster(port, scl, sda,
-                                                                                      idf::Frequency(100000))),
-                                                            updateTimer(),
-                                                            refPublisher(), refMessage(),
-                                                            rawPublisher(), rawMessage(),
-                                                            interpolatedPublisher(), interpolatedMessage(),
-                                                            updateThermistor(),
-                                                            thermistorBuffer(), pixelBuffer(),
-                                                            pixels(),
-                                                            time(), timeNs()
+ThermalCameraNode::ThermalCameraNode(I2cBus *bus) : Node("pcc_thermal_camera", "thermal"),
+                                                    camera(bus, AMG88XX_ADDR, "thermal_camera"),
+                                                    updateTimer(),
+                                                    refPublisher(), refMessage(),
+                                                    rawPublisher(), rawMessage(),
+                                                    interpolatedPublisher(), interpolatedMessage(),
+                                                    regionsSubscription(), regionsMessage(), regionsMessageBuffer(),
+                                                    regions(), regionCount(0),
+                                                    roiPublisher(), roiMessage(), roiDimensions(), roiLabels(),
+                                                    roiPixels(),
+                                                    frameCount(0),
+                                                    statsPublisher(), statsMessage(), statsDimension(), statsData(),
+                                                    background(CONFIG_PCC_THERMAL_BACKGROUND_SHIFT,
+                                                               CONFIG_PCC_THERMAL_MOTION_SIGMA,
+                                                               CONFIG_PCC_THERMAL_MOTION_MIN_DELTA),
+                                                    rawPixels(), motionMask(0), motionPublished(false),
+                                                    motionPublisher(), motionMessage(),
+                                                    updateThermistor(),
+                                                    thermistorBuffer(), pixelBuffer(),
+                                                    stamp(),
+                                                    framePublished(false)
 {
-    try
+    esp_err_t result = camera.writeRegister(AMG88XX_REG_POWER_MODE, AMG88XX_MODE_NORMAL); // Set mode to normal
+    if (result == ESP_OK)
+    {
+        result = camera.writeRegister(AMG88XX_REG_RESET, 0x3F); // Reset the camera
+    }
+    if (result == ESP_OK)
     {
-        master->sync_write(AMG88XX_ADDR, {AMG88XX_REG_POWER_MODE, AMG88XX_MODE_NORMAL}); // Set mode to normal
-        master->sync_write(AMG88XX_ADDR, {AMG88XX_REG_RESET, 0x3F}); // Reset the camera
-        master->sync_write(AMG88XX_ADDR, {AMG88XX_REG_FRAMERATE, AMG88XX_FPS_10}); // Set fps to 10
+        result = camera.writeRegister(AMG88XX_REG_FRAMERATE, AMG88XX_FPS_10); // Set fps to 10
     }
-    catch (idf::I2CException &)
+    if (result != ESP_OK)
     {
-        // ToDo: Add diagnostics
         ESP_LOGI("thermal_camera", "Can't connect to the thermal camera");
     }
 
@@ -80,6 +97,31 @@ ThermalCameraNode::ThermalCameraNode(idf::GPIONumBase<idf::SDA_type> sda,
     rawMessage.width = 8;
     rawMessage.step = 8 << 1;
     rawMessage.data.size = AMG88XX_PIXEL_ARRAY_SIZE;
+
+    regionsMessage.data.data = regionsMessageBuffer;
+    regionsMessage.data.size = 0;
+    regionsMessage.data.capacity = sizeof(regionsMessageBuffer);
+
+    roiMessage.layout.dim.data = roiDimensions;
+    roiMessage.layout.dim.capacity = THERMAL_MAX_REGIONS;
+    roiMessage.data.data = roiPixels;
+    roiMessage.data.capacity = sizeof(roiPixels) / sizeof(roiPixels[0]);
+    for (size_t i = 0; i < THERMAL_MAX_REGIONS; i++)
+    {
+        roiDimensions[i].label.data = roiLabels[i];
+        roiDimensions[i].label.capacity = THERMAL_REGION_LABEL_SIZE;
+    }
+
+    statsDimension.label.data = const_cast<char *>("min,max,mean,hottest,histogram");
+    statsDimension.label.size = 30;
+    statsDimension.size = THERMAL_STATS_SIZE;
+    statsDimension.stride = 1;
+    statsMessage.layout.dim.data = &statsDimension;
+    statsMessage.layout.dim.size = 1;
+    statsMessage.layout.dim.capacity = 1;
+    statsMessage.data.data = statsData;
+    statsMessage.data.size = THERMAL_STATS_SIZE;
+    statsMessage.data.capacity = THERMAL_STATS_SIZE;
 }
 
 void ThermalCameraNode::setup(rclc_support_t *support, rclc_executor_t *executor)
@@ -104,14 +146,46 @@ void ThermalCameraNode::setup(rclc_support_t *support, rclc_executor_t *executor
                                                                                           msg,
                                                                                           ThermalFrame),
                                                  "raw"), true);
+
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&roiPublisher,
+                                                 &node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Float32MultiArray),
+                                                 "roi"), true);
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&statsPublisher,
+                                                 &node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Float32MultiArray),
+                                                 "stats"), true);
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&motionPublisher,
+                                                 &node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt64),
+                                                 "motion"), true);
+    motionPublished = false;
+    // The timer doesn't run while the agent is gone, so the scene may have changed since the model last saw it
+    background.reset();
+    HANDLE_ROS_ERROR(rclc_subscription_init_default(&regionsSubscription,
+                                                    &node,
+                                                    ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt8MultiArray),
+                                                    "roi_config"), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_subscription_with_context(executor,
+                                                                 &regionsSubscription,
+                                                                 &regionsMessage,
+                                                                 CONTEXT_SUBSCRIPTION_CALLBACK(ThermalCameraNode,
+                                                                                               regionsCallback),
+                                                                 this,
+                                                                 ON_NEW_DATA), true);
 }
 
 void ThermalCameraNode::cleanup()
 {
     LOG(LOGLEVEL_DEBUG, "Cleaning up ThermalCameraNode");
 
+    HANDLE_ROS_ERROR(rcl_subscription_fini(&regionsSubscription, &node), false);
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&motionPublisher, &node), false);
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&statsPublisher, &node), false);
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&roiPublisher, &node), false);
     HANDLE_ROS_ERROR(rcl_publisher_fini(&rawPublisher, &node), false);
     HANDLE_ROS_ERROR(rcl_publisher_fini(&refPublisher, &node), false);
+    HANDLE_ROS_ERROR(rcl_timer_fini(&updateTimer.timer), false);
 
     Node::cleanup();
 }
@@ -121,54 +195,130 @@ void ThermalCameraNode::updateTimerCallback(__attribute__((unused)) rcl_timer_t
 {
     updateThermistor = !updateThermistor;
     vTaskDelay(100 / portTICK_PERIOD_MS);
-    try
+    esp_err_t result = ESP_OK;
+    if (updateThermistor)
     {
-        if (updateThermistor)
-        {
-            thermistorBuffer = master->sync_transfer(AMG88XX_ADDR,
-                                                     {AMG88XX_REG_THERMISTOR},
-                                                     2);
-        }
-        pixelBuffer = master->sync_transfer(AMG88XX_ADDR,
-                                            {AMG88XX_REG_PIXEL_OFFSET},
-                                            AMG88XX_PIXEL_ARRAY_SIZE << 1);
+        result = camera.readRegisters(AMG88XX_REG_THERMISTOR, thermistorBuffer, sizeof(thermistorBuffer));
     }
-    catch (idf::I2CException &)
+    if (result == ESP_OK)
+    {
+        result = camera.readRegisters(AMG88XX_REG_PIXEL_OFFSET, pixelBuffer, sizeof(pixelBuffer));
+    }
+    if (result != ESP_OK)
     {
-        // ToDo: Add diagnostics
         ESP_LOGI("thermal_camera", "Can't connect to the thermal camera at runtime");
         return;
     }
 
-    time = (int32_t) (esp_timer_get_time() / 1000000);
-    timeNs = (uint32_t) (esp_timer_get_time() % 1000000);
+    stampNow(&stamp);
 
     if (updateThermistor)
     {
         uint16_t recast = uInt8ToUInt16(thermistorBuffer[0], thermistorBuffer[1]);
         auto thermistor_temp = (float) (signedMag12ToFloat(recast) * AMG88XX_THERMISTOR_CONVERSION);
 
-        refMessage.header.stamp.sec = time;
-        refMessage.header.stamp.nanosec = timeNs;
+        refMessage.header.stamp = stamp;
         refMessage.temperature = thermistor_temp;
 
-        HANDLE_ROS_ERROR(rcl_publish(&refPublisher, &refMessage, nullptr), false);
+        if (linkBudgetTakeMessage(LINK_CLASS_TELEMETRY, ROSIDL_GET_MSG_TYPE_SUPPORT(sensor_msgs, msg, Temperature),
+                                  &refMessage))
+        {
+            HANDLE_ROS_ERROR(rcl_publish(&refPublisher, &refMessage, nullptr), false);
+        }
     }
 
+    // The frame is converted straight into the local topic's sample, and stats are gathered in the same loop so they
+    // don't cost another pass over the frame. This task is the only writer, so the sample stays valid after endWrite
+    ThermalSample *sample = thermalFrames.beginWrite();
+    float *pixels = sample->pixels;
+    ThermalFrameStats &stats = sample->stats;
+    stats.reset();
     uint8_t pos;
     uint16_t recast_pixel;
     for (int i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++) {
         pos = i << 1;
         recast_pixel = uInt8ToUInt16(pixelBuffer[pos], pixelBuffer[pos + 1]);
 
-        pixels[i] = (float) (int12ToFloat(recast_pixel) * AMG88XX_PIXEL_TEMP_CONVERSION);
+        rawPixels[i] = int12ToInt16(recast_pixel);
+        pixels[i] = (float) (rawPixels[i] * AMG88XX_PIXEL_TEMP_CONVERSION);
+        stats.add(i, pixels[i]);
     }
+    // The model runs on the raw integers
+    sample->motionMask = background.update(rawPixels);
+    sample->stamp = stamp;
+    thermalFrames.endWrite();
 
-    rawMessage.header.stamp.sec = time;
-    rawMessage.header.stamp.nanosec = timeNs;
+    stats.write(statsData);
+    if (linkBudgetTakeMessage(LINK_CLASS_TELEMETRY, ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Float32MultiArray),
+                              &statsMessage))
+    {
+        HANDLE_ROS_ERROR(rcl_publish(&statsPublisher, &statsMessage, nullptr), false);
+    }
+
+    // The mask only goes out when it changes, or after it couldn't be sent
+    if (sample->motionMask != motionMask || !motionPublished)
+    {
+        motionMask = sample->motionMask;
+        motionMessage.data = motionMask;
+        motionPublished = linkBudgetTakeMessage(LINK_CLASS_TELEMETRY,
+                                                ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt64), &motionMessage) &&
+                          rcl_publish(&motionPublisher, &motionMessage, nullptr) == RCL_RET_OK;
+    }
+
+    // With regions of interest set, only they go out every frame and the full frame goes out at a reduced rate
+    rawMessage.header.stamp = stamp;
     rawMessage.data.data = pixels;
+    if ((regionCount == 0 || frameCount % CONFIG_PCC_THERMAL_FULL_FRAME_DIVIDER == 0) &&
+        linkBudgetTakeMessage(LINK_CLASS_TELEMETRY,
+                              ROSIDL_GET_MSG_TYPE_SUPPORT(avr_pcc_2023_interfaces, msg, ThermalFrame), &rawMessage))
+    {
+        HANDLE_ROS_ERROR(rcl_publish(&rawPublisher, &rawMessage, nullptr), false);
+    }
+    if (regionCount > 0)
+    {
+        roiMessage.data.size = extractThermalRegions(pixels, regions, regionCount, roiPixels);
+
+        if (linkBudgetTakeMessage(LINK_CLASS_TELEMETRY,
+                                  ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Float32MultiArray), &roiMessage))
+        {
+            HANDLE_ROS_ERROR(rcl_publish(&roiPublisher, &roiMessage, nullptr), false);
+        }
+    }
+    frameCount++;
+
+    if (!framePublished)
+    {
+        markBootEvent("first_frame");
+        framePublished = true;
+    }
+}
+
+void ThermalCameraNode::regionsCallback(const void *message)
+{
+    auto message_msg = (const std_msgs__msg__UInt8MultiArray *) message;
+    recordServiceRequest("/thermal/roi_config", message_msg->data.data, message_msg->data.size);
 
-    HANDLE_ROS_ERROR(rcl_publish(&rawPublisher, &rawMessage, nullptr), false);
+    const char *error = validateThermalRegions(message_msg->data.data, message_msg->data.size);
+    if (error != nullptr)
+    {
+        LOG(LOGLEVEL_WARN, error);
+        return;
+    }
+
+    regionCount = message_msg->data.size / sizeof(ThermalRegion);
+    for (size_t i = 0; i < regionCount; i++)
+    {
+        const uint8_t *region_data = &message_msg->data.data[i * sizeof(ThermalRegion)];
+        regions[i] = {region_data[0], region_data[1], region_data[2], region_data[3]};
+
+        // Each region is described by a dimension, so subscribers can split the data without knowing the config
+        roiDimensions[i].label.size = snprintf(roiLabels[i], THERMAL_REGION_LABEL_SIZE, "%u,%u %ux%u",
+                                               regions[i].x, regions[i].y, regions[i].width, regions[i].height);
+        roiDimensions[i].size = regions[i].width * regions[i].height;
+        roiDimensions[i].stride = regions[i].width;
+    }
+    roiMessage.layout.dim.size = regionCount;
+    frameCount = 0;
 }
 
 float ThermalCameraNode::signedMag12ToFloat(uint16_t val)
@@ -179,9 +329,9 @@ float ThermalCameraNode::signedMag12ToFloat(uint16_t val)
     return (val & 0x800) ? 0 - (float)abs_val : (float)abs_val;
 }
 
-float ThermalCameraNode::int12ToFloat(uint16_t val)
+int16_t ThermalCameraNode::int12ToInt16(uint16_t val)
 {
     auto s_val = (int16_t)(val << 4); // shift to left so that the sign bit of the 12-bit integer number is
                                                   // placed on the sign bit of the 16-bit signed integer number
-    return (float)(s_val >> 4); // shift back the signed number, return converts to float
+    return (int16_t)(s_val >> 4); // shift back the signed number
 }
@@ -0,0 +1,116 @@
+#include "pca9685.hpp"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define PCA9685_REG_MODE1 0x00
+#define PCA9685_REG_LED0 0x06
+#define PCA9685_REG_ALL_LED 0xFA
+#define PCA9685_REG_PRE_SCALE 0xFE
+#define PCA9685_MODE1_SLEEP (1 << 4)
+#define PCA9685_MODE1_AI (1 << 5)
+#define PCA9685_MODE1_RESTART (1 << 7)
+/**
+ * Set in the high byte of the on or off count to turn a channel fully on or off
+ */
+#define PCA9685_FULL (1 << 4)
+#define PCA9685_OSCILLATOR 25000000
+
+Pca9685::Pca9685(I2cBus *bus, uint8_t address, const char *name) : device(bus, address, name, I2C_PRIORITY_HIGH)
+{
+}
+
+esp_err_t Pca9685::init()
+{
+    return updateMode(PCA9685_MODE1_SLEEP | PCA9685_MODE1_RESTART, PCA9685_MODE1_AI);
+}
+
+esp_err_t Pca9685::setPwmFrequency(uint16_t frequency)
+{
+    const uint32_t pre_scale = (PCA9685_OSCILLATOR + 2048 * frequency) / (4096 * frequency) - 1;
+    if (pre_scale < 3 || pre_scale > 255)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The prescaler can only be written while the oscillator is off
+    uint8_t mode;
+    esp_err_t result = device.readRegisters(PCA9685_REG_MODE1, &mode, 1);
+    if (result == ESP_OK)
+    {
+        result = device.writeRegister(PCA9685_REG_MODE1, (mode & ~PCA9685_MODE1_RESTART) | PCA9685_MODE1_SLEEP);
+    }
+    if (result == ESP_OK)
+    {
+        result = device.writeRegister(PCA9685_REG_PRE_SCALE, (uint8_t) pre_scale);
+    }
+    if (result == ESP_OK)
+    {
+        result = device.writeRegister(PCA9685_REG_MODE1, mode & ~PCA9685_MODE1_RESTART);
+    }
+    if (result == ESP_OK && !(mode & PCA9685_MODE1_SLEEP))
+    {
+        // The oscillator needs 500us to start before the outputs can be restarted
+        vTaskDelay(1);
+        result = device.writeRegister(PCA9685_REG_MODE1, mode | PCA9685_MODE1_RESTART);
+    }
+    return result;
+}
+
+esp_err_t Pca9685::setPwmValue(uint8_t channel, uint16_t value)
+{
+    if (channel > PCA9685_CHANNEL_ALL || value > PCA9685_MAX_PWM_VALUE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t reg = channel == PCA9685_CHANNEL_ALL ? PCA9685_REG_ALL_LED : PCA9685_REG_LED0 + 4 * channel;
+    uint8_t data[5] = {reg, 0, 0, 0, 0};
+    if (value == PCA9685_MAX_PWM_VALUE)
+    {
+        data[2] = PCA9685_FULL;
+    }
+    else if (value == 0)
+    {
+        data[4] = PCA9685_FULL;
+    }
+    else
+    {
+        data[3] = value & 0xFF;
+        data[4] = value >> 8;
+    }
+    return device.write(data, sizeof(data));
+}
+
+esp_err_t Pca9685::sleep(bool sleep)
+{
+    if (sleep)
+    {
+        return updateMode(0, PCA9685_MODE1_SLEEP);
+    }
+
+    uint8_t mode;
+    esp_err_t result = device.readRegisters(PCA9685_REG_MODE1, &mode, 1);
+    if (result == ESP_OK)
+    {
+        result = device.writeRegister(PCA9685_REG_MODE1, mode & ~(PCA9685_MODE1_SLEEP | PCA9685_MODE1_RESTART));
+    }
+    if (result == ESP_OK && (mode & PCA9685_MODE1_RESTART))
+    {
+        // Writing restart brings the channels back to what they were before sleeping
+        vTaskDelay(1);
+        result = device.writeRegister(PCA9685_REG_MODE1, (mode & ~PCA9685_MODE1_SLEEP) | PCA9685_MODE1_RESTART);
+    }
+    return result;
+}
+
+esp_err_t Pca9685::updateMode(uint8_t clear, uint8_t set)
+{
+    uint8_t mode;
+    esp_err_t result = device.readRegisters(PCA9685_REG_MODE1, &mode, 1);
+    if (result == ESP_OK)
+    {
+        result = device.writeRegister(PCA9685_REG_MODE1, (mode & ~clear) | set);
+    }
+    return result;
+}
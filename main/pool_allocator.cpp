@@ -0,0 +1,254 @@
+#include "pool_allocator.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+struct PoolConfig
+{
+    uint32_t blockSize;
+    uint32_t blocks;
+};
+
+/**
+ * Sized for the micro-ROS entities and the executors' handles, the diagnostics report the peaks to tune these against
+ */
+static constexpr PoolConfig POOL_CONFIGS[POOL_ALLOCATOR_POOLS] = {{16, 64},
+                                                                  {32, 64},
+                                                                  {64, 48},
+                                                                  {128, 32},
+                                                                  {256, 16},
+                                                                  {512, 8},
+                                                                  {1024, 4},
+                                                                  {4096, 2}};
+
+static constexpr size_t poolArenaSize()
+{
+    size_t size = 0;
+    for (const PoolConfig &config : POOL_CONFIGS)
+    {
+        size += config.blockSize * config.blocks;
+    }
+    return size;
+}
+
+#if CONFIG_PCC_POOL_ALLOCATOR
+
+/**
+ * The pools are laid out one after the other in the arena, smallest class first
+ */
+struct Pool
+{
+    uint8_t *end;
+    /**
+     * Free blocks hold the pointer to the next free block
+     */
+    void *freeList;
+    PoolAllocatorStats stats;
+};
+
+alignas(16) static uint8_t poolArena[poolArenaSize()];
+static Pool pools[POOL_ALLOCATOR_POOLS];
+static uint32_t heapAllocations;
+static uint32_t heapBlocks;
+static StaticSemaphore_t poolLockBuffer;
+static SemaphoreHandle_t poolLock;
+
+/**
+ * @return The pool the block came from, or nullptr if it came from the heap
+ */
+static Pool *findPool(const void *pointer)
+{
+    const auto *block = (const uint8_t *) pointer;
+    if (block < poolArena || block >= poolArena + sizeof(poolArena))
+    {
+        return nullptr;
+    }
+    for (Pool &pool : pools)
+    {
+        if (block < pool.end)
+        {
+            return &pool;
+        }
+    }
+    return nullptr;
+}
+
+static void *poolAllocate(size_t size, __attribute__((unused)) void *state)
+{
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    for (Pool &pool : pools)
+    {
+        if (size > pool.stats.blockSize)
+        {
+            continue;
+        }
+        if (pool.freeList == nullptr)
+        {
+            pool.stats.exhausted++;
+            continue;
+        }
+
+        void *block = pool.freeList;
+        pool.freeList = *(void **) block;
+        pool.stats.used++;
+        pool.stats.peak = pool.stats.used > pool.stats.peak ? pool.stats.used : pool.stats.peak;
+        xSemaphoreGive(poolLock);
+        return block;
+    }
+
+    void *block = malloc(size);
+    if (block != nullptr)
+    {
+        heapAllocations++;
+        heapBlocks++;
+    }
+    xSemaphoreGive(poolLock);
+    return block;
+}
+
+static void poolDeallocate(void *pointer, __attribute__((unused)) void *state)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    Pool *pool = findPool(pointer);
+    if (pool == nullptr)
+    {
+        heapBlocks--;
+        free(pointer);
+    }
+    else
+    {
+        *(void **) pointer = pool->freeList;
+        pool->freeList = pointer;
+        pool->stats.used--;
+    }
+    xSemaphoreGive(poolLock);
+}
+
+static void *poolReallocate(void *pointer, size_t size, void *state)
+{
+    if (pointer == nullptr)
+    {
+        return poolAllocate(size, state);
+    }
+
+    const Pool *pool = findPool(pointer);
+    if (pool == nullptr)
+    {
+        // The heap block count doesn't change, and realloc keeps the block when it can
+        return realloc(pointer, size);
+    }
+    if (size <= pool->stats.blockSize)
+    {
+        return pointer;
+    }
+
+    void *block = poolAllocate(size, state);
+    if (block != nullptr)
+    {
+        memcpy(block, pointer, pool->stats.blockSize);
+        poolDeallocate(pointer, state);
+    }
+    return block;
+}
+
+static void *poolZeroAllocate(size_t count, size_t size, void *state)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        return nullptr;
+    }
+    void *block = poolAllocate(count * size, state);
+    if (block != nullptr)
+    {
+        memset(block, 0, count * size);
+    }
+    return block;
+}
+
+void initPoolAllocator()
+{
+    poolLock = xSemaphoreCreateMutexStatic(&poolLockBuffer);
+
+    uint8_t *start = poolArena;
+    for (size_t i = 0; i < POOL_ALLOCATOR_POOLS; i++)
+    {
+        const PoolConfig &config = POOL_CONFIGS[i];
+        Pool &pool = pools[i];
+        pool.end = start + config.blockSize * config.blocks;
+        pool.stats = {config.blockSize, config.blocks, 0, 0, 0};
+
+        // Thread the free list through the blocks in address order
+        pool.freeList = nullptr;
+        for (uint32_t block = config.blocks; block > 0; block--)
+        {
+            void *pointer = start + (block - 1) * config.blockSize;
+            *(void **) pointer = pool.freeList;
+            pool.freeList = pointer;
+        }
+        start = pool.end;
+    }
+}
+
+rcl_allocator_t getPoolAllocator()
+{
+    rcl_allocator_t allocator = rcutils_get_zero_initialized_allocator();
+    allocator.allocate = poolAllocate;
+    allocator.deallocate = poolDeallocate;
+    allocator.reallocate = poolReallocate;
+    allocator.zero_allocate = poolZeroAllocate;
+    allocator.state = nullptr;
+    return allocator;
+}
+
+PoolAllocatorStats getPoolAllocatorStats(size_t pool)
+{
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    const PoolAllocatorStats stats = pools[pool].stats;
+    xSemaphoreGive(poolLock);
+    return stats;
+}
+
+uint32_t getPoolAllocatorHeapAllocations()
+{
+    return heapAllocations;
+}
+
+uint32_t getPoolAllocatorHeapBlocks()
+{
+    return heapBlocks;
+}
+
+#else
+
+void initPoolAllocator()
+{
+}
+
+rcl_allocator_t getPoolAllocator()
+{
+    return rcl_get_default_allocator();
+}
+
+PoolAllocatorStats getPoolAllocatorStats(size_t pool)
+{
+    return {POOL_CONFIGS[pool].blockSize, 0, 0, 0, 0};
+}
+
+uint32_t getPoolAllocatorHeapAllocations()
+{
+    return 0;
+}
+
+uint32_t getPoolAllocatorHeapBlocks()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#include "rate_limiter.hpp"
+
+RateLimiter::RateLimiter(int64_t interval, uint32_t burst) : interval(interval),
+                                                             limit(interval * burst),
+                                                             arrivalTime(0),
+                                                             limited(0)
+{
+}
+
+bool RateLimiter::take(int64_t now)
+{
+    int64_t arrival_time = arrivalTime.load(std::memory_order_relaxed);
+    int64_t next_arrival_time;
+    do
+    {
+        next_arrival_time = (arrival_time > now ? arrival_time : now) + interval;
+        if (next_arrival_time - now > limit)
+        {
+            limited.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!arrivalTime.compare_exchange_weak(arrival_time, next_arrival_time, std::memory_order_relaxed));
+    return true;
+}
+
+uint32_t RateLimiter::getLimited() const
+{
+    return limited.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,205 @@
+#include "recorder.hpp"
+
+#if CONFIG_PCC_RECORDING
+
+#include <algorithm>
+#include <cstring>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <std_msgs/msg/u_int8_multi_array.h>
+
+#include "callback_stats.hpp"
+#include "link_budget.hpp"
+#include "system.hpp"
+
+/**
+ * Records are published at most this often (ms), up to RECORDER_CHUNK_SIZE bytes of whole records at a time
+ */
+#define RECORDER_PERIOD 20
+#define RECORDER_CHUNK_SIZE 1024
+
+struct RecordPart
+{
+    const void *data;
+    size_t length;
+};
+
+static uint8_t recordBuffer[CONFIG_PCC_RECORDING_BUFFER_SIZE];
+static size_t readIndex;
+static size_t usedBytes;
+static uint32_t pendingGap;
+static uint32_t droppedRecords;
+static SemaphoreHandle_t recorderLock;
+
+static rcl_timer_t recorderTimer;
+static rcl_publisher_t recorderPublisher;
+static std_msgs__msg__UInt8MultiArray recorderMessage;
+static uint8_t recorderChunk[RECORDER_CHUNK_SIZE];
+
+static void copyIn(const void *data, size_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    const size_t start = (readIndex + usedBytes) % sizeof(recordBuffer);
+    const size_t first = std::min(length, sizeof(recordBuffer) - start);
+    memcpy(&recordBuffer[start], data, first);
+    memcpy(recordBuffer, (const uint8_t *) data + first, length - first);
+    usedBytes += length;
+}
+
+static void copyOut(size_t offset, void *data, size_t length)
+{
+    const size_t start = (readIndex + offset) % sizeof(recordBuffer);
+    const size_t first = std::min(length, sizeof(recordBuffer) - start);
+    memcpy(data, &recordBuffer[start], first);
+    memcpy((uint8_t *) data + first, recordBuffer, length - first);
+}
+
+/**
+ * Must be called with the lock held
+ */
+static bool appendRecord(RecordType type, uint32_t time, std::initializer_list<RecordPart> parts, size_t length)
+{
+    if (sizeof(RecordHeader) + length > sizeof(recordBuffer) - usedBytes)
+    {
+        return false;
+    }
+    const RecordHeader header = {type, 0, (uint16_t) length, time};
+    copyIn(&header, sizeof(header));
+    for (const RecordPart &part : parts)
+    {
+        copyIn(part.data, part.length);
+    }
+    return true;
+}
+
+static void addRecord(RecordType type, std::initializer_list<RecordPart> parts)
+{
+    size_t length = 0;
+    for (const RecordPart &part : parts)
+    {
+        length += part.length;
+    }
+    // A record has to fit in one message to be published at all
+    if (sizeof(RecordHeader) + length > RECORDER_CHUNK_SIZE || recorderLock == nullptr)
+    {
+        return;
+    }
+
+    const auto time = (uint32_t) (esp_timer_get_time() / 1000);
+    xSemaphoreTake(recorderLock, portMAX_DELAY);
+    // Mark where records went missing before anything newer, so replay knows the recording isn't continuous
+    if (pendingGap > 0 && appendRecord(RECORD_GAP, time, {{&pendingGap, sizeof(pendingGap)}}, sizeof(pendingGap)))
+    {
+        pendingGap = 0;
+    }
+    if (pendingGap > 0 || !appendRecord(type, time, parts, length))
+    {
+        pendingGap++;
+        droppedRecords++;
+    }
+    xSemaphoreGive(recorderLock);
+}
+
+static void recorderTimerCallback(rcl_timer_t *timer, __attribute__((unused)) int64_t last_call_time)
+{
+    MEASURE_TIMER_CALLBACK("recorderTimerCallback", timer);
+
+    // Records wait in the buffer while the link is busy
+    if (!linkBudgetReady(LINK_CLASS_BULK))
+    {
+        return;
+    }
+
+    size_t chunk_length = 0;
+    xSemaphoreTake(recorderLock, portMAX_DELAY);
+    while (usedBytes >= sizeof(RecordHeader))
+    {
+        RecordHeader header;
+        copyOut(0, &header, sizeof(header));
+        const size_t record_length = sizeof(header) + header.length;
+        if (chunk_length + record_length > sizeof(recorderChunk))
+        {
+            break;
+        }
+        copyOut(0, &recorderChunk[chunk_length], record_length);
+        chunk_length += record_length;
+        readIndex = (readIndex + record_length) % sizeof(recordBuffer);
+        usedBytes -= record_length;
+    }
+    xSemaphoreGive(recorderLock);
+
+    if (chunk_length > 0)
+    {
+        recorderMessage.data.data = recorderChunk;
+        recorderMessage.data.size = chunk_length;
+        recorderMessage.data.capacity = sizeof(recorderChunk);
+        HANDLE_ROS_ERROR(rcl_publish(&recorderPublisher, &recorderMessage, nullptr), false);
+        linkBudgetCharge(LINK_CLASS_BULK, chunk_length);
+    }
+}
+
+void initRecorder()
+{
+    recorderLock = xSemaphoreCreateMutex();
+}
+
+void setupRecorder(rclc_support_t *support, rclc_executor_t *executor, rcl_node_t *node)
+{
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&recorderPublisher,
+                                                 node,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt8MultiArray),
+                                                 "recording"), true);
+    HANDLE_ROS_ERROR(rclc_timer_init_default(&recorderTimer,
+                                             support,
+                                             RCL_MS_TO_NS(RECORDER_PERIOD),
+                                             recorderTimerCallback), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_timer(executor, &recorderTimer), true);
+    LOG(LOGLEVEL_DEBUG, "Set up recorder");
+}
+
+void cleanupRecorder(rcl_node_t *node)
+{
+    HANDLE_ROS_ERROR(rcl_timer_fini(&recorderTimer), false);
+    HANDLE_ROS_ERROR(rcl_publisher_fini(&recorderPublisher, node), false);
+}
+
+void recordI2cRead(i2c_port_t port, uint8_t address,
+                   const uint8_t *write_data, size_t write_length,
+                   const uint8_t *read_data, size_t read_length)
+{
+    if (write_length > UINT8_MAX)
+    {
+        return;
+    }
+    const uint8_t prefix[] = {(uint8_t) port, address, (uint8_t) write_length};
+    addRecord(RECORD_I2C_READ, {{prefix, sizeof(prefix)},
+                                {write_data, write_length},
+                                {read_data, read_length}});
+}
+
+void recordServiceRequest(const char *service, const uint8_t *fields, size_t length)
+{
+    const size_t name_length = strlen(service);
+    if (name_length > UINT8_MAX)
+    {
+        return;
+    }
+    const auto prefix = (uint8_t) name_length;
+    addRecord(RECORD_SERVICE_REQUEST, {{&prefix, sizeof(prefix)},
+                                       {service, name_length},
+                                       {fields, length}});
+}
+
+uint32_t getRecorderDropped()
+{
+    xSemaphoreTake(recorderLock, portMAX_DELAY);
+    const uint32_t dropped = droppedRecords;
+    xSemaphoreGive(recorderLock);
+    return dropped;
+}
+
+#endif
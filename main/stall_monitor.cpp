@@ -0,0 +1,252 @@
+#include "stall_monitor.hpp"
+
+#if CONFIG_PCC_STALL_MONITOR
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "log_buffer.hpp"
+#include "static_task.hpp"
+#include "system.hpp"
+
+/**
+ * How often the monitor checks the heartbeats (ms), so a stall is reported at most this long after the timeout
+ */
+#define STALL_CHECK_PERIOD 100
+#define STALL_REPORT_MAGIC 0x53544c4c
+
+static Heartbeat heartbeats[STALL_MAX_HEARTBEATS];
+static std::atomic<size_t> heartbeatCount = 0;
+static thread_local Heartbeat *taskHeartbeat = nullptr;
+
+/**
+ * Whether each heartbeat's current stall was reported, and when the stalled activity started. Only the monitor task
+ * uses these
+ */
+static bool stallReported[STALL_MAX_HEARTBEATS];
+static uint32_t stallSince[STALL_MAX_HEARTBEATS];
+static std::atomic<uint32_t> stallCount = 0;
+
+/**
+ * Kept across resets, it is only trusted if the magic number is there and the board wasn't powered off
+ */
+RTC_NOINIT_ATTR static StallReport rtcStallReport;
+static StallReport previousStallReport;
+static esp_reset_reason_t previousResetReason;
+static bool previousStallLogged = false;
+static StaticSemaphore_t stallReportLockBuffer;
+static SemaphoreHandle_t stallReportLock;
+
+static StaticStackTask<3072> monitorTask;
+
+static inline uint32_t now()
+{
+    return (uint32_t) esp_timer_get_time();
+}
+
+static const char *resetReasonName(esp_reset_reason_t reason)
+{
+    switch (reason)
+    {
+        case ESP_RST_POWERON:
+            return "power on";
+        case ESP_RST_SW:
+            return "software reset";
+        case ESP_RST_PANIC:
+            return "panic";
+        case ESP_RST_INT_WDT:
+            return "interrupt watchdog";
+        case ESP_RST_TASK_WDT:
+            return "task watchdog";
+        case ESP_RST_WDT:
+            return "watchdog";
+        case ESP_RST_BROWNOUT:
+            return "brownout";
+        default:
+            return "other";
+    }
+}
+
+static void copyName(char *destination, const char *name)
+{
+    strncpy(destination, name, STALL_NAME_SIZE - 1);
+    destination[STALL_NAME_SIZE - 1] = '\0';
+}
+
+static void monitorThread(__attribute__((unused)) void *arg)
+{
+    TickType_t wake_time = xTaskGetTickCount();
+    while (true)
+    {
+        vTaskDelayUntil(&wake_time, STALL_CHECK_PERIOD / portTICK_PERIOD_MS);
+        checkHeartbeats(now());
+    }
+}
+
+void initStallMonitor()
+{
+    stallReportLock = xSemaphoreCreateMutexStatic(&stallReportLockBuffer);
+
+    previousResetReason = esp_reset_reason();
+    if (rtcStallReport.magic == STALL_REPORT_MAGIC && previousResetReason != ESP_RST_POWERON)
+    {
+        previousStallReport = rtcStallReport;
+    }
+    memset(&rtcStallReport, 0, sizeof(rtcStallReport));
+    rtcStallReport.magic = STALL_REPORT_MAGIC;
+
+    // Above every watched task, so a busy one can't hide its own stall
+    monitorTask.start(monitorThread, "stall_monitor", nullptr, 7);
+}
+
+void watchTask(const char *name)
+{
+    const size_t index = heartbeatCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= STALL_MAX_HEARTBEATS)
+    {
+        ESP_LOGE("stall", "Too many watched tasks, %s isn't watched", name);
+        return;
+    }
+    // The monitor only reads the task name after it sees an activity, which is stored after this
+    heartbeats[index].task = name;
+    taskHeartbeat = &heartbeats[index];
+#if CONFIG_ESP_TASK_WDT_INIT
+    HANDLE_ESP_ERROR(esp_task_wdt_add(nullptr), false);
+#endif
+}
+
+void feedWatchdog()
+{
+#if CONFIG_ESP_TASK_WDT_INIT
+    if (taskHeartbeat != nullptr)
+    {
+        esp_task_wdt_reset();
+    }
+#endif
+}
+
+size_t checkHeartbeats(uint32_t time)
+{
+    size_t stalled = 0;
+    for (size_t i = 0; i < STALL_MAX_HEARTBEATS; i++)
+    {
+        Heartbeat &heartbeat = heartbeats[i];
+        // A newer since than the activity's only makes the stall look shorter until the next check
+        const char *activity = heartbeat.activity.load(std::memory_order_acquire);
+        const uint32_t since = heartbeat.since.load(std::memory_order_relaxed);
+        const uint32_t duration = (time - since) / 1000;
+        if (activity == nullptr || duration < CONFIG_PCC_STALL_TIMEOUT)
+        {
+            stallReported[i] = false;
+            continue;
+        }
+        stalled++;
+
+        const bool new_stall = !stallReported[i] || stallSince[i] != since;
+        if (new_stall)
+        {
+            stallReported[i] = true;
+            stallSince[i] = since;
+            stallCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // The report keeps the longest stall, and follows it while it goes on in case it ends in a watchdog reset
+        xSemaphoreTake(stallReportLock, portMAX_DELAY);
+        rtcStallReport.count = stallCount.load(std::memory_order_relaxed);
+        if (duration >= rtcStallReport.duration)
+        {
+            copyName(rtcStallReport.task, heartbeat.task);
+            copyName(rtcStallReport.activity, activity);
+            rtcStallReport.duration = duration;
+            rtcStallReport.uptime = (uint32_t) (esp_timer_get_time() / 1000) - duration;
+        }
+        xSemaphoreGive(stallReportLock);
+
+        if (new_stall)
+        {
+            char message[LOG_RECORD_MESSAGE_SIZE];
+            snprintf(message, sizeof(message), "Stall: %s has been in %s for %" PRIu32 " ms", heartbeat.task, activity,
+                     duration);
+            LOG(LOGLEVEL_ERROR, message);
+        }
+    }
+    return stalled;
+}
+
+uint32_t getStallCount()
+{
+    return stallCount.load(std::memory_order_relaxed);
+}
+
+StallReport getStallReport()
+{
+    xSemaphoreTake(stallReportLock, portMAX_DELAY);
+    const StallReport report = rtcStallReport;
+    xSemaphoreGive(stallReportLock);
+    return report;
+}
+
+bool hasPreviousStall()
+{
+    return previousStallReport.count > 0 || previousResetReason == ESP_RST_TASK_WDT ||
+           previousResetReason == ESP_RST_INT_WDT || previousResetReason == ESP_RST_WDT;
+}
+
+void logPreviousStall()
+{
+    if (previousStallLogged)
+    {
+        return;
+    }
+    previousStallLogged = true;
+
+    if (!hasPreviousStall())
+    {
+        return;
+    }
+    char message[LOG_RECORD_MESSAGE_SIZE];
+    snprintf(message, sizeof(message), "Previous boot ended in a %s reset after %" PRIu32 " stalls",
+             resetReasonName(previousResetReason), previousStallReport.count);
+    LOG(LOGLEVEL_WARN, message);
+    if (previousStallReport.count > 0)
+    {
+        // Task names are at most 16 characters, like FreeRTOS's, which leaves room for the whole activity
+        snprintf(message, sizeof(message), "Longest stall then: %.16s in %s for %" PRIu32 " ms at %" PRIu32 " ms",
+                 previousStallReport.task, previousStallReport.activity, previousStallReport.duration,
+                 previousStallReport.uptime);
+        LOG(LOGLEVEL_WARN, message);
+    }
+}
+
+StallActivity::StallActivity(const char *name) : heartbeat(taskHeartbeat),
+                                                 previous(nullptr)
+{
+    if (heartbeat == nullptr)
+    {
+        return;
+    }
+    previous = heartbeat->activity.load(std::memory_order_relaxed);
+    heartbeat->since.store(now(), std::memory_order_relaxed);
+    heartbeat->activity.store(name, std::memory_order_release);
+}
+
+StallActivity::~StallActivity()
+{
+    if (heartbeat == nullptr)
+    {
+        return;
+    }
+    // The interrupted activity starts over, so the time spent in this one doesn't count against it
+    heartbeat->since.store(now(), std::memory_order_relaxed);
+    heartbeat->activity.store(previous, std::memory_order_release);
+}
+
+#endif
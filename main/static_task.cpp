@@ -0,0 +1,35 @@
+#include "static_task.hpp"
+
+StaticTask::StaticTask(StackType_t *stack, uint32_t stack_size) : stack(stack),
+                                                                  stackSize(stack_size),
+                                                                  buffer(),
+                                                                  handle(nullptr)
+{
+}
+
+void StaticTask::start(TaskFunction_t function, const char *name, void *arg, UBaseType_t priority)
+{
+    // ESP-IDF takes the stack size in bytes, not words
+    handle = xTaskCreateStatic(function, name, stackSize, arg, priority, stack, &buffer);
+}
+
+void StaticTask::startPinned(TaskFunction_t function, const char *name, void *arg, UBaseType_t priority,
+                             BaseType_t core)
+{
+    handle = xTaskCreateStaticPinnedToCore(function, name, stackSize, arg, priority, stack, &buffer, core);
+}
+
+void StaticTask::notify()
+{
+    xTaskNotifyGive(handle);
+}
+
+bool StaticTask::waitForNotify(TickType_t timeout)
+{
+    return ulTaskNotifyTake(pdTRUE, timeout) > 0;
+}
+
+TaskHandle_t StaticTask::getHandle() const
+{
+    return handle;
+}
@@ -1,12 +1,25 @@
 #include "system.hpp"
 
+#include <atomic>
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <freertos/semphr.h>
 #include <rcl/error_handling.h>
 #include <rcl_interfaces/msg/log.h>
 #include <rmw_microros/rmw_microros.h>
+#include <std_msgs/msg/u_int8_multi_array.h>
 #include <std_srvs/srv/trigger.h>
 
+#include "boot.hpp"
+#include "diagnostics.hpp"
+#include "esp32_serial_transport.hpp"
+#include "link_budget.hpp"
+#include "log_buffer.hpp"
+#include "rate_limiter.hpp"
+#include "recorder.hpp"
+#include "static_task.hpp"
+#include "time_sync.hpp"
+
 /**
  * If this is 1, errors will turn the neopixel red and blink the
  * led for each digit in the error code in reverse order
@@ -17,21 +30,63 @@
  * If this is 1, debug logs will be sent, otherwise they will just be not sent, but they will remain in the firmware
  */
 #define DEBUG_LOG 0
+/**
+ * The log drain task wakes up at least this often (ms) and publishes at most LOG_DRAIN_BATCH records per lock
+ */
+#define LOG_DRAIN_PERIOD 100
+#define LOG_DRAIN_BATCH 8
+/**
+ * ESP-IDF log lines bridged to /rosout are limited to one per ESP_LOG_RATE_INTERVAL us on average,
+ * with bursts of up to ESP_LOG_RATE_BURST lines
+ */
+#define ESP_LOG_RATE_INTERVAL 50000
+#define ESP_LOG_RATE_BURST 20
+
+/**
+ * How often the agent is pinged while connected
+ */
+#define CONNECTION_PING_PERIOD 1000
+/**
+ * Size of the callback_stats service response, it has to fit in the reliable stream's buffers
+ */
+#define CALLBACK_STATS_RESPONSE_SIZE 1536
 
-bool setupDone = false;
-bool resetScheduled = false;
+std::atomic<bool> setupDone = false;
+/**
+ * Set once the logger publisher is initialized and cleared under loggerLock before it is finalized, records wait in
+ * the buffer while it is clear
+ */
+std::atomic<bool> loggerReady = false;
+std::atomic<bool> resetScheduled = false;
+std::atomic<ConnectionState> connectionState = CONNECTION_WAITING;
+ConnectionStats connectionStats;
 
 void (*setupFunc)();
 void (*cleanupFunc)();
 vprintf_like_t oldLogger;
 
+LogBuffer logBuffer;
+SemaphoreHandle_t loggerLock = nullptr;
+TaskHandle_t logDrainTask = nullptr;
+StaticStackTask<6144> logDrainStaticTask;
+StaticStackTask<16000> connectionTask;
+RateLimiter espLogLimiter(ESP_LOG_RATE_INTERVAL, ESP_LOG_RATE_BURST);
+#if CONFIG_PCC_BINARY_LOG
+uint8_t binaryLogPacket[LOG_DRAIN_BATCH * BINARY_LOG_RECORD_MAX_SIZE];
+std_msgs__msg__UInt8MultiArray binaryLogMessage;
+#endif
+
 NeopixelStrip *statusStrip;
-rcl_timer_t pingTimer;
 rcl_node_t systemNode;
 rcl_publisher_t loggerPublisher;
 rcl_service_t resetService;
 std_srvs__srv__Trigger_Request resetServiceRequest;
 std_srvs__srv__Trigger_Response resetServiceResponse;
+rcl_service_t callbackStatsService;
+std_srvs__srv__Trigger_Request callbackStatsRequest;
+std_srvs__srv__Trigger_Response callbackStatsResponse;
+char callbackStatsText[CALLBACK_STATS_RESPONSE_SIZE];
+uint32_t callbackStatsOverhead;
 
 void setStatusStrip(NeopixelStrip *strip)
 {
@@ -41,6 +96,7 @@ void setStatusStrip(NeopixelStrip *strip)
 void reset()
 {
     LOG(LOGLEVEL_INFO, "Resetting");
+    flushLog();
     statusStrip->fill(0, 255, 100);
     statusStrip->show();
     gpio_set_level(LED_PIN, 1);
@@ -51,7 +107,9 @@ void reset()
     esp_restart();
 }
 
-bool log(const LogLevel level, const char msg[], const char file[], const char function[], uint32_t line)
+bool log(const LogLevel level,
+         const char msg[], const char file[], const char function[], uint32_t line,
+         uint32_t site, __attribute__((unused)) bool literal)
 {
 #if !DEBUG_LOG
     if (level <= LOGLEVEL_DEBUG)
@@ -61,27 +119,146 @@ bool log(const LogLevel level, const char msg[], const char file[], const char f
 #endif
     if (setupDone)
     {
-        rcl_interfaces__msg__Log logger_msg;
+        bool pushed = logBuffer.push(esp_timer_get_time(), level, file, function, line, site,
+                                     [msg, literal](char *buffer, size_t size)
+                                     {
+                                         size_t length = 0;
+#if CONFIG_PCC_BINARY_LOG
+                                         // The decoder already knows the text of literal messages
+                                         if (literal)
+                                         {
+                                             return length;
+                                         }
+#endif
+                                         while (length < size - 1 && msg[length] != '\0')
+                                         {
+                                             buffer[length] = msg[length];
+                                             length++;
+                                         }
+                                         return length;
+                                     });
+        if (logDrainTask != nullptr)
+        {
+            xTaskNotifyGive(logDrainTask);
+        }
+        return pushed;
+    }
+    return false;
+}
 
-        logger_msg.name.data = const_cast<char *>("PCC");
-        logger_msg.name.size = 3;
+/**
+ * Publish up to a batch of buffered log records. Must be called with loggerLock held
+ * @return Whether records are left in the buffer that can be published now
+ */
+bool publishLogBatch()
+{
+    if (!loggerReady)
+    {
+        return false;
+    }
+#if CONFIG_PCC_BINARY_LOG
+    size_t packet_length = 0;
+    bool more = true;
+    for (uint32_t i = 0; i < LOG_DRAIN_BATCH && more; i++)
+    {
+        more = logBuffer.pop([&packet_length](const LogRecord &record)
+                             {
+                                 packet_length += encodeBinaryLogRecord(record,
+                                                                        &binaryLogPacket[packet_length],
+                                                                        sizeof(binaryLogPacket) - packet_length);
+                             });
+    }
+    if (packet_length > 0)
+    {
+        binaryLogMessage.data.data = binaryLogPacket;
+        binaryLogMessage.data.size = packet_length;
+        binaryLogMessage.data.capacity = sizeof(binaryLogPacket);
+        rcl_publish(&loggerPublisher, &binaryLogMessage, nullptr);
+        linkBudgetCharge(LINK_CLASS_LOG, packet_length);
+    }
+    return more;
+#else
+    for (uint32_t i = 0; i < LOG_DRAIN_BATCH; i++)
+    {
+        bool has_record = logBuffer.pop([](const LogRecord &record)
+                                        {
+                                            rcl_interfaces__msg__Log logger_msg;
+
+                                            logger_msg.name.data = const_cast<char *>("PCC");
+                                            logger_msg.name.size = 3;
+
+                                            toStamp(record.stamp, &logger_msg.stamp);
+
+                                            logger_msg.level = record.level;
+                                            logger_msg.msg.data = const_cast<char *>(record.message);
+                                            logger_msg.msg.size = record.messageLength;
+                                            logger_msg.file.data = const_cast<char *>(record.file);
+                                            logger_msg.file.size = strlen(record.file);
+                                            logger_msg.function.data = const_cast<char *>(record.function);
+                                            logger_msg.function.size = strlen(record.function);
+                                            logger_msg.line = record.line;
+
+                                            rcl_publish(&loggerPublisher, &logger_msg, nullptr);
+                                            linkBudgetChargeMessage(LINK_CLASS_LOG,
+                                                                    ROSIDL_GET_MSG_TYPE_SUPPORT(rcl_interfaces,
+                                                                                                msg, Log),
+                                                                    &logger_msg);
+                                        });
+        if (!has_record)
+        {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
 
-        logger_msg.stamp.sec = (int32_t) esp_timer_get_time() / 1000;
-        logger_msg.stamp.nanosec = 0;
+/**
+ * Publishes buffered log records at low priority, so logging never serializes or writes to the uart on the caller
+ */
+void logDrainThread(__attribute__((unused)) void *arg)
+{
+    uint32_t reported_drops = 0;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, LOG_DRAIN_PERIOD / portTICK_PERIOD_MS);
 
-        logger_msg.level = level;
-        logger_msg.msg.data = const_cast<char *>(msg);
-        logger_msg.msg.size = strlen(msg);
-        logger_msg.file.data = const_cast<char *>(file);
-        logger_msg.file.size = strlen(file);
-        logger_msg.function.data = const_cast<char *>(function);
-        logger_msg.function.size = strlen(function);
-        logger_msg.line = line;
+        // While the link is busy, records wait in the buffer until the next notification or period
+        bool more = true;
+        while (more && linkBudgetReady(LINK_CLASS_LOG))
+        {
+            xSemaphoreTake(loggerLock, portMAX_DELAY);
+            more = publishLogBatch();
+            xSemaphoreGive(loggerLock);
+        }
 
-        rcl_ret_t rc = rcl_publish(&loggerPublisher, &logger_msg, nullptr);
-        return rc == RCL_RET_OK;
+        const uint32_t drops = logBuffer.getDropped();
+        if (drops != reported_drops && setupDone)
+        {
+            char message[48];
+            snprintf(message, sizeof(message), "Dropped %lu log messages", drops - reported_drops);
+            reported_drops = drops;
+            LOG(LOGLEVEL_WARN, message);
+        }
     }
-    return false;
+}
+
+void flushLog()
+{
+    if (loggerLock == nullptr)
+    {
+        return;
+    }
+    xSemaphoreTake(loggerLock, portMAX_DELAY);
+    while (publishLogBatch())
+    {
+    }
+    xSemaphoreGive(loggerLock);
+}
+
+uint32_t getDroppedLogs()
+{
+    return logBuffer.getDropped();
 }
 
 void blinkError(rcl_ret_t error)
@@ -148,24 +325,6 @@ bool handleError(const int32_t rc,
     return rc == RCL_RET_OK;
 }
 
-void pingTimerCallback(__attribute__((unused)) rcl_timer_t *timer, __attribute__((unused)) int64_t last_call_time)
-{
-    if (resetScheduled)
-    {
-        LOG(LOGLEVEL_INFO, "Running scheduled reset");
-        setupDone = false;
-        cleanupFunc();
-        reset();
-        return;
-    }
-
-    rmw_ret_t ping_result = rmw_uros_ping_agent(100, 5);
-    if (ping_result == RMW_RET_ERROR)
-    {
-        reset();
-    }
-}
-
 void resetCallback(__attribute__((unused)) const void *request, void *response)
 {
     auto response_msg = (std_srvs__srv__Trigger_Response *) response;
@@ -177,36 +336,70 @@ void resetCallback(__attribute__((unused)) const void *request, void *response)
     LOG(LOGLEVEL_INFO, "Reset scheduled");
 }
 
-void setupSystem(rclc_support_t *support, rclc_executor_t *executor)
+void callbackStatsCallback(__attribute__((unused)) const void *request, void *response)
 {
-    HANDLE_ROS_ERROR(rclc_timer_init_default(
-            &pingTimer,
-            support,
-            RCL_MS_TO_NS(1000),
-            &pingTimerCallback), true);
-    HANDLE_ROS_ERROR(rclc_executor_add_timer(executor, &pingTimer), true);
+    auto response_msg = (std_srvs__srv__Trigger_Response *) response;
+    int length = snprintf(callbackStatsText, sizeof(callbackStatsText),
+                          "overhead=%luns, times in us as bucket_upper_bound:count\n",
+                          (unsigned long) callbackStatsOverhead);
+    length += (int) formatCallbackStats(callbackStatsText + length, sizeof(callbackStatsText) - length);
+
+    response_msg->success = true;
+    response_msg->message.data = callbackStatsText;
+    response_msg->message.size = length;
+}
 
+void setupSystem(rclc_support_t *support, rclc_executor_t *executors)
+{
     HANDLE_ROS_ERROR(rclc_node_init_default(&systemNode, "pcc_system", "pcc", support), true);
+#if CONFIG_PCC_BINARY_LOG
+    HANDLE_ROS_ERROR(rclc_publisher_init_default(&loggerPublisher,
+                                                 &systemNode,
+                                                 ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, UInt8MultiArray),
+                                                 "log_binary"), true);
+#else
     HANDLE_ROS_ERROR(rclc_publisher_init_default(&loggerPublisher,
                                                  &systemNode,
                                                  ROSIDL_GET_MSG_TYPE_SUPPORT(rcl_interfaces, msg, Log),
                                                  "/rosout"), true);
+#endif
+    // setupDone is already set so setup can log, but the drain task only publishes from here on
+    loggerReady = true;
     LOG(LOGLEVEL_INFO, "Logger started");
 
     HANDLE_ROS_ERROR(rclc_service_init_best_effort(&resetService,
                                                    &systemNode,
                                                    ROSIDL_GET_SRV_TYPE_SUPPORT(std_srvs, srv, Trigger),
                                                    "reset"), true);
-    HANDLE_ROS_ERROR(rclc_executor_add_service(executor, &resetService,
+    HANDLE_ROS_ERROR(rclc_executor_add_service(&executors[EXECUTOR_CONTROL], &resetService,
                                                &resetServiceRequest, &resetServiceResponse,
                                                resetCallback), true);
     LOG(LOGLEVEL_DEBUG, "Set up reset service");
+
+    callbackStatsOverhead = measureCallbackStatsOverhead();
+    HANDLE_ROS_ERROR(rclc_service_init_default(&callbackStatsService,
+                                               &systemNode,
+                                               ROSIDL_GET_SRV_TYPE_SUPPORT(std_srvs, srv, Trigger),
+                                               "callback_stats"), true);
+    HANDLE_ROS_ERROR(rclc_executor_add_service(&executors[EXECUTOR_CONTROL], &callbackStatsService,
+                                               &callbackStatsRequest, &callbackStatsResponse,
+                                               callbackStatsCallback), true);
+    LOG(LOGLEVEL_DEBUG, "Set up callback stats service");
+
+    setupDiagnostics(support, &executors[EXECUTOR_TELEMETRY], &systemNode);
+    setupRecorder(support, &executors[EXECUTOR_TELEMETRY], &systemNode);
 }
 
 void cleanupSystem()
 {
+    cleanupRecorder(&systemNode);
+    cleanupDiagnostics(&systemNode);
+    HANDLE_ROS_ERROR(rcl_service_fini(&callbackStatsService, &systemNode), false);
     HANDLE_ROS_ERROR(rcl_service_fini(&resetService, &systemNode), false);
+    xSemaphoreTake(loggerLock, portMAX_DELAY);
+    loggerReady = false;
     HANDLE_ROS_ERROR(rcl_publisher_fini(&loggerPublisher, &systemNode), false);
+    xSemaphoreGive(loggerLock);
     HANDLE_ROS_ERROR(rcl_node_fini(&systemNode), false);
 }
 
@@ -215,45 +408,136 @@ int vprintfLog(const char *format, va_list arg)
     int length = -1;
     if (oldLogger != nullptr)
     {
+#if DEBUG_LOG
+        if (setupDone && espLogLimiter.take(esp_timer_get_time()))
+        {
+            // Format straight into the queued record, so there is no heap allocation and no shared buffer
+            va_list ros_arg;
+            va_copy(ros_arg, arg);
+            logBuffer.pushFormatted(esp_timer_get_time(), LOGLEVEL_DEBUG, "SYS", "SYS", 0, 0, format, ros_arg);
+            va_end(ros_arg);
+        }
+#endif
         length = oldLogger(format, arg);
-
-        char* buffer = new char[length + 1];
-        vsnprintf(buffer, length, format, arg);
-
-        log(LOGLEVEL_DEBUG, buffer, "SYS", "SYS");
-
-        delete[] buffer;
     }
 
     return length;
 }
 
-void setupThread(__attribute((unused)) void *arg)
+uint32_t getRateLimitedEspLogs()
+{
+    return espLogLimiter.getLimited();
+}
+
+/**
+ * Connect to the agent, then watch the connection. When the agent is lost, the ros entities are
+ * torn down with the cleanup function and set up again once it comes back, without touching the hardware
+ */
+void connectionThread(__attribute((unused)) void *arg)
 {
     statusStrip->fill(255, 16, 0);
     statusStrip->show();
+    int64_t lost_time = 0;
+    int64_t last_sync_time = 0;
     while (true)
     {
-        rmw_ret_t ping_result = rmw_uros_ping_agent(200, 5);
-        if (ping_result == RMW_RET_OK)
+        switch (connectionState)
         {
-            statusStrip->fill(0, 0, 0);
-            statusStrip->show();
-            setupDone = true;
-            setupFunc();
-
-            vTaskDelete(nullptr);
-            return;
+            case CONNECTION_WAITING:
+                if (rmw_uros_ping_agent(200, 5) == RMW_RET_OK)
+                {
+                    if (lost_time == 0)
+                    {
+                        markBootEvent("agent_connected");
+                    }
+                    statusStrip->fill(0, 0, 0);
+                    statusStrip->show();
+                    setupDone = true;
+                    setupFunc();
+                    connectionState = CONNECTION_CONNECTED;
+                    if (syncTime())
+                    {
+                        last_sync_time = esp_timer_get_time();
+                    }
+
+                    char message[48];
+                    snprintf(message, sizeof(message), "Link at %lu baud", esp32SerialGetBaudRate());
+                    LOG(LOGLEVEL_INFO, message);
+                    if (lost_time != 0)
+                    {
+                        connectionStats.reconnects++;
+                        connectionStats.lastReconnectTime = esp_timer_get_time() - lost_time;
+                        snprintf(message, sizeof(message), "Reconnected after %lli ms",
+                                 connectionStats.lastReconnectTime / 1000);
+                        LOG(LOGLEVEL_INFO, message);
+                    }
+                    break;
+                }
+                esp32SerialPingFailed();
+                vTaskDelay(100 / portTICK_PERIOD_MS);
+                break;
+            case CONNECTION_CONNECTED:
+                vTaskDelay(CONNECTION_PING_PERIOD / portTICK_PERIOD_MS);
+                if (resetScheduled)
+                {
+                    LOG(LOGLEVEL_INFO, "Running scheduled reset");
+                    setupDone = false;
+                    cleanupFunc();
+                    reset();
+                }
+                if (rmw_uros_ping_agent(100, 5) != RMW_RET_OK)
+                {
+                    connectionState = CONNECTION_LOST;
+                    break;
+                }
+                if (esp_timer_get_time() - last_sync_time >= (int64_t) CONFIG_PCC_TIME_SYNC_PERIOD * 1000 &&
+                    syncTime())
+                {
+                    last_sync_time = esp_timer_get_time();
+                }
+                break;
+            case CONNECTION_LOST:
+                ESP_LOGI("agent", "Lost the micro-ros agent");
+                lost_time = esp_timer_get_time();
+                connectionStats.disconnects++;
+                setupDone = false;
+
+                statusStrip->fill(255, 16, 0);
+                statusStrip->show();
+                gpio_set_level(LED_PIN, 0);
+
+                cleanupFunc();
+                // Most drops are the agent restarting at the same rate, so the rate that was working is tried first.
+                // Waiting steps on if it keeps failing
+                esp32SerialResetPings();
+                connectionState = CONNECTION_WAITING;
+                break;
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
 
+ConnectionState getConnectionState()
+{
+    return connectionState;
+}
+
+ConnectionStats getConnectionStats()
+{
+    return connectionStats;
+}
+
 void initSystem(void (*setup_func)(), void (*cleanup_func)())
 {
     setupFunc = setup_func;
     cleanupFunc = cleanup_func;
 
+    initTimeSync();
+    initLinkBudget();
+    initRecorder();
+    loggerLock = xSemaphoreCreateMutex();
+    logDrainStaticTask.start(logDrainThread, "log_drain", nullptr, 1);
+    logDrainTask = logDrainStaticTask.getHandle();
+
     ESP_LOGI("sys_log", "Starting logging to /rosout");
     oldLogger = esp_log_set_vprintf(&vprintfLog);
     ESP_LOGI("sys_log", "ESP log started");
@@ -261,10 +545,5 @@ void initSystem(void (*setup_func)(), void (*cleanup_func)())
     statusStrip->fill(0, 0, 0);
     statusStrip->show();
 
-    xTaskCreate(setupThread,
-                "system_setup",
-                16000,
-                nullptr,
-                5,
-                nullptr);
+    connectionTask.start(connectionThread, "system_connection", nullptr, 5);
 }
@@ -0,0 +1,48 @@
+#include "task_stats.hpp"
+
+#include <cstring>
+
+TaskStatsAggregator::TaskStatsAggregator() : history(),
+                                             historyCount(0),
+                                             lastTotalRunTime(0)
+{
+}
+
+size_t TaskStatsAggregator::update(const TaskSample *samples, size_t count,
+                                   uint32_t total_run_time, uint32_t cores,
+                                   TaskUsage *usages)
+{
+    if (count > TASK_STATS_MAX_TASKS)
+    {
+        count = TASK_STATS_MAX_TASKS;
+    }
+
+    // Unsigned differences keep working when the counters wrap
+    const uint32_t elapsed = total_run_time - lastTotalRunTime;
+    History new_history[TASK_STATS_MAX_TASKS];
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t previous_run_time = 0;
+        for (size_t j = 0; j < historyCount; j++)
+        {
+            if (history[j].id == samples[i].id)
+            {
+                previous_run_time = history[j].runTime;
+                break;
+            }
+        }
+
+        const uint32_t run_time = samples[i].runTime - previous_run_time;
+        usages[i].name = samples[i].name;
+        usages[i].cpuPercent = elapsed > 0 ? 100.0f * (float) run_time / ((float) elapsed * (float) cores) : 0;
+        usages[i].stackHighWaterMark = samples[i].stackHighWaterMark;
+        usages[i].lowStack = samples[i].stackHighWaterMark < TASK_STATS_STACK_WARNING;
+
+        new_history[i] = {samples[i].id, samples[i].runTime};
+    }
+
+    memcpy(history, new_history, count * sizeof(History));
+    historyCount = count;
+    lastTotalRunTime = total_run_time;
+    return count;
+}
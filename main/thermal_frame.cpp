@@ -0,0 +1,47 @@
+#include "thermal_frame.hpp"
+
+#include <cstring>
+
+const char *validateThermalRegions(const uint8_t *data, size_t size)
+{
+    if (size % sizeof(ThermalRegion) != 0)
+    {
+        return "Regions must be x, y, width, height groups";
+    }
+    if (size / sizeof(ThermalRegion) > THERMAL_MAX_REGIONS)
+    {
+        return "Too many regions";
+    }
+    for (size_t i = 0; i < size; i += sizeof(ThermalRegion))
+    {
+        const uint8_t x = data[i];
+        const uint8_t y = data[i + 1];
+        const uint8_t width = data[i + 2];
+        const uint8_t height = data[i + 3];
+        if (width == 0 || height == 0)
+        {
+            return "Region is empty";
+        }
+        if (x >= AMG88XX_GRID_SIZE || y >= AMG88XX_GRID_SIZE ||
+            width > AMG88XX_GRID_SIZE - x || height > AMG88XX_GRID_SIZE - y)
+        {
+            return "Region is outside the frame";
+        }
+    }
+    return nullptr;
+}
+
+size_t extractThermalRegions(const float *frame, const ThermalRegion *regions, size_t count, float *output)
+{
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const ThermalRegion &region = regions[i];
+        for (uint8_t row = region.y; row < region.y + region.height; row++)
+        {
+            memcpy(&output[written], &frame[row * AMG88XX_GRID_SIZE + region.x], region.width * sizeof(float));
+            written += region.width;
+        }
+    }
+    return written;
+}
@@ -0,0 +1,81 @@
+#include "thermal_strip.hpp"
+
+#include <array>
+
+struct LutColor
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+/**
+ * Black through purple, red and orange to white, evenly spaced. Ambient pixels are off so only heat lights the strip
+ */
+static constexpr LutColor THERMAL_LUT_STOPS[] = {{0, 0, 0},
+                                                 {60, 0, 110},
+                                                 {190, 30, 40},
+                                                 {250, 140, 0},
+                                                 {255, 255, 200}};
+
+static constexpr std::array<LutColor, 256> makeThermalLut()
+{
+    std::array<LutColor, 256> lut{};
+    for (size_t i = 0; i < lut.size(); i++)
+    {
+        // Stretched by 256 / 255, so the last entry is the last stop instead of one step short of it
+        const size_t position = i * 256 / 255;
+        const size_t stop = position / 64 < 3 ? position / 64 : 3;
+        const LutColor &from = THERMAL_LUT_STOPS[stop];
+        const LutColor &to = THERMAL_LUT_STOPS[stop + 1];
+        const int t = (int) (position - stop * 64);
+        lut[i] = {(uint8_t) (from.r + (to.r - from.r) * t / 64),
+                  (uint8_t) (from.g + (to.g - from.g) * t / 64),
+                  (uint8_t) (from.b + (to.b - from.b) * t / 64)};
+    }
+    return lut;
+}
+
+static constexpr std::array<LutColor, 256> THERMAL_LUT = makeThermalLut();
+
+rgb_t thermalColor(float temperature, float low)
+{
+    const float position = (temperature - low) * (255.0f / CONFIG_PCC_LED_THERMAL_SPAN);
+    const size_t index = position <= 0 ? 0 : (position >= 255 ? 255 : (size_t) position);
+    const LutColor &color = THERMAL_LUT[index];
+    return {.r = color.r, .g = color.g, .b = color.b};
+}
+
+void thermalColumnMax(const float *pixels, float *column_max)
+{
+    for (size_t column = 0; column < AMG88XX_GRID_SIZE; column++)
+    {
+        column_max[column] = pixels[column];
+        for (size_t row = 1; row < AMG88XX_GRID_SIZE; row++)
+        {
+            const float pixel = pixels[row * AMG88XX_GRID_SIZE + column];
+            column_max[column] = pixel > column_max[column] ? pixel : column_max[column];
+        }
+    }
+}
+
+rgb_t thermalStripColor(const float *column_max, const ThermalFrameStats &stats, LedStripThermalView view,
+                        size_t led, size_t length)
+{
+    const float low = stats.count > 0 ? stats.sum / (float) stats.count : 0;
+    const size_t first = led * AMG88XX_GRID_SIZE / length;
+    const size_t last = ((led + 1) * AMG88XX_GRID_SIZE - 1) / length;
+
+    if (view == LED_STRIP_THERMAL_BEARING)
+    {
+        const size_t column = stats.hottest % AMG88XX_GRID_SIZE;
+        return first <= column && column <= last ? thermalColor(stats.max, low) : rgb_t{.r = 0, .g = 0, .b = 0};
+    }
+
+    float hottest = column_max[first];
+    for (size_t column = first + 1; column <= last; column++)
+    {
+        hottest = column_max[column] > hottest ? column_max[column] : hottest;
+    }
+    return thermalColor(hottest, low);
+}
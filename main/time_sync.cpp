@@ -0,0 +1,198 @@
+#include "time_sync.hpp"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <rmw_microros/rmw_microros.h>
+
+/**
+ * How long to wait for the agent to answer a sync (ms)
+ */
+#define TIME_SYNC_TIMEOUT 100
+
+static ClockModel clockModel;
+static SemaphoreHandle_t clockLock = nullptr;
+
+ClockModel::ClockModel() : anchorLocal(0),
+                           anchorReference(0),
+                           correction(0),
+                           drift(0),
+                           lastSampleLocal(0),
+                           lastSampleReference(0),
+                           lastError(0),
+                           samples(0),
+                           outliers(0),
+                           recentOutliers(0)
+{
+}
+
+void ClockModel::addSample(int64_t local, int64_t reference)
+{
+    if (samples == 0)
+    {
+        anchorLocal = local;
+        anchorReference = reference;
+        correction = 0;
+        lastSampleLocal = local;
+        lastSampleReference = reference;
+        lastError = 0;
+        samples++;
+        return;
+    }
+
+    const int64_t predicted = toReference(local);
+    lastError = reference - predicted;
+    const int64_t outlier_threshold = TIME_SYNC_OUTLIER_THRESHOLD +
+                                      (local - lastSampleLocal) * TIME_SYNC_OUTLIER_DRIFT / 1000;
+    if ((lastError > outlier_threshold || lastError < -outlier_threshold) && recentOutliers < TIME_SYNC_MAX_OUTLIERS)
+    {
+        // Most likely the answer sat behind other traffic on one leg of the round trip
+        outliers++;
+        recentOutliers++;
+        return;
+    }
+    recentOutliers = 0;
+
+    if (lastError > TIME_SYNC_STEP_THRESHOLD || lastError < -TIME_SYNC_STEP_THRESHOLD)
+    {
+        // The reference clock jumped, so this sample says nothing about drift. Start measuring again from it
+        anchorLocal = local;
+        anchorReference = reference;
+        correction = 0;
+        lastSampleLocal = local;
+        lastSampleReference = reference;
+        samples = 1;
+        return;
+    }
+
+    // ns the reference moved more than the local clock, per us of local time, is ppb / 1000
+    const int64_t elapsed = local - lastSampleLocal;
+    if (elapsed > 0)
+    {
+        const int64_t measured = ((reference - lastSampleReference) - elapsed * 1000) * 1000000 / elapsed;
+        drift = samples == 1 ? measured : drift + (measured - drift) / TIME_SYNC_DRIFT_FILTER;
+    }
+    lastSampleLocal = local;
+    lastSampleReference = reference;
+    samples++;
+
+    // Continue from where the model was and slew the error in from here
+    anchorLocal = local;
+    anchorReference = predicted;
+    correction = lastError;
+}
+
+int64_t ClockModel::toReference(int64_t local) const
+{
+    if (samples == 0)
+    {
+        return local * 1000;
+    }
+
+    const int64_t elapsed = local - anchorLocal;
+    int64_t reference = anchorReference + elapsed * 1000 + elapsed * drift / 1000000;
+    if (elapsed > 0)
+    {
+        reference += elapsed >= TIME_SYNC_SLEW_TIME ? correction : correction * elapsed / TIME_SYNC_SLEW_TIME;
+    }
+    return reference;
+}
+
+bool ClockModel::isSynced() const
+{
+    return samples > 0;
+}
+
+int64_t ClockModel::getDrift() const
+{
+    return drift;
+}
+
+int64_t ClockModel::getLastError() const
+{
+    return lastError;
+}
+
+uint32_t ClockModel::getOutliers() const
+{
+    return outliers;
+}
+
+void initTimeSync()
+{
+    clockLock = xSemaphoreCreateMutex();
+}
+
+bool syncTime()
+{
+    if (rmw_uros_sync_session(TIME_SYNC_TIMEOUT) != RMW_RET_OK)
+    {
+        return false;
+    }
+
+    // Read both clocks as close together as possible
+    const int64_t reference = rmw_uros_epoch_nanos();
+    const int64_t local = esp_timer_get_time();
+
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    clockModel.addSample(local, reference);
+    xSemaphoreGive(clockLock);
+    return true;
+}
+
+bool isTimeSynced()
+{
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    const bool synced = clockModel.isSynced();
+    xSemaphoreGive(clockLock);
+    return synced;
+}
+
+int64_t getClockDrift()
+{
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    const int64_t drift = clockModel.getDrift();
+    xSemaphoreGive(clockLock);
+    return drift;
+}
+
+int64_t getClockSyncError()
+{
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    const int64_t error = clockModel.getLastError();
+    xSemaphoreGive(clockLock);
+    return error;
+}
+
+uint32_t getClockSyncOutliers()
+{
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    const uint32_t outliers = clockModel.getOutliers();
+    xSemaphoreGive(clockLock);
+    return outliers;
+}
+
+int64_t toEpochNanos(int64_t local)
+{
+    xSemaphoreTake(clockLock, portMAX_DELAY);
+    const int64_t epoch = clockModel.toReference(local);
+    xSemaphoreGive(clockLock);
+    return epoch;
+}
+
+int64_t getEpochNanos()
+{
+    return toEpochNanos(esp_timer_get_time());
+}
+
+void toStamp(int64_t local, builtin_interfaces__msg__Time *stamp)
+{
+    const int64_t epoch = toEpochNanos(local);
+    stamp->sec = (int32_t) (epoch / 1000000000);
+    stamp->nanosec = (uint32_t) (epoch % 1000000000);
+}
+
+void stampNow(builtin_interfaces__msg__Time *stamp)
+{
+    toStamp(esp_timer_get_time(), stamp);
+}
@@ -0,0 +1,72 @@
+#include "pcc_sim/fake_amg88xx.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#define AMG88XX_REG_RESET 0x01
+#define AMG88XX_REG_THERMISTOR 0x0E
+#define AMG88XX_REG_PIXEL_OFFSET 0x80
+#define AMG88XX_THERMISTOR_CONVERSION .0625f
+#define AMG88XX_PIXEL_TEMP_CONVERSION .25f
+
+#define FAKE_AMG88XX_AMBIENT 22.0f
+#define FAKE_AMG88XX_SPOT 36.0f
+#define FAKE_AMG88XX_SPOT_RADIUS 1.5f
+
+FakeAmg88xx::FakeAmg88xx() : fixedFrame(false),
+                             frame(),
+                             frameCount()
+{
+    // Thermistor is 12 bit sign and magnitude
+    const auto thermistor = (uint16_t) (FAKE_AMG88XX_AMBIENT / AMG88XX_THERMISTOR_CONVERSION);
+    registers[AMG88XX_REG_THERMISTOR] = thermistor & 0xFF;
+    registers[AMG88XX_REG_THERMISTOR + 1] = (thermistor >> 8) & 0x07;
+}
+
+void FakeAmg88xx::setFrame(const float *temperatures)
+{
+    fixedFrame = temperatures != nullptr;
+    if (fixedFrame)
+    {
+        memcpy(frame, temperatures, sizeof(frame));
+    }
+}
+
+void FakeAmg88xx::onRegisterRead(uint8_t reg, __attribute__((unused)) size_t length)
+{
+    if (reg != AMG88XX_REG_PIXEL_OFFSET)
+    {
+        return;
+    }
+
+    if (fixedFrame)
+    {
+        writePixels(frame);
+        return;
+    }
+
+    // Move the spot around a circle, one lap every 100 frames
+    float scene[FAKE_AMG88XX_PIXELS];
+    const float angle = (float) (frameCount++ % 100) * (float) (2 * M_PI / 100);
+    const float spot_x = 3.5f + 2.5f * cosf(angle);
+    const float spot_y = 3.5f + 2.5f * sinf(angle);
+    for (int i = 0; i < FAKE_AMG88XX_PIXELS; i++)
+    {
+        const float dx = (float) (i % 8) - spot_x;
+        const float dy = (float) (i / 8) - spot_y;
+        const float falloff = expf(-(dx * dx + dy * dy) / (2 * FAKE_AMG88XX_SPOT_RADIUS * FAKE_AMG88XX_SPOT_RADIUS));
+        scene[i] = FAKE_AMG88XX_AMBIENT + (FAKE_AMG88XX_SPOT - FAKE_AMG88XX_AMBIENT) * falloff;
+    }
+    writePixels(scene);
+}
+
+void FakeAmg88xx::writePixels(const float *temperatures)
+{
+    // Pixels are 12 bit two's complement, little endian
+    for (int i = 0; i < FAKE_AMG88XX_PIXELS; i++)
+    {
+        const auto raw = (int16_t) lroundf(temperatures[i] / AMG88XX_PIXEL_TEMP_CONVERSION);
+        registers[AMG88XX_REG_PIXEL_OFFSET + 2 * i] = raw & 0xFF;
+        registers[AMG88XX_REG_PIXEL_OFFSET + 2 * i + 1] = (raw >> 8) & 0x0F;
+    }
+}
@@ -0,0 +1,54 @@
+#include "pcc_sim/fake_pca9685.hpp"
+
+#include <esp_log.h>
+
+static const char *TAG = "fake_pca9685";
+
+FakePca9685::FakePca9685()
+{
+    registers[PCA9685_REG_MODE1] = PCA9685_MODE1_SLEEP;
+    registers[PCA9685_REG_PRE_SCALE] = 0x1E;
+}
+
+uint16_t FakePca9685::getPwm(uint8_t channel) const
+{
+    if (channel >= PCA9685_CHANNELS || isSleeping())
+    {
+        return 0;
+    }
+    const uint8_t base = PCA9685_REG_LED0 + 4 * channel;
+    if (registers[base + 1] & 0x10)
+    {
+        return 4096;
+    }
+    return ((registers[base + 3] & 0x0F) << 8) | registers[base + 2];
+}
+
+bool FakePca9685::isSleeping() const
+{
+    return registers[PCA9685_REG_MODE1] & PCA9685_MODE1_SLEEP;
+}
+
+void FakePca9685::onRegisterWrite(uint8_t reg, uint8_t value)
+{
+    if (reg >= PCA9685_REG_ALL_LED && reg < PCA9685_REG_ALL_LED + 4)
+    {
+        // The all channel registers are write only and fan out to every channel
+        for (uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++)
+        {
+            registers[PCA9685_REG_LED0 + 4 * channel + (reg - PCA9685_REG_ALL_LED)] = value;
+        }
+    }
+    else if (reg == PCA9685_REG_MODE1)
+    {
+        ESP_LOGI(TAG, "%s", (value & PCA9685_MODE1_SLEEP) ? "Sleeping" : "Awake");
+        return;
+    }
+
+    // The off count high byte is the last one written for a channel
+    if (reg >= PCA9685_REG_LED0 && reg < PCA9685_REG_LED0 + 4 * PCA9685_CHANNELS && (reg - PCA9685_REG_LED0) % 4 == 3)
+    {
+        const uint8_t channel = (reg - PCA9685_REG_LED0) / 4;
+        ESP_LOGI(TAG, "Channel %u -> %u", channel, getPwm(channel));
+    }
+}
@@ -0,0 +1,45 @@
+#include <stdint.h>
+
+#ifndef AVR_PCC_2023_SIM_COLOR_H
+#define AVR_PCC_2023_SIM_COLOR_H
+
+/**
+ * The parts of esp-idf-lib's color library the firmware uses
+ */
+
+typedef uint8_t fract8;
+
+typedef struct
+{
+    union
+    {
+        uint8_t r;
+        uint8_t red;
+    };
+    union
+    {
+        uint8_t g;
+        uint8_t green;
+    };
+    union
+    {
+        uint8_t b;
+        uint8_t blue;
+    };
+} rgb_t;
+
+static inline uint8_t blend8(uint8_t a, uint8_t b, fract8 amount_of_b)
+{
+    return (uint8_t) (((uint16_t) a * (255 - amount_of_b) + (uint16_t) b * amount_of_b) / 255);
+}
+
+static inline rgb_t rgb_blend(rgb_t existing, rgb_t overlay, fract8 amount)
+{
+    rgb_t result;
+    result.r = blend8(existing.r, overlay.r, amount);
+    result.g = blend8(existing.g, overlay.g, amount);
+    result.b = blend8(existing.b, overlay.b, amount);
+    return result;
+}
+
+#endif //AVR_PCC_2023_SIM_COLOR_H
@@ -0,0 +1,17 @@
+#include "pcc_sim/fake_amg88xx.hpp"
+#include "pcc_sim/fake_pca9685.hpp"
+
+#ifndef AVR_PCC_2023_SIM_DEVICES_HPP
+#define AVR_PCC_2023_SIM_DEVICES_HPP
+
+/**
+ * @return The fake thermal camera on I2C1
+ */
+FakeAmg88xx &simThermalCamera();
+
+/**
+ * @return The fake servo driver on I2C0
+ */
+FakePca9685 &simServoDriver();
+
+#endif //AVR_PCC_2023_SIM_DEVICES_HPP
@@ -0,0 +1,34 @@
+#include "pcc_sim/i2c_bus.hpp"
+
+#ifndef AVR_PCC_2023_SIM_FAKE_AMG88XX_HPP
+#define AVR_PCC_2023_SIM_FAKE_AMG88XX_HPP
+
+#define FAKE_AMG88XX_PIXELS 64
+
+/**
+ * An AMG88xx thermal camera looking at a room temperature scene with one warm spot
+ * drifting across it, so that every pixel read returns a new frame
+ */
+class FakeAmg88xx : public FakeRegisterDevice
+{
+public:
+    FakeAmg88xx();
+
+    /**
+     * Override the generated scene with a fixed frame
+     * @param temperatures 64 pixel temperatures in C, row major, or nullptr to go back to the generated scene
+     */
+    void setFrame(const float *temperatures);
+
+protected:
+    void onRegisterRead(uint8_t reg, size_t length) override;
+
+private:
+    bool fixedFrame;
+    float frame[FAKE_AMG88XX_PIXELS];
+    uint32_t frameCount;
+
+    void writePixels(const float *temperatures);
+};
+
+#endif //AVR_PCC_2023_SIM_FAKE_AMG88XX_HPP
@@ -0,0 +1,34 @@
+#include "pcc_sim/i2c_bus.hpp"
+
+#ifndef AVR_PCC_2023_SIM_FAKE_PCA9685_HPP
+#define AVR_PCC_2023_SIM_FAKE_PCA9685_HPP
+
+#define PCA9685_REG_MODE1 0x00
+#define PCA9685_REG_LED0 0x06
+#define PCA9685_REG_ALL_LED 0xFA
+#define PCA9685_REG_PRE_SCALE 0xFE
+#define PCA9685_MODE1_SLEEP (1 << 4)
+#define PCA9685_MODE1_AI (1 << 5)
+#define PCA9685_MODE1_RESTART (1 << 7)
+#define PCA9685_CHANNELS 16
+
+/**
+ * A PCA9685 pwm driver that logs the servo pulses it is told to output
+ */
+class FakePca9685 : public FakeRegisterDevice
+{
+public:
+    FakePca9685();
+
+    /**
+     * @return The off count (0 - 4095) of a channel, or 0 while the chip is asleep
+     */
+    [[nodiscard]] uint16_t getPwm(uint8_t channel) const;
+
+    [[nodiscard]] bool isSleeping() const;
+
+protected:
+    void onRegisterWrite(uint8_t reg, uint8_t value) override;
+};
+
+#endif //AVR_PCC_2023_SIM_FAKE_PCA9685_HPP
@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+
+#include "driver/i2c.h"
+
+#ifndef AVR_PCC_2023_SIM_I2C_BUS_HPP
+#define AVR_PCC_2023_SIM_I2C_BUS_HPP
+
+/**
+ * A simulated device on a fake i2c bus
+ */
+class FakeI2cDevice
+{
+public:
+    virtual ~FakeI2cDevice() = default;
+
+    /**
+     * Called for the write phase of a transfer
+     * @return ESP_OK if the device acknowledged every byte
+     */
+    virtual esp_err_t write(const uint8_t *data, size_t length) = 0;
+
+    /**
+     * Called for the read phase of a transfer
+     * @return ESP_OK if the device acknowledged the read
+     */
+    virtual esp_err_t read(uint8_t *data, size_t length) = 0;
+};
+
+/**
+ * A fake device with an auto incrementing register pointer, the way most i2c sensors behave
+ */
+class FakeRegisterDevice : public FakeI2cDevice
+{
+public:
+    esp_err_t write(const uint8_t *data, size_t length) override;
+
+    esp_err_t read(uint8_t *data, size_t length) override;
+
+protected:
+    uint8_t registers[256] = {};
+    uint8_t pointer = 0;
+
+    /**
+     * Called after a register was written by the master
+     */
+    virtual void onRegisterWrite(__attribute__((unused)) uint8_t reg, __attribute__((unused)) uint8_t value)
+    {
+    }
+
+    /**
+     * Called before registers are read so the device can refresh them
+     */
+    virtual void onRegisterRead(__attribute__((unused)) uint8_t reg, __attribute__((unused)) size_t length)
+    {
+    }
+};
+
+/**
+ * Attach a fake device to a bus
+ * @param port The bus the device is on
+ * @param address The 7 bit device address
+ * @param device The device, which must outlive the simulation
+ */
+void simI2cAttach(i2c_port_t port, uint8_t address, FakeI2cDevice *device);
+
+/**
+ * @return The device attached on an address, or nullptr if there is none
+ */
+FakeI2cDevice *simI2cGetDevice(i2c_port_t port, uint8_t address);
+
+/**
+ * Run a write then read transfer on a fake bus. Either phase can be empty
+ * @return ESP_FAIL if no device answers on the address, otherwise the device's result
+ */
+esp_err_t simI2cTransfer(i2c_port_t port, uint8_t address,
+                         const uint8_t *write_data, size_t write_length,
+                         uint8_t *read_data, size_t read_length);
+
+#endif //AVR_PCC_2023_SIM_I2C_BUS_HPP
@@ -0,0 +1,65 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pcc_sim/i2c_bus.hpp"
+
+#ifndef AVR_PCC_2023_SIM_REPLAY_HPP
+#define AVR_PCC_2023_SIM_REPLAY_HPP
+
+/**
+ * Files saved by tools/pcc_record.py start with this, followed by the records exactly as the pcc published them
+ */
+#define SIM_REPLAY_MAGIC "PCCREC\x01"
+#define SIM_REPLAY_MAGIC_SIZE 8
+
+/**
+ * Answers reads with the ones recorded from a real device, in the order they were recorded, and starts over at the
+ * end of the recording. Writes, and reads the recording has no answer for, go to the device it replaced
+ */
+class ReplayI2cDevice : public FakeI2cDevice
+{
+public:
+    /**
+     * @param fallback The device that was on the address before, or nullptr
+     */
+    explicit ReplayI2cDevice(FakeI2cDevice *fallback);
+
+    /**
+     * Add a recorded read
+     * @param write The bytes written right before the read, usually the register address
+     * @param read The bytes the device answered with
+     */
+    void addRead(std::vector<uint8_t> write, std::vector<uint8_t> read);
+
+    esp_err_t write(const uint8_t *data, size_t length) override;
+
+    esp_err_t read(uint8_t *data, size_t length) override;
+
+    /**
+     * @return The number of reads answered from the recording
+     */
+    [[nodiscard]] size_t getReplayed() const;
+
+private:
+    struct RecordedRead
+    {
+        std::vector<uint8_t> write;
+        std::vector<uint8_t> read;
+    };
+
+    FakeI2cDevice *const fallback;
+    std::vector<RecordedRead> reads;
+    std::vector<uint8_t> lastWrite;
+    size_t cursor;
+    size_t replayed;
+};
+
+/**
+ * Load a recording and put a ReplayI2cDevice on every address it has reads for
+ * @param path A file saved by tools/pcc_record.py
+ * @return Whether the file could be loaded
+ */
+bool simReplayAttach(const char *path);
+
+#endif //AVR_PCC_2023_SIM_REPLAY_HPP
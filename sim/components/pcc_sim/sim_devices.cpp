@@ -0,0 +1,34 @@
+#include "pcc_sim/devices.hpp"
+
+#include <cstdlib>
+
+#include "pcc_sim/replay.hpp"
+
+/**
+ * The devices wired to the pcc, on the same ports and addresses main.cpp uses
+ */
+static FakePca9685 servoDriver;
+static FakeAmg88xx thermalCamera;
+
+__attribute__((constructor)) static void attachSimDevices()
+{
+    simI2cAttach(I2C_NUM_0, 0x40, &servoDriver);
+    simI2cAttach(I2C_NUM_1, 0x69, &thermalCamera);
+
+    // Recorded reads take the place of the fakes, which still see the writes
+    const char *replay_path = getenv("PCC_SIM_REPLAY");
+    if (replay_path != nullptr)
+    {
+        simReplayAttach(replay_path);
+    }
+}
+
+FakeAmg88xx &simThermalCamera()
+{
+    return thermalCamera;
+}
+
+FakePca9685 &simServoDriver()
+{
+    return servoDriver;
+}
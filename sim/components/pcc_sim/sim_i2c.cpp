@@ -0,0 +1,247 @@
+#include "driver/i2c.h"
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "pcc_sim/i2c_bus.hpp"
+
+#define SIM_I2C_MAX_ADDRESS 128
+
+struct SimI2cCommand
+{
+    enum
+    {
+        START,
+        WRITE,
+        READ,
+        STOP
+    } type;
+    std::vector<uint8_t> data;
+    uint8_t *readBuffer;
+};
+
+struct SimI2cPort
+{
+    bool configured;
+    bool installed;
+    FakeI2cDevice *devices[SIM_I2C_MAX_ADDRESS];
+};
+
+static std::mutex busLock;
+static SimI2cPort ports[I2C_NUM_MAX];
+
+esp_err_t FakeRegisterDevice::write(const uint8_t *data, size_t length)
+{
+    if (length == 0)
+    {
+        return ESP_OK;
+    }
+    pointer = data[0];
+    for (size_t i = 1; i < length; i++)
+    {
+        registers[pointer] = data[i];
+        onRegisterWrite(pointer, data[i]);
+        pointer++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t FakeRegisterDevice::read(uint8_t *data, size_t length)
+{
+    onRegisterRead(pointer, length);
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = registers[pointer++];
+    }
+    return ESP_OK;
+}
+
+void simI2cAttach(i2c_port_t port, uint8_t address, FakeI2cDevice *device)
+{
+    std::lock_guard<std::mutex> lock(busLock);
+    ports[port].devices[address & (SIM_I2C_MAX_ADDRESS - 1)] = device;
+}
+
+FakeI2cDevice *simI2cGetDevice(i2c_port_t port, uint8_t address)
+{
+    std::lock_guard<std::mutex> lock(busLock);
+    return ports[port].devices[address & (SIM_I2C_MAX_ADDRESS - 1)];
+}
+
+esp_err_t simI2cTransfer(i2c_port_t port, uint8_t address,
+                         const uint8_t *write_data, size_t write_length,
+                         uint8_t *read_data, size_t read_length)
+{
+    if (port >= I2C_NUM_MAX || address >= SIM_I2C_MAX_ADDRESS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(busLock);
+    FakeI2cDevice *device = ports[port].devices[address];
+    if (device == nullptr)
+    {
+        return ESP_FAIL;
+    }
+    esp_err_t result = ESP_OK;
+    if (write_length > 0)
+    {
+        result = device->write(write_data, write_length);
+    }
+    if (result == ESP_OK && read_length > 0)
+    {
+        result = device->read(read_data, read_length);
+    }
+    return result;
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    if (i2c_num >= I2C_NUM_MAX || i2c_conf->mode != I2C_MODE_MASTER)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ports[i2c_num].configured = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, __attribute__((unused)) i2c_mode_t mode,
+                             __attribute__((unused)) size_t slv_rx_buf_len,
+                             __attribute__((unused)) size_t slv_tx_buf_len,
+                             __attribute__((unused)) int intr_alloc_flags)
+{
+    if (i2c_num >= I2C_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ports[i2c_num].installed)
+    {
+        return ESP_FAIL;
+    }
+    ports[i2c_num].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    if (i2c_num >= I2C_NUM_MAX || !ports[i2c_num].installed)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ports[i2c_num].installed = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create()
+{
+    return new std::vector<SimI2cCommand>();
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    delete (std::vector<SimI2cCommand> *) cmd_handle;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size)
+{
+    if (size < sizeof(std::vector<SimI2cCommand>) ||
+        (uintptr_t) buffer % alignof(std::vector<SimI2cCommand>) != 0)
+    {
+        return nullptr;
+    }
+    return new(buffer) std::vector<SimI2cCommand>();
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle)
+{
+    using CommandList = std::vector<SimI2cCommand>;
+    ((CommandList *) cmd_handle)->~CommandList();
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    ((std::vector<SimI2cCommand> *) cmd_handle)->push_back({SimI2cCommand::START, {}, nullptr});
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    return i2c_master_write(cmd_handle, &data, 1, ack_en);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len,
+                           __attribute__((unused)) bool ack_en)
+{
+    auto *commands = (std::vector<SimI2cCommand> *) cmd_handle;
+    if (!commands->empty() && commands->back().type == SimI2cCommand::WRITE)
+    {
+        commands->back().data.insert(commands->back().data.end(), data, data + data_len);
+    }
+    else
+    {
+        commands->push_back({SimI2cCommand::WRITE, std::vector<uint8_t>(data, data + data_len), nullptr});
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len,
+                          __attribute__((unused)) i2c_ack_type_t ack)
+{
+    ((std::vector<SimI2cCommand> *) cmd_handle)->push_back({SimI2cCommand::READ,
+                                                            std::vector<uint8_t>(data_len),
+                                                            data});
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    ((std::vector<SimI2cCommand> *) cmd_handle)->push_back({SimI2cCommand::STOP, {}, nullptr});
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle,
+                               __attribute__((unused)) TickType_t ticks_to_wait)
+{
+    if (i2c_num >= I2C_NUM_MAX || !ports[i2c_num].installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Every segment after a start begins with the address byte, which selects the device and direction
+    auto *commands = (std::vector<SimI2cCommand> *) cmd_handle;
+    uint8_t address = 0;
+    bool expect_address = false;
+    for (SimI2cCommand &command : *commands)
+    {
+        esp_err_t result = ESP_OK;
+        switch (command.type)
+        {
+            case SimI2cCommand::START:
+                expect_address = true;
+                break;
+            case SimI2cCommand::WRITE:
+                if (expect_address)
+                {
+                    address = command.data[0] >> 1;
+                    expect_address = false;
+                    result = simI2cTransfer(i2c_num, address, command.data.data() + 1, command.data.size() - 1,
+                                            nullptr, 0);
+                }
+                else
+                {
+                    result = simI2cTransfer(i2c_num, address, command.data.data(), command.data.size(), nullptr, 0);
+                }
+                break;
+            case SimI2cCommand::READ:
+                result = simI2cTransfer(i2c_num, address, nullptr, 0, command.readBuffer, command.data.size());
+                break;
+            case SimI2cCommand::STOP:
+                break;
+        }
+        if (result != ESP_OK)
+        {
+            return result;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,117 @@
+#include "pcc_sim/replay.hpp"
+
+#include <cstring>
+#include <esp_log.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+
+/**
+ * The record layout from main/include/recorder.hpp, which the sim can't include
+ */
+#define REPLAY_HEADER_SIZE 8
+#define REPLAY_RECORD_I2C_READ 1
+
+static const char *TAG = "sim_replay";
+
+/**
+ * Devices are attached from a constructor, which can run before this file's globals are constructed
+ */
+static std::map<uint16_t, std::unique_ptr<ReplayI2cDevice>> &replayDevices()
+{
+    static std::map<uint16_t, std::unique_ptr<ReplayI2cDevice>> devices;
+    return devices;
+}
+
+ReplayI2cDevice::ReplayI2cDevice(FakeI2cDevice *fallback) : fallback(fallback),
+                                                            cursor(0),
+                                                            replayed(0)
+{
+}
+
+void ReplayI2cDevice::addRead(std::vector<uint8_t> write, std::vector<uint8_t> read)
+{
+    reads.push_back({std::move(write), std::move(read)});
+}
+
+esp_err_t ReplayI2cDevice::write(const uint8_t *data, size_t length)
+{
+    lastWrite.assign(data, data + length);
+    return fallback != nullptr ? fallback->write(data, length) : ESP_OK;
+}
+
+esp_err_t ReplayI2cDevice::read(uint8_t *data, size_t length)
+{
+    // Reads normally come back in the recorded order, the search only skips ones the firmware no longer makes
+    for (size_t i = 0; i < reads.size(); i++)
+    {
+        const RecordedRead &recorded = reads[(cursor + i) % reads.size()];
+        if (recorded.write == lastWrite && recorded.read.size() == length)
+        {
+            memcpy(data, recorded.read.data(), length);
+            cursor = (cursor + i + 1) % reads.size();
+            replayed++;
+            lastWrite.clear();
+            return ESP_OK;
+        }
+    }
+    lastWrite.clear();
+    return fallback != nullptr ? fallback->read(data, length) : ESP_FAIL;
+}
+
+size_t ReplayI2cDevice::getReplayed() const
+{
+    return replayed;
+}
+
+bool simReplayAttach(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file || data.size() < SIM_REPLAY_MAGIC_SIZE ||
+        memcmp(data.data(), SIM_REPLAY_MAGIC, SIM_REPLAY_MAGIC_SIZE) != 0)
+    {
+        ESP_LOGE(TAG, "%s is not a pcc recording", path);
+        return false;
+    }
+
+    size_t offset = SIM_REPLAY_MAGIC_SIZE;
+    size_t read_count = 0;
+    while (offset + REPLAY_HEADER_SIZE <= data.size())
+    {
+        const uint8_t type = data[offset];
+        const size_t length = data[offset + 2] | (data[offset + 3] << 8);
+        const uint8_t *payload = data.data() + offset + REPLAY_HEADER_SIZE;
+        offset += REPLAY_HEADER_SIZE + length;
+        if (offset > data.size())
+        {
+            ESP_LOGW(TAG, "%s ends in the middle of a record", path);
+            break;
+        }
+        if (type != REPLAY_RECORD_I2C_READ || length < 3 || payload[2] > length - 3)
+        {
+            continue;
+        }
+
+        const auto port = (i2c_port_t) payload[0];
+        const uint8_t address = payload[1];
+        const size_t write_length = payload[2];
+        if (port >= I2C_NUM_MAX)
+        {
+            continue;
+        }
+        std::unique_ptr<ReplayI2cDevice> &device = replayDevices()[(port << 8) | address];
+        if (device == nullptr)
+        {
+            device = std::make_unique<ReplayI2cDevice>(simI2cGetDevice(port, address));
+            simI2cAttach(port, address, device.get());
+        }
+        device->addRead(std::vector<uint8_t>(payload + 3, payload + 3 + write_length),
+                        std::vector<uint8_t>(payload + 3 + write_length, payload + length));
+        read_count++;
+    }
+
+    ESP_LOGI(TAG, "Replaying %zu reads on %zu devices from %s", read_count, replayDevices().size(), path);
+    return true;
+}
@@ -0,0 +1,107 @@
+#include "driver/rmt.h"
+
+#include <cstring>
+#include <mutex>
+
+#define SIM_RMT_MAX_PIXELS 256
+#define WS2812_BITS 24
+
+struct SimRmtChannel
+{
+    bool installed;
+    uint8_t clkDiv;
+    size_t pixelCount;
+    uint32_t pixels[SIM_RMT_MAX_PIXELS];
+};
+
+static std::mutex channelLock;
+static SimRmtChannel channels[RMT_CHANNEL_MAX];
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param)
+{
+    if (rmt_param->channel >= RMT_CHANNEL_MAX || rmt_param->clk_div == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(channelLock);
+    channels[rmt_param->channel].clkDiv = rmt_param->clk_div;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel,
+                             __attribute__((unused)) size_t rx_buf_size,
+                             __attribute__((unused)) int intr_alloc_flags)
+{
+    if (channel >= RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(channelLock);
+    if (channels[channel].installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel)
+{
+    if (channel >= RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(channelLock);
+    channels[channel].installed = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel,
+                          const rmt_item32_t *rmt_item, int item_num,
+                          __attribute__((unused)) bool wait_tx_done)
+{
+    if (channel >= RMT_CHANNEL_MAX || rmt_item == nullptr || item_num < 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(channelLock);
+    SimRmtChannel &sim_channel = channels[channel];
+    if (!sim_channel.installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A one bit is the one with the longer high time
+    sim_channel.pixelCount = 0;
+    for (int pixel = 0; pixel + WS2812_BITS <= item_num && pixel / WS2812_BITS < SIM_RMT_MAX_PIXELS;
+         pixel += WS2812_BITS)
+    {
+        uint32_t grb = 0;
+        for (int bit = 0; bit < WS2812_BITS; bit++)
+        {
+            const rmt_item32_t &item = rmt_item[pixel + bit];
+            grb = (grb << 1) | (item.duration0 > item.duration1);
+        }
+        sim_channel.pixels[sim_channel.pixelCount++] = ((grb & 0x00FF00) << 8) |
+                                                       ((grb & 0xFF0000) >> 8) |
+                                                       (grb & 0x0000FF);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, __attribute__((unused)) TickType_t wait_time)
+{
+    return channel >= RMT_CHANNEL_MAX ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+size_t simRmtGetPixels(rmt_channel_t channel, uint32_t *pixels, size_t max_pixels)
+{
+    if (channel >= RMT_CHANNEL_MAX)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(channelLock);
+    const size_t count = channels[channel].pixelCount < max_pixels ? channels[channel].pixelCount : max_pixels;
+    memcpy(pixels, channels[channel].pixels, count * sizeof(uint32_t));
+    return channels[channel].pixelCount;
+}
@@ -0,0 +1,320 @@
+#include "driver/uart.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <esp_log.h>
+#include <freertos/task.h>
+
+/**
+ * How often the monitor task checks the pty for data to raise UART_DATA events
+ */
+#define SIM_UART_POLL_MS 1
+/**
+ * Bytes the hardware fifo holds on top of the driver's tx buffer
+ */
+#define SIM_UART_FIFO_SIZE 128
+/**
+ * Bits on the wire per byte, with the start and stop bits
+ */
+#define SIM_UART_BITS_PER_BYTE 10
+
+static const char *TAG = "sim_uart";
+
+struct SimUart
+{
+    int fd;
+    uint32_t baudRate;
+    int txBufferSize;
+    /**
+     * When the bytes written so far would be out on the wire, in us
+     */
+    int64_t wireIdleTime;
+    QueueHandle_t queue;
+    TaskHandle_t monitorTask;
+};
+
+static SimUart uarts[UART_NUM_MAX] = {
+        {-1, 115200, 0, 0, nullptr, nullptr},
+        {-1, 115200, 0, 0, nullptr, nullptr},
+        {-1, 115200, 0, 0, nullptr, nullptr}
+};
+
+static int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Block until the wire is idle or has at most buffered bytes left to send
+ */
+static void waitForWire(const SimUart &uart, size_t buffered)
+{
+    const int64_t buffered_time = (int64_t) buffered * SIM_UART_BITS_PER_BYTE * 1000000 / uart.baudRate;
+    const int64_t wait = uart.wireIdleTime - buffered_time - nowUs();
+    if (wait > 0)
+    {
+        vTaskDelay((TickType_t) ((wait / 1000 + portTICK_PERIOD_MS) / portTICK_PERIOD_MS));
+    }
+}
+
+static bool isInstalled(uart_port_t uart_num)
+{
+    return uart_num < UART_NUM_MAX && uarts[uart_num].fd >= 0;
+}
+
+/**
+ * Raise a UART_DATA event whenever the pty has data and no event is pending.
+ * The FreeRTOS posix port only runs one task thread at a time, so this polls instead of blocking in poll()
+ */
+static void monitorThread(void *arg)
+{
+    auto *uart = (SimUart *) arg;
+    while (true)
+    {
+        int available = 0;
+        if (ioctl(uart->fd, FIONREAD, &available) == 0 && available > 0 && uxQueueMessagesWaiting(uart->queue) == 0)
+        {
+            const uart_event_t event = {UART_DATA, (size_t) available, false};
+            xQueueSend(uart->queue, &event, 0);
+        }
+        vTaskDelay(pdMS_TO_TICKS(SIM_UART_POLL_MS) > 0 ? pdMS_TO_TICKS(SIM_UART_POLL_MS) : 1);
+    }
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    if (uart_num >= UART_NUM_MAX || uart_config->baud_rate <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uarts[uart_num].baudRate = uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num,
+                       __attribute__((unused)) int tx_io_num, __attribute__((unused)) int rx_io_num,
+                       __attribute__((unused)) int rts_io_num, __attribute__((unused)) int cts_io_num)
+{
+    return uart_num < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num,
+                              __attribute__((unused)) int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue,
+                              __attribute__((unused)) int intr_alloc_flags)
+{
+    if (uart_num >= UART_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (isInstalled(uart_num))
+    {
+        return ESP_FAIL;
+    }
+
+    const int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        ESP_LOGE(TAG, "Can't open a pty: %d", errno);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return ESP_FAIL;
+    }
+
+    // Raw mode on the master side too, otherwise the line discipline mangles XRCE frames
+    termios attributes = {};
+    tcgetattr(fd, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(fd, TCSANOW, &attributes);
+
+    const char *slave_name = ptsname(fd);
+    const char *link_path = getenv("PCC_SIM_SERIAL");
+    if (link_path != nullptr)
+    {
+        unlink(link_path);
+        if (symlink(slave_name, link_path) != 0)
+        {
+            ESP_LOGW(TAG, "Can't link %s to %s", link_path, slave_name);
+        }
+    }
+    printf("UART%d is on %s%s%s\n",
+           uart_num, slave_name, link_path != nullptr ? " -> " : "", link_path != nullptr ? link_path : "");
+
+    uarts[uart_num].fd = fd;
+    uarts[uart_num].txBufferSize = tx_buffer_size;
+    uarts[uart_num].wireIdleTime = 0;
+    if (queue_size > 0 && uart_queue != nullptr)
+    {
+        uarts[uart_num].queue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        *uart_queue = uarts[uart_num].queue;
+        xTaskCreate(monitorThread, "sim_uart", 4096, &uarts[uart_num], 20, &uarts[uart_num].monitorTask);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    if (!isInstalled(uart_num))
+    {
+        return ESP_FAIL;
+    }
+    SimUart &uart = uarts[uart_num];
+    if (uart.monitorTask != nullptr)
+    {
+        vTaskDelete(uart.monitorTask);
+        uart.monitorTask = nullptr;
+    }
+    if (uart.queue != nullptr)
+    {
+        vQueueDelete(uart.queue);
+        uart.queue = nullptr;
+    }
+    close(uart.fd);
+    uart.fd = -1;
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    if (!isInstalled(uart_num))
+    {
+        return -1;
+    }
+    size_t written = 0;
+    while (written < size)
+    {
+        const ssize_t result = write(uarts[uart_num].fd, (const uint8_t *) src + written, size - written);
+        if (result > 0)
+        {
+            written += result;
+        }
+        else if (result < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            return -1;
+        }
+        else
+        {
+            // Nobody is reading the other end yet
+            vTaskDelay(1);
+        }
+    }
+
+    // The pty takes the bytes at once, so send them at the baud rate here. Like the driver, the caller only waits
+    // once the tx buffer is full, or for every byte to reach the fifo without a tx buffer
+    SimUart &uart = uarts[uart_num];
+    const int64_t now = nowUs();
+    uart.wireIdleTime = (uart.wireIdleTime > now ? uart.wireIdleTime : now) +
+                        (int64_t) written * SIM_UART_BITS_PER_BYTE * 1000000 / uart.baudRate;
+    waitForWire(uart, uart.txBufferSize + SIM_UART_FIFO_SIZE);
+    return (int) written;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (!isInstalled(uart_num))
+    {
+        return -1;
+    }
+    const TickType_t start = xTaskGetTickCount();
+    while (true)
+    {
+        const ssize_t result = read(uarts[uart_num].fd, buf, length);
+        if (result > 0)
+        {
+            return (int) result;
+        }
+        if (result < 0 && errno != EAGAIN && errno != EINTR && errno != EIO)
+        {
+            return -1;
+        }
+        if (xTaskGetTickCount() - start >= ticks_to_wait)
+        {
+            return 0;
+        }
+        vTaskDelay(1);
+    }
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    if (!isInstalled(uart_num))
+    {
+        return ESP_FAIL;
+    }
+    int available = 0;
+    ioctl(uarts[uart_num].fd, FIONREAD, &available);
+    *size = available > 0 ? available : 0;
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    if (!isInstalled(uart_num))
+    {
+        return ESP_FAIL;
+    }
+    tcflush(uarts[uart_num].fd, TCIFLUSH);
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, __attribute__((unused)) TickType_t ticks_to_wait)
+{
+    if (!isInstalled(uart_num))
+    {
+        return ESP_FAIL;
+    }
+    waitForWire(uarts[uart_num], 0);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    // A pty has no real baud rate, the rate only paces writes and lets the firmware's negotiation logic run
+    if (uart_num >= UART_NUM_MAX || baudrate == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uarts[uart_num].baudRate = baudrate;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t uart_num, uint32_t *baudrate)
+{
+    if (uart_num >= UART_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *baudrate = uarts[uart_num].baudRate;
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t uart_num,
+                                            __attribute__((unused)) char pattern_chr,
+                                            __attribute__((unused)) uint8_t chr_num,
+                                            __attribute__((unused)) int chr_tout,
+                                            __attribute__((unused)) int post_idle,
+                                            __attribute__((unused)) int pre_idle)
+{
+    return isInstalled(uart_num) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, __attribute__((unused)) int queue_length)
+{
+    return isInstalled(uart_num) ? ESP_OK : ESP_FAIL;
+}
+
+int uart_pattern_pop_pos(__attribute__((unused)) uart_port_t uart_num)
+{
+    return -1;
+}
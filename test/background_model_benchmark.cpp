@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdio>
+
+#include "background_model.hpp"
+
+#define BENCHMARK_FRAMES 1000000
+#define BENCHMARK_BACKGROUND 100
+#define BENCHMARK_HOT 40
+
+/**
+ * Keeps the compiler from dropping the update
+ */
+static void consume(uint64_t mask)
+{
+    asm volatile("" : : "r"(mask) : "memory");
+}
+
+static double nowNs()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Times updates over a set of frames that is cycled through
+ * @return The average ns per frame
+ */
+static double timeUpdates(BackgroundModel *model, const int16_t (*frames)[BACKGROUND_MODEL_PIXELS])
+{
+    const double start = nowNs();
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        consume(model->update(frames[frame % 16]));
+    }
+    return (nowNs() - start) / BENCHMARK_FRAMES;
+}
+
+/**
+ * Prints the time for one frame's update, on a quiet background and with a quarter of the pixels flagged, as JSON
+ */
+int main()
+{
+    // The thermal camera's defaults
+    BackgroundModel model(5, 3, 8);
+
+    int16_t quiet[16][BACKGROUND_MODEL_PIXELS];
+    int16_t busy[16][BACKGROUND_MODEL_PIXELS];
+    uint32_t state = 1;
+    for (size_t frame = 0; frame < 16; frame++)
+    {
+        for (size_t i = 0; i < BACKGROUND_MODEL_PIXELS; i++)
+        {
+            state = state * 1664525 + 1013904223;
+            quiet[frame][i] = (int16_t) (BENCHMARK_BACKGROUND + (int16_t) ((state >> 16) % 5) - 2);
+            busy[frame][i] = (int16_t) (quiet[frame][i] + (i % 4 == 0 ? BENCHMARK_HOT : 0));
+        }
+    }
+
+    const double quiet_ns = timeUpdates(&model, quiet);
+    const double busy_ns = timeUpdates(&model, busy);
+
+    printf("{\"frames\": %d, \"pixels\": %d, \"update_ns\": %.1f, \"update_flagged_ns\": %.1f}\n",
+           BENCHMARK_FRAMES, BACKGROUND_MODEL_PIXELS, quiet_ns, busy_ns);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <cstdint>
+
+#include "background_model.hpp"
+#include "test.hpp"
+
+#define TEST_SHIFT 5
+#define TEST_SIGMA 3
+#define TEST_MIN_DEVIATION 8
+#define TEST_TRAINING_FRAMES (1 << TEST_SHIFT)
+/**
+ * 25 C in the sensor's 0.25 C steps
+ */
+#define TEST_BACKGROUND 100
+/**
+ * A person against the background, 10 C warmer
+ */
+#define TEST_HOT 40
+
+/**
+ * A repeatable sensor noise of -2 to 2 steps
+ */
+static int16_t noise(uint32_t *state)
+{
+    *state = *state * 1664525 + 1013904223;
+    return (int16_t) ((*state >> 16) % 5) - 2;
+}
+
+/**
+ * Fill a frame with the background level plus noise
+ */
+static void fillFrame(int16_t *frame, int16_t level, uint32_t *state)
+{
+    for (size_t i = 0; i < BACKGROUND_MODEL_PIXELS; i++)
+    {
+        frame[i] = (int16_t) (level + (state != nullptr ? noise(state) : 0));
+    }
+}
+
+/**
+ * Feed frames of a steady background
+ * @return The flags of every frame together
+ */
+static uint64_t feed(BackgroundModel *model, int16_t level, uint32_t frames, uint32_t *state)
+{
+    int16_t frame[BACKGROUND_MODEL_PIXELS];
+    uint64_t mask = 0;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        fillFrame(frame, level, state);
+        mask |= model->update(frame);
+    }
+    return mask;
+}
+
+static void testTrainingFlagsNothing()
+{
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, TEST_MIN_DEVIATION);
+    int16_t frame[BACKGROUND_MODEL_PIXELS];
+    uint64_t mask = 0;
+    for (uint32_t i = 0; i < TEST_TRAINING_FRAMES; i++)
+    {
+        // Far apart frames would all be flagged by a trained model
+        fillFrame(frame, (int16_t) (i % 2 == 0 ? TEST_BACKGROUND : TEST_BACKGROUND + TEST_HOT), nullptr);
+        mask |= model.update(frame);
+    }
+    CHECK(mask == 0);
+}
+
+static void testNoisyBackgroundStaysQuiet()
+{
+    // Without the minimum deviation, only the variance keeps the noise from being flagged
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, 0);
+    uint32_t state = 1;
+    feed(&model, TEST_BACKGROUND, TEST_TRAINING_FRAMES, &state);
+    CHECK(feed(&model, TEST_BACKGROUND, 2000, &state) == 0);
+}
+
+/**
+ * Pixels far from a trained background are flagged, and only those
+ */
+static void checkHotSpot(int16_t level)
+{
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, TEST_MIN_DEVIATION);
+    uint32_t state = 2;
+    feed(&model, level, TEST_TRAINING_FRAMES + 100, &state);
+
+    int16_t frame[BACKGROUND_MODEL_PIXELS];
+    fillFrame(frame, level, &state);
+    frame[10] = (int16_t) (level + TEST_HOT);
+    frame[11] = (int16_t) (level + TEST_HOT);
+    frame[63] = (int16_t) (level - TEST_HOT);
+    CHECK(model.update(frame) == ((1ull << 10) | (1ull << 11) | (1ull << 63)));
+}
+
+static void testHotSpotIsFlagged()
+{
+    checkHotSpot(TEST_BACKGROUND);
+    // -40 C, below zero the raw values are negative
+    checkHotSpot(-160);
+}
+
+static void testMinimumDeviation()
+{
+    // A noiseless background has no variance, so only the minimum deviation decides
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, TEST_MIN_DEVIATION);
+    feed(&model, TEST_BACKGROUND, TEST_TRAINING_FRAMES, nullptr);
+
+    int16_t frame[BACKGROUND_MODEL_PIXELS];
+    fillFrame(frame, TEST_BACKGROUND, nullptr);
+    frame[0] = TEST_BACKGROUND + TEST_MIN_DEVIATION;
+    frame[1] = TEST_BACKGROUND + TEST_MIN_DEVIATION + 1;
+    frame[2] = TEST_BACKGROUND - TEST_MIN_DEVIATION - 1;
+    CHECK(model.update(frame) == 0b110);
+}
+
+static void testStillSourceFades()
+{
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, TEST_MIN_DEVIATION);
+    uint32_t state = 3;
+    feed(&model, TEST_BACKGROUND, TEST_TRAINING_FRAMES + 100, &state);
+
+    int16_t frame[BACKGROUND_MODEL_PIXELS];
+    uint32_t flagged_frames = 0;
+    uint32_t last_flagged = 0;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        fillFrame(frame, TEST_BACKGROUND, &state);
+        frame[20] = TEST_BACKGROUND + TEST_HOT;
+        const uint64_t mask = model.update(frame);
+        CHECK((mask & ~(1ull << 20)) == 0);
+        if (mask != 0)
+        {
+            flagged_frames++;
+            last_flagged = i;
+        }
+    }
+    // It stays flagged for far longer than the background takes to follow a change, but not forever
+    CHECK(flagged_frames == last_flagged + 1);
+    CHECK(flagged_frames > (TEST_TRAINING_FRAMES << BACKGROUND_MODEL_FOREGROUND_SHIFT));
+    CHECK(flagged_frames < 1000);
+
+    // Once it is part of the background, taking it away is a change too
+    fillFrame(frame, TEST_BACKGROUND, &state);
+    CHECK(model.update(frame) == 1ull << 20);
+}
+
+static void testResetRetrains()
+{
+    BackgroundModel model(TEST_SHIFT, TEST_SIGMA, TEST_MIN_DEVIATION);
+    uint32_t state = 4;
+    feed(&model, TEST_BACKGROUND, TEST_TRAINING_FRAMES + 100, &state);
+    CHECK(feed(&model, TEST_BACKGROUND + TEST_HOT, 1, &state) == ~0ull);
+
+    // A new scene after a reset is learned instead of flagged
+    model.reset();
+    CHECK(feed(&model, TEST_BACKGROUND + TEST_HOT, TEST_TRAINING_FRAMES, &state) == 0);
+    CHECK(feed(&model, TEST_BACKGROUND + TEST_HOT, 100, &state) == 0);
+    CHECK(feed(&model, TEST_BACKGROUND, 1, &state) == ~0ull);
+}
+
+int main()
+{
+    runTest("training flags nothing", testTrainingFlagsNothing);
+    runTest("noisy background stays quiet", testNoisyBackgroundStaysQuiet);
+    runTest("hot spot is flagged", testHotSpotIsFlagged);
+    runTest("minimum deviation", testMinimumDeviation);
+    runTest("still source fades", testStillSourceFades);
+    runTest("reset retrains", testResetRetrains);
+    return testResult();
+}
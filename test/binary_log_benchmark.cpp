@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "binary_log.hpp"
+
+#define BENCHMARK_ROUNDS 100000
+/**
+ * LOG_DRAIN_BATCH in system.cpp, the records in one binary log packet
+ */
+#define DRAIN_BATCH 8
+/**
+ * LINK_MESSAGE_OVERHEAD in link_budget.hpp, the XRCE and serial framing around each published message
+ */
+#define MESSAGE_OVERHEAD 32
+
+/**
+ * A log call from the firmware, with how often it happens in the traffic
+ */
+struct LogSite
+{
+    const char *file;
+    const char *function;
+    uint32_t line;
+    uint8_t level;
+    const char *message;
+    bool literal;
+    uint32_t weight;
+};
+
+/**
+ * The log calls of a node set up followed by a session of firing and patterns, most of them literals like in the
+ * firmware, with the formatted stall and boot messages sent as text
+ */
+static const LogSite TRAFFIC[] = {
+        {"./main/nodes/laser.cpp", "virtual void LaserNode::setup(rclc_support_t*, rclc_executor_t*)", 54, 20,
+         "Setting up LaserNode", true, 1},
+        {"./main/nodes/laser.cpp", "virtual void LaserNode::setup(rclc_support_t*, rclc_executor_t*)", 58, 10,
+         "Setting up LaserNode: fire service", true, 1},
+        {"./main/nodes/laser.cpp", "void LaserNode::fireCallback(const void*, void*)", 313, 10,
+         "Laser fire: starting fire", true, 20},
+        {"./main/nodes/laser.cpp", "void LaserNode::fireCallback(const void*, void*)", 342, 30,
+         "Tried to fire laser while on cooldown", true, 10},
+        {"./main/nodes/laser.cpp", "void LaserNode::firePatternCallback(const void*, void*)", 401, 10,
+         "Laser pattern: starting pattern", true, 5},
+        {"./main/nodes/laser.cpp", "void LaserNode::patternThread()", 236, 10,
+         "Laser pattern: ended", false, 5},
+        {"./main/stall_monitor.cpp", "size_t checkHeartbeats(uint32_t)", 178, 40,
+         "Stall: thermal has been in thermal update for 1250 ms", false, 1},
+        {"./main/boot.cpp", "void logBootProfile()", 89, 20,
+         "Boot: agent took 845.2 ms, from 12.4 ms on core 0", false, 1},
+        {"./main/main.cpp", "void app_main()", 158, 20,
+         "Setup complete", true, 1},
+};
+
+/**
+ * @return The size of a string in CDR after aligning to 4 bytes
+ */
+static size_t cdrString(size_t offset, size_t length)
+{
+    offset = (offset + 3) & ~(size_t) 3;
+    return offset + 4 + length + 1;
+}
+
+/**
+ * @return The published size of an rcl_interfaces/Log message, named "PCC" like the firmware's
+ */
+static size_t logMessageSize(const LogSite &site)
+{
+    // stamp and level
+    size_t size = 4 + 4 + 1;
+    size = cdrString(size, strlen("PCC"));
+    size = cdrString(size, strlen(site.message));
+    size = cdrString(size, strlen(site.file));
+    size = cdrString(size, strlen(site.function));
+    size = ((size + 3) & ~(size_t) 3) + 4;
+    return size + MESSAGE_OVERHEAD;
+}
+
+/**
+ * @return The published size of a std_msgs/UInt8MultiArray carrying a binary log packet
+ */
+static size_t binaryPacketSize(size_t packet_length)
+{
+    // No layout dimensions, the data offset, then the data
+    return 4 + 4 + 4 + packet_length + MESSAGE_OVERHEAD;
+}
+
+static LogRecord makeRecord(const LogSite &site)
+{
+    LogRecord record = {};
+    record.file = site.file;
+    record.function = site.function;
+    record.line = site.line;
+    record.level = site.level;
+    record.site = logSiteId(site.file, site.line);
+    if (!site.literal)
+    {
+        record.messageLength = strlen(site.message);
+        memcpy(record.message, site.message, record.messageLength);
+    }
+    return record;
+}
+
+/**
+ * Prints the bytes on the link for the traffic as full Log messages and as binary log packets, and the time to
+ * encode a binary record, as JSON
+ */
+int main()
+{
+    uint32_t records = 0;
+    size_t log_bytes = 0;
+    size_t binary_bytes = 0;
+    uint8_t packet[DRAIN_BATCH * BINARY_LOG_RECORD_MAX_SIZE];
+    size_t packet_length = 0;
+    uint32_t batched = 0;
+    for (const LogSite &site : TRAFFIC)
+    {
+        const LogRecord record = makeRecord(site);
+        for (uint32_t i = 0; i < site.weight; i++)
+        {
+            records++;
+            log_bytes += logMessageSize(site);
+            packet_length += encodeBinaryLogRecord(record, &packet[packet_length], sizeof(packet) - packet_length);
+            if (++batched == DRAIN_BATCH)
+            {
+                binary_bytes += binaryPacketSize(packet_length);
+                packet_length = 0;
+                batched = 0;
+            }
+        }
+    }
+    if (batched > 0)
+    {
+        binary_bytes += binaryPacketSize(packet_length);
+    }
+
+    // A batch of records with their site ids computed at the call, like LOG's
+    LogRecord batch[DRAIN_BATCH];
+    for (size_t i = 0; i < DRAIN_BATCH; i++)
+    {
+        batch[i] = makeRecord(TRAFFIC[i % (sizeof(TRAFFIC) / sizeof(TRAFFIC[0]))]);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; round++)
+    {
+        asm volatile("" : : "r"(batch) : "memory");
+        packet_length = 0;
+        for (const LogRecord &record : batch)
+        {
+            packet_length += encodeBinaryLogRecord(record, &packet[packet_length], sizeof(packet) - packet_length);
+        }
+        asm volatile("" : : "r"(packet) : "memory");
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const double encode_ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                             (BENCHMARK_ROUNDS * DRAIN_BATCH);
+
+    printf("{\"records\": %u, \"log_bytes\": %zu, \"binary_bytes\": %zu, \"log_bytes_per_record\": %.1f, "
+           "\"binary_bytes_per_record\": %.1f, \"reduction\": %.2f, \"encode_ns\": %.1f}\n",
+           records, log_bytes, binary_bytes, (double) log_bytes / records, (double) binary_bytes / records,
+           (double) log_bytes / binary_bytes, encode_ns);
+    return 0;
+}
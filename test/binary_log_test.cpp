@@ -0,0 +1,86 @@
+#include <cstring>
+
+#include "binary_log.hpp"
+#include "test.hpp"
+
+/**
+ * Spells its argument the way LOG does
+ */
+#define IS_LITERAL(msg) isLogLiteral(#msg)
+
+static void testLiteralMessages()
+{
+    CHECK(IS_LITERAL("Setting up LaserNode"));
+    CHECK(IS_LITERAL(""));
+    CHECK(IS_LITERAL("Quoted \"name\" and a \\ backslash"));
+    static_assert(IS_LITERAL("Checked at compile time"), "LOG needs the answer as a constant");
+}
+
+static void testMessagesThatAreNotLiterals()
+{
+    const char *message = "from a variable";
+    const char array[] = "from an array";
+    const bool aborted = false;
+    // The arguments are only spelled, these keep them used
+    (void) message;
+    (void) array;
+    (void) aborted;
+
+    CHECK(!IS_LITERAL(message));
+    CHECK(!IS_LITERAL(array));
+    CHECK(!IS_LITERAL(aborted ? "Laser pattern: cancelled" : "Laser pattern: ended"));
+    // The decoder only finds single literals, so concatenated ones are sent
+    CHECK(!IS_LITERAL("Two " "literals"));
+    CHECK(!IS_LITERAL("Ends with a literal" + 0));
+}
+
+static void testSiteIdMatchesTheDecoder()
+{
+    // site_id("laser.cpp", 330) in tools/log_decoder.py
+    CHECK(logSiteId("laser.cpp", 330) == 0xab83cf87u);
+    // Only the file name counts
+    CHECK(logSiteId("/project/main/nodes/laser.cpp", 330) == 0xab83cf87u);
+    CHECK(logSiteId("laser.cpp", 331) != 0xab83cf87u);
+}
+
+static void testEncodeRecord()
+{
+    LogRecord record = {};
+    record.file = "laser.cpp";
+    record.line = 330;
+    record.level = 30;
+    record.messageLength = 2;
+    memcpy(record.message, "hi", 2);
+
+    uint8_t buffer[BINARY_LOG_RECORD_MAX_SIZE];
+    CHECK(encodeBinaryLogRecord(record, buffer, sizeof(buffer)) == BINARY_LOG_RECORD_HEADER_SIZE + 2);
+    const uint8_t expected[] = {0x87, 0xcf, 0x83, 0xab, 30, 2, 'h', 'i'};
+    CHECK(memcmp(buffer, expected, sizeof(expected)) == 0);
+
+    // A site id computed at the call is used as it is
+    record.site = 0x01020304;
+    record.messageLength = 0;
+    CHECK(encodeBinaryLogRecord(record, buffer, sizeof(buffer)) == BINARY_LOG_RECORD_HEADER_SIZE);
+    CHECK(buffer[0] == 0x04 && buffer[3] == 0x01 && buffer[5] == 0);
+}
+
+static void testEncodeNeedsRoom()
+{
+    LogRecord record = {};
+    record.site = 1;
+    record.messageLength = 10;
+    uint8_t buffer[BINARY_LOG_RECORD_MAX_SIZE];
+    CHECK(encodeBinaryLogRecord(record, buffer, BINARY_LOG_RECORD_HEADER_SIZE + 9) == 0);
+    CHECK(encodeBinaryLogRecord(record, buffer, BINARY_LOG_RECORD_HEADER_SIZE + 10) ==
+          BINARY_LOG_RECORD_HEADER_SIZE + 10);
+}
+
+int main()
+{
+    runTest("literal messages", testLiteralMessages);
+    runTest("messages that are not literals", testMessagesThatAreNotLiterals);
+    runTest("site id matches the decoder", testSiteIdMatchesTheDecoder);
+    runTest("encode a record", testEncodeRecord);
+    runTest("encode needs room", testEncodeNeedsRoom);
+    return testResult();
+}
@@ -0,0 +1,162 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "boot.hpp"
+#include "test.hpp"
+
+/**
+ * What the steps of one test saw, in the order they finished
+ */
+struct StepLog
+{
+    std::atomic<uint32_t> done{0};
+    std::atomic<size_t> finished{0};
+    uint8_t order[BOOT_MAX_STEPS + 1]{};
+    /**
+     * The steps that were done when each step started
+     */
+    uint32_t doneAtStart[BOOT_MAX_STEPS + 1]{};
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+};
+
+struct StepContext
+{
+    StepLog *log;
+    uint8_t id;
+    /**
+     * How long the step takes, in ms
+     */
+    uint32_t duration;
+};
+
+static void recordStep(void *arg)
+{
+    auto context = (StepContext *) arg;
+    StepLog *log = context->log;
+    log->doneAtStart[context->id] = log->done.load();
+
+    const int running = log->running.fetch_add(1) + 1;
+    int max_running = log->maxRunning.load();
+    while (running > max_running && !log->maxRunning.compare_exchange_weak(max_running, running))
+    {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(context->duration));
+    log->running.fetch_sub(1);
+
+    log->order[log->finished.fetch_add(1)] = context->id;
+    log->done.fetch_or(1u << context->id);
+}
+
+static void testIndependentStepsOverlap()
+{
+    StepLog log;
+    StepContext contexts[4];
+    InitScheduler scheduler;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        contexts[i] = {&log, i, 100};
+        scheduler.add("independent", recordStep, &contexts[i]);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.start();
+    scheduler.wait();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(log.done.load() == 0xf);
+    CHECK(log.maxRunning.load() == 4);
+    // Run one after the other they would take 400 ms
+    CHECK(elapsed < std::chrono::milliseconds(300));
+}
+
+static void testDependenciesFinishFirst()
+{
+    // a, then b and c, then d once both are done
+    StepLog log;
+    StepContext a = {&log, 0, 20};
+    StepContext b = {&log, 1, 60};
+    StepContext c = {&log, 2, 10};
+    StepContext d = {&log, 3, 0};
+    InitScheduler scheduler;
+    const InitStep step_a = scheduler.add("a", recordStep, &a);
+    const InitStep step_b = scheduler.add("b", recordStep, &b, step_a);
+    const InitStep step_c = scheduler.add("c", recordStep, &c, step_a);
+    scheduler.add("d", recordStep, &d, step_b | step_c);
+    scheduler.start();
+    scheduler.wait();
+
+    CHECK(log.finished.load() == 4);
+    CHECK(log.doneAtStart[0] == 0);
+    CHECK((log.doneAtStart[1] & 0x1) == 0x1);
+    CHECK((log.doneAtStart[2] & 0x1) == 0x1);
+    CHECK(log.doneAtStart[3] == 0x7);
+    CHECK(log.order[0] == 0);
+    CHECK(log.order[3] == 3);
+    // b and c only wait for a, so they overlap
+    CHECK(log.maxRunning.load() == 2);
+}
+
+static void testWaitBlocksUntilDone()
+{
+    StepLog log;
+    StepContext slow = {&log, 0, 100};
+    InitScheduler scheduler;
+    scheduler.add("slow", recordStep, &slow);
+    scheduler.start();
+    scheduler.wait();
+    CHECK(log.done.load() == 0x1);
+}
+
+static void testEmptySchedulerDoesNotBlock()
+{
+    InitScheduler scheduler;
+    scheduler.start();
+    scheduler.wait();
+}
+
+static void testLaterDependencyIsDropped()
+{
+    // A step can't wait for one added after it, that one could wait for it in turn
+    StepLog log;
+    StepContext first = {&log, 0, 0};
+    StepContext second = {&log, 1, 0};
+    InitScheduler scheduler;
+    scheduler.add("first", recordStep, &first, 0x2);
+    scheduler.add("second", recordStep, &second);
+    scheduler.start();
+    scheduler.wait();
+    CHECK(log.done.load() == 0x3);
+}
+
+static void testStepsPastTheLimitRunRightAway()
+{
+    StepLog log;
+    StepContext contexts[BOOT_MAX_STEPS + 1];
+    InitScheduler scheduler;
+    for (uint8_t i = 0; i < BOOT_MAX_STEPS; i++)
+    {
+        contexts[i] = {&log, i, 0};
+        CHECK(scheduler.add("step", recordStep, &contexts[i]) == (InitStep) 1 << i);
+    }
+
+    contexts[BOOT_MAX_STEPS] = {&log, BOOT_MAX_STEPS, 0};
+    CHECK(scheduler.add("extra", recordStep, &contexts[BOOT_MAX_STEPS]) == 0);
+    CHECK(log.done.load() == 1u << BOOT_MAX_STEPS);
+
+    scheduler.start();
+    scheduler.wait();
+    CHECK(log.finished.load() == BOOT_MAX_STEPS + 1);
+}
+
+int main()
+{
+    runTest("independent steps overlap", testIndependentStepsOverlap);
+    runTest("dependencies finish first", testDependenciesFinishFirst);
+    runTest("wait blocks until done", testWaitBlocksUntilDone);
+    runTest("empty scheduler doesn't block", testEmptySchedulerDoesNotBlock);
+    runTest("later dependency is dropped", testLaterDependencyIsDropped);
+    runTest("steps past the limit run right away", testStepsPastTheLimitRunRightAway);
+    return testResult();
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdio>
+
+#include "callback_stats.hpp"
+
+#define BENCHMARK_ROUNDS 1000000
+
+/**
+ * Keeps the compiler from dropping the loop
+ */
+static void consume(const void *data)
+{
+    asm volatile("" : : "r"(data) : "memory");
+}
+
+static double nowNs()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+__attribute__((noinline)) static void bareCallback(int *value)
+{
+    consume(value);
+}
+
+__attribute__((noinline)) static void measuredCallback(int *value)
+{
+    MEASURE_CALLBACK("measuredCallback");
+    consume(value);
+}
+
+/**
+ * Prints the cost of adding a time to a histogram, of an empty callback with and without MEASURE_CALLBACK, and what
+ * measureCallbackStatsOverhead reports for the same thing, as JSON
+ */
+int main()
+{
+    CallbackHistogram histogram;
+    double start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_ROUNDS; i++)
+    {
+        histogram.add(i & 0x3fff);
+        consume(&histogram);
+    }
+    const double add_ns = (nowNs() - start) / BENCHMARK_ROUNDS;
+
+    int value = 0;
+    start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_ROUNDS; i++)
+    {
+        bareCallback(&value);
+    }
+    const double bare_ns = (nowNs() - start) / BENCHMARK_ROUNDS;
+
+    start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_ROUNDS; i++)
+    {
+        measuredCallback(&value);
+    }
+    const double measured_ns = (nowNs() - start) / BENCHMARK_ROUNDS;
+
+    printf("{\"rounds\": %d, \"histogram_add_ns\": %.1f, \"bare_callback_ns\": %.1f, \"measured_callback_ns\": %.1f, "
+           "\"overhead_ns\": %.1f, \"reported_overhead_ns\": %u}\n",
+           BENCHMARK_ROUNDS, add_ns, bare_ns, measured_ns, measured_ns - bare_ns,
+           measureCallbackStatsOverhead());
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <cstring>
+
+#include "callback_stats.hpp"
+#include "test.hpp"
+
+/**
+ * Add the same time several times
+ */
+static void addTimes(CallbackHistogram *histogram, int64_t time, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        histogram->add(time);
+    }
+}
+
+static void testBucketEdges()
+{
+    CHECK(callbackStatsBucket(-5) == 0);
+    CHECK(callbackStatsBucket(0) == 0);
+    CHECK(callbackStatsBucket(1) == 1);
+    CHECK(callbackStatsBucket(2) == 2);
+    CHECK(callbackStatsBucket(3) == 2);
+    CHECK(callbackStatsBucket(4) == 3);
+    // Each bucket ends right before the next power of two
+    for (size_t bucket = 1; bucket < CALLBACK_STATS_BUCKETS - 1; bucket++)
+    {
+        CHECK(callbackStatsBucket(1LL << (bucket - 1)) == bucket);
+        CHECK(callbackStatsBucket((1LL << bucket) - 1) == bucket);
+    }
+    // Everything from 2^14 us up goes in the last bucket
+    CHECK(callbackStatsBucket(1LL << (CALLBACK_STATS_BUCKETS - 2)) == CALLBACK_STATS_BUCKETS - 1);
+    CHECK(callbackStatsBucket(1LL << 40) == CALLBACK_STATS_BUCKETS - 1);
+}
+
+static void testHistogram()
+{
+    CallbackHistogram histogram;
+    CHECK(histogram.getCount() == 0);
+    CHECK(histogram.getMax() == 0);
+    histogram.add(0);
+    histogram.add(5);
+    histogram.add(7);
+    histogram.add(100000);
+    CHECK(histogram.getCount() == 4);
+    CHECK(histogram.getMax() == 100000);
+    CHECK(histogram.getBucket(0) == 1);
+    CHECK(histogram.getBucket(3) == 2);
+    CHECK(histogram.getBucket(CALLBACK_STATS_BUCKETS - 1) == 1);
+
+    char text[64];
+    CHECK(histogram.format(text, sizeof(text)) == strlen(" 1:1 8:2 inf:1"));
+    CHECK(strcmp(text, " 1:1 8:2 inf:1") == 0);
+    // Cut short, it stays terminated
+    CHECK(histogram.format(text, 6) == 5);
+    CHECK(strcmp(text, " 1:1 ") == 0);
+}
+
+static void testPercentiles()
+{
+    CallbackHistogram histogram;
+    CHECK(histogram.getPercentile(50) == 0);
+
+    // 90 fast callbacks, 10 slow ones
+    addTimes(&histogram, 3, 90);
+    addTimes(&histogram, 1000, 10);
+    CHECK(histogram.getPercentile(1) == 4);
+    CHECK(histogram.getPercentile(50) == 4);
+    CHECK(histogram.getPercentile(90) == 4);
+    // The slow bucket ends at 1024, but nothing took longer than 1000
+    CHECK(histogram.getPercentile(91) == 1000);
+    CHECK(histogram.getPercentile(99) == 1000);
+    CHECK(histogram.getPercentile(100) == 1000);
+
+    // Times past the last bucket's start are only bounded by the longest one
+    addTimes(&histogram, 20000, 2);
+    CHECK(histogram.getPercentile(99) == 20000);
+    CHECK(histogram.getPercentile(50) == 4);
+
+    // Rounding up keeps a single outlier in 100 out of p99
+    CallbackHistogram outlier;
+    addTimes(&outlier, 10, 99);
+    outlier.add(5000);
+    CHECK(outlier.getPercentile(99) == 16);
+    CHECK(outlier.getPercentile(100) == 5000);
+
+    // The bucket under 1 us
+    CallbackHistogram zero;
+    addTimes(&zero, 0, 10);
+    CHECK(zero.getPercentile(50) == 0);
+}
+
+static void testTimerLateness()
+{
+    CallbackStats stats("timer", false);
+    // A 100 ms timer called 3 ms late, then one called early
+    rcl_timer_t timer = {100000000, 97000000};
+    {
+        CallbackTimer callback_timer(&stats, &timer);
+    }
+    timer.timeUntilNextCall = 100500000;
+    {
+        CallbackTimer callback_timer(&stats, &timer);
+    }
+    CHECK(stats.queueing.getCount() == 2);
+    CHECK(stats.queueing.getBucket(callbackStatsBucket(3000)) == 1);
+    CHECK(stats.queueing.getBucket(0) == 1);
+    CHECK(stats.execution.getCount() == 2);
+}
+
+static void testExecutorQueueing()
+{
+    CallbackStats stats("queued", false);
+    rclc_executor_handle_t handles[] = {{false},
+                                        {true}};
+    CHECK(callbackStatsTrigger(handles, 2, nullptr));
+    CHECK(!callbackStatsTrigger(handles, 1, nullptr));
+    {
+        CallbackTimer callback_timer(&stats);
+    }
+    CHECK(stats.queueing.getCount() == 1);
+    CHECK(stats.queueing.getMax() < 1000);
+}
+
+static void measuredCallback()
+{
+    MEASURE_CALLBACK("measuredCallback");
+}
+
+static void testReport()
+{
+    measuredCallback();
+    measuredCallback();
+    CallbackStats *stats = getCallbackStats();
+    CHECK(stats != nullptr && strcmp(stats->name, "measuredCallback") == 0);
+    CHECK(stats != nullptr && stats->execution.getCount() == 2);
+
+    char text[256];
+    const size_t length = formatCallbackStats(text, sizeof(text));
+    CHECK(length == strlen(text));
+    CHECK(strncmp(text, "measuredCallback n=2 p50=", 25) == 0);
+    CHECK(text[length - 1] == '\n');
+
+    char short_text[16];
+    CHECK(formatCallbackStats(short_text, sizeof(short_text)) == sizeof(short_text) - 1);
+    CHECK(strlen(short_text) == sizeof(short_text) - 1);
+}
+
+int main()
+{
+    runTest("bucket edges", testBucketEdges);
+    runTest("histogram", testHistogram);
+    runTest("percentiles", testPercentiles);
+    runTest("timer lateness", testTimerLateness);
+    runTest("executor queueing", testExecutorQueueing);
+    runTest("report", testReport);
+    return testResult();
+}
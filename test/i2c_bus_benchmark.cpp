@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "i2c_bus.hpp"
+#include "pcc_sim/i2c_bus.hpp"
+
+#define BENCHMARK_DURATION 500
+#define BENCHMARK_READERS 4
+#define BENCHMARK_WRITERS 2
+/**
+ * An AMG88xx frame, two bytes per pixel
+ */
+#define FRAME_SIZE 128
+/**
+ * A reader on its own, the readers, then a reader with the writers
+ */
+#define BENCHMARK_DEVICES (1 + BENCHMARK_READERS + 1 + BENCHMARK_WRITERS)
+
+/**
+ * Result of one phase of the benchmark
+ */
+struct Phase
+{
+    double transactionsPerS;
+    uint32_t averageLatency;
+    uint32_t maxLatency;
+};
+
+/**
+ * Runs readers of whole frames and writers of single pwm channels on the bus at once, for BENCHMARK_DURATION ms
+ */
+static Phase runPhase(I2cDevice *const *readers, size_t reader_count, I2cDevice *const *writers, size_t writer_count)
+{
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> transactions{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < reader_count; i++)
+    {
+        threads.emplace_back([&, device = readers[i]]()
+                             {
+                                 uint8_t frame[FRAME_SIZE];
+                                 while (running.load(std::memory_order_relaxed))
+                                 {
+                                     device->readRegisters(0x80, frame, sizeof(frame));
+                                     transactions.fetch_add(1, std::memory_order_relaxed);
+                                 }
+                             });
+    }
+    for (size_t i = 0; i < writer_count; i++)
+    {
+        threads.emplace_back([&, device = writers[i]]()
+                             {
+                                 const uint8_t data[5] = {0x06, 0, 0, 0x34, 0x01};
+                                 while (running.load(std::memory_order_relaxed))
+                                 {
+                                     device->write(data, sizeof(data));
+                                     transactions.fetch_add(1, std::memory_order_relaxed);
+                                 }
+                             });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_DURATION));
+    running.store(false);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    Phase phase = {};
+    phase.transactionsPerS = transactions.load() /
+                             std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+    for (size_t i = 0; i < reader_count + writer_count; i++)
+    {
+        const I2cDeviceStats stats = (i < reader_count ? readers[i] : writers[i - reader_count])->getStats();
+        phase.averageLatency = std::max(phase.averageLatency, stats.averageLatency);
+        phase.maxLatency = std::max(phase.maxLatency, stats.maxLatency);
+    }
+    return phase;
+}
+
+/**
+ * Prints the transactions per second through the bus task and the worst device latencies (us), for one reader, for
+ * several readers that get batched, and for readers mixed with writers, as JSON. The fake bus takes no time, so this
+ * is the cost of the queue, the batching and the hand back to the caller
+ */
+int main()
+{
+    static I2cBus bus(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22, 400000);
+    static FakeRegisterDevice fakes[BENCHMARK_DEVICES];
+    I2cDevice *devices[BENCHMARK_DEVICES];
+    for (uint8_t i = 0; i < BENCHMARK_DEVICES; i++)
+    {
+        simI2cAttach(I2C_NUM_0, 0x40 + i, &fakes[i]);
+        devices[i] = new I2cDevice(&bus, 0x40 + i, "benchmark");
+    }
+
+    // Each phase uses its own devices, so their latencies start from zero
+    const Phase single = runPhase(&devices[0], 1, nullptr, 0);
+    const Phase readers = runPhase(&devices[1], BENCHMARK_READERS, nullptr, 0);
+    const Phase mixed = runPhase(&devices[1 + BENCHMARK_READERS], 1, &devices[2 + BENCHMARK_READERS],
+                                 BENCHMARK_WRITERS);
+
+    printf("{\"single_reader_per_s\": %.0f, \"single_reader_max_latency_us\": %u, "
+           "\"readers\": %d, \"readers_per_s\": %.0f, \"readers_average_latency_us\": %u, "
+           "\"readers_max_latency_us\": %u, \"writers\": %d, \"mixed_per_s\": %.0f, "
+           "\"mixed_average_latency_us\": %u, \"mixed_max_latency_us\": %u}\n",
+           single.transactionsPerS, single.maxLatency,
+           BENCHMARK_READERS, readers.transactionsPerS, readers.averageLatency, readers.maxLatency,
+           BENCHMARK_WRITERS, mixed.transactionsPerS, mixed.averageLatency, mixed.maxLatency);
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "i2c_bus.hpp"
+#include "pcc_sim/i2c_bus.hpp"
+#include "test.hpp"
+
+#define CONTENTION_THREADS 4
+#define CONTENTION_ROUNDS 500
+/**
+ * Time (ms) for a thread to get its transaction on the queue
+ */
+#define QUEUE_DELAY 20
+
+/**
+ * A register device that counts the writes that set registers
+ */
+class CountingDevice : public FakeRegisterDevice
+{
+public:
+    std::atomic<uint32_t> registerWrites{0};
+
+    esp_err_t write(const uint8_t *data, size_t length) override
+    {
+        if (length > 1)
+        {
+            registerWrites++;
+        }
+        return FakeRegisterDevice::write(data, length);
+    }
+};
+
+/**
+ * A device whose reads hold the bus until it is opened, so transactions pile up in the queue behind it
+ */
+class GateDevice : public FakeRegisterDevice
+{
+public:
+    esp_err_t read(uint8_t *data, size_t length) override
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        opened.wait(guard, [this]()
+        {
+            return open;
+        });
+        return FakeRegisterDevice::read(data, length);
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            open = true;
+        }
+        opened.notify_all();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable opened;
+    bool open = false;
+};
+
+/**
+ * A device that doesn't acknowledge reads
+ */
+class NackDevice : public FakeRegisterDevice
+{
+public:
+    esp_err_t read(__attribute__((unused)) uint8_t *data, __attribute__((unused)) size_t length) override
+    {
+        return ESP_FAIL;
+    }
+};
+
+/**
+ * Tasks hammer their own devices on a shared bus, every read sees the task's own last write
+ */
+static void testContention()
+{
+    static I2cBus bus(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22, 400000);
+    static CountingDevice fakes[CONTENTION_THREADS];
+    static I2cDevice *devices[CONTENTION_THREADS];
+    for (uint8_t i = 0; i < CONTENTION_THREADS; i++)
+    {
+        simI2cAttach(I2C_NUM_0, 0x10 + i, &fakes[i]);
+        devices[i] = new I2cDevice(&bus, 0x10 + i, "contention");
+    }
+
+    std::atomic<uint32_t> failures{0};
+    std::atomic<uint32_t> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < CONTENTION_THREADS; thread++)
+    {
+        threads.emplace_back([&, thread]()
+                             {
+                                 I2cDevice *device = devices[thread];
+                                 for (uint32_t i = 0; i < CONTENTION_ROUNDS; i++)
+                                 {
+                                     const auto reg = (uint8_t) (i % 8);
+                                     uint8_t value = 0;
+                                     if (device->writeRegister(reg, (uint8_t) (i * 7 + thread)) != ESP_OK ||
+                                         device->readRegisters(reg, &value, 1) != ESP_OK)
+                                     {
+                                         failures++;
+                                     }
+                                     else if (value != (uint8_t) (i * 7 + thread))
+                                     {
+                                         mismatches++;
+                                     }
+                                 }
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(failures == 0);
+    CHECK(mismatches == 0);
+    for (size_t i = 0; i < CONTENTION_THREADS; i++)
+    {
+        const I2cDeviceStats stats = devices[i]->getStats();
+        CHECK(stats.transactions == 2 * CONTENTION_ROUNDS);
+        CHECK(stats.errors == 0);
+        CHECK(stats.averageLatency <= stats.maxLatency);
+        CHECK(fakes[i].registerWrites == CONTENTION_ROUNDS);
+    }
+}
+
+/**
+ * A write queued with reads, one of which fails, reaches its device once
+ */
+static void testFailedBatchRepeatsNoWrite()
+{
+    static I2cBus bus(I2C_NUM_1, GPIO_NUM_25, GPIO_NUM_26, 400000);
+    static GateDevice gate_fake;
+    static CountingDevice write_fake;
+    static NackDevice nack_fake;
+    static CountingDevice read_fake;
+    simI2cAttach(I2C_NUM_1, 0x20, &gate_fake);
+    simI2cAttach(I2C_NUM_1, 0x21, &write_fake);
+    simI2cAttach(I2C_NUM_1, 0x22, &nack_fake);
+    simI2cAttach(I2C_NUM_1, 0x23, &read_fake);
+    static I2cDevice gate(&bus, 0x20, "gate");
+    static I2cDevice writer(&bus, 0x21, "writer");
+    static I2cDevice nack(&bus, 0x22, "nack");
+    static I2cDevice reader(&bus, 0x23, "reader");
+
+    // Hold the bus, then queue a write, a read that fails and a read that works behind it
+    esp_err_t write_result = ESP_FAIL;
+    esp_err_t nack_result = ESP_OK;
+    esp_err_t read_result = ESP_FAIL;
+    std::vector<std::thread> threads;
+    threads.emplace_back([]()
+                         {
+                             uint8_t value;
+                             gate.readRegisters(0, &value, 1);
+                         });
+    std::this_thread::sleep_for(std::chrono::milliseconds(QUEUE_DELAY));
+    threads.emplace_back([&write_result]()
+                         {
+                             write_result = writer.writeRegister(1, 5);
+                         });
+    std::this_thread::sleep_for(std::chrono::milliseconds(QUEUE_DELAY));
+    threads.emplace_back([&nack_result]()
+                         {
+                             uint8_t value;
+                             nack_result = nack.readRegisters(0, &value, 1);
+                         });
+    std::this_thread::sleep_for(std::chrono::milliseconds(QUEUE_DELAY));
+    threads.emplace_back([&read_result]()
+                         {
+                             uint8_t value;
+                             read_result = reader.readRegisters(0, &value, 1);
+                         });
+    std::this_thread::sleep_for(std::chrono::milliseconds(QUEUE_DELAY));
+    gate_fake.release();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(write_result == ESP_OK);
+    CHECK(write_fake.registerWrites == 1);
+    CHECK(nack_result != ESP_OK);
+    CHECK(read_result == ESP_OK);
+    // Failures are only counted against the device that caused them
+    CHECK(nack.getStats().errors == 1);
+    CHECK(reader.getStats().errors == 0);
+    CHECK(writer.getStats().errors == 0);
+}
+
+int main()
+{
+    runTest("contention", testContention);
+    runTest("failed batch repeats no write", testFailedBatchRepeatsNoWrite);
+    return testResult();
+}
@@ -0,0 +1,167 @@
+#include <cstring>
+
+#include "laser_pattern.hpp"
+#include "test.hpp"
+
+/**
+ * Validate a pattern given as its elements
+ */
+#define VALIDATE(...)                                                          \
+    []()                                                                       \
+    {                                                                          \
+        const uint16_t data[] = {__VA_ARGS__};                                 \
+        return validateLaserPattern(data, sizeof(data) / sizeof(data[0]));     \
+    }()
+
+static bool rejectedWith(const char *error, const char *expected)
+{
+    return error != nullptr && strcmp(error, expected) == 0;
+}
+
+static void testSafePatterns()
+{
+    // The single fire, at exactly the duty cycle limit
+    CHECK(VALIDATE(1, 250, 750) == nullptr);
+    CHECK(VALIDATE(LASER_PATTERN_MAX_REPEATS, 1, LASER_PATTERN_MIN_OFF_TIME) == nullptr);
+    CHECK(VALIDATE(3, 100, 300, 50, 550) == nullptr);
+
+    uint16_t longest[1 + (LASER_PATTERN_MAX_PULSES << 1)];
+    longest[0] = 1;
+    for (size_t i = 1; i < sizeof(longest) / sizeof(longest[0]); i += 2)
+    {
+        longest[i] = 10;
+        longest[i + 1] = 90;
+    }
+    CHECK(validateLaserPattern(longest, sizeof(longest) / sizeof(longest[0])) == nullptr);
+}
+
+static void testMalformedPatterns()
+{
+    const char *shape = "Pattern must be a repeat count followed by on/off pairs";
+    CHECK(rejectedWith(validateLaserPattern(nullptr, 0), shape));
+    CHECK(rejectedWith(VALIDATE(1), shape));
+    CHECK(rejectedWith(VALIDATE(1, 100), shape));
+    CHECK(rejectedWith(VALIDATE(1, 100, 400, 100), shape));
+
+    uint16_t too_long[3 + (LASER_PATTERN_MAX_PULSES << 1)];
+    too_long[0] = 1;
+    for (size_t i = 1; i < sizeof(too_long) / sizeof(too_long[0]); i += 2)
+    {
+        too_long[i] = 10;
+        too_long[i + 1] = 90;
+    }
+    CHECK(rejectedWith(validateLaserPattern(too_long, sizeof(too_long) / sizeof(too_long[0])), "Too many pulses"));
+}
+
+static void testRepeatLimits()
+{
+    CHECK(rejectedWith(VALIDATE(0, 100, 400), "Invalid repeat count"));
+    CHECK(rejectedWith(VALIDATE(LASER_PATTERN_MAX_REPEATS + 1, 100, 400), "Invalid repeat count"));
+}
+
+static void testPulseLimits()
+{
+    CHECK(rejectedWith(VALIDATE(1, 0, 400), "Pulse on time out of range"));
+    CHECK(rejectedWith(VALIDATE(1, LASER_PATTERN_MAX_ON_TIME + 1, 2000), "Pulse on time out of range"));
+    CHECK(rejectedWith(VALIDATE(1, 10, LASER_PATTERN_MIN_OFF_TIME - 1), "Pulse off time too short"));
+    // A bad pulse anywhere rejects the pattern
+    CHECK(rejectedWith(VALIDATE(1, 100, 400, 100, 400, 300, 2000), "Pulse on time out of range"));
+}
+
+static void testDutyCycleLimit()
+{
+    CHECK(rejectedWith(VALIDATE(1, 250, 749), "Duty cycle too high"));
+    // Every pulse is within the on and off time limits, but the pattern is on too much
+    CHECK(rejectedWith(VALIDATE(1, 100, 300, 200, 100), "Duty cycle too high"));
+    // The longest on and off times don't overflow the totals
+    CHECK(VALIDATE(1, 250, 65535) == nullptr);
+}
+
+static void testLoadPattern()
+{
+    const uint16_t data[] = {5, 100, 300, 50, 550};
+    LaserPulse pulses[LASER_PATTERN_MAX_PULSES];
+    uint16_t repeats = 0;
+    CHECK(loadLaserPattern(data, sizeof(data) / sizeof(data[0]), pulses, &repeats) == 2);
+    CHECK(repeats == 5);
+    CHECK(pulses[0].onTime == 100 && pulses[0].offTime == 300);
+    CHECK(pulses[1].onTime == 50 && pulses[1].offTime == 550);
+}
+
+/**
+ * Runs a pattern against a virtual tick count, waking each edge late by some ticks like a busy system would
+ * @param start The tick the pattern starts at
+ * @param edges Set to the tick each edge was due at
+ * @param lateness The ticks each wake comes after the edge
+ * @return The tick the pattern ended at
+ */
+static uint32_t runPattern(const LaserPulse *pulses, size_t length, uint16_t repeats, uint32_t start,
+                           uint32_t *edges, uint32_t lateness)
+{
+    uint32_t now = start;
+    uint32_t wake_time = start;
+    size_t edge = 0;
+    for (uint16_t repeat = 0; repeat < repeats; repeat++)
+    {
+        for (size_t pulse = 0; pulse < length; pulse++)
+        {
+            now += advanceLaserPulse(&wake_time, pulses[pulse].onTime, now) + lateness;
+            edges[edge++] = wake_time;
+            now += advanceLaserPulse(&wake_time, pulses[pulse].offTime, now) + lateness;
+            edges[edge++] = wake_time;
+        }
+    }
+    return now;
+}
+
+static void testPatternTiming()
+{
+    const LaserPulse pulses[] = {{100, 300},
+                                 {50,  550}};
+    uint32_t edges[8];
+    const uint32_t end = runPattern(pulses, 2, 2, 1000, edges, 0);
+    const uint32_t expected[] = {1100, 1400, 1450, 2000, 2100, 2400, 2450, 3000};
+    CHECK(memcmp(edges, expected, sizeof(expected)) == 0);
+    CHECK(end == 3000);
+}
+
+static void testLateWakesDontDrift()
+{
+    const LaserPulse pulses[] = {{100, 300}};
+    uint32_t edges[20];
+    // Every wake is 3 ticks late, the edges stay where they were due and the pattern only ends 3 ticks late
+    const uint32_t end = runPattern(pulses, 1, 10, 0, edges, 3);
+    CHECK(edges[19] == 4000);
+    CHECK(end == 4003);
+
+    // An edge that already passed isn't waited for at all
+    uint32_t wake_time = 0;
+    CHECK(advanceLaserPulse(&wake_time, 100, 150) == 0);
+    CHECK(wake_time == 100);
+    CHECK(advanceLaserPulse(&wake_time, 100, 150) == 50);
+}
+
+static void testTickCountWraps()
+{
+    const LaserPulse pulses[] = {{100, 300}};
+    uint32_t edges[4];
+    const uint32_t start = 0xFFFFFFFF - 250;
+    const uint32_t end = runPattern(pulses, 1, 2, start, edges, 0);
+    CHECK(edges[0] == start + 100);
+    CHECK(edges[1] == 149);
+    CHECK(end == 549);
+}
+
+int main()
+{
+    runTest("safe patterns", testSafePatterns);
+    runTest("malformed patterns", testMalformedPatterns);
+    runTest("repeat limits", testRepeatLimits);
+    runTest("pulse limits", testPulseLimits);
+    runTest("duty cycle limit", testDutyCycleLimit);
+    runTest("load a pattern", testLoadPattern);
+    runTest("pattern timing", testPatternTiming);
+    runTest("late wakes don't drift", testLateWakesDontDrift);
+    runTest("tick count wraps", testTickCountWraps);
+    return testResult();
+}
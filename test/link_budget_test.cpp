@@ -0,0 +1,231 @@
+#include <esp_timer.h>
+#include <rosidl_typesupport_microxrcedds_c/identifier.h>
+#include <rosidl_typesupport_microxrcedds_c/message_type_support.h>
+
+#include "esp32_serial_transport.hpp"
+#include "link_budget.hpp"
+#include "test.hpp"
+
+#define START_TIME 1000000
+/**
+ * A message's payload, LINK_MESSAGE_OVERHEAD more goes on the link
+ */
+#define MESSAGE_SIZE 100
+/**
+ * How long the simulated link runs (ms)
+ */
+#define SIMULATION_TIME 5000
+#define CONTROL_PERIOD 20
+#define CONTROL_SIZE 60
+/**
+ * The budgets let the uart's queue grow to the link's 200 ms burst, plus a last message that takes a class into debt.
+ * A service response waits at most that long
+ */
+#define CONTROL_MAX_LATENCY 250
+
+// The link budget reads the serial link's rate and the bytes written to it from the transport, which the test plays
+
+static uint32_t fakeBaudRate = 115200;
+static uint32_t fakeBytesOut = 0;
+
+void esp32SerialGetStats(struct Esp32SerialStats *stats)
+{
+    *stats = {};
+    stats->bytesOut = fakeBytesOut;
+}
+
+uint32_t esp32SerialGetBaudRate()
+{
+    return fakeBaudRate;
+}
+
+static size_t fakeSerializedSize(__attribute__((unused)) const void *message)
+{
+    return 68;
+}
+
+static const message_type_support_callbacks_t fakeCallbacks = {fakeSerializedSize};
+static const rosidl_message_type_support_t fakeTypeSupport = {ROSIDL_TYPESUPPORT_MICROXRCEDDS_C__IDENTIFIER_VALUE,
+                                                              &fakeCallbacks, nullptr};
+static const rosidl_message_type_support_t otherTypeSupport = {"rosidl_typesupport_c", nullptr, nullptr};
+
+/**
+ * Start over with full budgets on an idle link
+ */
+static void resetLink(uint32_t baud_rate)
+{
+    fakeBaudRate = baud_rate;
+    fakeBytesOut = 0;
+    hostTimerTime = START_TIME;
+    initLinkBudget();
+}
+
+static void advance(uint32_t ms)
+{
+    hostTimerTime += ms * 1000;
+}
+
+/**
+ * @return How many MESSAGE_SIZE messages the class may send right now
+ */
+static uint32_t takeAll(LinkClass link_class)
+{
+    uint32_t taken = 0;
+    while (linkBudgetTake(link_class, MESSAGE_SIZE))
+    {
+        taken++;
+    }
+    return taken;
+}
+
+static void testBudgetsStartFull()
+{
+    // 11520 bytes/s, a 200 ms burst of 60, 15 and 15% of it. The last message takes the budget into debt
+    resetLink(115200);
+    const LinkClassStats before = getLinkClassStats(LINK_CLASS_TELEMETRY);
+    CHECK(takeAll(LINK_CLASS_TELEMETRY) == 11);
+    CHECK(takeAll(LINK_CLASS_LOG) == 3);
+    CHECK(takeAll(LINK_CLASS_BULK) == 3);
+
+    const LinkClassStats after = getLinkClassStats(LINK_CLASS_TELEMETRY);
+    CHECK(after.messages - before.messages == 11);
+    CHECK(after.bytes - before.bytes == 11 * (MESSAGE_SIZE + LINK_MESSAGE_OVERHEAD));
+    CHECK(after.held - before.held == 1);
+}
+
+static void testSustainedRate()
+{
+    // Asking for far more than the share, for 10 s, gets the share plus the starting burst
+    resetLink(115200);
+    const LinkClassStats before = getLinkClassStats(LINK_CLASS_TELEMETRY);
+    for (uint32_t ms = 0; ms < 10000; ms++)
+    {
+        linkBudgetTake(LINK_CLASS_TELEMETRY, MESSAGE_SIZE);
+        advance(1);
+    }
+    const uint32_t bytes = getLinkClassStats(LINK_CLASS_TELEMETRY).bytes - before.bytes;
+    const float expected = 11520 * 0.6f * 10 + 11520 * 0.6f * 0.2f;
+    CHECK(bytes > expected * 0.99f && bytes < expected * 1.01f);
+}
+
+static void testIdleDoesntBank()
+{
+    resetLink(115200);
+    takeAll(LINK_CLASS_LOG);
+    advance(60000);
+    CHECK(takeAll(LINK_CLASS_LOG) == 3);
+}
+
+static void testBusyLinkHoldsLowerClassesFirst()
+{
+    // The link's burst is 2304 bytes. Bulk needs half of it left, logs a quarter, telemetry any
+    resetLink(115200);
+    const LinkClassStats bulk_before = getLinkClassStats(LINK_CLASS_BULK);
+    fakeBytesOut += 1500;
+    CHECK(!linkBudgetReady(LINK_CLASS_BULK));
+    CHECK(linkBudgetReady(LINK_CLASS_LOG));
+    CHECK(linkBudgetReady(LINK_CLASS_TELEMETRY));
+
+    fakeBytesOut += 400;
+    CHECK(!linkBudgetReady(LINK_CLASS_LOG));
+    CHECK(linkBudgetReady(LINK_CLASS_TELEMETRY));
+
+    fakeBytesOut += 1000;
+    CHECK(!linkBudgetReady(LINK_CLASS_TELEMETRY));
+    CHECK(getLinkClassStats(LINK_CLASS_BULK).held - bulk_before.held == 1);
+
+    // Once the uart has sent it, everything goes again
+    advance(300);
+    CHECK(linkBudgetReady(LINK_CLASS_BULK));
+    CHECK(linkBudgetReady(LINK_CLASS_LOG));
+    CHECK(linkBudgetReady(LINK_CLASS_TELEMETRY));
+}
+
+static void testDebtHoldsUntilRepaid()
+{
+    // A 2000 byte recording chunk charged after sending leaves the class 1686 bytes in debt, at 1728 bytes/s
+    resetLink(115200);
+    linkBudgetCharge(LINK_CLASS_BULK, 2000);
+    CHECK(!linkBudgetReady(LINK_CLASS_BULK));
+    advance(900);
+    CHECK(!linkBudgetReady(LINK_CLASS_BULK));
+    advance(200);
+    CHECK(linkBudgetReady(LINK_CLASS_BULK));
+    // The other classes weren't touched
+    CHECK(linkBudgetReady(LINK_CLASS_LOG));
+}
+
+static void testBudgetsFollowTheBaudRate()
+{
+    resetLink(921600);
+    CHECK(takeAll(LINK_CLASS_TELEMETRY) == 84);
+}
+
+static void testMessageSizes()
+{
+    resetLink(115200);
+    const LinkClassStats before = getLinkClassStats(LINK_CLASS_BULK);
+    CHECK(linkBudgetTakeMessage(LINK_CLASS_BULK, &fakeTypeSupport, nullptr));
+    linkBudgetChargeMessage(LINK_CLASS_BULK, &fakeTypeSupport, nullptr);
+    // Without the micro XRCE-DDS type support only the overhead is known
+    CHECK(linkBudgetTakeMessage(LINK_CLASS_BULK, &otherTypeSupport, nullptr));
+    const LinkClassStats after = getLinkClassStats(LINK_CLASS_BULK);
+    CHECK(after.messages - before.messages == 3);
+    CHECK(after.bytes - before.bytes == 2 * (68 + LINK_MESSAGE_OVERHEAD) + LINK_MESSAGE_OVERHEAD);
+}
+
+/**
+ * Every class tries to send far more than the link can take, while a service response goes out every CONTROL_PERIOD.
+ * The uart queue drains at the link's rate, and a response waits for everything queued before it
+ * @param budgeted Whether the classes go through the link budget, or write whatever they have
+ * @return The longest a response waited (ms)
+ */
+static float simulateControlLatency(bool budgeted)
+{
+    resetLink(115200);
+    const float capacity = 11520;
+    const size_t sizes[LINK_CLASSES] = {400, 120, 500};
+    float queued = 0;
+    float max_latency = 0;
+    for (uint32_t ms = 0; ms < SIMULATION_TIME; ms++)
+    {
+        queued -= queued < capacity / 1000 ? queued : capacity / 1000;
+        for (size_t link_class = 0; link_class < LINK_CLASSES; link_class++)
+        {
+            if (!budgeted || linkBudgetTake((LinkClass) link_class, sizes[link_class]))
+            {
+                queued += (float) (sizes[link_class] + LINK_MESSAGE_OVERHEAD);
+                fakeBytesOut += sizes[link_class] + LINK_MESSAGE_OVERHEAD;
+            }
+        }
+        if (ms % CONTROL_PERIOD == 0)
+        {
+            const float latency = queued / capacity * 1000;
+            max_latency = latency > max_latency ? latency : max_latency;
+            queued += CONTROL_SIZE + LINK_MESSAGE_OVERHEAD;
+            fakeBytesOut += CONTROL_SIZE + LINK_MESSAGE_OVERHEAD;
+        }
+        advance(1);
+    }
+    return max_latency;
+}
+
+static void testControlLatencyStaysBounded()
+{
+    CHECK(simulateControlLatency(true) <= CONTROL_MAX_LATENCY);
+    // Without it the queue grows for as long as the load lasts
+    CHECK(simulateControlLatency(false) > SIMULATION_TIME);
+}
+
+int main()
+{
+    runTest("budgets start full", testBudgetsStartFull);
+    runTest("sustained rate", testSustainedRate);
+    runTest("idle doesn't bank", testIdleDoesntBank);
+    runTest("busy link holds lower classes first", testBusyLinkHoldsLowerClassesFirst);
+    runTest("debt holds until repaid", testDebtHoldsUntilRepaid);
+    runTest("budgets follow the baud rate", testBudgetsFollowTheBaudRate);
+    runTest("message sizes", testMessageSizes);
+    runTest("control latency stays bounded", testControlLatencyStaysBounded);
+    return testResult();
+}
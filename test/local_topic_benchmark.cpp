@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "local_topic.hpp"
+
+#define BENCHMARK_ITERATIONS 1000000
+#define LATENCY_SAMPLES 5000
+/**
+ * The writer publishes at about the thermal camera's 10 Hz times 100, so the run stays short
+ */
+#define LATENCY_PERIOD_US 1000
+
+/**
+ * The size of a thermal sample: 64 pixels, the stats, the motion mask and a stamp
+ */
+struct BenchmarkSample
+{
+    int64_t publishTime;
+    float pixels[64];
+    float stats[12];
+    uint64_t motionMask;
+};
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double percentile(std::vector<int64_t> &values, double fraction)
+{
+    std::sort(values.begin(), values.end());
+    return (double) values[(size_t) (fraction * (double) (values.size() - 1))];
+}
+
+/**
+ * Prints the cost of an uncontended publish and read, and how long a sample takes to reach a reader on another thread
+ * that polls the topic, as JSON
+ */
+int main()
+{
+    static LocalTopic<BenchmarkSample> topic;
+    BenchmarkSample sample = {};
+
+    int64_t start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        sample.publishTime = i;
+        topic.publish(sample);
+    }
+    const double publish_ns = (double) (nowNs() - start) / BENCHMARK_ITERATIONS;
+
+    uint32_t last_sequence = 0;
+    uint32_t reads = 0;
+    start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        // Forget the last sequence, so every read copies the sample
+        last_sequence = 0;
+        reads += topic.read(sample, last_sequence);
+    }
+    const double read_ns = (double) (nowNs() - start) / BENCHMARK_ITERATIONS;
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(LATENCY_SAMPLES);
+    std::atomic<bool> writing{true};
+    std::thread reader([&]()
+                       {
+                           BenchmarkSample received;
+                           uint32_t sequence = topic.getSequence();
+                           while (writing.load(std::memory_order_relaxed))
+                           {
+                               if (topic.read(received, sequence))
+                               {
+                                   latencies.push_back(nowNs() - received.publishTime);
+                               }
+                           }
+                       });
+    for (uint32_t i = 0; i < LATENCY_SAMPLES; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(LATENCY_PERIOD_US));
+        sample.publishTime = nowNs();
+        topic.publish(sample);
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(LATENCY_PERIOD_US));
+    writing.store(false);
+    reader.join();
+
+    if (latencies.empty() || reads != BENCHMARK_ITERATIONS)
+    {
+        fprintf(stderr, "The reader didn't get the samples\n");
+        return 1;
+    }
+    printf("{\"sample_bytes\": %zu, \"publish_ns\": %.1f, \"read_ns\": %.1f, \"latency_samples\": %zu, "
+           "\"latency_p50_ns\": %.0f, \"latency_p99_ns\": %.0f, \"latency_max_ns\": %.0f}\n",
+           sizeof(BenchmarkSample), publish_ns, read_ns, latencies.size(), percentile(latencies, 0.5),
+           percentile(latencies, 0.99), percentile(latencies, 1));
+    return 0;
+}
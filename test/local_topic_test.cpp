@@ -0,0 +1,167 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "local_topic.hpp"
+#include "test.hpp"
+
+#define STRESS_READERS 4
+/**
+ * How long the writer publishes for, in ms
+ */
+#define STRESS_DURATION 1000
+/**
+ * The writer yields this often, so the readers also get to run on a machine with fewer cores than threads
+ */
+#define STRESS_YIELD_SAMPLES 16
+
+/**
+ * About the size of a thermal sample, so a copy takes long enough for publishes to overlap reads. Every word of a
+ * sample holds the same value, so a torn copy has two different ones
+ */
+struct StressSample
+{
+    uint32_t words[80];
+};
+
+static void testReadWithoutPublish()
+{
+    LocalTopic<uint32_t> topic;
+    uint32_t value = 0;
+    uint32_t last_sequence = 0;
+    CHECK(!topic.read(value, last_sequence));
+    CHECK(topic.getSequence() == 0);
+}
+
+static void testReadGetsEachSampleOnce()
+{
+    LocalTopic<uint32_t> topic;
+    uint32_t value = 0;
+    uint32_t last_sequence = 0;
+
+    topic.publish(7);
+    CHECK(topic.read(value, last_sequence));
+    CHECK(value == 7);
+    CHECK(last_sequence == 2);
+    CHECK(!topic.read(value, last_sequence));
+
+    // A reader that falls behind only gets the latest sample
+    topic.publish(8);
+    topic.publish(9);
+    CHECK(topic.read(value, last_sequence));
+    CHECK(value == 9);
+    CHECK(last_sequence == 6);
+}
+
+static void testReadSkipsPublishInProgress()
+{
+    LocalTopic<uint32_t> topic;
+    uint32_t value = 0;
+    uint32_t last_sequence = 0;
+
+    topic.publish(1);
+    *topic.beginWrite() = 2;
+    CHECK(topic.getSequence() & 1);
+    uint32_t other_sequence = 0;
+    CHECK(!topic.read(value, other_sequence));
+    CHECK(other_sequence == 0);
+
+    topic.endWrite();
+    CHECK(topic.read(value, last_sequence));
+    CHECK(value == 2);
+}
+
+static void testConcurrentReadsAreNeverTorn()
+{
+    static LocalTopic<StressSample> topic;
+    std::atomic<bool> writing{true};
+    std::atomic<size_t> ready{0};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> backwards{0};
+    std::atomic<uint64_t> reads{0};
+    uint32_t last_values[STRESS_READERS] = {};
+
+    std::vector<std::thread> readers;
+    for (size_t reader = 0; reader < STRESS_READERS; reader++)
+    {
+        readers.emplace_back([&, reader]()
+                             {
+                                 StressSample sample;
+                                 uint32_t last_sequence = 0;
+                                 uint32_t last_value = 0;
+                                 ready.fetch_add(1);
+                                 // One more read after the writer is done, to get the last sample
+                                 bool last_pass = false;
+                                 while (!last_pass)
+                                 {
+                                     last_pass = !writing.load();
+                                     if (!topic.read(sample, last_sequence))
+                                     {
+                                         std::this_thread::yield();
+                                         continue;
+                                     }
+                                     reads.fetch_add(1, std::memory_order_relaxed);
+                                     for (uint32_t word : sample.words)
+                                     {
+                                         if (word != sample.words[0])
+                                         {
+                                             torn.fetch_add(1);
+                                             break;
+                                         }
+                                     }
+                                     if (sample.words[0] <= last_value)
+                                     {
+                                         backwards.fetch_add(1);
+                                     }
+                                     last_value = sample.words[0];
+                                 }
+                                 last_values[reader] = last_value;
+                             });
+    }
+
+    while (ready.load() < STRESS_READERS)
+    {
+        std::this_thread::yield();
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(STRESS_DURATION);
+    uint32_t samples = 0;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        samples++;
+        if (samples % STRESS_YIELD_SAMPLES == 0)
+        {
+            std::this_thread::yield();
+        }
+        StressSample *sample = topic.beginWrite();
+        for (uint32_t &word : sample->words)
+        {
+            word = samples;
+        }
+        topic.endWrite();
+    }
+    writing.store(false);
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    printf("%llu reads of %u samples\n", (unsigned long long) reads.load(), samples);
+    CHECK(torn.load() == 0);
+    CHECK(backwards.load() == 0);
+    CHECK(reads.load() > 0);
+    for (uint32_t last_value : last_values)
+    {
+        CHECK(last_value == samples);
+    }
+    CHECK(topic.getSequence() == 2 * samples);
+}
+
+int main()
+{
+    runTest("read without publish", testReadWithoutPublish);
+    runTest("read gets each sample once", testReadGetsEachSampleOnce);
+    runTest("read skips a publish in progress", testReadSkipsPublishInProgress);
+    runTest("concurrent reads are never torn", testConcurrentReadsAreNeverTorn);
+    return testResult();
+}
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "log_buffer.hpp"
+
+#define BENCHMARK_CALLS 1000000
+#define BENCHMARK_PRODUCERS 4
+#define BENCHMARK_PRODUCER_CALLS 200000
+
+static const char MESSAGE[] = "Thermal camera frame took longer than the update period";
+
+/**
+ * The enqueue of log, copying the message unless it is a literal the binary log decoder already knows
+ */
+static bool logCall(LogBuffer &buffer, const char *message, bool literal)
+{
+    return buffer.push(0, 20, __FILE__, __PRETTY_FUNCTION__, __LINE__, 0,
+                       [message, literal](char *record_message, size_t size)
+                       {
+                           size_t length = 0;
+                           if (literal)
+                           {
+                               return length;
+                           }
+                           while (length < size - 1 && message[length] != '\0')
+                           {
+                               record_message[length] = message[length];
+                               length++;
+                           }
+                           return length;
+                       });
+}
+
+/**
+ * Keeps the compiler from dropping the consumed record
+ */
+static void consume(const LogRecord &record)
+{
+    asm volatile("" : : "r"(&record) : "memory");
+}
+
+static double nowNs()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @return The time of a log call and of taking its record back out on the same thread, in ns
+ */
+static double runCalls(bool literal)
+{
+    static LogBuffer buffer;
+    const double start = nowNs();
+    for (uint32_t i = 0; i < BENCHMARK_CALLS; i++)
+    {
+        logCall(buffer, MESSAGE, literal);
+        buffer.pop(consume);
+    }
+    return (nowNs() - start) / BENCHMARK_CALLS;
+}
+
+/**
+ * Producers log as fast as they can while one consumer drains the buffer
+ * @param records_per_s Set to the records that made it through the buffer per second
+ * @return The share of log calls that were dropped
+ */
+static double runProducers(double &records_per_s)
+{
+    static LogBuffer buffer;
+    std::atomic<bool> producing{true};
+    uint32_t popped = 0;
+    std::thread consumer([&]()
+                         {
+                             while (producing.load())
+                             {
+                                 if (buffer.pop(consume))
+                                 {
+                                     popped++;
+                                 }
+                                 else
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                             while (buffer.pop(consume))
+                             {
+                                 popped++;
+                             }
+                         });
+
+    const double start = nowNs();
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < BENCHMARK_PRODUCERS; producer++)
+    {
+        producers.emplace_back([]()
+                               {
+                                   for (uint32_t i = 0; i < BENCHMARK_PRODUCER_CALLS; i++)
+                                   {
+                                       logCall(buffer, MESSAGE, false);
+                                       if (i % 16 == 0)
+                                       {
+                                           std::this_thread::yield();
+                                       }
+                                   }
+                               });
+    }
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    producing.store(false);
+    consumer.join();
+    const double elapsed_s = (nowNs() - start) / 1e9;
+
+    records_per_s = popped / elapsed_s;
+    return (double) buffer.getDropped() / (BENCHMARK_PRODUCERS * BENCHMARK_PRODUCER_CALLS);
+}
+
+/**
+ * Prints the cost of a log call with a copied and a literal message, and the throughput and drop rate with several
+ * producers against one consumer, as JSON
+ */
+int main()
+{
+    runCalls(false);
+    const double copy_ns = runCalls(false);
+    const double literal_ns = runCalls(true);
+    double records_per_s;
+    const double drop_rate = runProducers(records_per_s);
+
+    printf("{\"calls\": %d, \"copy_ns\": %.1f, \"literal_ns\": %.1f, \"producers\": %d, \"records_per_s\": %.0f, "
+           "\"drop_rate\": %.4f}\n",
+           BENCHMARK_CALLS, copy_ns, literal_ns, BENCHMARK_PRODUCERS, records_per_s, drop_rate);
+    return 0;
+}
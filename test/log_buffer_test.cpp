@@ -0,0 +1,192 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "log_buffer.hpp"
+#include "test.hpp"
+
+#define STRESS_PRODUCERS 4
+#define STRESS_RECORDS 100000
+
+/**
+ * Push a message the way log does, copying it up to the terminator
+ */
+static bool pushMessage(LogBuffer &buffer, const char *message, uint32_t line = 0)
+{
+    return buffer.push(0, 20, "file", "function", line, 0,
+                       [message](char *record_message, size_t size)
+                       {
+                           size_t length = 0;
+                           while (length < size - 1 && message[length] != '\0')
+                           {
+                               record_message[length] = message[length];
+                               length++;
+                           }
+                           return length;
+                       });
+}
+
+static void testEmptyBufferHasNothing()
+{
+    LogBuffer buffer;
+    CHECK(!buffer.pop([](const LogRecord &)
+                      {
+                      }));
+    CHECK(buffer.getDropped() == 0);
+}
+
+static void testRecordsComeOutInOrder()
+{
+    LogBuffer buffer;
+    CHECK(pushMessage(buffer, "first", 1));
+    CHECK(pushMessage(buffer, "second", 2));
+
+    uint32_t lines[2] = {};
+    char messages[2][LOG_RECORD_MESSAGE_SIZE] = {};
+    for (size_t i = 0; i < 2; i++)
+    {
+        CHECK(buffer.pop([&, i](const LogRecord &record)
+                         {
+                             lines[i] = record.line;
+                             memcpy(messages[i], record.message, record.messageLength);
+                         }));
+    }
+    CHECK(lines[0] == 1 && lines[1] == 2);
+    CHECK(strcmp(messages[0], "first") == 0);
+    CHECK(strcmp(messages[1], "second") == 0);
+}
+
+static void testFullBufferDropsAndCounts()
+{
+    LogBuffer buffer;
+    for (uint32_t i = 0; i < LOG_BUFFER_RECORDS; i++)
+    {
+        CHECK(pushMessage(buffer, "fits", i));
+    }
+    CHECK(!pushMessage(buffer, "dropped"));
+    CHECK(!pushMessage(buffer, "dropped"));
+    CHECK(buffer.getDropped() == 2);
+
+    // The oldest records are kept, and a popped slot is free again
+    uint32_t line = LOG_BUFFER_RECORDS;
+    CHECK(buffer.pop([&line](const LogRecord &record)
+                     {
+                         line = record.line;
+                     }));
+    CHECK(line == 0);
+    CHECK(pushMessage(buffer, "fits again"));
+    CHECK(buffer.getDropped() == 2);
+}
+
+static void testLongMessageIsCut()
+{
+    LogBuffer buffer;
+    char message[LOG_RECORD_MESSAGE_SIZE * 2];
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+    CHECK(pushMessage(buffer, message));
+    size_t length = 0;
+    buffer.pop([&length](const LogRecord &record)
+               {
+                   length = record.messageLength;
+               });
+    CHECK(length == LOG_RECORD_MESSAGE_SIZE - 1);
+}
+
+/**
+ * Producers push numbered records while one consumer drains them. Every record is either popped once, in order for
+ * its producer and with its own message, or counted as dropped
+ */
+static void testConcurrentProducers()
+{
+    static LogBuffer buffer;
+    std::atomic<uint32_t> pushed{0};
+    std::atomic<bool> producing{true};
+
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < STRESS_PRODUCERS; producer++)
+    {
+        producers.emplace_back([&, producer]()
+                               {
+                                   char message[32];
+                                   for (uint32_t i = 0; i < STRESS_RECORDS; i++)
+                                   {
+                                       snprintf(message, sizeof(message), "%u:%u", producer, i);
+                                       pushed.fetch_add(pushMessage(buffer, message, producer * STRESS_RECORDS + i),
+                                                        std::memory_order_relaxed);
+                                       // Let the consumer in, so records both get through and get dropped
+                                       if (i % 16 == 0)
+                                       {
+                                           std::this_thread::yield();
+                                       }
+                                   }
+                               });
+    }
+
+    uint32_t popped = 0;
+    uint32_t out_of_order = 0;
+    uint32_t corrupted = 0;
+    int64_t last[STRESS_PRODUCERS];
+    for (int64_t &value : last)
+    {
+        value = -1;
+    }
+    const auto consume = [&](const LogRecord &record)
+    {
+        const uint32_t producer = record.line / STRESS_RECORDS;
+        const uint32_t index = record.line % STRESS_RECORDS;
+        char expected[32];
+        const int length = snprintf(expected, sizeof(expected), "%u:%u", producer, index);
+        if (producer >= STRESS_PRODUCERS || record.messageLength != (size_t) length ||
+            memcmp(record.message, expected, length) != 0)
+        {
+            corrupted++;
+            return;
+        }
+        if ((int64_t) index <= last[producer])
+        {
+            out_of_order++;
+        }
+        last[producer] = index;
+        popped++;
+    };
+
+    std::thread consumer([&]()
+                         {
+                             while (producing.load())
+                             {
+                                 if (!buffer.pop(consume))
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                             while (buffer.pop(consume))
+                             {
+                             }
+                         });
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    producing.store(false);
+    consumer.join();
+
+    printf("%u of %u records pushed, %u dropped\n", pushed.load(), STRESS_PRODUCERS * STRESS_RECORDS,
+           buffer.getDropped());
+    CHECK(corrupted == 0);
+    CHECK(out_of_order == 0);
+    CHECK(popped == pushed.load());
+    CHECK(pushed.load() + buffer.getDropped() == STRESS_PRODUCERS * STRESS_RECORDS);
+}
+
+int main()
+{
+    runTest("empty buffer has nothing", testEmptyBufferHasNothing);
+    runTest("records come out in order", testRecordsComeOutInOrder);
+    runTest("full buffer drops and counts", testFullBufferDropsAndCounts);
+    runTest("long message is cut", testLongMessageIsCut);
+    runTest("concurrent producers", testConcurrentProducers);
+    return testResult();
+}
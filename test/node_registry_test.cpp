@@ -0,0 +1,106 @@
+#include <cstring>
+
+#include "node_registry.hpp"
+#include "test.hpp"
+
+/**
+ * The order nodes were set up and cleaned up in, as their ids
+ */
+static char events[16];
+static size_t eventCount = 0;
+
+static void record(char event)
+{
+    if (eventCount < sizeof(events) - 1)
+    {
+        events[eventCount++] = event;
+        events[eventCount] = '\0';
+    }
+}
+
+/**
+ * A node that adds handles to its executor like a real one would
+ * @tparam Id Recorded on setup, and in lower case on cleanup
+ * @tparam Handles The number of handles setup really adds
+ */
+template<char Id, ExecutorGroup Group, size_t Handles>
+class FakeNode
+{
+public:
+    static constexpr NodeResources RESOURCES = {1, 1, 0, Handles, 0};
+    static constexpr ExecutorGroup EXECUTOR = Group;
+
+    explicit FakeNode(int value) : value(value)
+    {
+    }
+
+    void setup(__attribute__((unused)) rclc_support_t *support, rclc_executor_t *executor)
+    {
+        record(Id);
+        executor->index += addedHandles;
+    }
+
+    void cleanup()
+    {
+        record((char) (Id - 'A' + 'a'));
+    }
+
+    int value;
+    size_t addedHandles = Handles;
+};
+
+using Laser = FakeNode<'L', EXECUTOR_CONTROL, 5>;
+using Servo = FakeNode<'S', EXECUTOR_CONTROL, 2>;
+using Thermal = FakeNode<'T', EXECUTOR_TELEMETRY, 3>;
+using Registry = NodeRegistry<Laser, Thermal, Servo>;
+
+static_assert(Registry::RESOURCES == NodeResources{3, 3, 0, 10, 0});
+static_assert(Registry::executorHandles(EXECUTOR_CONTROL) == 7);
+static_assert(Registry::executorHandles(EXECUTOR_TELEMETRY) == 3);
+static_assert(NodeRegistry<Thermal>::executorHandles(EXECUTOR_CONTROL) == 0);
+
+static void testNodesGetTheirExecutor()
+{
+    static Registry registry;
+    registry.emplace<Laser>(1);
+    registry.emplace<Thermal>(2);
+    registry.emplace<Servo>(3);
+    CHECK(registry.get<Laser>().value == 1);
+    CHECK(registry.get<Thermal>().value == 2);
+    CHECK(registry.get<Servo>().value == 3);
+
+    rclc_support_t support = {};
+    rclc_executor_t executors[EXECUTOR_GROUPS] = {};
+    eventCount = 0;
+    CHECK(registry.setup(&support, executors));
+    CHECK(executors[EXECUTOR_CONTROL].index == Registry::executorHandles(EXECUTOR_CONTROL));
+    CHECK(executors[EXECUTOR_TELEMETRY].index == Registry::executorHandles(EXECUTOR_TELEMETRY));
+
+    registry.cleanup();
+    CHECK(strcmp(events, "LTSstl") == 0);
+}
+
+static void testMismatchedHandlesAreCaught()
+{
+    static Registry registry;
+    registry.emplace<Laser>(1);
+    registry.emplace<Thermal>(2);
+    registry.emplace<Servo>(3);
+    // The servo node adds a handle it didn't declare
+    registry.get<Servo>().addedHandles = 3;
+
+    rclc_support_t support = {};
+    rclc_executor_t executors[EXECUTOR_GROUPS] = {};
+    eventCount = 0;
+    CHECK(!registry.setup(&support, executors));
+    // Every node still got set up, in order
+    CHECK(strcmp(events, "LTS") == 0);
+    CHECK(executors[EXECUTOR_CONTROL].index == Registry::executorHandles(EXECUTOR_CONTROL) + 1);
+}
+
+int main()
+{
+    runTest("nodes get their executor", testNodesGetTheirExecutor);
+    runTest("mismatched handles are caught", testMismatchedHandlesAreCaught);
+    return testResult();
+}
@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "node_resources.hpp"
+#include "test.hpp"
+
+/**
+ * The largest app-colcon.meta can be
+ */
+#define META_SIZE 4096
+
+static char meta[META_SIZE];
+
+/**
+ * Read app-colcon.meta, whose path the build passes in APP_COLCON_META
+ * @return Whether it could be read
+ */
+static bool readMeta()
+{
+    FILE *file = fopen(APP_COLCON_META, "r");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    const size_t length = fread(meta, 1, sizeof(meta) - 1, file);
+    fclose(file);
+    meta[length] = '\0';
+    return length > 0 && length < sizeof(meta) - 1;
+}
+
+/**
+ * @param name The cmake argument, like RMW_UXRCE_MAX_NODES
+ * @return The value app-colcon.meta sets it to, or -1 if it doesn't
+ */
+static long metaLimit(const char *name)
+{
+    char argument[64];
+    snprintf(argument, sizeof(argument), "-D%s=", name);
+    const char *found = strstr(meta, argument);
+    if (found == nullptr)
+    {
+        return -1;
+    }
+    return strtol(found + strlen(argument), nullptr, 10);
+}
+
+/**
+ * @return Whether the meta sets the limit, and count fits in it
+ */
+static bool fitsLimit(const char *name, size_t count)
+{
+    const long limit = metaLimit(name);
+    if (limit < 0 || (size_t) limit < count)
+    {
+        fprintf(stderr, "%s is %ld, the firmware needs %zu\n", name, limit, count);
+        return false;
+    }
+    return true;
+}
+
+static void testMetaParses()
+{
+    CHECK(readMeta());
+    CHECK(metaLimit("RMW_UXRCE_MAX_CLIENTS") == 0);
+    CHECK(metaLimit("RMW_UXRCE_NOT_AN_OPTION") == -1);
+}
+
+static void testResourcesFitMeta()
+{
+    CHECK(readMeta());
+    CHECK(fitsLimit("RMW_UXRCE_MAX_NODES", PCC_RESOURCES.nodes));
+    CHECK(fitsLimit("RMW_UXRCE_MAX_PUBLISHERS", PCC_RESOURCES.publishers));
+    CHECK(fitsLimit("RMW_UXRCE_MAX_SUBSCRIPTIONS", PCC_RESOURCES.subscriptions));
+    CHECK(fitsLimit("RMW_UXRCE_MAX_SERVICES", PCC_RESOURCES.services));
+}
+
+static void testResourcesAddUp()
+{
+    constexpr NodeResources a = {1, 2, 3, 4, 5};
+    constexpr NodeResources b = {5, 4, 3, 2, 1};
+    static_assert(a + b == NodeResources{6, 6, 6, 6, 6});
+    static_assert(a.executorHandles() == 12);
+    static_assert(!(a == b));
+
+    // Diagnostics and the recorder live on the system node, they don't add nodes of their own
+    CHECK(DIAGNOSTICS_RESOURCES.nodes == 0 && RECORDER_RESOURCES.nodes == 0);
+}
+
+int main()
+{
+    runTest("meta parses", testMetaParses);
+    runTest("resources fit meta", testResourcesFitMeta);
+    runTest("resources add up", testResourcesAddUp);
+    return testResult();
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "pool_allocator.hpp"
+
+#define BENCHMARK_ROUNDS 2000
+/**
+ * Blocks allocated per round and per thread, few enough that every thread stays within the pools
+ */
+#define BENCHMARK_BLOCKS 24
+#define BENCHMARK_THREADS 4
+
+/**
+ * The sizes of one round, mostly small like micro-ROS's entities and strings, and the order they are freed in
+ */
+struct Workload
+{
+    size_t sizes[BENCHMARK_BLOCKS];
+    size_t freeOrder[BENCHMARK_BLOCKS];
+};
+
+static Workload makeWorkload(uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<size_t> small(1, 128);
+    std::uniform_int_distribution<size_t> large(129, 1024);
+    Workload workload = {};
+    for (size_t i = 0; i < BENCHMARK_BLOCKS; i++)
+    {
+        workload.sizes[i] = i % 6 == 0 ? large(generator) : small(generator);
+        workload.freeOrder[i] = i;
+    }
+    std::shuffle(workload.freeOrder, workload.freeOrder + BENCHMARK_BLOCKS, generator);
+    return workload;
+}
+
+/**
+ * @return The time per allocation and free, in ns
+ */
+static double runRounds(const rcl_allocator_t &allocator, const Workload &workload)
+{
+    void *blocks[BENCHMARK_BLOCKS];
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < BENCHMARK_ROUNDS; round++)
+    {
+        for (size_t i = 0; i < BENCHMARK_BLOCKS; i++)
+        {
+            blocks[i] = allocator.allocate(workload.sizes[i], allocator.state);
+            // Touch the block, like the caller would
+            *(volatile uint8_t *) blocks[i] = 0;
+        }
+        for (size_t i : workload.freeOrder)
+        {
+            allocator.deallocate(blocks[i], allocator.state);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+           (BENCHMARK_ROUNDS * BENCHMARK_BLOCKS);
+}
+
+/**
+ * @return The time per allocation and free with every thread running the rounds at once, in ns
+ */
+static double runThreads(const rcl_allocator_t &allocator)
+{
+    double times[BENCHMARK_THREADS];
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < BENCHMARK_THREADS; thread++)
+    {
+        threads.emplace_back([&allocator, &times, thread]()
+                             {
+                                 times[thread] = runRounds(allocator, makeWorkload(thread + 1));
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    double total = 0;
+    for (double time : times)
+    {
+        total += time;
+    }
+    return total / BENCHMARK_THREADS;
+}
+
+/**
+ * Prints the time per allocation and free of the pool allocator and of malloc, on one thread and on several at once,
+ * as JSON
+ */
+int main()
+{
+    initPoolAllocator();
+    const rcl_allocator_t pool = getPoolAllocator();
+    const rcl_allocator_t heap = rcl_get_default_allocator();
+    const Workload workload = makeWorkload(0);
+
+    // Warm both up, so malloc has its arenas and the pool free lists are in the cache
+    runRounds(pool, workload);
+    runRounds(heap, workload);
+
+    const double pool_ns = runRounds(pool, workload);
+    const double malloc_ns = runRounds(heap, workload);
+    const double pool_threads_ns = runThreads(pool);
+    const double malloc_threads_ns = runThreads(heap);
+
+    uint32_t exhausted = 0;
+    for (size_t i = 0; i < POOL_ALLOCATOR_POOLS; i++)
+    {
+        exhausted += getPoolAllocatorStats(i).exhausted;
+    }
+    printf("{\"blocks_per_round\": %d, \"threads\": %d, \"pool_ns\": %.1f, \"malloc_ns\": %.1f, "
+           "\"pool_threads_ns\": %.1f, \"malloc_threads_ns\": %.1f, \"pool_exhausted\": %u, "
+           "\"pool_heap_allocations\": %u}\n",
+           BENCHMARK_BLOCKS, BENCHMARK_THREADS, pool_ns, malloc_ns, pool_threads_ns, malloc_threads_ns, exhausted,
+           getPoolAllocatorHeapAllocations());
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "pool_allocator.hpp"
+#include "test.hpp"
+
+#define LARGEST_BLOCK 4096
+#define THREADS 4
+#define THREAD_OPERATIONS 200000
+/**
+ * Each thread keeps up to this many blocks at once, so the small classes can run out and fall through
+ */
+#define THREAD_LIVE_BLOCKS 96
+
+static rcl_allocator_t allocator;
+
+static void *allocate(size_t size)
+{
+    return allocator.allocate(size, allocator.state);
+}
+
+static void deallocate(void *pointer)
+{
+    allocator.deallocate(pointer, allocator.state);
+}
+
+static void *reallocate(void *pointer, size_t size)
+{
+    return allocator.reallocate(pointer, size, allocator.state);
+}
+
+static void *zeroAllocate(size_t count, size_t size)
+{
+    return allocator.zero_allocate(count, size, allocator.state);
+}
+
+/**
+ * Allocate a block, only in single threaded tests
+ * @return The size class the block is in, going by which class's use went up, or POOL_ALLOCATOR_POOLS if it is from
+ * the heap
+ */
+static size_t poolOf(size_t size, void **block)
+{
+    uint32_t used[POOL_ALLOCATOR_POOLS];
+    for (size_t i = 0; i < POOL_ALLOCATOR_POOLS; i++)
+    {
+        used[i] = getPoolAllocatorStats(i).used;
+    }
+    *block = allocate(size);
+    for (size_t i = 0; i < POOL_ALLOCATOR_POOLS; i++)
+    {
+        if (getPoolAllocatorStats(i).used != used[i])
+        {
+            return i;
+        }
+    }
+    return POOL_ALLOCATOR_POOLS;
+}
+
+static bool allPoolsFree()
+{
+    for (size_t i = 0; i < POOL_ALLOCATOR_POOLS; i++)
+    {
+        if (getPoolAllocatorStats(i).used != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testSizeClasses()
+{
+    const size_t sizes[] = {1, 16, 17, 32, 33, 64, 65, 128, 256, 257, 512, 1024, 1025, LARGEST_BLOCK};
+    const size_t pools[] = {0, 0, 1, 1, 2, 2, 3, 3, 4, 5, 5, 6, 7, 7};
+    void *blocks[sizeof(sizes) / sizeof(size_t)];
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); i++)
+    {
+        CHECK(poolOf(sizes[i], &blocks[i]) == pools[i]);
+        CHECK(blocks[i] != nullptr);
+        CHECK((uintptr_t) blocks[i] % alignof(max_align_t) == 0);
+        // The whole request is usable
+        memset(blocks[i], 0xa5, sizes[i]);
+    }
+    for (void *block : blocks)
+    {
+        deallocate(block);
+    }
+    CHECK(allPoolsFree());
+}
+
+static void testLargeRequestGoesToTheHeap()
+{
+    const uint32_t heap_allocations = getPoolAllocatorHeapAllocations();
+    const uint32_t heap_blocks = getPoolAllocatorHeapBlocks();
+    void *block;
+    CHECK(poolOf(LARGEST_BLOCK + 1, &block) == POOL_ALLOCATOR_POOLS);
+    CHECK(getPoolAllocatorHeapAllocations() == heap_allocations + 1);
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks + 1);
+    deallocate(block);
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks);
+    CHECK(getPoolAllocatorHeapAllocations() == heap_allocations + 1);
+}
+
+static void testFullClassFallsThrough()
+{
+    const PoolAllocatorStats smallest = getPoolAllocatorStats(0);
+    std::vector<void *> blocks;
+    for (uint32_t i = 0; i < smallest.blocks; i++)
+    {
+        blocks.push_back(allocate(1));
+    }
+    CHECK(getPoolAllocatorStats(0).used == smallest.blocks);
+
+    void *block;
+    CHECK(poolOf(1, &block) == 1);
+    CHECK(getPoolAllocatorStats(0).exhausted == smallest.exhausted + 1);
+    CHECK(getPoolAllocatorStats(0).peak == smallest.blocks);
+    deallocate(block);
+
+    // A freed block is handed out again first
+    deallocate(blocks.back());
+    CHECK(poolOf(1, &block) == 0);
+    CHECK(block == blocks.back());
+    blocks.back() = block;
+
+    for (void *pointer : blocks)
+    {
+        deallocate(pointer);
+    }
+    CHECK(allPoolsFree());
+    CHECK(getPoolAllocatorStats(0).peak == smallest.blocks);
+}
+
+static void testEveryFullClassFallsThroughToTheHeap()
+{
+    const uint32_t heap_allocations = getPoolAllocatorHeapAllocations();
+    const PoolAllocatorStats largest = getPoolAllocatorStats(POOL_ALLOCATOR_POOLS - 1);
+    std::vector<void *> blocks;
+    for (uint32_t i = 0; i < largest.blocks; i++)
+    {
+        blocks.push_back(allocate(LARGEST_BLOCK));
+    }
+    void *block;
+    CHECK(poolOf(LARGEST_BLOCK, &block) == POOL_ALLOCATOR_POOLS);
+    CHECK(getPoolAllocatorHeapAllocations() == heap_allocations + 1);
+    CHECK(getPoolAllocatorStats(POOL_ALLOCATOR_POOLS - 1).exhausted == largest.exhausted + 1);
+    blocks.push_back(block);
+
+    for (void *pointer : blocks)
+    {
+        deallocate(pointer);
+    }
+    CHECK(allPoolsFree());
+}
+
+static void testDeallocateNull()
+{
+    const uint32_t heap_blocks = getPoolAllocatorHeapBlocks();
+    deallocate(nullptr);
+    CHECK(allPoolsFree());
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks);
+}
+
+static void testReallocate()
+{
+    // Like allocate for a nullptr
+    auto block = (uint8_t *) reallocate(nullptr, 10);
+    CHECK(getPoolAllocatorStats(0).used == 1);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        block[i] = i;
+    }
+
+    // Anything that still fits the block keeps it
+    CHECK(reallocate(block, 16) == block);
+    CHECK(reallocate(block, 4) == block);
+
+    // Growing past the block moves to a larger class and keeps the contents
+    auto grown = (uint8_t *) reallocate(block, 100);
+    CHECK(getPoolAllocatorStats(0).used == 0);
+    CHECK(getPoolAllocatorStats(3).used == 1);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        CHECK(grown[i] == i);
+    }
+    memset(grown, 0x5a, 100);
+
+    // and past the largest class to the heap
+    const uint32_t heap_blocks = getPoolAllocatorHeapBlocks();
+    auto heap = (uint8_t *) reallocate(grown, LARGEST_BLOCK * 2);
+    CHECK(getPoolAllocatorStats(3).used == 0);
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks + 1);
+    for (size_t i = 0; i < 100; i++)
+    {
+        CHECK(heap[i] == 0x5a);
+    }
+
+    // A heap block stays on the heap, even when it shrinks to a size a class would take
+    heap = (uint8_t *) reallocate(heap, LARGEST_BLOCK * 4);
+    heap = (uint8_t *) reallocate(heap, 8);
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks + 1);
+    CHECK(heap[0] == 0x5a);
+    CHECK(allPoolsFree());
+
+    deallocate(heap);
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks);
+}
+
+static void testZeroAllocate()
+{
+    // Dirty a block, then get it back zeroed
+    void *dirty = allocate(64);
+    memset(dirty, 0xff, 64);
+    deallocate(dirty);
+    auto block = (uint8_t *) zeroAllocate(8, 8);
+    CHECK(block == dirty);
+    for (size_t i = 0; i < 64; i++)
+    {
+        CHECK(block[i] == 0);
+    }
+    deallocate(block);
+
+    block = (uint8_t *) zeroAllocate(3, 1000);
+    CHECK(getPoolAllocatorStats(7).used == 1);
+    deallocate(block);
+    CHECK(allPoolsFree());
+}
+
+static void testZeroAllocateOverflow()
+{
+    // count * size wraps around to a small number, so it must not be allocated
+    const uint32_t heap_allocations = getPoolAllocatorHeapAllocations();
+    CHECK(zeroAllocate(SIZE_MAX / 8 + 2, 8) == nullptr);
+    CHECK(zeroAllocate(SIZE_MAX, SIZE_MAX) == nullptr);
+    CHECK(zeroAllocate((size_t) 1 << (sizeof(size_t) * 4), (size_t) 1 << (sizeof(size_t) * 4)) == nullptr);
+    CHECK(allPoolsFree());
+    CHECK(getPoolAllocatorHeapAllocations() == heap_allocations);
+
+    void *block = zeroAllocate(0, SIZE_MAX);
+    deallocate(block);
+    CHECK(allPoolsFree());
+}
+
+/**
+ * Each thread allocates and frees blocks of random sizes, and fills every block with a pattern of its own that it
+ * checks before freeing it, so a block handed to two threads at once or corrupted by a free list shows up
+ */
+static void testConcurrentThreads()
+{
+    const uint32_t heap_blocks = getPoolAllocatorHeapBlocks();
+    std::atomic<uint32_t> corrupted{0};
+    std::atomic<uint32_t> failed{0};
+
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < THREADS; thread++)
+    {
+        threads.emplace_back([&, thread]()
+                             {
+                                 std::mt19937 generator(thread);
+                                 std::uniform_int_distribution<size_t> size_distribution(1, LARGEST_BLOCK + 512);
+                                 std::uniform_int_distribution<size_t> operation_distribution(0, 3);
+                                 struct Live
+                                 {
+                                     uint8_t *block;
+                                     size_t size;
+                                     uint8_t pattern;
+                                 };
+                                 std::vector<Live> live;
+                                 uint8_t pattern = thread << 6;
+
+                                 const auto check_and_free = [&](const Live &entry)
+                                 {
+                                     for (size_t i = 0; i < entry.size; i++)
+                                     {
+                                         if (entry.block[i] != entry.pattern)
+                                         {
+                                             corrupted.fetch_add(1);
+                                             break;
+                                         }
+                                     }
+                                     deallocate(entry.block);
+                                 };
+
+                                 for (uint32_t operation = 0; operation < THREAD_OPERATIONS; operation++)
+                                 {
+                                     const size_t choice = operation_distribution(generator);
+                                     if (!live.empty() && (live.size() >= THREAD_LIVE_BLOCKS || choice == 0))
+                                     {
+                                         const size_t index = generator() % live.size();
+                                         check_and_free(live[index]);
+                                         live[index] = live.back();
+                                         live.pop_back();
+                                         continue;
+                                     }
+
+                                     // Mostly small requests, like micro-ROS makes
+                                     size_t size = size_distribution(generator);
+                                     size = choice == 1 ? size : size / 64 + 1;
+                                     uint8_t *block;
+                                     if (choice == 2 && !live.empty())
+                                     {
+                                         Live &entry = live.back();
+                                         block = (uint8_t *) reallocate(entry.block, size);
+                                         if (block == nullptr)
+                                         {
+                                             failed.fetch_add(1);
+                                             continue;
+                                         }
+                                         // The old contents up to the smaller size survive
+                                         const size_t kept = size < entry.size ? size : entry.size;
+                                         for (size_t i = 0; i < kept; i++)
+                                         {
+                                             if (block[i] != entry.pattern)
+                                             {
+                                                 corrupted.fetch_add(1);
+                                                 break;
+                                             }
+                                         }
+                                         live.pop_back();
+                                     }
+                                     else
+                                     {
+                                         block = (uint8_t *) allocate(size);
+                                         if (block == nullptr)
+                                         {
+                                             failed.fetch_add(1);
+                                             continue;
+                                         }
+                                     }
+                                     pattern++;
+                                     memset(block, pattern, size);
+                                     live.push_back({block, size, pattern});
+                                 }
+                                 for (const Live &entry : live)
+                                 {
+                                     check_and_free(entry);
+                                 }
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(corrupted.load() == 0);
+    CHECK(failed.load() == 0);
+    CHECK(allPoolsFree());
+    CHECK(getPoolAllocatorHeapBlocks() == heap_blocks);
+}
+
+int main()
+{
+    initPoolAllocator();
+    allocator = getPoolAllocator();
+
+    runTest("size classes", testSizeClasses);
+    runTest("large request goes to the heap", testLargeRequestGoesToTheHeap);
+    runTest("full class falls through", testFullClassFallsThrough);
+    runTest("every full class falls through to the heap", testEveryFullClassFallsThroughToTheHeap);
+    runTest("deallocate nullptr", testDeallocateNull);
+    runTest("reallocate", testReallocate);
+    runTest("zero allocate", testZeroAllocate);
+    runTest("zero allocate overflow", testZeroAllocateOverflow);
+    runTest("concurrent threads", testConcurrentThreads);
+    return testResult();
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "log_buffer.hpp"
+#include "rate_limiter.hpp"
+#include "test.hpp"
+
+#define INTERVAL 50000
+#define BURST 20
+#define FLOOD_THREADS 4
+#define FLOOD_LINES 20000
+/**
+ * A line through the limiter and into the log buffer never takes longer than this (us), even while flooded. Far above
+ * what it should take, so a loaded machine doesn't fail it, but a lock or an allocation that blocks would
+ */
+#define FLOOD_MAX_LATENCY 20000
+
+/**
+ * Heap allocations made while countAllocations is set
+ */
+static std::atomic<bool> countAllocations{false};
+static std::atomic<uint32_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    if (countAllocations.load(std::memory_order_relaxed))
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, __attribute__((unused)) size_t size) noexcept
+{
+    free(memory);
+}
+
+/**
+ * @return How many of count events at now the limiter allows
+ */
+static uint32_t takeMany(RateLimiter &limiter, int64_t now, uint32_t count)
+{
+    uint32_t taken = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (limiter.take(now))
+        {
+            taken++;
+        }
+    }
+    return taken;
+}
+
+/**
+ * Push a line the way vprintfLog does
+ */
+static bool pushLine(LogBuffer &buffer, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const bool pushed = buffer.pushFormatted(0, 10, "SYS", "SYS", 0, 0, format, args);
+    va_end(args);
+    return pushed;
+}
+
+static void testBurst()
+{
+    RateLimiter limiter(INTERVAL, BURST);
+    const int64_t now = 1000000;
+    CHECK(takeMany(limiter, now, 100) == BURST);
+    CHECK(limiter.getLimited() == 100 - BURST);
+}
+
+static void testSustainedRate()
+{
+    RateLimiter limiter(INTERVAL, BURST);
+    // One event every interval is always allowed
+    int64_t now = 0;
+    for (uint32_t i = 0; i < 1000; i++, now += INTERVAL)
+    {
+        CHECK(limiter.take(now));
+    }
+    CHECK(limiter.getLimited() == 0);
+
+    // Ten times too fast, only one per interval gets through once the burst is used up
+    RateLimiter flooded(INTERVAL, BURST);
+    uint32_t taken = 0;
+    for (now = 0; now < 100 * INTERVAL; now += INTERVAL / 10)
+    {
+        if (flooded.take(now))
+        {
+            taken++;
+        }
+    }
+    CHECK(taken >= 100 + BURST - 1 && taken <= 100 + BURST);
+}
+
+static void testRecoversAfterIdle()
+{
+    RateLimiter limiter(INTERVAL, BURST);
+    CHECK(takeMany(limiter, 0, BURST + 5) == BURST);
+    CHECK(!limiter.take(INTERVAL / 2));
+    // Each interval frees one event
+    CHECK(takeMany(limiter, INTERVAL, 5) == 1);
+    CHECK(takeMany(limiter, 3 * INTERVAL, 5) == 2);
+    // A whole burst once it's been quiet for long enough
+    CHECK(takeMany(limiter, 100 * INTERVAL, 100) == BURST);
+}
+
+static void testIdleDoesntBank()
+{
+    RateLimiter limiter(INTERVAL, BURST);
+    // An hour of silence still only allows one burst
+    CHECK(takeMany(limiter, 3600000000LL, 100) == BURST);
+}
+
+static void testConcurrentTakes()
+{
+    RateLimiter limiter(INTERVAL, BURST);
+    std::atomic<uint32_t> taken{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < FLOOD_THREADS; i++)
+    {
+        threads.emplace_back([&limiter, &taken]()
+                             {
+                                 taken += takeMany(limiter, 1000000, 1000);
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(taken == BURST);
+    CHECK(limiter.getLimited() == FLOOD_THREADS * 1000 - BURST);
+}
+
+static void testFormattedLines()
+{
+    LogBuffer buffer;
+    CHECK(pushLine(buffer, "I (%d) wifi: %s\n\n", 1234, "connected"));
+    char long_line[LOG_RECORD_MESSAGE_SIZE * 2];
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+    CHECK(pushLine(buffer, "%s\n", long_line));
+
+    CHECK(buffer.pop([](const LogRecord &record)
+                     {
+                         CHECK(record.messageLength == strlen("I (1234) wifi: connected"));
+                         CHECK(strncmp(record.message, "I (1234) wifi: connected", record.messageLength) == 0);
+                     }));
+    CHECK(buffer.pop([](const LogRecord &record)
+                     {
+                         CHECK(record.messageLength == LOG_RECORD_MESSAGE_SIZE - 1);
+                         CHECK(record.message[record.messageLength - 1] == 'x');
+                     }));
+}
+
+/**
+ * Tasks flood esp log lines through the limiter into the log buffer while the drain task empties it. Nothing is
+ * allocated, every line returns quickly, and the lines that get through are bounded by the rate
+ */
+static void testFlood()
+{
+    static LogBuffer buffer;
+    static RateLimiter limiter(INTERVAL, BURST);
+    std::atomic<bool> draining{true};
+    std::atomic<uint32_t> drained{0};
+    std::atomic<uint32_t> pushed{0};
+    std::atomic<int64_t> max_latency{0};
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread drain([&draining, &drained]()
+                      {
+                          while (draining.load())
+                          {
+                              while (buffer.pop([](const LogRecord &)
+                                                {
+                                                }))
+                              {
+                                  drained++;
+                              }
+                              std::this_thread::yield();
+                          }
+                      });
+    // Starting the threads allocates, so only count once they are all waiting to go
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < FLOOD_THREADS; thread++)
+    {
+        threads.emplace_back([&, thread]()
+                             {
+                                 while (!go.load())
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                                 for (int line = 0; line < FLOOD_LINES; line++)
+                                 {
+                                     const auto line_start = std::chrono::steady_clock::now();
+                                     const int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                                             line_start - start).count();
+                                     if (limiter.take(now) &&
+                                         pushLine(buffer, "W (%d) task %d: line %d\n", (int) now, thread, line))
+                                     {
+                                         pushed++;
+                                     }
+                                     const int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now() - line_start).count();
+                                     int64_t seen = max_latency.load();
+                                     while (latency > seen && !max_latency.compare_exchange_weak(seen, latency))
+                                     {
+                                     }
+                                 }
+                             });
+    }
+    countAllocations.store(true);
+    go.store(true);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    countAllocations.store(false);
+    draining.store(false);
+    drain.join();
+    while (buffer.pop([](const LogRecord &)
+                      {
+                      }))
+    {
+        drained++;
+    }
+
+    const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    CHECK(allocations == 0);
+    CHECK(max_latency <= FLOOD_MAX_LATENCY);
+    CHECK(pushed + limiter.getLimited() + buffer.getDropped() == FLOOD_THREADS * FLOOD_LINES);
+    CHECK(pushed <= BURST + elapsed / INTERVAL + 1);
+    CHECK(drained == pushed);
+}
+
+int main()
+{
+    runTest("burst", testBurst);
+    runTest("sustained rate", testSustainedRate);
+    runTest("recovers after idle", testRecoversAfterIdle);
+    runTest("idle doesn't bank", testIdleDoesntBank);
+    runTest("concurrent takes", testConcurrentTakes);
+    runTest("formatted lines", testFormattedLines);
+    runTest("flood", testFlood);
+    return testResult();
+}
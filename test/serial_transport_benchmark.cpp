@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <driver/uart.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "esp32_serial_transport.hpp"
+
+/**
+ * Where sim_uart links the pty that the fake agent opens
+ */
+#define AGENT_LINK "/tmp/pcc_serial_transport_benchmark"
+#define ROUND_TRIPS 200
+#define SMALL_FRAME 32
+/**
+ * An XRCE serial frame at the default MTU
+ */
+#define LARGE_FRAME 512
+/**
+ * Streamed in, which isn't paced
+ */
+#define STREAM_SIZE (256 * 1024)
+/**
+ * Streamed out at each baud rate, small enough to take a few seconds at the slowest
+ */
+#define RATE_STREAM_SIZE (32 * 1024)
+/**
+ * Enough for every rate the transport steps through
+ */
+#define MAX_RATES 8
+
+static uart_port_t port = UART_NUM_0;
+static uxrCustomTransport transport = {&port};
+
+static double nowUs()
+{
+    return (double) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int openAgent()
+{
+    const int fd = open(AGENT_LINK, O_RDWR | O_NOCTTY);
+    if (fd >= 0)
+    {
+        termios attributes = {};
+        tcgetattr(fd, &attributes);
+        cfmakeraw(&attributes);
+        tcsetattr(fd, TCSANOW, &attributes);
+    }
+    return fd;
+}
+
+/**
+ * The agent side: echo everything back until stopped
+ */
+static void echoAgent(int fd, const std::atomic<bool> &running)
+{
+    uint8_t data[LARGE_FRAME];
+    while (running.load())
+    {
+        pollfd poll_fd = {fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, 10) > 0 && (poll_fd.revents & POLLIN) != 0)
+        {
+            const ssize_t length = read(fd, data, sizeof(data));
+            if (length > 0 && write(fd, data, length) != length)
+            {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Read from the transport like the XRCE session does, until length bytes came
+ */
+static void transportRead(uint8_t *data, size_t length)
+{
+    size_t received = 0;
+    while (received < length)
+    {
+        uint8_t error = 0;
+        received += esp32SerialRead(&transport, data + received, length - received, 10, &error);
+    }
+}
+
+struct Latency
+{
+    double p50;
+    double max;
+};
+
+/**
+ * Time a frame out to the echoing agent and back, in us
+ */
+static Latency roundTrips(size_t size)
+{
+    std::vector<uint8_t> frame(size, 0x55);
+    std::vector<uint8_t> received(size);
+    std::vector<double> times;
+    for (uint32_t i = 0; i < ROUND_TRIPS; i++)
+    {
+        uint8_t error = 0;
+        const double start = nowUs();
+        esp32SerialWrite(&transport, frame.data(), frame.size(), &error);
+        transportRead(received.data(), received.size());
+        times.push_back(nowUs() - start);
+    }
+    std::sort(times.begin(), times.end());
+    return {times[times.size() / 2], times.back()};
+}
+
+/**
+ * @return The bytes per second written in LARGE_FRAME frames, while the agent reads them as fast as it can
+ */
+static double streamOut(int agent)
+{
+    std::thread reader([agent]()
+                       {
+                           uint8_t data[LARGE_FRAME];
+                           size_t received = 0;
+                           while (received < RATE_STREAM_SIZE)
+                           {
+                               const ssize_t length = read(agent, data, sizeof(data));
+                               received += length > 0 ? length : 0;
+                           }
+                       });
+    static uint8_t frame[LARGE_FRAME];
+    const double start = nowUs();
+    for (size_t sent = 0; sent < RATE_STREAM_SIZE; sent += sizeof(frame))
+    {
+        uint8_t error = 0;
+        esp32SerialWrite(&transport, frame, sizeof(frame), &error);
+    }
+    reader.join();
+    return RATE_STREAM_SIZE / ((nowUs() - start) / 1000000);
+}
+
+/**
+ * @return The bytes per second read, while the agent writes LARGE_FRAME frames as fast as it can
+ */
+static double streamIn(int agent)
+{
+    std::thread writer([agent]()
+                       {
+                           static uint8_t frame[LARGE_FRAME];
+                           for (size_t sent = 0; sent < STREAM_SIZE; sent += sizeof(frame))
+                           {
+                               if (write(agent, frame, sizeof(frame)) != sizeof(frame))
+                               {
+                                   return;
+                               }
+                           }
+                       });
+    static uint8_t data[STREAM_SIZE];
+    const double start = nowUs();
+    transportRead(data, sizeof(data));
+    const double elapsed = nowUs() - start;
+    writer.join();
+    return STREAM_SIZE / (elapsed / 1000000);
+}
+
+/**
+ * Prints the round trip time of small and large frames through the transport and a fake agent on the sim_uart pty,
+ * the throughput in with large frames, and the throughput out at each rate the transport steps through, as JSON. The
+ * agent runs on the host and sim_uart only paces writes, so reads are the cost of the transport, the event queue and
+ * the pty, while frames out go at the baud rate like they would on the wire
+ */
+int main()
+{
+    setenv("PCC_SIM_SERIAL", AGENT_LINK, 1);
+    if (!esp32SerialOpen(&transport))
+    {
+        fprintf(stderr, "Can't open the transport\n");
+        return 1;
+    }
+    const int agent = openAgent();
+
+    std::atomic<bool> echoing{true};
+    std::thread echo([agent, &echoing]()
+                     {
+                         echoAgent(agent, echoing);
+                     });
+    const Latency small = roundTrips(SMALL_FRAME);
+    const Latency large = roundTrips(LARGE_FRAME);
+    echoing.store(false);
+    echo.join();
+
+    const double in = streamIn(agent);
+
+    // Step through every rate back to the configured one
+    uint32_t rates[MAX_RATES];
+    double rate_out[MAX_RATES];
+    size_t rate_count = 0;
+    const uint32_t configured = esp32SerialGetBaudRate();
+    do
+    {
+        rates[rate_count] = esp32SerialGetBaudRate();
+        rate_out[rate_count] = streamOut(agent);
+        rate_count++;
+    } while (esp32SerialStepBaudRate() != configured && rate_count < MAX_RATES);
+    Esp32SerialStats stats;
+    esp32SerialGetStats(&stats);
+
+    printf("{\"baud_rate\": %lu, \"small_frame\": %d, \"small_rtt_p50_us\": %.0f, \"small_rtt_max_us\": %.0f, "
+           "\"large_frame\": %d, \"large_rtt_p50_us\": %.0f, \"large_rtt_max_us\": %.0f, \"in_bytes_per_s\": %.0f, "
+           "\"blocked_write_ms\": %lld, \"overruns\": %lu, \"rates\": [",
+           (unsigned long) configured, SMALL_FRAME, small.p50, small.max, LARGE_FRAME, large.p50, large.max, in,
+           (long long) (stats.blockedWriteTime / 1000), (unsigned long) stats.overruns);
+    for (size_t i = 0; i < rate_count; i++)
+    {
+        printf("%s{\"baud_rate\": %lu, \"out_bytes_per_s\": %.0f}", i > 0 ? ", " : "", (unsigned long) rates[i],
+               rate_out[i]);
+    }
+    printf("]}\n");
+
+    close(agent);
+    esp32SerialClose(&transport);
+    unlink(AGENT_LINK);
+    return 0;
+}
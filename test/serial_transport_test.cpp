@@ -0,0 +1,364 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <driver/uart.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#include "esp32_serial_transport.hpp"
+#include "test.hpp"
+
+/**
+ * Where sim_uart links the pty that the fake agent opens
+ */
+#define AGENT_LINK "/tmp/pcc_serial_transport_test"
+#define LARGE_WRITE_SIZE 16384
+/**
+ * Far more than the tx buffer, so the write has to wait for most of it to go out at the baud rate
+ */
+#define PACED_WRITE_SIZE 8192
+
+static uart_port_t port = UART_NUM_0;
+static uxrCustomTransport transport = {&port};
+
+/**
+ * An XRCE serial frame with every byte a line discipline would mangle: the flag and escape bytes, newlines, and the
+ * interrupt and flow control characters
+ */
+static const uint8_t frame[] = {0x7E, 0x00, 0x01, 0x0A, 0x00, 0x0D, 0x0A, 0x7D, 0x5E, 0x03, 0x11, 0x13, 0x1A, 0x04,
+                                0x7F, 0xFF, 0x7D, 0x5D, 0x12, 0x34};
+
+static int64_t elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Open the agent's end of the link, in raw mode like the micro-ROS agent
+ */
+static int openAgent()
+{
+    const int fd = open(AGENT_LINK, O_RDWR | O_NOCTTY);
+    if (fd >= 0)
+    {
+        termios attributes = {};
+        tcgetattr(fd, &attributes);
+        cfmakeraw(&attributes);
+        tcsetattr(fd, TCSANOW, &attributes);
+    }
+    return fd;
+}
+
+/**
+ * Read from the agent's end until length bytes came or timeout ms passed
+ * @return The number of bytes read
+ */
+static size_t agentRead(int fd, uint8_t *data, size_t length, int timeout)
+{
+    const auto start = std::chrono::steady_clock::now();
+    size_t received = 0;
+    while (received < length && elapsedMs(start) < timeout)
+    {
+        pollfd poll_fd = {fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, 10) > 0 && (poll_fd.revents & POLLIN) != 0)
+        {
+            const ssize_t result = read(fd, data + received, length - received);
+            if (result > 0)
+            {
+                received += result;
+            }
+        }
+    }
+    return received;
+}
+
+static bool agentWrite(int fd, const uint8_t *data, size_t length)
+{
+    return write(fd, data, length) == (ssize_t) length;
+}
+
+/**
+ * Read from the transport like the XRCE session does, until length bytes came or timeout ms passed
+ * @return The number of bytes read
+ */
+static size_t transportRead(uint8_t *data, size_t length, int timeout)
+{
+    const auto start = std::chrono::steady_clock::now();
+    size_t received = 0;
+    while (received < length && elapsedMs(start) < timeout)
+    {
+        uint8_t error = 0;
+        received += esp32SerialRead(&transport, data + received, length - received, 10, &error);
+    }
+    return received;
+}
+
+/**
+ * A frame each way arrives byte for byte
+ */
+static bool roundTrip(int agent)
+{
+    uint8_t received[2 * sizeof(frame)] = {};
+    // Two frames back to back come out as one stream
+    bool ok = agentWrite(agent, frame, sizeof(frame)) && agentWrite(agent, frame, sizeof(frame));
+    ok = ok && transportRead(received, sizeof(received), 1000) == sizeof(received) &&
+         memcmp(received, frame, sizeof(frame)) == 0 &&
+         memcmp(received + sizeof(frame), frame, sizeof(frame)) == 0;
+
+    uint8_t error = 0;
+    memset(received, 0, sizeof(received));
+    ok = ok && esp32SerialWrite(&transport, frame, sizeof(frame), &error) == sizeof(frame);
+    ok = ok && agentRead(agent, received, sizeof(frame), 1000) == sizeof(frame) &&
+         memcmp(received, frame, sizeof(frame)) == 0;
+    return ok;
+}
+
+static void testFramesPassThrough()
+{
+    const int agent = openAgent();
+    CHECK(agent >= 0);
+    CHECK(roundTrip(agent));
+    close(agent);
+}
+
+static void testLargeWrite()
+{
+    const int agent = openAgent();
+    static uint8_t data[LARGE_WRITE_SIZE];
+    static uint8_t received[LARGE_WRITE_SIZE];
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    // More than the pty holds, so the write only finishes as the agent reads
+    size_t agent_received = 0;
+    std::thread reader([agent, &agent_received]()
+                       {
+                           agent_received = agentRead(agent, received, sizeof(received), 5000);
+                       });
+    uint8_t error = 0;
+    CHECK(esp32SerialWrite(&transport, data, sizeof(data), &error) == sizeof(data));
+    reader.join();
+    CHECK(agent_received == sizeof(data));
+    CHECK(memcmp(received, data, sizeof(data)) == 0);
+    close(agent);
+}
+
+static void testReadTimeout()
+{
+    const int agent = openAgent();
+    uint8_t data[16];
+    uint8_t error = 0;
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(esp32SerialRead(&transport, data, sizeof(data), 50, &error) == 0);
+    const int64_t elapsed = elapsedMs(start);
+    CHECK(elapsed >= 40);
+    CHECK(elapsed < 500);
+    close(agent);
+}
+
+static void testReadWakesOnData()
+{
+    const int agent = openAgent();
+    std::thread writer([agent]()
+                       {
+                           std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                           agentWrite(agent, frame, sizeof(frame));
+                       });
+    uint8_t data[sizeof(frame)];
+    uint8_t error = 0;
+    const auto start = std::chrono::steady_clock::now();
+    // The frame ends the wait, not the timeout
+    CHECK(esp32SerialRead(&transport, data, sizeof(data), 2000, &error) > 0);
+    CHECK(elapsedMs(start) < 1000);
+    writer.join();
+    transportRead(data, sizeof(data), 100);
+    close(agent);
+}
+
+static void testStats()
+{
+    const int agent = openAgent();
+    Esp32SerialStats before;
+    esp32SerialGetStats(&before);
+    CHECK(roundTrip(agent));
+    Esp32SerialStats after;
+    esp32SerialGetStats(&after);
+    CHECK(after.bytesIn - before.bytesIn == 2 * sizeof(frame));
+    CHECK(after.bytesOut - before.bytesOut == sizeof(frame));
+    CHECK(after.overruns == before.overruns);
+    close(agent);
+}
+
+static void testAgentLossAndRecovery()
+{
+    int agent = openAgent();
+    CHECK(roundTrip(agent));
+
+    // The agent goes away. Reads time out and writes fail without an error the session can't handle
+    close(agent);
+    uint8_t data[sizeof(frame)];
+    uint8_t error = 0;
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(esp32SerialRead(&transport, data, sizeof(data), 50, &error) == 0);
+    CHECK(elapsedMs(start) < 500);
+    CHECK(esp32SerialWrite(&transport, frame, sizeof(frame), &error) <= sizeof(frame));
+
+    // It comes back on the same port, without the transport being opened again
+    agent = openAgent();
+    CHECK(agent >= 0);
+    tcflush(agent, TCIOFLUSH);
+    CHECK(roundTrip(agent));
+    close(agent);
+}
+
+/**
+ * @return The rate the sim uart is at, which the fake agent has to match to hear the transport
+ */
+static uint32_t uartBaudRate()
+{
+    uint32_t baud_rate = 0;
+    uart_get_baudrate(port, &baud_rate);
+    return baud_rate;
+}
+
+/**
+ * Ping an agent listening at agent_rate until it answers, like the connection task does while waiting for it. The pty
+ * carries the bytes at any rate, so the agent drops them when the rates don't match, like it would hear noise
+ * @return The number of pings it took, or 0 if it never answered
+ */
+static size_t pingsToFind(int agent, uint32_t agent_rate)
+{
+    for (size_t ping = 1; ping <= 10; ping++)
+    {
+        uint8_t error = 0;
+        uint8_t received[sizeof(frame)];
+        esp32SerialWrite(&transport, frame, sizeof(frame), &error);
+        const bool heard = agentRead(agent, received, sizeof(received), 1000) == sizeof(frame);
+        if (heard && uartBaudRate() == agent_rate && agentWrite(agent, received, sizeof(received)) &&
+            transportRead(received, sizeof(received), 1000) == sizeof(frame))
+        {
+            esp32SerialResetPings();
+            return ping;
+        }
+        esp32SerialPingFailed();
+    }
+    return 0;
+}
+
+static void testBaudRateSteps()
+{
+    const int agent = openAgent();
+    CHECK(esp32SerialGetBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+    CHECK(uartBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+
+    // Up through the candidates, then back around to the configured rate, with frames passing at every one
+    CHECK(esp32SerialStepBaudRate() == 921600);
+    CHECK(uartBaudRate() == 921600);
+    CHECK(roundTrip(agent));
+    CHECK(esp32SerialStepBaudRate() == 2000000);
+    CHECK(esp32SerialGetBaudRate() == 2000000);
+    CHECK(roundTrip(agent));
+    CHECK(esp32SerialStepBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+    CHECK(uartBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+    CHECK(roundTrip(agent));
+    close(agent);
+}
+
+static void testNegotiation()
+{
+    const int agent = openAgent();
+    // Each rate gets CONFIG_PCC_UART_AUTO_BAUD_PINGS pings before the next one is tried
+    CHECK(pingsToFind(agent, 921600) == CONFIG_PCC_UART_AUTO_BAUD_PINGS + 1);
+    CHECK(esp32SerialGetBaudRate() == 921600);
+    // The agent restarts at the same rate, it is found again straight away
+    CHECK(pingsToFind(agent, 921600) == 1);
+    CHECK(pingsToFind(agent, 2000000) == CONFIG_PCC_UART_AUTO_BAUD_PINGS + 1);
+    // Restarted at a lower rate, it is found once the rates wrap around
+    CHECK(pingsToFind(agent, CONFIG_PCC_UART_BAUD_RATE) == CONFIG_PCC_UART_AUTO_BAUD_PINGS + 1);
+    CHECK(esp32SerialGetBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+
+    // A ping lost to noise doesn't count against the rate once the agent answered
+    esp32SerialPingFailed();
+    esp32SerialResetPings();
+    esp32SerialPingFailed();
+    CHECK(esp32SerialGetBaudRate() == CONFIG_PCC_UART_BAUD_RATE);
+    esp32SerialResetPings();
+    close(agent);
+}
+
+/**
+ * @return How long writing PACED_WRITE_SIZE bytes held the caller, in ms
+ */
+static int64_t pacedWrite(int agent)
+{
+    static uint8_t data[PACED_WRITE_SIZE];
+    static uint8_t received[PACED_WRITE_SIZE];
+    std::thread reader([agent]()
+                       {
+                           agentRead(agent, received, sizeof(received), 5000);
+                       });
+    uint8_t error = 0;
+    const auto start = std::chrono::steady_clock::now();
+    esp32SerialWrite(&transport, data, sizeof(data), &error);
+    const int64_t elapsed = elapsedMs(start);
+    reader.join();
+    // Let the last of it go out, so the next write starts on an idle wire
+    uart_wait_tx_done(port, portMAX_DELAY);
+    return elapsed;
+}
+
+static void testWritesGoAtTheBaudRate()
+{
+    const int agent = openAgent();
+    // The caller waits for everything past the tx buffer and fifo to go out, about 520 ms at 115200 baud
+    const int64_t slow = pacedWrite(agent);
+    CHECK(slow >= 450);
+    CHECK(slow < 2000);
+
+    esp32SerialStepBaudRate();
+    esp32SerialStepBaudRate();
+    CHECK(pacedWrite(agent) < 200);
+    esp32SerialStepBaudRate();
+    close(agent);
+}
+
+static void testReopen()
+{
+    // What the session does when it is torn down and set up again after losing the agent
+    CHECK(esp32SerialClose(&transport));
+    CHECK(esp32SerialOpen(&transport));
+    const int agent = openAgent();
+    CHECK(agent >= 0);
+    CHECK(roundTrip(agent));
+    close(agent);
+}
+
+int main()
+{
+    setenv("PCC_SIM_SERIAL", AGENT_LINK, 1);
+    if (!esp32SerialOpen(&transport))
+    {
+        fprintf(stderr, "Can't open the transport\n");
+        return 1;
+    }
+
+    runTest("frames pass through", testFramesPassThrough);
+    runTest("large write", testLargeWrite);
+    runTest("read timeout", testReadTimeout);
+    runTest("read wakes on data", testReadWakesOnData);
+    runTest("stats", testStats);
+    runTest("agent loss and recovery", testAgentLossAndRecovery);
+    runTest("baud rate steps", testBaudRateSteps);
+    runTest("negotiation", testNegotiation);
+    runTest("writes go at the baud rate", testWritesGoAtTheBaudRate);
+    runTest("reopen", testReopen);
+
+    esp32SerialClose(&transport);
+    unlink(AGENT_LINK);
+    return testResult();
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <esp_timer.h>
+#include <thread>
+
+#include "stall_monitor.hpp"
+#include "test.hpp"
+
+/**
+ * STALL_CHECK_PERIOD in stall_monitor.cpp. A stall is reported at most this long after the timeout, the slack covers
+ * the scheduling of the host threads
+ */
+#define MONITOR_CHECK_PERIOD 100
+#define DETECTION_SLACK 100
+
+static void sleepMs(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static void testShortActivitiesAreNotStalls()
+{
+    std::thread worker([]()
+                       {
+                           watchTask("short");
+                           for (size_t i = 0; i < 8; i++)
+                           {
+                               StallActivity activity("short_callback");
+                               sleepMs(CONFIG_PCC_STALL_TIMEOUT / 4);
+                           }
+                       });
+    worker.join();
+    CHECK(getStallCount() == 0);
+}
+
+static void testInterruptedActivityStartsOver()
+{
+    // The outer activity runs for longer than the timeout in total, but never that long without a nested one ending
+    std::thread worker([]()
+                       {
+                           watchTask("nested");
+                           StallActivity spin("spin");
+                           for (size_t i = 0; i < 6; i++)
+                           {
+                               sleepMs(CONFIG_PCC_STALL_TIMEOUT / 4);
+                               StallActivity callback("nested_callback");
+                           }
+                       });
+    worker.join();
+    CHECK(getStallCount() == 0);
+}
+
+static void testUnwatchedTaskIsIgnored()
+{
+    std::thread worker([]()
+                       {
+                           StallActivity activity("unwatched_callback");
+                           sleepMs(CONFIG_PCC_STALL_TIMEOUT + 2 * MONITOR_CHECK_PERIOD);
+                       });
+    worker.join();
+    CHECK(getStallCount() == 0);
+}
+
+static void testBlockedCallbackIsDetected()
+{
+    std::atomic<int64_t> blocked_since{0};
+    std::atomic<bool> release{false};
+    std::thread worker([&]()
+                       {
+                           watchTask("blocked");
+                           StallActivity spin("spin");
+                           {
+                               // Like a transfer that never finishes
+                               StallActivity callback("blocked_callback");
+                               blocked_since.store(esp_timer_get_time());
+                               while (!release.load())
+                               {
+                                   sleepMs(1);
+                               }
+                           }
+                       });
+
+    while (blocked_since.load() == 0)
+    {
+        sleepMs(1);
+    }
+    const uint32_t stalls = getStallCount();
+    const int64_t timeout = esp_timer_get_time() + 2 * CONFIG_PCC_STALL_TIMEOUT * 1000;
+    while (getStallCount() == stalls && esp_timer_get_time() < timeout)
+    {
+        sleepMs(1);
+    }
+    const auto detection_time = (uint32_t) ((esp_timer_get_time() - blocked_since.load()) / 1000);
+    printf("Detected after %u ms\n", detection_time);
+    CHECK(getStallCount() == stalls + 1);
+    CHECK(detection_time >= CONFIG_PCC_STALL_TIMEOUT);
+    CHECK(detection_time <= CONFIG_PCC_STALL_TIMEOUT + MONITOR_CHECK_PERIOD + DETECTION_SLACK);
+
+    // A stall is only counted once while it goes on, and the report follows it
+    sleepMs(3 * MONITOR_CHECK_PERIOD);
+    CHECK(getStallCount() == stalls + 1);
+    const StallReport report = getStallReport();
+    CHECK(strcmp(report.task, "blocked") == 0);
+    CHECK(strcmp(report.activity, "blocked_callback") == 0);
+    CHECK(report.duration >= detection_time + 2 * MONITOR_CHECK_PERIOD);
+    CHECK(report.count == stalls + 1);
+
+    release.store(true);
+    worker.join();
+}
+
+static void testStallAfterRecoveryIsCountedAgain()
+{
+    std::thread worker([]()
+                       {
+                           watchTask("twice");
+                           for (size_t i = 0; i < 2; i++)
+                           {
+                               StallActivity callback("slow_callback");
+                               sleepMs(CONFIG_PCC_STALL_TIMEOUT + 2 * MONITOR_CHECK_PERIOD);
+                           }
+                       });
+    const uint32_t stalls = getStallCount();
+    worker.join();
+    CHECK(getStallCount() == stalls + 2);
+}
+
+int main()
+{
+    initStallMonitor();
+    CHECK(!hasPreviousStall());
+
+    runTest("short activities are not stalls", testShortActivitiesAreNotStalls);
+    runTest("interrupted activity starts over", testInterruptedActivityStartsOver);
+    runTest("unwatched task is ignored", testUnwatchedTaskIsIgnored);
+    runTest("blocked callback is detected", testBlockedCallbackIsDetected);
+    runTest("stall after recovery is counted again", testStallAfterRecoveryIsCountedAgain);
+    return testResult();
+}
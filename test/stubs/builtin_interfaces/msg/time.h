@@ -0,0 +1,12 @@
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_TEST_BUILTIN_INTERFACES_TIME_H
+#define AVR_PCC_2023_TEST_BUILTIN_INTERFACES_TIME_H
+
+struct builtin_interfaces__msg__Time
+{
+    int32_t sec;
+    uint32_t nanosec;
+};
+
+#endif //AVR_PCC_2023_TEST_BUILTIN_INTERFACES_TIME_H
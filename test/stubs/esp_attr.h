@@ -0,0 +1,9 @@
+#ifndef AVR_PCC_2023_TEST_ESP_ATTR_H
+#define AVR_PCC_2023_TEST_ESP_ATTR_H
+
+/**
+ * There is no RTC memory on the host, these variables only live as long as the process
+ */
+#define RTC_NOINIT_ATTR
+
+#endif //AVR_PCC_2023_TEST_ESP_ATTR_H
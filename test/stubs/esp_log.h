@@ -0,0 +1,12 @@
+#include <cstdio>
+
+#ifndef AVR_PCC_2023_TEST_ESP_LOG_H
+#define AVR_PCC_2023_TEST_ESP_LOG_H
+
+#define ESP_LOG_HOST(level, tag, format, ...) fprintf(stderr, level " (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...) ESP_LOG_HOST("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_HOST("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_HOST("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { (void) (tag); } while (0)
+
+#endif //AVR_PCC_2023_TEST_ESP_LOG_H
@@ -0,0 +1,29 @@
+#ifndef AVR_PCC_2023_TEST_ESP_SYSTEM_H
+#define AVR_PCC_2023_TEST_ESP_SYSTEM_H
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+} esp_reset_reason_t;
+
+/**
+ * What esp_reset_reason reports, tests can set it before the code under test reads it
+ */
+inline esp_reset_reason_t hostResetReason = ESP_RST_POWERON;
+
+inline esp_reset_reason_t esp_reset_reason()
+{
+    return hostResetReason;
+}
+
+#endif //AVR_PCC_2023_TEST_ESP_SYSTEM_H
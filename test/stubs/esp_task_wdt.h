@@ -0,0 +1,20 @@
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef AVR_PCC_2023_TEST_ESP_TASK_WDT_H
+#define AVR_PCC_2023_TEST_ESP_TASK_WDT_H
+
+/**
+ * The task watchdog isn't simulated, CONFIG_ESP_TASK_WDT_INIT is off
+ */
+inline esp_err_t esp_task_wdt_add(__attribute__((unused)) TaskHandle_t task)
+{
+    return ESP_OK;
+}
+
+inline esp_err_t esp_task_wdt_reset()
+{
+    return ESP_OK;
+}
+
+#endif //AVR_PCC_2023_TEST_ESP_TASK_WDT_H
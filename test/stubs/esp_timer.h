@@ -0,0 +1,28 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifndef AVR_PCC_2023_TEST_ESP_TIMER_H
+#define AVR_PCC_2023_TEST_ESP_TIMER_H
+
+/**
+ * When set, the time esp_timer_get_time returns instead of the clock, so a test can run through time without waiting
+ */
+inline std::atomic<int64_t> hostTimerTime{0};
+
+/**
+ * @return The time in us since the first call, which starts at 1 s so no stamp is 0
+ */
+inline int64_t esp_timer_get_time()
+{
+    const int64_t time = hostTimerTime.load(std::memory_order_relaxed);
+    if (time != 0)
+    {
+        return time;
+    }
+    static const auto start = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + 1000000;
+}
+
+#endif //AVR_PCC_2023_TEST_ESP_TIMER_H
@@ -0,0 +1,280 @@
+#include <chrono>
+#include <thread>
+
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/**
+ * Thrown by vTaskDelete to unwind the task's thread
+ */
+struct TaskDeleted
+{
+};
+
+static const auto startTime = std::chrono::steady_clock::now();
+static thread_local HostTask *currentTask = nullptr;
+
+static void startThread(HostTask *task, TaskFunction_t function, const char *name, void *arg)
+{
+    task->notifications = 0;
+    task->name = name;
+    task->deleted = false;
+    std::thread([task, function, arg]()
+                {
+                    currentTask = task;
+                    try
+                    {
+                        function(arg);
+                    }
+                    catch (const TaskDeleted &)
+                    {
+                    }
+                }).detach();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, __attribute__((unused)) uint32_t stack_size,
+                       void *arg, __attribute__((unused)) UBaseType_t priority, TaskHandle_t *handle)
+{
+    // Never freed, like a task's control block would be after it deletes itself
+    auto task = new HostTask();
+    if (handle != nullptr)
+    {
+        *handle = task;
+    }
+    startThread(task, function, name, arg);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char *name, __attribute__((unused)) uint32_t stack_size,
+                               void *arg, __attribute__((unused)) UBaseType_t priority,
+                               __attribute__((unused)) StackType_t *stack, StaticTask_t *buffer)
+{
+    startThread(buffer, function, name, arg);
+    return buffer;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer,
+                                           __attribute__((unused)) BaseType_t core)
+{
+    return xTaskCreateStatic(function, name, stack_size, arg, priority, stack, buffer);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr || task == currentTask)
+    {
+        throw TaskDeleted();
+    }
+    task->deleted = true;
+}
+
+/**
+ * Unwind the calling task's thread if another task deleted it
+ */
+static void checkDeleted()
+{
+    if (currentTask != nullptr && currentTask->deleted)
+    {
+        throw TaskDeleted();
+    }
+}
+
+TickType_t xTaskGetTickCount()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - startTime;
+    return (TickType_t) std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    checkDeleted();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    checkDeleted();
+}
+
+void vTaskDelayUntil(TickType_t *wake_time, TickType_t increment)
+{
+    checkDeleted();
+    *wake_time += increment;
+    std::this_thread::sleep_until(startTime + std::chrono::milliseconds(*wake_time));
+    checkDeleted();
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->notified.notify_all();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t timeout)
+{
+    HostTask *task = currentTask;
+    std::unique_lock<std::mutex> guard(task->lock);
+    const auto has_notification = [task]()
+    {
+        return task->notifications > 0;
+    };
+    if (timeout == portMAX_DELAY)
+    {
+        task->notified.wait(guard, has_notification);
+    }
+    else if (!task->notified.wait_for(guard, std::chrono::milliseconds(timeout), has_notification))
+    {
+        return 0;
+    }
+
+    const uint32_t notifications = task->notifications;
+    task->notifications = clear ? 0 : notifications - 1;
+    return notifications;
+}
+
+EventGroupHandle_t xEventGroupCreate()
+{
+    auto group = new HostEventGroup();
+    group->bits = 0;
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t result;
+    {
+        std::lock_guard<std::mutex> guard(group->lock);
+        group->bits |= bits;
+        result = group->bits;
+    }
+    group->changed.notify_all();
+    return result;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all,
+                                TickType_t timeout)
+{
+    std::unique_lock<std::mutex> guard(group->lock);
+    const auto is_set = [group, bits, all]()
+    {
+        return all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool set;
+    if (timeout == portMAX_DELAY)
+    {
+        group->changed.wait(guard, is_set);
+        set = true;
+    }
+    else
+    {
+        set = group->changed.wait_for(guard, std::chrono::milliseconds(timeout), is_set);
+    }
+
+    const EventBits_t result = group->bits;
+    if (set && clear)
+    {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, __attribute__((unused)) uint8_t *storage,
+                                 StaticQueue_t *buffer)
+{
+    buffer->length = length;
+    buffer->itemSize = item_size;
+    return buffer;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return xQueueCreateStatic(length, item_size, nullptr, new HostQueue());
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    xQueueReset(queue);
+}
+
+/**
+ * Wait for room in a queue, then add an item at the front or the back
+ */
+static BaseType_t queueSend(QueueHandle_t queue, const void *item, TickType_t timeout, bool front)
+{
+    std::unique_lock<std::mutex> guard(queue->lock);
+    const auto has_room = [queue]()
+    {
+        return queue->items.size() < queue->length;
+    };
+    if (timeout == portMAX_DELAY)
+    {
+        queue->changed.wait(guard, has_room);
+    }
+    else if (!queue->changed.wait_for(guard, std::chrono::milliseconds(timeout), has_room))
+    {
+        return pdFALSE;
+    }
+
+    std::vector<uint8_t> copy((const uint8_t *) item, (const uint8_t *) item + queue->itemSize);
+    if (front)
+    {
+        queue->items.push_front(std::move(copy));
+    }
+    else
+    {
+        queue->items.push_back(std::move(copy));
+    }
+    guard.unlock();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    return queueSend(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    return queueSend(queue, item, timeout, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> guard(queue->lock);
+    const auto has_item = [queue]()
+    {
+        return !queue->items.empty();
+    };
+    if (timeout == portMAX_DELAY)
+    {
+        queue->changed.wait(guard, has_item);
+    }
+    else if (!queue->changed.wait_for(guard, std::chrono::milliseconds(timeout), has_item))
+    {
+        return pdFALSE;
+    }
+
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    guard.unlock();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t) queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->items.clear();
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
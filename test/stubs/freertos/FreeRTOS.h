@@ -0,0 +1,68 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Like the real FreeRTOSConfig.h
+#include "sdkconfig.h"
+
+#ifndef AVR_PCC_2023_TEST_FREERTOS_H
+#define AVR_PCC_2023_TEST_FREERTOS_H
+
+/**
+ * The parts of FreeRTOS the tested sources use, on std::thread. Ticks are milliseconds and every task runs on its own
+ * thread, so priorities and cores are ignored
+ */
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t) 0xffffffff)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms) / portTICK_PERIOD_MS)
+
+/**
+ * A task's notification count, and the thread it runs on. The objects are often static while their threads are
+ * detached, so what a thread can still be waiting on at exit is never destroyed, like FreeRTOS's objects never are
+ */
+struct HostTask
+{
+    std::mutex &lock = *new std::mutex();
+    std::condition_variable &notified = *new std::condition_variable();
+    uint32_t notifications;
+    const char *name;
+    /**
+     * Set when another task deletes it, it stops at its next delay
+     */
+    std::atomic<bool> deleted;
+};
+
+typedef HostTask StaticTask_t;
+typedef HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+/**
+ * A counting semaphore, which mutexes and binary semaphores are made from. Never destroyed, like HostTask
+ */
+struct HostSemaphore
+{
+    std::mutex &lock = *new std::mutex();
+    std::condition_variable &given = *new std::condition_variable();
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+typedef HostSemaphore StaticSemaphore_t;
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline BaseType_t xPortGetCoreID()
+{
+    return 0;
+}
+
+#endif //AVR_PCC_2023_TEST_FREERTOS_H
@@ -0,0 +1,24 @@
+#include "freertos/FreeRTOS.h"
+
+#ifndef AVR_PCC_2023_TEST_EVENT_GROUPS_H
+#define AVR_PCC_2023_TEST_EVENT_GROUPS_H
+
+typedef uint32_t EventBits_t;
+
+struct HostEventGroup
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits;
+};
+
+typedef HostEventGroup *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all,
+                                TickType_t timeout);
+
+#endif //AVR_PCC_2023_TEST_EVENT_GROUPS_H
@@ -0,0 +1,46 @@
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+
+#ifndef AVR_PCC_2023_TEST_QUEUE_H
+#define AVR_PCC_2023_TEST_QUEUE_H
+
+/**
+ * A queue of copied items. The storage given to xQueueCreateStatic isn't used, and like HostTask it is never destroyed
+ */
+struct HostQueue
+{
+    std::mutex &lock = *new std::mutex();
+    std::condition_variable &changed = *new std::condition_variable();
+    std::deque<std::vector<uint8_t>> &items = *new std::deque<std::vector<uint8_t>>();
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+typedef HostQueue StaticQueue_t;
+typedef HostQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+
+/**
+ * The queue is only emptied, since a task may still be using it
+ */
+void vQueueDelete(QueueHandle_t queue);
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t timeout);
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t timeout);
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+#define xQueueSend xQueueSendToBack
+
+#endif //AVR_PCC_2023_TEST_QUEUE_H
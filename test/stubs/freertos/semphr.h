@@ -0,0 +1,62 @@
+#include "freertos/FreeRTOS.h"
+
+#ifndef AVR_PCC_2023_TEST_SEMPHR_H
+#define AVR_PCC_2023_TEST_SEMPHR_H
+
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    buffer->count = 1;
+    buffer->maxCount = 1;
+    return buffer;
+}
+
+/**
+ * Never freed, there is no vSemaphoreDelete
+ */
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return xSemaphoreCreateMutexStatic(new HostSemaphore());
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    auto semaphore = new HostSemaphore();
+    semaphore->count = 0;
+    semaphore->maxCount = 1;
+    return semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    const auto available = [semaphore]()
+    {
+        return semaphore->count > 0;
+    };
+    if (timeout == portMAX_DELAY)
+    {
+        semaphore->given.wait(guard, available);
+    }
+    else if (!semaphore->given.wait_for(guard, std::chrono::milliseconds(timeout), available))
+    {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount)
+        {
+            return pdFALSE;
+        }
+        semaphore->count++;
+    }
+    semaphore->given.notify_one();
+    return pdTRUE;
+}
+
+#endif //AVR_PCC_2023_TEST_SEMPHR_H
@@ -0,0 +1,31 @@
+#include "freertos/FreeRTOS.h"
+
+#ifndef AVR_PCC_2023_TEST_TASK_H
+#define AVR_PCC_2023_TEST_TASK_H
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle);
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *buffer,
+                                           BaseType_t core);
+
+/**
+ * Deleting the calling task unwinds its thread, so it doesn't return. Another task is stopped at its next delay
+ */
+void vTaskDelete(TaskHandle_t task);
+
+TickType_t xTaskGetTickCount();
+
+void vTaskDelay(TickType_t ticks);
+
+void vTaskDelayUntil(TickType_t *wake_time, TickType_t increment);
+
+void xTaskNotifyGive(TaskHandle_t task);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t timeout);
+
+#endif //AVR_PCC_2023_TEST_TASK_H
@@ -0,0 +1,47 @@
+#include <cstddef>
+#include <cstdlib>
+
+#ifndef AVR_PCC_2023_TEST_RCL_ALLOCATOR_H
+#define AVR_PCC_2023_TEST_RCL_ALLOCATOR_H
+
+/**
+ * rcutils' allocator, which rcl uses as is
+ */
+typedef struct rcutils_allocator_s
+{
+    void *(*allocate)(size_t size, void *state);
+    void (*deallocate)(void *pointer, void *state);
+    void *(*reallocate)(void *pointer, size_t size, void *state);
+    void *(*zero_allocate)(size_t number_of_elements, size_t size_of_element, void *state);
+    void *state;
+} rcutils_allocator_t;
+
+typedef rcutils_allocator_t rcl_allocator_t;
+
+inline rcutils_allocator_t rcutils_get_zero_initialized_allocator()
+{
+    return {nullptr, nullptr, nullptr, nullptr, nullptr};
+}
+
+inline rcl_allocator_t rcl_get_default_allocator()
+{
+    return {[](size_t size, void *)
+            {
+                return malloc(size);
+            },
+            [](void *pointer, void *)
+            {
+                free(pointer);
+            },
+            [](void *pointer, size_t size, void *)
+            {
+                return realloc(pointer, size);
+            },
+            [](size_t number_of_elements, size_t size_of_element, void *)
+            {
+                return calloc(number_of_elements, size_of_element);
+            },
+            nullptr};
+}
+
+#endif //AVR_PCC_2023_TEST_RCL_ALLOCATOR_H
@@ -0,0 +1,39 @@
+#include <cstdint>
+
+#include "rcl/allocator.h"
+
+#ifndef AVR_PCC_2023_TEST_RCL_H
+#define AVR_PCC_2023_TEST_RCL_H
+
+typedef int32_t rcl_ret_t;
+
+#define RCL_RET_OK 0
+#define RCL_RET_ERROR 1
+
+struct rcl_node_t
+{
+    void *impl;
+};
+
+/**
+ * A timer whose period and next call are set by the test, in ns
+ */
+struct rcl_timer_t
+{
+    int64_t period;
+    int64_t timeUntilNextCall;
+};
+
+inline rcl_ret_t rcl_timer_get_period(const rcl_timer_t *timer, int64_t *period)
+{
+    *period = timer->period;
+    return RCL_RET_OK;
+}
+
+inline rcl_ret_t rcl_timer_get_time_until_next_call(const rcl_timer_t *timer, int64_t *time_until_next_call)
+{
+    *time_until_next_call = timer->timeUntilNextCall;
+    return RCL_RET_OK;
+}
+
+#endif //AVR_PCC_2023_TEST_RCL_H
@@ -0,0 +1,34 @@
+#include <cstddef>
+
+#include "rcl/rcl.h"
+
+#ifndef AVR_PCC_2023_TEST_RCLC_EXECUTOR_H
+#define AVR_PCC_2023_TEST_RCLC_EXECUTOR_H
+
+struct rclc_executor_handle_t
+{
+    bool data_available;
+};
+
+/**
+ * Only the number of handles added so far, which nodes advance in setup
+ */
+struct rclc_executor_t
+{
+    size_t index;
+};
+
+inline bool rclc_executor_trigger_any(rclc_executor_handle_t *handles, unsigned int size,
+                                      __attribute__((unused)) void *obj)
+{
+    for (unsigned int i = 0; i < size; i++)
+    {
+        if (handles[i].data_available)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif //AVR_PCC_2023_TEST_RCLC_EXECUTOR_H
@@ -0,0 +1,12 @@
+#include "rcl/rcl.h"
+#include "rclc/executor.h"
+
+#ifndef AVR_PCC_2023_TEST_RCLC_H
+#define AVR_PCC_2023_TEST_RCLC_H
+
+struct rclc_support_t
+{
+    void *context;
+};
+
+#endif //AVR_PCC_2023_TEST_RCLC_H
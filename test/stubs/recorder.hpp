@@ -0,0 +1,20 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <driver/i2c.h>
+
+#ifndef AVR_PCC_2023_RECORDER_HPP
+#define AVR_PCC_2023_RECORDER_HPP
+
+/**
+ * Nothing is recorded on the host, like with CONFIG_PCC_RECORDER off
+ */
+inline void recordI2cRead(__attribute__((unused)) i2c_port_t port, __attribute__((unused)) uint8_t address,
+                          __attribute__((unused)) const uint8_t *write_data,
+                          __attribute__((unused)) size_t write_length,
+                          __attribute__((unused)) const uint8_t *read_data,
+                          __attribute__((unused)) size_t read_length)
+{
+}
+
+#endif //AVR_PCC_2023_RECORDER_HPP
@@ -0,0 +1,32 @@
+#include <cstdint>
+
+#include "esp_timer.h"
+
+#ifndef AVR_PCC_2023_TEST_RMW_MICROROS_H
+#define AVR_PCC_2023_TEST_RMW_MICROROS_H
+
+typedef int32_t rmw_ret_t;
+
+#define RMW_RET_OK 0
+#define RMW_RET_ERROR 1
+
+/**
+ * Whether the fake agent answers syncs
+ */
+inline bool hostAgentAnswers = true;
+/**
+ * The fake agent's epoch time minus esp_timer_get_time, in ns
+ */
+inline int64_t hostAgentOffset = 0;
+
+inline rmw_ret_t rmw_uros_sync_session(__attribute__((unused)) int timeout_ms)
+{
+    return hostAgentAnswers ? RMW_RET_OK : RMW_RET_ERROR;
+}
+
+inline int64_t rmw_uros_epoch_nanos()
+{
+    return esp_timer_get_time() * 1000 + hostAgentOffset;
+}
+
+#endif //AVR_PCC_2023_TEST_RMW_MICROROS_H
@@ -0,0 +1,31 @@
+#include <cstring>
+
+#ifndef AVR_PCC_2023_TEST_ROSIDL_MESSAGE_TYPE_SUPPORT_STRUCT_H
+#define AVR_PCC_2023_TEST_ROSIDL_MESSAGE_TYPE_SUPPORT_STRUCT_H
+
+struct rosidl_message_type_support_t;
+
+typedef const rosidl_message_type_support_t *(*rosidl_message_typesupport_handle_function)(
+        const rosidl_message_type_support_t *, const char *);
+
+struct rosidl_message_type_support_t
+{
+    const char *typesupport_identifier;
+    const void *data;
+    rosidl_message_typesupport_handle_function func;
+};
+
+/**
+ * The handle itself if it is for the identifier, otherwise whatever its func finds
+ */
+inline const rosidl_message_type_support_t *get_message_typesupport_handle(
+        const rosidl_message_type_support_t *handle, const char *identifier)
+{
+    if (strcmp(handle->typesupport_identifier, identifier) == 0)
+    {
+        return handle;
+    }
+    return handle->func != nullptr ? handle->func(handle, identifier) : nullptr;
+}
+
+#endif //AVR_PCC_2023_TEST_ROSIDL_MESSAGE_TYPE_SUPPORT_STRUCT_H
@@ -0,0 +1,6 @@
+#ifndef AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_IDENTIFIER_H
+#define AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_IDENTIFIER_H
+
+#define ROSIDL_TYPESUPPORT_MICROXRCEDDS_C__IDENTIFIER_VALUE "rosidl_typesupport_microxrcedds_c"
+
+#endif //AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_IDENTIFIER_H
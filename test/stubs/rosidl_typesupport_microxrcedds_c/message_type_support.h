@@ -0,0 +1,16 @@
+#include <cstddef>
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+#ifndef AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_MESSAGE_TYPE_SUPPORT_H
+#define AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_MESSAGE_TYPE_SUPPORT_H
+
+/**
+ * Only the callback the firmware uses, the real one also serializes and deserializes
+ */
+struct message_type_support_callbacks_t
+{
+    size_t (*get_serialized_size)(const void *message);
+};
+
+#endif //AVR_PCC_2023_TEST_ROSIDL_MICROXRCEDDS_MESSAGE_TYPE_SUPPORT_H
@@ -0,0 +1,31 @@
+#ifndef AVR_PCC_2023_TEST_SDKCONFIG_H
+#define AVR_PCC_2023_TEST_SDKCONFIG_H
+
+/**
+ * The options the tested sources read, at their Kconfig defaults
+ */
+#define CONFIG_PCC_LED_THERMAL_SPAN 10
+#define CONFIG_PCC_LINK_BUDGET 1
+#define CONFIG_PCC_LINK_TELEMETRY_SHARE 60
+#define CONFIG_PCC_LINK_LOG_SHARE 15
+#define CONFIG_PCC_LINK_BULK_SHARE 15
+#define CONFIG_PCC_POOL_ALLOCATOR 1
+/**
+ * Not the default, so the resources are checked with everything the firmware can create
+ */
+#define CONFIG_PCC_RECORDING 1
+#define CONFIG_PCC_STALL_MONITOR 1
+#define CONFIG_PCC_STALL_TIMEOUT 1000
+#define CONFIG_PCC_UART_BAUD_RATE 115200
+#define CONFIG_PCC_UART_AUTO_BAUD 1
+#define CONFIG_PCC_UART_AUTO_BAUD_PINGS 2
+#define CONFIG_PCC_UART_EVENT_DRIVEN 1
+#define CONFIG_PCC_UART_RX_BUFFER_SIZE 2048
+#define CONFIG_PCC_UART_TX_BUFFER_SIZE 2048
+#define CONFIG_PCC_UART_EVENT_QUEUE_SIZE 20
+#define CONFIG_MICROROS_UART_TXD 1
+#define CONFIG_MICROROS_UART_RXD 3
+#define CONFIG_MICROROS_UART_RTS (-1)
+#define CONFIG_MICROROS_UART_CTS (-1)
+
+#endif //AVR_PCC_2023_TEST_SDKCONFIG_H
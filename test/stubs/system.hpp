@@ -0,0 +1,36 @@
+#include <cstdint>
+#include <cstdio>
+
+#ifndef AVR_PCC_2023_SYSTEM_HPP
+#define AVR_PCC_2023_SYSTEM_HPP
+
+/**
+ * Logs go to stderr on the host, instead of through the log drain to /rosout
+ */
+#define LOG(logLevel, msg) fprintf(stderr, "[%d] %s\n", (int) (logLevel), msg)
+#define HANDLE_ESP_ERROR(rc, do_reset) hostHandleError(rc)
+#define CONTEXT_TASK_CALLBACK(cls, func) [](void *void_context) \
+{                                                               \
+    auto context = (cls *) void_context;                        \
+    context->func();                                            \
+}
+
+/**
+ * Errors are only reported by the result on the host, nothing resets
+ * @return Whether there was no error
+ */
+inline bool hostHandleError(int rc)
+{
+    return rc == 0;
+}
+
+enum [[maybe_unused]] LogLevel
+{
+    LOGLEVEL_DEBUG = 10,
+    LOGLEVEL_INFO = 20,
+    LOGLEVEL_WARN = 30,
+    LOGLEVEL_ERROR = 40,
+    LOGLEVEL_FATAL = 50
+};
+
+#endif //AVR_PCC_2023_SYSTEM_HPP
@@ -0,0 +1,15 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef AVR_PCC_2023_TEST_UXR_TRANSPORT_H
+#define AVR_PCC_2023_TEST_UXR_TRANSPORT_H
+
+/**
+ * The part of Micro XRCE-DDS's custom transport that the transport functions use
+ */
+typedef struct uxrCustomTransport
+{
+    void *args;
+} uxrCustomTransport;
+
+#endif //AVR_PCC_2023_TEST_UXR_TRANSPORT_H
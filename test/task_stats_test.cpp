@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstring>
+
+#include "task_stats.hpp"
+#include "test.hpp"
+
+static bool near(float value, float expected)
+{
+    return std::fabs(value - expected) < 0.01f;
+}
+
+static void testFirstSnapshot()
+{
+    // Everything that ran since boot is counted against the time since boot
+    TaskStatsAggregator stats;
+    const TaskSample samples[] = {{1, "IDLE0", 600, 1000},
+                                  {2, "IDLE1", 900, 1000},
+                                  {3, "main", 300, 2048}};
+    TaskUsage usages[3];
+    CHECK(stats.update(samples, 3, 1000, 2, usages) == 3);
+    CHECK(strcmp(usages[0].name, "IDLE0") == 0 && near(usages[0].cpuPercent, 30));
+    CHECK(strcmp(usages[1].name, "IDLE1") == 0 && near(usages[1].cpuPercent, 45));
+    CHECK(strcmp(usages[2].name, "main") == 0 && near(usages[2].cpuPercent, 15));
+}
+
+static void testIntervalUsage()
+{
+    TaskStatsAggregator stats;
+    TaskSample samples[] = {{1, "IDLE0", 1000, 1000},
+                            {2, "IDLE1", 1000, 1000}};
+    TaskUsage usages[2];
+    stats.update(samples, 2, 1000, 2, usages);
+
+    // Only what ran since the last snapshot counts, so a task that was idle the whole time reads 0
+    samples[0].runTime = 2000;
+    stats.update(samples, 2, 2000, 2, usages);
+    CHECK(near(usages[0].cpuPercent, 50));
+    CHECK(near(usages[1].cpuPercent, 0));
+
+    // A single core gets the whole percentage
+    TaskStatsAggregator single;
+    single.update(samples, 1, 2000, 1, usages);
+    samples[0].runTime = 2500;
+    single.update(samples, 1, 3000, 1, usages);
+    CHECK(near(usages[0].cpuPercent, 50));
+}
+
+static void testCountersWrap()
+{
+    TaskStatsAggregator stats;
+    TaskSample samples[] = {{1, "wifi", 0xFFFFFF00, 1000}};
+    TaskUsage usages[1];
+    stats.update(samples, 1, 0xFFFFFE00, 1, usages);
+
+    samples[0].runTime = 0x100;
+    stats.update(samples, 1, 0x600, 1, usages);
+    CHECK(near(usages[0].cpuPercent, 25));
+}
+
+static void testTasksComeAndGo()
+{
+    TaskStatsAggregator stats;
+    const TaskSample first[] = {{1, "a", 100, 1000},
+                                {2, "b", 200, 1000},
+                                {3, "c", 300, 1000}};
+    TaskUsage usages[3];
+    stats.update(first, 3, 1000, 1, usages);
+
+    // b is gone, d is new and only its own run time counts, and the order changed
+    const TaskSample second[] = {{4, "d", 100, 1000},
+                                 {3, "c", 500, 1000},
+                                 {1, "a", 200, 1000}};
+    CHECK(stats.update(second, 3, 2000, 1, usages) == 3);
+    CHECK(strcmp(usages[0].name, "d") == 0 && near(usages[0].cpuPercent, 10));
+    CHECK(strcmp(usages[1].name, "c") == 0 && near(usages[1].cpuPercent, 20));
+    CHECK(strcmp(usages[2].name, "a") == 0 && near(usages[2].cpuPercent, 10));
+
+    // A new task that reuses a removed task's name is still a new task
+    const TaskSample third[] = {{5, "b", 50, 1000}};
+    stats.update(third, 1, 3000, 1, usages);
+    CHECK(near(usages[0].cpuPercent, 5));
+}
+
+static void testNoTimeElapsed()
+{
+    TaskStatsAggregator stats;
+    const TaskSample samples[] = {{1, "a", 100, 1000}};
+    TaskUsage usages[1];
+    stats.update(samples, 1, 1000, 1, usages);
+    stats.update(samples, 1, 1000, 1, usages);
+    CHECK(usages[0].cpuPercent == 0);
+}
+
+static void testStackWatermarks()
+{
+    TaskStatsAggregator stats;
+    const TaskSample samples[] = {{1, "roomy", 0, 3000},
+                                  {2, "edge", 0, TASK_STATS_STACK_WARNING},
+                                  {3, "tight", 0, TASK_STATS_STACK_WARNING - 1},
+                                  {4, "overflowed", 0, 0}};
+    TaskUsage usages[4];
+    stats.update(samples, 4, 1000, 1, usages);
+    CHECK(usages[0].stackHighWaterMark == 3000 && !usages[0].lowStack);
+    CHECK(usages[1].stackHighWaterMark == TASK_STATS_STACK_WARNING && !usages[1].lowStack);
+    CHECK(usages[2].stackHighWaterMark == TASK_STATS_STACK_WARNING - 1 && usages[2].lowStack);
+    CHECK(usages[3].stackHighWaterMark == 0 && usages[3].lowStack);
+}
+
+static void testTooManyTasks()
+{
+    TaskStatsAggregator stats;
+    TaskSample samples[TASK_STATS_MAX_TASKS + 4];
+    for (uint32_t i = 0; i < TASK_STATS_MAX_TASKS + 4; i++)
+    {
+        samples[i] = {i, "task", 10 * i, 1000};
+    }
+    TaskUsage usages[TASK_STATS_MAX_TASKS];
+    CHECK(stats.update(samples, TASK_STATS_MAX_TASKS + 4, 1000, 1, usages) == TASK_STATS_MAX_TASKS);
+    CHECK(near(usages[TASK_STATS_MAX_TASKS - 1].cpuPercent, (TASK_STATS_MAX_TASKS - 1) * 1.0f));
+}
+
+int main()
+{
+    runTest("first snapshot", testFirstSnapshot);
+    runTest("interval usage", testIntervalUsage);
+    runTest("counters wrap", testCountersWrap);
+    runTest("tasks come and go", testTasksComeAndGo);
+    runTest("no time elapsed", testNoTimeElapsed);
+    runTest("stack watermarks", testStackWatermarks);
+    runTest("too many tasks", testTooManyTasks);
+    return testResult();
+}
@@ -0,0 +1,42 @@
+#include <cstdio>
+
+#ifndef AVR_PCC_2023_TEST_HPP
+#define AVR_PCC_2023_TEST_HPP
+
+/**
+ * Checks keep going after a failure, so one run reports every check that failed
+ */
+#define CHECK(condition) checkCondition(condition, #condition, __FILE__, __LINE__)
+
+inline int testFailures = 0;
+
+inline bool checkCondition(bool condition, const char *text, const char *file, int line)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        testFailures++;
+    }
+    return condition;
+}
+
+/**
+ * Run a test case and report it
+ */
+template<typename Test>
+void runTest(const char *name, Test test)
+{
+    const int failures = testFailures;
+    test();
+    printf("%s %s\n", testFailures == failures ? "PASS" : "FAIL", name);
+}
+
+/**
+ * @return The exit code for the test executable
+ */
+inline int testResult()
+{
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif //AVR_PCC_2023_TEST_HPP
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdio>
+
+#include "thermal_frame.hpp"
+
+#define BENCHMARK_FRAMES 1000000
+#define AMG88XX_PIXEL_TEMP_CONVERSION .25
+
+/**
+ * The raw pixel conversion of ThermalCameraNode::updateTimerCallback
+ */
+static inline float convertPixel(const uint8_t *buffer, int i)
+{
+    const auto recast = (uint16_t) (((uint16_t) buffer[(i << 1) + 1] << 8) | buffer[i << 1]);
+    const auto value = (int16_t) ((int16_t) (recast << 4) >> 4);
+    return (float) (value * AMG88XX_PIXEL_TEMP_CONVERSION);
+}
+
+/**
+ * Keeps the compiler from dropping the converted frame
+ */
+static void consume(const void *data)
+{
+    asm volatile("" : : "r"(data) : "memory");
+}
+
+static double nowNs()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Prints the time to convert a frame on its own and with the stats gathered in the same loop, as JSON
+ */
+int main()
+{
+    uint8_t buffer[AMG88XX_PIXEL_ARRAY_SIZE << 1];
+    for (int i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        // 18 - 33.75 C in 0.25 C steps, across three histogram bins
+        const uint16_t raw = 72 + i;
+        buffer[i << 1] = raw & 0xff;
+        buffer[(i << 1) + 1] = raw >> 8;
+    }
+    float pixels[AMG88XX_PIXEL_ARRAY_SIZE];
+
+    double start = nowNs();
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        consume(buffer);
+        for (int i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+        {
+            pixels[i] = convertPixel(buffer, i);
+        }
+        consume(pixels);
+    }
+    const double convert_ns = (nowNs() - start) / BENCHMARK_FRAMES;
+
+    ThermalFrameStats stats;
+    float stats_data[THERMAL_STATS_SIZE];
+    start = nowNs();
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        consume(buffer);
+        stats.reset();
+        for (int i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+        {
+            pixels[i] = convertPixel(buffer, i);
+            stats.add(i, pixels[i]);
+        }
+        stats.write(stats_data);
+        consume(pixels);
+        consume(stats_data);
+    }
+    const double convert_with_stats_ns = (nowNs() - start) / BENCHMARK_FRAMES;
+
+    printf("{\"frames\": %d, \"convert_ns\": %.1f, \"convert_with_stats_ns\": %.1f, \"stats_ns\": %.1f}\n",
+           BENCHMARK_FRAMES, convert_ns, convert_with_stats_ns, convert_with_stats_ns - convert_ns);
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include <cmath>
+#include <cstring>
+
+#include "test.hpp"
+#include "thermal_frame.hpp"
+
+/**
+ * A frame where each pixel holds its own index, so extracted pixels show where they came from
+ */
+static void indexFrame(float *frame)
+{
+    for (size_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        frame[i] = (float) i;
+    }
+}
+
+static void testValidRegions()
+{
+    const uint8_t whole_frame[] = {0, 0, 8, 8};
+    CHECK(validateThermalRegions(whole_frame, sizeof(whole_frame)) == nullptr);
+
+    const uint8_t corners[] = {0, 0, 1, 1, 7, 0, 1, 1, 0, 7, 1, 1, 7, 7, 1, 1};
+    CHECK(validateThermalRegions(corners, sizeof(corners)) == nullptr);
+
+    const uint8_t bottom_right[] = {4, 6, 4, 2};
+    CHECK(validateThermalRegions(bottom_right, sizeof(bottom_right)) == nullptr);
+
+    // No regions turns them off
+    CHECK(validateThermalRegions(nullptr, 0) == nullptr);
+}
+
+static void testPartialRegionIsRejected()
+{
+    const uint8_t data[] = {0, 0, 2, 2, 1, 1};
+    CHECK(validateThermalRegions(data, sizeof(data)) != nullptr);
+}
+
+static void testTooManyRegionsAreRejected()
+{
+    uint8_t data[(THERMAL_MAX_REGIONS + 1) * sizeof(ThermalRegion)];
+    for (size_t i = 0; i < sizeof(data); i += sizeof(ThermalRegion))
+    {
+        data[i] = 0;
+        data[i + 1] = 0;
+        data[i + 2] = 1;
+        data[i + 3] = 1;
+    }
+    CHECK(validateThermalRegions(data, sizeof(data)) != nullptr);
+    CHECK(validateThermalRegions(data, sizeof(data) - sizeof(ThermalRegion)) == nullptr);
+}
+
+static void testEmptyRegionIsRejected()
+{
+    const uint8_t no_width[] = {2, 2, 0, 3};
+    CHECK(validateThermalRegions(no_width, sizeof(no_width)) != nullptr);
+    const uint8_t no_height[] = {2, 2, 3, 0};
+    CHECK(validateThermalRegions(no_height, sizeof(no_height)) != nullptr);
+}
+
+static void testRegionOutsideTheFrameIsRejected()
+{
+    const uint8_t past_right[] = {6, 0, 3, 1};
+    CHECK(validateThermalRegions(past_right, sizeof(past_right)) != nullptr);
+    const uint8_t past_bottom[] = {0, 7, 1, 2};
+    CHECK(validateThermalRegions(past_bottom, sizeof(past_bottom)) != nullptr);
+    const uint8_t start_outside[] = {8, 0, 1, 1};
+    CHECK(validateThermalRegions(start_outside, sizeof(start_outside)) != nullptr);
+    // x + width would wrap around in 8 bits
+    const uint8_t wrapping[] = {7, 0, 255, 1};
+    CHECK(validateThermalRegions(wrapping, sizeof(wrapping)) != nullptr);
+
+    // One bad region rejects the whole list
+    const uint8_t second_bad[] = {0, 0, 2, 2, 0, 0, 9, 1};
+    CHECK(validateThermalRegions(second_bad, sizeof(second_bad)) != nullptr);
+}
+
+static void testExtractRegions()
+{
+    float frame[AMG88XX_PIXEL_ARRAY_SIZE];
+    indexFrame(frame);
+
+    // A 2x3 block, then a single pixel, then the last row
+    const ThermalRegion regions[] = {{1, 2, 2, 3},
+                                     {7, 7, 1, 1},
+                                     {0, 7, 8, 1}};
+    float output[THERMAL_MAX_REGIONS * AMG88XX_PIXEL_ARRAY_SIZE];
+    memset(output, 0, sizeof(output));
+    const size_t written = extractThermalRegions(frame, regions, 3, output);
+
+    const float expected[] = {17, 18, 25, 26, 33, 34,
+                              63,
+                              56, 57, 58, 59, 60, 61, 62, 63};
+    CHECK(written == sizeof(expected) / sizeof(float));
+    CHECK(memcmp(output, expected, sizeof(expected)) == 0);
+    // Nothing past the regions is touched
+    CHECK(output[written] == 0);
+}
+
+static void testExtractWholeFrame()
+{
+    float frame[AMG88XX_PIXEL_ARRAY_SIZE];
+    indexFrame(frame);
+    const ThermalRegion whole_frame = {0, 0, AMG88XX_GRID_SIZE, AMG88XX_GRID_SIZE};
+    float output[AMG88XX_PIXEL_ARRAY_SIZE];
+    CHECK(extractThermalRegions(frame, &whole_frame, 1, output) == AMG88XX_PIXEL_ARRAY_SIZE);
+    CHECK(memcmp(output, frame, sizeof(frame)) == 0);
+    CHECK(extractThermalRegions(frame, &whole_frame, 0, output) == 0);
+}
+
+static void testStatsOfEmptyFrame()
+{
+    ThermalFrameStats stats;
+    stats.reset();
+    float output[THERMAL_STATS_SIZE];
+    stats.write(output);
+    CHECK(output[2] == 0);
+    CHECK(output[3] == 0);
+    for (size_t i = 0; i < THERMAL_HISTOGRAM_BINS; i++)
+    {
+        CHECK(output[4 + i] == 0);
+    }
+}
+
+static void testStatsOfFrame()
+{
+    // A 20 C background with a 35.5 C spot and a -2.25 C pixel, in steps of the sensor's 0.25 C
+    float frame[AMG88XX_PIXEL_ARRAY_SIZE];
+    for (float &pixel : frame)
+    {
+        pixel = 20;
+    }
+    frame[42] = 35.5f;
+    frame[5] = -2.25f;
+
+    ThermalFrameStats stats;
+    stats.reset();
+    for (uint8_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        stats.add(i, frame[i]);
+    }
+    float output[THERMAL_STATS_SIZE];
+    stats.write(output);
+
+    CHECK(output[0] == -2.25f);
+    CHECK(output[1] == 35.5f);
+    CHECK(output[2] == (20 * 62 + 35.5f - 2.25f) / 64);
+    CHECK(output[3] == 42);
+    const float expected_histogram[THERMAL_HISTOGRAM_BINS] = {1, 0, 62, 1, 0, 0, 0, 0};
+    CHECK(memcmp(&output[4], expected_histogram, sizeof(expected_histogram)) == 0);
+}
+
+static void testStatsMatchASecondPass()
+{
+    // 64 different values from -20 C to 106 C in 2 C steps, in a scrambled order
+    float frame[AMG88XX_PIXEL_ARRAY_SIZE];
+    for (size_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        frame[i] = (float) ((int) ((i * 37) % AMG88XX_PIXEL_ARRAY_SIZE) * 8 - 80) * 0.25f;
+    }
+
+    ThermalFrameStats stats;
+    stats.reset();
+    for (uint8_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        stats.add(i, frame[i]);
+    }
+
+    float min = frame[0];
+    float max = frame[0];
+    float sum = 0;
+    size_t hottest = 0;
+    uint8_t histogram[THERMAL_HISTOGRAM_BINS] = {};
+    for (size_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        min = fminf(min, frame[i]);
+        if (frame[i] > max)
+        {
+            max = frame[i];
+            hottest = i;
+        }
+        sum += frame[i];
+        int bin = (int) floorf((frame[i] - THERMAL_HISTOGRAM_MIN) / THERMAL_HISTOGRAM_BIN_WIDTH);
+        bin = bin < 0 ? 0 : (bin >= THERMAL_HISTOGRAM_BINS ? THERMAL_HISTOGRAM_BINS - 1 : bin);
+        histogram[bin]++;
+    }
+
+    CHECK(stats.min == min);
+    CHECK(stats.max == max);
+    CHECK(stats.sum == sum);
+    CHECK(stats.hottest == hottest);
+    CHECK(stats.count == AMG88XX_PIXEL_ARRAY_SIZE);
+    CHECK(memcmp(stats.histogram, histogram, sizeof(histogram)) == 0);
+}
+
+static void testHistogramBinEdges()
+{
+    ThermalFrameStats stats;
+    stats.reset();
+    // Below the range, on the edges between bins, and past the end of the range
+    stats.add(0, -40);
+    stats.add(1, -0.25f);
+    stats.add(2, 0);
+    stats.add(3, 9.75f);
+    stats.add(4, 10);
+    stats.add(5, 79.75f);
+    stats.add(6, 80);
+    stats.add(7, 200);
+    const uint8_t expected[THERMAL_HISTOGRAM_BINS] = {4, 1, 0, 0, 0, 0, 0, 3};
+    CHECK(memcmp(stats.histogram, expected, sizeof(expected)) == 0);
+}
+
+static void testHottestIsTheFirstOfEqualPixels()
+{
+    ThermalFrameStats stats;
+    stats.reset();
+    stats.add(0, 25);
+    stats.add(1, 30);
+    stats.add(2, 30);
+    CHECK(stats.hottest == 1);
+}
+
+static void testResetClearsTheStats()
+{
+    ThermalFrameStats stats;
+    stats.reset();
+    stats.add(0, 50);
+    stats.reset();
+    stats.add(0, 10);
+    CHECK(stats.min == 10);
+    CHECK(stats.max == 10);
+    CHECK(stats.count == 1);
+    CHECK(stats.histogram[5] == 0);
+    CHECK(stats.histogram[1] == 1);
+}
+
+int main()
+{
+    runTest("valid regions", testValidRegions);
+    runTest("partial region is rejected", testPartialRegionIsRejected);
+    runTest("too many regions are rejected", testTooManyRegionsAreRejected);
+    runTest("empty region is rejected", testEmptyRegionIsRejected);
+    runTest("region outside the frame is rejected", testRegionOutsideTheFrameIsRejected);
+    runTest("extract regions", testExtractRegions);
+    runTest("extract the whole frame", testExtractWholeFrame);
+    runTest("stats of an empty frame", testStatsOfEmptyFrame);
+    runTest("stats of a frame", testStatsOfFrame);
+    runTest("stats match a second pass", testStatsMatchASecondPass);
+    runTest("histogram bin edges", testHistogramBinEdges);
+    runTest("hottest is the first of equal pixels", testHottestIsTheFirstOfEqualPixels);
+    runTest("reset clears the stats", testResetClearsTheStats);
+    return testResult();
+}
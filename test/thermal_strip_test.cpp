@@ -0,0 +1,155 @@
+#include <cstdlib>
+
+#include "test.hpp"
+#include "thermal_strip.hpp"
+
+#define AMBIENT 20.0f
+#define HOT 30.0f
+
+/**
+ * The LUT's index for a temperature above low, a bit past the index so float rounding doesn't land below it
+ */
+#define LUT_TEMPERATURE(low, index) ((low) + ((index) + 0.5f) * CONFIG_PCC_LED_THERMAL_SPAN / 255.0f)
+
+/**
+ * A frame at AMBIENT with one HOT pixel, as the camera would publish it
+ */
+struct TestFrame
+{
+    float pixels[AMG88XX_PIXEL_ARRAY_SIZE];
+    float columnMax[AMG88XX_GRID_SIZE];
+    ThermalFrameStats stats;
+
+    TestFrame(size_t row, size_t column) : pixels(), columnMax(), stats()
+    {
+        stats.reset();
+        for (uint8_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+        {
+            pixels[i] = i == row * AMG88XX_GRID_SIZE + column ? HOT : AMBIENT;
+            stats.add(i, pixels[i]);
+        }
+        thermalColumnMax(pixels, columnMax);
+    }
+
+    /**
+     * @return A bit per LED of a strip of length, set where the LED is lit
+     */
+    [[nodiscard]] uint32_t litLeds(LedStripThermalView view, size_t length) const
+    {
+        uint32_t lit = 0;
+        for (size_t led = 0; led < length; led++)
+        {
+            const rgb_t color = thermalStripColor(columnMax, stats, view, led, length);
+            if (color.r != 0 || color.g != 0 || color.b != 0)
+            {
+                lit |= 1u << led;
+            }
+        }
+        return lit;
+    }
+};
+
+static bool isColor(rgb_t color, uint8_t r, uint8_t g, uint8_t b)
+{
+    return color.r == r && color.g == g && color.b == b;
+}
+
+static void testColorStops()
+{
+    const float low = 25;
+    CHECK(isColor(thermalColor(low, low), 0, 0, 0));
+    CHECK(isColor(thermalColor(LUT_TEMPERATURE(low, 64), low), 60, 0, 110));
+    CHECK(isColor(thermalColor(LUT_TEMPERATURE(low, 128), low), 190, 30, 40));
+    CHECK(isColor(thermalColor(LUT_TEMPERATURE(low, 192), low), 250, 140, 0));
+    CHECK(isColor(thermalColor(low + CONFIG_PCC_LED_THERMAL_SPAN, low), 255, 255, 200));
+}
+
+static void testColorsClamp()
+{
+    const float low = 25;
+    // Colder than the mean is off, hotter than the span is the brightest color
+    CHECK(isColor(thermalColor(low - 5, low), 0, 0, 0));
+    CHECK(isColor(thermalColor(-1000, low), 0, 0, 0));
+    CHECK(isColor(thermalColor(low + 5 * CONFIG_PCC_LED_THERMAL_SPAN, low), 255, 255, 200));
+    CHECK(isColor(thermalColor(1000, low), 255, 255, 200));
+}
+
+static void testColorsAreSmooth()
+{
+    // A small change in temperature never jumps the color, so a target moving across the scene doesn't flicker.
+    // The steepest blend, blue up to the last stop, moves about 3 a step, twice that where a step is skipped
+    const float low = 25;
+    rgb_t previous = thermalColor(low, low);
+    for (int index = 1; index < 256; index++)
+    {
+        const rgb_t color = thermalColor(LUT_TEMPERATURE(low, index), low);
+        CHECK(abs(color.r - previous.r) <= 8 && abs(color.g - previous.g) <= 8 && abs(color.b - previous.b) <= 8);
+        previous = color;
+    }
+}
+
+static void testColumnMax()
+{
+    const TestFrame frame(3, 5);
+    for (size_t column = 0; column < AMG88XX_GRID_SIZE; column++)
+    {
+        CHECK(frame.columnMax[column] == (column == 5 ? HOT : AMBIENT));
+    }
+}
+
+static void testColumnsView()
+{
+    // The hot pixel is above the frame's mean, the ambient pixels are just below it and stay dark
+    const TestFrame frame(3, 5);
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_COLUMNS, AMG88XX_GRID_SIZE) == 1u << 5);
+    const rgb_t hot = thermalStripColor(frame.columnMax, frame.stats, LED_STRIP_THERMAL_COLUMNS, 5, 8);
+    const float mean = frame.stats.sum / (float) frame.stats.count;
+    const rgb_t expected = thermalColor(HOT, mean);
+    CHECK(isColor(hot, expected.r, expected.g, expected.b));
+
+    // A longer strip stretches each column over several LEDs
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_COLUMNS, 16) == (1u << 10 | 1u << 11));
+    // A shorter one has LEDs covering several columns, and still shows the hot one
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_COLUMNS, 3) == (1u << 1 | 1u << 2));
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_COLUMNS, 1) == 1u);
+}
+
+static void testBearingView()
+{
+    const TestFrame frame(6, 2);
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_BEARING, AMG88XX_GRID_SIZE) == 1u << 2);
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_BEARING, 16) == (1u << 4 | 1u << 5));
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_BEARING, 4) == 1u << 1);
+
+    // Every lit LED shows the hottest pixel's color
+    const float mean = frame.stats.sum / (float) frame.stats.count;
+    const rgb_t expected = thermalColor(HOT, mean);
+    const rgb_t color = thermalStripColor(frame.columnMax, frame.stats, LED_STRIP_THERMAL_BEARING, 4, 16);
+    CHECK(isColor(color, expected.r, expected.g, expected.b));
+}
+
+static void testUniformFrameIsDark()
+{
+    TestFrame frame(0, 0);
+    frame.stats.reset();
+    for (uint8_t i = 0; i < AMG88XX_PIXEL_ARRAY_SIZE; i++)
+    {
+        frame.pixels[i] = AMBIENT;
+        frame.stats.add(i, AMBIENT);
+    }
+    thermalColumnMax(frame.pixels, frame.columnMax);
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_COLUMNS, 8) == 0);
+    CHECK(frame.litLeds(LED_STRIP_THERMAL_BEARING, 8) == 0);
+}
+
+int main()
+{
+    runTest("color stops", testColorStops);
+    runTest("colors clamp", testColorsClamp);
+    runTest("colors are smooth", testColorsAreSmooth);
+    runTest("column max", testColumnMax);
+    runTest("columns view", testColumnsView);
+    runTest("bearing view", testBearingView);
+    runTest("uniform frame is dark", testUniformFrameIsDark);
+    return testResult();
+}
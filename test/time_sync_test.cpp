@@ -0,0 +1,243 @@
+#include <cstdint>
+#include <esp_timer.h>
+#include <rmw_microros/rmw_microros.h>
+
+#include "test.hpp"
+#include "time_sync.hpp"
+
+/**
+ * The sync period at its Kconfig default, in us
+ */
+#define TEST_SYNC_PERIOD 10000000LL
+/**
+ * An epoch time in ns, in 2023
+ */
+#define TEST_EPOCH 1690000000000000000LL
+
+/**
+ * A reference clock that is offset from the local one and runs at a different rate
+ */
+struct SkewedClock
+{
+    int64_t offset;
+    /**
+     * How much faster it runs, in parts per billion
+     */
+    int64_t drift;
+
+    [[nodiscard]] int64_t at(int64_t local) const
+    {
+        return offset + local * 1000 + local * drift / 1000000;
+    }
+};
+
+static int64_t absolute(int64_t value)
+{
+    return value < 0 ? -value : value;
+}
+
+/**
+ * A repeatable error of -range to range in ns, like the asymmetry of the sync's round trip
+ */
+static int64_t jitter(uint32_t *state, int64_t range)
+{
+    *state = *state * 1664525 + 1013904223;
+    return (int64_t) (*state >> 8) % (2 * range + 1) - range;
+}
+
+/**
+ * Sync the model with the clock every period
+ * @return The local time of the last sample
+ */
+static int64_t train(ClockModel *model, const SkewedClock &clock, int64_t start, uint32_t samples)
+{
+    int64_t local = start;
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        local = start + i * TEST_SYNC_PERIOD;
+        model->addSample(local, clock.at(local));
+    }
+    return local;
+}
+
+static void testUnsynced()
+{
+    ClockModel model;
+    CHECK(!model.isSynced());
+    CHECK(model.toReference(1234567) == 1234567000);
+}
+
+static void testFirstSampleAnchors()
+{
+    ClockModel model;
+    model.addSample(1000000, TEST_EPOCH);
+    CHECK(model.isSynced());
+    CHECK(model.getDrift() == 0);
+    CHECK(model.toReference(1000000) == TEST_EPOCH);
+    CHECK(model.toReference(3000000) == TEST_EPOCH + 2000000000);
+}
+
+/**
+ * The model learns the clock's drift from exact syncs
+ */
+static void checkDrift(const SkewedClock &clock)
+{
+    ClockModel model;
+    const int64_t last = train(&model, clock, 5000000, 10);
+    CHECK(absolute(model.getDrift() - clock.drift) <= 1);
+    // Extrapolated a whole period past the last sync, it is still within a us
+    const int64_t later = last + TEST_SYNC_PERIOD;
+    CHECK(absolute(model.toReference(later) - clock.at(later)) < 1000);
+    CHECK(absolute(model.getLastError()) < 1000);
+}
+
+static void testDriftEstimation()
+{
+    checkDrift({TEST_EPOCH, 40000});
+    checkDrift({TEST_EPOCH, -25000});
+}
+
+static void testNoisyDriftEstimation()
+{
+    const SkewedClock clock = {TEST_EPOCH, 30000};
+    ClockModel model;
+    uint32_t state = 1;
+    int64_t local = 0;
+    for (uint32_t i = 0; i < 60; i++)
+    {
+        local = i * TEST_SYNC_PERIOD;
+        model.addSample(local, clock.at(local) + jitter(&state, 300000));
+    }
+    // 300 us of error on each sync over a 10 s period, the filter keeps the drift to a few ppm
+    CHECK(absolute(model.getDrift() - clock.drift) < 5000);
+    for (int64_t later = local; later < local + TEST_SYNC_PERIOD; later += TEST_SYNC_PERIOD / 10)
+    {
+        CHECK(absolute(model.toReference(later) - clock.at(later)) < 500000);
+    }
+    CHECK(model.getOutliers() == 0);
+}
+
+static void testSlewIsMonotonic()
+{
+    const SkewedClock clock = {TEST_EPOCH, 0};
+    ClockModel model;
+    int64_t local = train(&model, clock, 0, 3);
+
+    // A sync that says the model is 1 ms ahead is slewed in, time slows down instead of going back
+    local += TEST_SYNC_PERIOD;
+    model.addSample(local, clock.at(local) - 1000000);
+    CHECK(model.getLastError() == -1000000);
+    CHECK(model.toReference(local) == clock.at(local));
+    int64_t previous = model.toReference(local);
+    bool increasing = true;
+    for (int64_t time = local + 1; time <= local + TIME_SYNC_SLEW_TIME + 1000; time += 7)
+    {
+        const int64_t reference = model.toReference(time);
+        increasing = increasing && reference > previous;
+        previous = reference;
+    }
+    CHECK(increasing);
+    // The error also moves the drift estimate an eighth of the way to 100 ppm, 25 us over the slew
+    const int64_t slewed = local + TIME_SYNC_SLEW_TIME;
+    CHECK(absolute(model.toReference(slewed) - (clock.at(slewed) - 1000000)) <= 25000);
+}
+
+static void testOutlierIgnored()
+{
+    const SkewedClock clock = {TEST_EPOCH, 20000};
+    ClockModel model;
+    int64_t local = train(&model, clock, 0, 5);
+    const ClockModel before = model;
+
+    // The answer sat behind telemetry for 30 ms
+    local += TEST_SYNC_PERIOD;
+    model.addSample(local, clock.at(local) + 30000000);
+    CHECK(model.getOutliers() == 1);
+    CHECK(absolute(model.getLastError() - 30000000) < 1000);
+    CHECK(model.getDrift() == before.getDrift());
+    CHECK(model.toReference(local + 1000000) == before.toReference(local + 1000000));
+
+    // The next good sync is measured against the last one that was used
+    local += TEST_SYNC_PERIOD;
+    model.addSample(local, clock.at(local));
+    CHECK(model.getOutliers() == 1);
+    CHECK(absolute(model.getLastError()) < 1000);
+    CHECK(absolute(model.getDrift() - clock.drift) <= 1);
+
+    // A held up answer is also ignored when it makes the clock look behind
+    local += TEST_SYNC_PERIOD;
+    model.addSample(local, clock.at(local) - 10000000);
+    CHECK(model.getOutliers() == 2);
+    CHECK(absolute(model.toReference(local) - clock.at(local)) < 1000);
+}
+
+static void testLastingChangeIsUsed()
+{
+    // The reference clock steps by a second, then by 20 ms, and stays there
+    SkewedClock clock = {TEST_EPOCH, 0};
+    ClockModel model;
+    int64_t local = train(&model, clock, 0, 3);
+
+    clock.offset += 1000000000;
+    for (uint32_t i = 0; i < TIME_SYNC_MAX_OUTLIERS; i++)
+    {
+        local += TEST_SYNC_PERIOD;
+        model.addSample(local, clock.at(local));
+        CHECK(absolute(model.toReference(local) - (clock.at(local) - 1000000000)) < 1000);
+    }
+    // Stepped, since it is past the step threshold
+    local += TEST_SYNC_PERIOD;
+    model.addSample(local, clock.at(local));
+    CHECK(model.toReference(local) == clock.at(local));
+    CHECK(model.getOutliers() == TIME_SYNC_MAX_OUTLIERS);
+    local = train(&model, clock, local + TEST_SYNC_PERIOD, 3);
+
+    clock.offset += 20000000;
+    for (uint32_t i = 0; i <= TIME_SYNC_MAX_OUTLIERS; i++)
+    {
+        local += TEST_SYNC_PERIOD;
+        model.addSample(local, clock.at(local));
+    }
+    // Slewed, since it is under the step threshold
+    CHECK(absolute(model.toReference(local) - (clock.at(local) - 20000000)) < 1000);
+    // Measured over the ignored syncs too, the change moves the drift estimate by about 80 ppm
+    const int64_t slewed = local + TIME_SYNC_SLEW_TIME;
+    CHECK(absolute(model.toReference(slewed) - clock.at(slewed)) < 200000);
+    CHECK(model.getOutliers() == 2 * TIME_SYNC_MAX_OUTLIERS);
+}
+
+static void testSyncWithAgent()
+{
+    // Held still, so the clock can't tick between syncTime reading the agent's time and its own
+    hostTimerTime = 5000000;
+    initTimeSync();
+    hostAgentAnswers = false;
+    hostAgentOffset = TEST_EPOCH;
+    CHECK(!syncTime());
+    CHECK(!isTimeSynced());
+    CHECK(toEpochNanos(2500000) == 2500000000);
+
+    hostAgentAnswers = true;
+    CHECK(syncTime());
+    CHECK(isTimeSynced());
+    builtin_interfaces__msg__Time stamp = {};
+    toStamp(2500000, &stamp);
+    CHECK(stamp.sec == (int32_t) ((TEST_EPOCH + 2500000000) / 1000000000));
+    CHECK(stamp.nanosec == (uint32_t) ((TEST_EPOCH + 2500000000) % 1000000000));
+    stampNow(&stamp);
+    CHECK(absolute((int64_t) stamp.sec * 1000000000 + stamp.nanosec - getEpochNanos()) < 1000000000);
+    hostTimerTime = 0;
+}
+
+int main()
+{
+    runTest("unsynced", testUnsynced);
+    runTest("first sample anchors", testFirstSampleAnchors);
+    runTest("drift estimation", testDriftEstimation);
+    runTest("noisy drift estimation", testNoisyDriftEstimation);
+    runTest("slew is monotonic", testSlewIsMonotonic);
+    runTest("outlier ignored", testOutlierIgnored);
+    runTest("lasting change is used", testLastingChangeIsUsed);
+    runTest("sync with agent", testSyncWithAgent);
+    return testResult();
+}
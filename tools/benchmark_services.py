@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""
+Measures the round trip time of the pcc's services, from the host sending a request to the response arriving.
+
+Each service is called at a fixed rate without waiting for earlier calls, so queueing in the agent, the link and the
+executor shows up in the numbers. The results are printed as JSON, one entry per service with the calls that
+succeeded, failed or got no response, the latency percentiles in ms and the achieved throughput of the calls that
+succeeded, plus the firmware's own callback stats from /pcc/callback_stats.
+
+/laser/fire fires the real laser, so it is only called on the simulation or with --fire-laser.
+
+The pcc can be real hardware on a serial port, or the simulation build, which this script can start together with
+a micro-ROS agent on a pseudo terminal:
+
+    tools/benchmark_services.py --sim build/avr_pcc_2023.elf --agent > baseline.json
+"""
+
+import argparse
+import importlib
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from pathlib import Path
+
+# Service name: (module, type, request fields)
+SERVICES = {
+    "/laser/fire": ("std_srvs.srv", "Trigger", {}),
+    "/servo/set_position": ("avr_pcc_2023_interfaces.srv", "SetServo", {"servo_num": 0, "value": 128}),
+    "/led_strip/set": ("avr_pcc_2023_interfaces.srv", "SetLedStrip",
+                       {"mode": 0, "argument": 0, "color.r": 0, "color.g": 0, "color.b": 255}),
+}
+# Fires the laser on real hardware, so it is only called with --sim or --fire-laser
+LASER_SERVICE = "/laser/fire"
+# The pcc reboots after a reset, so it is only called once, after everything else
+RESET_SERVICE = "/pcc/reset"
+CALLBACK_STATS_SERVICE = "/pcc/callback_stats"
+
+
+def percentile(values: list[float], fraction: float) -> float:
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def load_type(module: str, name: str):
+    return getattr(importlib.import_module(module), name)
+
+
+def make_request(service_type, fields: dict):
+    request = service_type.Request()
+    for path, value in fields.items():
+        target = request
+        *parents, name = path.split(".")
+        for parent in parents:
+            target = getattr(target, parent)
+        setattr(target, name, value)
+    return request
+
+
+def succeeded(response) -> bool:
+    """
+    Whether the pcc reports that the call worked. Responses without a success field count as working
+    """
+    return getattr(response, "success", True)
+
+
+def summarize(latencies: list[float], sent: int, failed: int, duration: float) -> dict:
+    """
+    Latencies are only of the calls that succeeded, a failed call can return before doing the work
+    """
+    result = {"sent": sent, "succeeded": len(latencies), "failed": failed, "lost": sent - len(latencies) - failed}
+    if latencies and duration > 0:
+        result.update({"p50_ms": round(statistics.median(latencies), 3),
+                       "p99_ms": round(percentile(latencies, 0.99), 3),
+                       "max_ms": round(max(latencies), 3),
+                       "throughput_hz": round(len(latencies) / duration, 2)})
+    return result
+
+
+def benchmark(client, request, rate: float, count: int, timeout: float) -> dict:
+    """
+    Send count requests at rate Hz and wait for the responses, the executor has to be spinning in another thread
+    """
+    latencies = []
+    failed = 0
+    last_response = 0.0
+    lock = threading.Lock()
+    pending = []
+
+    def on_done(sent_time: float):
+        def callback(future):
+            nonlocal failed, last_response
+            response = future.result()
+            if response is None:
+                return
+            with lock:
+                if succeeded(response):
+                    last_response = time.perf_counter()
+                    latencies.append((last_response - sent_time) * 1000)
+                else:
+                    failed += 1
+        return callback
+
+    start = time.perf_counter()
+    for i in range(count):
+        delay = start + i / rate - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+        sent_time = time.perf_counter()
+        future = client.call_async(request)
+        future.add_done_callback(on_done(sent_time))
+        pending.append(future)
+
+    deadline = time.perf_counter() + timeout
+    while time.perf_counter() < deadline and not all(future.done() for future in pending):
+        time.sleep(0.01)
+    for future in pending:
+        if not future.done():
+            client.remove_pending_request(future)
+
+    with lock:
+        return summarize(list(latencies), count, failed, last_response - start)
+
+
+def call_once(client, request, timeout: float):
+    event = threading.Event()
+    sent_time = time.perf_counter()
+    future = client.call_async(request)
+    future.add_done_callback(lambda _: event.set())
+    if not event.wait(timeout):
+        client.remove_pending_request(future)
+        return None, None
+    return future.result(), (time.perf_counter() - sent_time) * 1000
+
+
+def start_processes(args) -> list[subprocess.Popen]:
+    processes = []
+    if args.sim is not None:
+        # The sim links the pty once its uart is installed, so a stale link would be mistaken for it
+        args.device.unlink(missing_ok=True)
+        environment = dict(os.environ, PCC_SIM_SERIAL=str(args.device))
+        processes.append(subprocess.Popen([str(args.sim)], env=environment,
+                                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+        deadline = time.monotonic() + 10
+        while not args.device.exists():
+            if time.monotonic() > deadline:
+                raise SystemExit(f"The simulation didn't create {args.device}")
+            time.sleep(0.1)
+    if args.agent:
+        processes.append(subprocess.Popen(["ros2", "run", "micro_ros_agent", "micro_ros_agent",
+                                           "serial", "--dev", str(args.device), "-b", str(args.baud)],
+                                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+    return processes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sim", type=Path, help="start this simulation build of the firmware")
+    parser.add_argument("--agent", action="store_true", help="start a micro-ROS agent on --device")
+    parser.add_argument("--device", type=Path, default=Path(tempfile.gettempdir()) / "pcc_benchmark_serial",
+                        help="serial port of the pcc, or where the simulation links its pty")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--rate", type=float, action="append",
+                        help="call rate in Hz, can be given more than once (default 10 and 50)")
+    parser.add_argument("--count", type=int, default=200, help="calls per service and rate")
+    parser.add_argument("--timeout", type=float, default=2.0, help="seconds to wait for late responses")
+    parser.add_argument("--service", action="append", choices=sorted(SERVICES), help="only benchmark these")
+    parser.add_argument("--fire-laser", action="store_true",
+                        help="also call /laser/fire on a real pcc, which fires the laser every call")
+    parser.add_argument("--reset", action="store_true", help="also time one call to /pcc/reset at the end")
+    args = parser.parse_args()
+    rates = args.rate or [10.0, 50.0]
+
+    names = args.service or sorted(SERVICES)
+    if args.sim is None and not args.fire_laser:
+        if LASER_SERVICE in names and args.service:
+            parser.error(f"{LASER_SERVICE} fires the laser, pass --fire-laser to call it on a real pcc")
+        names = [name for name in names if name != LASER_SERVICE]
+
+    processes = start_processes(args)
+
+    import rclpy
+    from rclpy.executors import SingleThreadedExecutor
+    from rclpy.node import Node
+
+    rclpy.init()
+    node = Node("pcc_benchmark")
+    executor = SingleThreadedExecutor()
+    executor.add_node(node)
+    spin_thread = threading.Thread(target=executor.spin, daemon=True)
+    spin_thread.start()
+
+    trigger = load_type("std_srvs.srv", "Trigger")
+    results = {"rates_hz": rates, "count": args.count, "target": "sim" if args.sim is not None else str(args.device),
+               "services": {}}
+    try:
+        for name in names:
+            module, type_name, fields = SERVICES[name]
+            service_type = load_type(module, type_name)
+            client = node.create_client(service_type, name)
+            if not client.wait_for_service(timeout_sec=30):
+                print(f"{name} is not available, skipping it", file=sys.stderr)
+                continue
+            request = make_request(service_type, fields)
+            results["services"][name] = {str(rate): benchmark(client, request, rate, args.count, args.timeout)
+                                         for rate in rates}
+            print(f"Benchmarked {name}", file=sys.stderr)
+
+        stats_client = node.create_client(trigger, CALLBACK_STATS_SERVICE)
+        if stats_client.wait_for_service(timeout_sec=5):
+            response, _ = call_once(stats_client, trigger.Request(), args.timeout)
+            if response is not None:
+                results["callback_stats"] = response.message
+
+        if args.reset:
+            reset_client = node.create_client(trigger, RESET_SERVICE)
+            if reset_client.wait_for_service(timeout_sec=5):
+                response, latency = call_once(reset_client, trigger.Request(), args.timeout)
+                results["services"][RESET_SERVICE] = {"completed": response is not None,
+                                                      "succeeded": response is not None and succeeded(response),
+                                                      "latency_ms": round(latency, 3) if latency else None}
+    finally:
+        executor.shutdown()
+        node.destroy_node()
+        rclpy.try_shutdown()
+        for process in reversed(processes):
+            process.terminate()
+            process.wait()
+
+    json.dump(results, sys.stdout, indent=2)
+    print()
+
+
+if __name__ == "__main__":
+    main()
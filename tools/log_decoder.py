@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Expands the pcc's binary log records (CONFIG_PCC_BINARY_LOG) back into rcl_interfaces/Log messages on /rosout.
+
+Log sites are identified by the FNV-1a hash of "<file name>:<line>", the same as logSiteId in binary_log.hpp,
+so the decoder scans the firmware sources to find every site and the text of literal messages.
+Run it against the sources the firmware was built from, otherwise the line numbers won't match.
+"""
+
+import argparse
+import re
+import struct
+from pathlib import Path
+
+SOURCE_SUFFIXES = {".c", ".cpp", ".h", ".hpp"}
+SITE_PATTERN = re.compile(r"\b(LOG|HANDLE_ROS_ERROR|HANDLE_ESP_ERROR)\s*\(")
+LITERAL_LOG_PATTERN = re.compile(r'\bLOG\s*\(\s*LOGLEVEL_\w+\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+RECORD_HEADER = struct.Struct("<IBB")
+
+# Messages from the ESP-IDF log bridge use this pseudo site
+SYSTEM_SITE = ("SYS", 0)
+
+
+def site_id(file_name: str, line: int) -> int:
+    value = 2166136261
+    for byte in f"{file_name}:{line}".encode():
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+class LogSite:
+    def __init__(self, file_name: str, line: int, message: str | None):
+        self.file_name = file_name
+        self.line = line
+        self.message = message
+
+
+def scan_sources(source_dir: Path) -> dict[int, LogSite]:
+    sites = {site_id(*SYSTEM_SITE): LogSite(*SYSTEM_SITE, None)}
+    for path in sorted(source_dir.rglob("*")):
+        if path.suffix not in SOURCE_SUFFIXES or not path.is_file():
+            continue
+        for line_number, text in enumerate(path.read_text(errors="replace").splitlines(), start=1):
+            if SITE_PATTERN.search(text) is None:
+                continue
+            literal = LITERAL_LOG_PATTERN.search(text)
+            message = literal.group(1).encode().decode("unicode_escape") if literal is not None else None
+            sites[site_id(path.name, line_number)] = LogSite(path.name, line_number, message)
+    return sites
+
+
+def decode_packet(packet: bytes, sites: dict[int, LogSite]):
+    """
+    Yields (level, file name, line, message) for each record in a packet
+    """
+    offset = 0
+    while offset + RECORD_HEADER.size <= len(packet):
+        site, level, length = RECORD_HEADER.unpack_from(packet, offset)
+        offset += RECORD_HEADER.size
+        payload = packet[offset:offset + length].decode(errors="replace")
+        offset += length
+
+        log_site = sites.get(site)
+        if log_site is None:
+            yield level, "", 0, payload or f"<unknown log site {site:08x}>"
+        else:
+            yield level, log_site.file_name, log_site.line, payload or log_site.message or ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sources", type=Path, default=Path(__file__).resolve().parent.parent / "main",
+                        help="firmware source directory to scan for log sites")
+    parser.add_argument("--topic", default="/pcc/log_binary")
+    args = parser.parse_args()
+
+    import rclpy
+    from rclpy.node import Node
+    from rcl_interfaces.msg import Log
+    from std_msgs.msg import UInt8MultiArray
+
+    sites = scan_sources(args.sources)
+
+    rclpy.init()
+    node = Node("pcc_log_decoder")
+    publisher = node.create_publisher(Log, "/rosout", 100)
+    node.get_logger().info(f"Found {len(sites)} log sites in {args.sources}")
+
+    def on_packet(message: UInt8MultiArray):
+        stamp = node.get_clock().now().to_msg()
+        for level, file_name, line, text in decode_packet(bytes(message.data), sites):
+            publisher.publish(Log(stamp=stamp, level=level, name="PCC", msg=text, file=file_name, line=line))
+
+    node.create_subscription(UInt8MultiArray, args.topic, on_packet, 100)
+    try:
+        rclpy.spin(node)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        node.destroy_node()
+        rclpy.try_shutdown()
+
+
+if __name__ == "__main__":
+    main()
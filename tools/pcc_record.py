@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+Saves and replays the pcc's recordings (CONFIG_PCC_RECORDING).
+
+record: saves the records the pcc publishes on /pcc/recording to a file. The file starts with the magic below,
+followed by the records exactly as they were published.
+
+replay: calls the recorded services and publishes the recorded commands, with the same timing as the recording. Run
+the simulation build with $PCC_SIM_REPLAY set to the same file, and the sensors answer with the recorded reads too.
+
+Service requests are recorded as a name and the request fields packed little endian, the layouts below have to match
+the recordServiceRequest calls in the firmware.
+"""
+
+import argparse
+import importlib
+import struct
+import time
+from pathlib import Path
+
+MAGIC = b"PCCREC\x01\x00"
+RECORD_HEADER = struct.Struct("<BBHI")
+
+RECORD_I2C_READ = 1
+RECORD_SERVICE_REQUEST = 2
+RECORD_GAP = 3
+
+# Service name: (module, type, fields as (name, struct format))
+SERVICES = {
+    "/laser/fire": ("std_srvs.srv", "Trigger", []),
+    "/laser/set_loop": ("std_srvs.srv", "SetBool", [("data", "?")]),
+    "/laser/fire_pattern": ("std_srvs.srv", "Trigger", []),
+    "/laser/cancel_pattern": ("std_srvs.srv", "Trigger", []),
+    "/servo/enable": ("std_srvs.srv", "SetBool", [("data", "?")]),
+    "/servo/set_position": ("avr_pcc_2023_interfaces.srv", "SetServo", [("servo_num", "B"), ("value", "B")]),
+    "/led_strip/set": ("avr_pcc_2023_interfaces.srv", "SetLedStrip",
+                       [("mode", "B"), ("argument", "B"),
+                        ("color.r", "B"), ("color.g", "B"), ("color.b", "B"),
+                        ("secondary_color.r", "B"), ("secondary_color.g", "B"), ("secondary_color.b", "B")]),
+}
+
+# Topic name: (module, type, struct format of one element), the payload is the whole data array
+TOPICS = {
+    "/laser/pattern": ("std_msgs.msg", "UInt16MultiArray", "H"),
+    "/thermal/roi_config": ("std_msgs.msg", "UInt8MultiArray", "B"),
+}
+
+
+def read_records(data: bytes):
+    """
+    Yields (type, time in ms, payload) for each record in a recording
+    """
+    offset = 0
+    while offset + RECORD_HEADER.size <= len(data):
+        record_type, _, length, record_time = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        if offset + length > len(data):
+            break
+        yield record_type, record_time, data[offset:offset + length]
+        offset += length
+
+
+def parse_request(payload: bytes) -> tuple[str, bytes]:
+    name_length = payload[0]
+    return payload[1:1 + name_length].decode(), payload[1 + name_length:]
+
+
+def set_field(message, path: str, value):
+    *parents, name = path.split(".")
+    for parent in parents:
+        message = getattr(message, parent)
+    setattr(message, name, value)
+
+
+def load_type(module: str, name: str):
+    return getattr(importlib.import_module(module), name)
+
+
+def record(args):
+    import rclpy
+    from rclpy.node import Node
+    from std_msgs.msg import UInt8MultiArray
+
+    rclpy.init()
+    node = Node("pcc_recorder")
+    counts = {RECORD_I2C_READ: 0, RECORD_SERVICE_REQUEST: 0, RECORD_GAP: 0}
+
+    with args.file.open("wb") as file:
+        file.write(MAGIC)
+
+        def on_chunk(message: UInt8MultiArray):
+            chunk = bytes(message.data)
+            file.write(chunk)
+            file.flush()
+            for record_type, _, payload in read_records(chunk):
+                if record_type == RECORD_GAP:
+                    node.get_logger().warn(f"The pcc dropped {struct.unpack('<I', payload)[0]} records")
+                counts[record_type] = counts.get(record_type, 0) + 1
+
+        node.create_subscription(UInt8MultiArray, args.topic, on_chunk, 100)
+        node.get_logger().info(f"Recording {args.topic} to {args.file}")
+        try:
+            rclpy.spin(node)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            print(f"{counts[RECORD_I2C_READ]} i2c reads, {counts[RECORD_SERVICE_REQUEST]} requests, "
+                  f"{counts[RECORD_GAP]} gaps")
+            node.destroy_node()
+            rclpy.try_shutdown()
+
+
+def replay(args):
+    import rclpy
+    from rclpy.node import Node
+
+    data = args.file.read_bytes()
+    if not data.startswith(MAGIC):
+        raise SystemExit(f"{args.file} is not a pcc recording")
+    requests = [(record_time, *parse_request(payload))
+                for record_type, record_time, payload in read_records(data[len(MAGIC):])
+                if record_type == RECORD_SERVICE_REQUEST]
+    if not requests:
+        raise SystemExit(f"{args.file} has no requests to replay")
+
+    rclpy.init()
+    node = Node("pcc_replay")
+    clients = {name: node.create_client(load_type(module, type_name), name)
+               for name, (module, type_name, _) in SERVICES.items()}
+    publishers = {name: node.create_publisher(load_type(module, type_name), name, 10)
+                  for name, (module, type_name, _) in TOPICS.items()}
+
+    start_time = time.monotonic()
+    first_time = requests[0][0]
+    try:
+        for record_time, name, fields in requests:
+            delay = start_time + (record_time - first_time) / 1000 / args.speed - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+
+            if name in TOPICS:
+                module, type_name, element = TOPICS[name]
+                message = load_type(module, type_name)()
+                message.data = list(struct.unpack(f"<{len(fields) // struct.calcsize(element)}{element}", fields))
+                publishers[name].publish(message)
+                print(f"{record_time:>10} {name} {list(message.data)}")
+                continue
+
+            if name not in SERVICES:
+                node.get_logger().warn(f"Skipping {name}, its layout is unknown")
+                continue
+            module, type_name, layout = SERVICES[name]
+            request = load_type(module, type_name).Request()
+            values = struct.unpack("<" + "".join(field_format for _, field_format in layout), fields)
+            for (field, _), value in zip(layout, values):
+                set_field(request, field, value)
+
+            client = clients[name]
+            if not client.wait_for_service(timeout_sec=args.timeout):
+                node.get_logger().warn(f"{name} is not available")
+                continue
+            future = client.call_async(request)
+            rclpy.spin_until_future_complete(node, future, timeout_sec=args.timeout)
+            print(f"{record_time:>10} {name} {values} -> {future.result()}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        node.destroy_node()
+        rclpy.try_shutdown()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    subparsers = parser.add_subparsers(required=True)
+
+    record_parser = subparsers.add_parser("record", help="save the pcc's recording to a file")
+    record_parser.add_argument("file", type=Path)
+    record_parser.add_argument("--topic", default="/pcc/recording")
+    record_parser.set_defaults(func=record)
+
+    replay_parser = subparsers.add_parser("replay", help="send the recorded requests again")
+    replay_parser.add_argument("file", type=Path)
+    replay_parser.add_argument("--speed", type=float, default=1.0, help="replay this many times faster")
+    replay_parser.add_argument("--timeout", type=float, default=2.0, help="seconds to wait for each service")
+    replay_parser.set_defaults(func=replay)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()